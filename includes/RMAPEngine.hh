@@ -158,7 +158,7 @@ public:
 				rmapTargetAcessAction->processTransaction(&rmapTransaction);
 				rmapTransaction.setState(RMAPTransaction::ReplySet);
 			} catch (...) {
-				delete rmapTransaction.commandPacket;
+				rmapEngine->releaseRMAPPacket(rmapTransaction.commandPacket);
 				rmapEngine->receivedCommandPacketDiscarded();
 				isCompleted_ = true;
 				return;
@@ -170,13 +170,13 @@ public:
 			} catch (...) {
 				rmapTargetAcessAction->transactionReplyCouldNotBeSent(&rmapTransaction);
 				rmapEngine->replyToReceivedCommandPacketCouldNotBeSent();
-				delete rmapTransaction.commandPacket;
+				rmapEngine->releaseRMAPPacket(rmapTransaction.commandPacket);
 				isCompleted_ = true;
 				return;
 			}
 			rmapTargetAcessAction->transactionWillComplete(&rmapTransaction);
 			rmapTransaction.setState(RMAPTransaction::ReplyCompleted);
-			delete rmapTransaction.commandPacket;
+			rmapEngine->releaseRMAPPacket(rmapTransaction.commandPacket);
 			isCompleted_ = true;
 		}
 
@@ -202,6 +202,31 @@ public:
 		}
 	};
 
+public:
+	/** Counts outages of a SpaceWireIF which reconnects by itself.
+	 * The engine keeps running during an outage; commands sent during the
+	 * outage are queued by the SpaceWireIF, and transactions whose replies
+	 * were lost time out in RMAPInitiator as usual.
+	 */
+	class RMAPEngineSpaceWireIFActionLinkStateAction: public SpaceWireIFActionLinkStateAction {
+	private:
+		RMAPEngine* rmapEngine;
+
+	public:
+		RMAPEngineSpaceWireIFActionLinkStateAction(RMAPEngine* rmapEngine) {
+			this->rmapEngine = rmapEngine;
+		}
+
+	public:
+		void linkLost(SpaceWireIF* spwif) {
+			rmapEngine->nSpaceWireIFLinkLosses++;
+		}
+
+		void linkRestored(SpaceWireIF* spwif) {
+			rmapEngine->nSpaceWireIFLinkRestorations++;
+		}
+	};
+
 private:
 	std::map<uint16_t, RMAPTransaction*> transactions;
 	CxxUtilities::Mutex transactionIDMutex;
@@ -222,6 +247,7 @@ private:
 
 private:
 	RMAPEngineSpaceWireIFActionCloseAction* spacewireIFActionCloseAction;
+	RMAPEngineSpaceWireIFActionLinkStateAction* spacewireIFActionLinkStateAction;
 
 public:
 	bool stopped;
@@ -234,9 +260,12 @@ public:
 	size_t nErrorneousCommandPackets;
 	size_t nTransactionsAbortedWhenReplying;
 	size_t nErrorInRMAPReplyPacketProcessing;
+	size_t nSpaceWireIFLinkLosses;
+	size_t nSpaceWireIFLinkRestorations;
 
 private:
 	bool stopActionsHasBeenExecuted;
+	bool reportErrorneousReplyPackets;
 
 public:
 	RMAPEngine() {
@@ -252,7 +281,9 @@ public:
 
 public:
 	~RMAPEngine() {
-
+		for (size_t i = 0; i < freeRMAPPackets.size(); i++) {
+			delete freeRMAPPackets[i];
+		}
 	}
 
 private:
@@ -265,8 +296,10 @@ private:
 		transactionIDMutex.unlock();
 		stopped = true;
 		spacewireIFActionCloseAction = NULL;
+		spacewireIFActionLinkStateAction = NULL;
 		stopActionsHasBeenExecuted = false;
 		useDraftECRC = false;
+		reportErrorneousReplyPackets = true;
 		//initialize counters
 		initializeCounters();
 	}
@@ -278,6 +311,8 @@ private:
 		nErrorneousCommandPackets = 0;
 		nTransactionsAbortedWhenReplying = 0;
 		nErrorInRMAPReplyPacketProcessing = 0;
+		nSpaceWireIFLinkLosses = 0;
+		nSpaceWireIFLinkRestorations = 0;
 	}
 
 public:
@@ -289,13 +324,16 @@ public:
 		spwif->setTimeoutDuration(DefaultReceiveTimeoutDurationInMicroSec);
 		while (!stopped) {
 			try {
-				RMAPPacket* rmapPacket = receivePacket();
-				if (rmapPacket == NULL) {
-					//do nothing
-				} else if (rmapPacket->isCommand()) {
-					rmapCommandPacketReceived(rmapPacket);
-				} else {
-					rmapReplyPacketReceived(rmapPacket);
+				//packets which arrived in a burst are processed in one wakeup
+				receivePackets();
+				for (size_t i = 0; i < receivedRMAPPackets.size(); i++) {
+					RMAPPacket* rmapPacket = receivedRMAPPackets[i];
+					receivedRMAPPackets[i] = NULL;
+					if (rmapPacket->isCommand()) {
+						rmapCommandPacketReceived(rmapPacket);
+					} else {
+						rmapReplyPacketReceived(rmapPacket);
+					}
 				}
 			} catch (RMAPPacketException& e) {
 				cerr << "RMAPEngine::run() got RMAPPacketException " << e.toString() << endl;
@@ -305,6 +343,12 @@ public:
 				break;
 			}
 		}
+		for (size_t i = 0; i < receivedRMAPPackets.size(); i++) {
+			if (receivedRMAPPackets[i] != NULL) {
+				releaseRMAPPacket(receivedRMAPPackets[i]);
+			}
+		}
+		receivedRMAPPackets.clear();
 		stopped = true;
 		invokeRegisteredStopActions();
 		hasStopped = true;
@@ -364,7 +408,7 @@ private:
 				return;
 			}
 		}
-		delete commandPacket;
+		releaseRMAPPacket(commandPacket);
 		receivedCommandPacketDiscarded();
 	}
 
@@ -393,17 +437,15 @@ private:
 				//if not found, increment error counter
 				nErrorneousReplyPackets++;
 				discardedRMAPReplyPackets.push_back(packet);
-				std::cerr << "RMAP Reply packet was received but no corresponding transaction was found." << std::endl;
-				std::cerr << "RMAPEngine tries to recover normal operation, but may fail continuously." << std::endl;
+				if (reportErrorneousReplyPackets) {
+					std::cerr << "RMAP Reply packet was received but no corresponding transaction was found." << std::endl;
+					std::cerr << "RMAPEngine tries to recover normal operation, but may fail continuously." << std::endl;
+				}
 				return;
 			}
-			//register reply packet to the resolved transaction
-			transaction->replyPacket = packet;
-			//update transaction state
-			transaction->setState(RMAPTransaction::ReplyReceived);
-			if (!transaction->isNonblockingMode) {
-				transaction->getCondition()->signal();
-			}
+			//register reply packet to the resolved transaction, update transaction state,
+			//and wake up the initiator waiting for the reply
+			transaction->setReplyReceived(packet);
 		} catch (CxxUtilities::MutexException& e) {
 			std::cerr << "Fatal error in RMAPEngine::rmapReplyPacketReceived()... :-(" << std::endl;
 			std::cerr << "RMAPEngine tries to recover normal operation, but may fail continuously." << std::endl;
@@ -433,13 +475,18 @@ private:
 	bool useDraftECRC;
 
 private:
-	RMAPPacket* receivePacket() throw (RMAPEngineException) {
+	/** Receives packets which are available via SpaceWireIF::receiveBatch(), and
+	 * stores them to receivedRMAPPackets. Packets terminated with EEP and packets
+	 * which cannot be interpreted as RMAP packets are discarded.
+	 * receivedRMAPPackets is empty after a timeout.
+	 */
+	void receivePackets() throw (RMAPEngineException) {
 		using namespace std;
-		std::vector<uint8_t>* buffer = new std::vector<uint8_t>;
+		receivedRMAPPackets.clear();
+		size_t nPackets;
 		try {
-			spwif->receive(buffer);
+			nPackets = spwif->receiveBatch(receiveBuffers, receiveEOPTypes, MaximumNumberOfPacketsPerReceive);
 		} catch (SpaceWireIFException& e) {
-			delete buffer;
 			//cout << e.toString() << endl;
 			if (e.status == SpaceWireIFException::Disconnected) {
 				//tell run() that SpaceWireIF is disconnected
@@ -447,31 +494,91 @@ private:
 			} else {
 				if (e.status == SpaceWireIFException::Timeout) {
 					//cout << "#receive timeout" << endl;
-					return NULL;
+					return;
 				} else {
 					//tell run() that SpaceWireIF is disconnected
 					throw RMAPEngineException(RMAPEngineException::SpaceWireIFDisconnected);
 				}
 			}
 		}
-		RMAPPacket* packet = new RMAPPacket();
-		if (!useDraftECRC) {
-			packet->setUseDraftECRC(false);
-		} else {
-			packet->setUseDraftECRC(true);
+		const std::vector<SpaceWireReceiveTimestamp>& timestamps = spwif->getReceivedPacketTimestamps();
+		RMAPPacket* packet = NULL;
+		for (size_t i = 0; i < nPackets; i++) {
+			if (receiveEOPTypes[i] == SpaceWireEOPMarker::EEP) {
+				//a packet terminated with EEP may be truncated, and is not interpreted
+				receivedPacketDiscarded();
+				continue;
+			}
+			//an instance which failed interpretation is reused for the next packet
+			if (packet == NULL) {
+				packet = leaseRMAPPacket();
+			}
+			packet->setUseDraftECRC(useDraftECRC);
+			try {
+				packet->interpretAsAnRMAPPacket(&receiveBuffers[i]);
+			} catch (RMAPPacketException& e) {
+				receivedPacketDiscarded();
+				continue;
+			}
+			if (i < timestamps.size()) {
+				packet->setReceiveTimestamp(timestamps[i]);
+			}
+			receivedRMAPPackets.push_back(packet);
+			packet = NULL;
 		}
-		try {
-			packet->interpretAsAnRMAPPacket(buffer);
-		} catch (RMAPPacketException& e) {
-			delete packet;
-			delete buffer;
-			receivedPacketDiscarded();
-			return NULL;
-		}
-		delete buffer;
+		if (packet != NULL) {
+			releaseRMAPPacket(packet);
+		}
+	}
+
+public:
+	/** Gives back an RMAPPacket instance which was received by this engine
+	 * (e.g. a reply packet passed to RMAPInitiator, or a command packet passed
+	 * to RMAPTargetProcessThread). The instance is reused for a later received
+	 * packet instead of being deleted. NULL is ignored.
+	 */
+	void releaseRMAPPacket(RMAPPacket* packet) {
+		if (packet == NULL) {
+			return;
+		}
+		freeRMAPPacketsMutex.lock();
+		if (freeRMAPPackets.size() < MaximumNumberOfFreeRMAPPackets) {
+			freeRMAPPackets.push_back(packet);
+			packet = NULL;
+		}
+		freeRMAPPacketsMutex.unlock();
+		delete packet;
+	}
+
+private:
+	/** Returns a released RMAPPacket instance reset to the initial state, or a new instance. */
+	RMAPPacket* leaseRMAPPacket() {
+		RMAPPacket* packet = NULL;
+		freeRMAPPacketsMutex.lock();
+		if (freeRMAPPackets.size() != 0) {
+			packet = freeRMAPPackets.back();
+			freeRMAPPackets.pop_back();
+		}
+		freeRMAPPacketsMutex.unlock();
+		if (packet == NULL) {
+			return new RMAPPacket();
+		}
+		//vectors assigned from the empty ones of a new instance keep their capacity
+		*packet = RMAPPacket();
 		return packet;
 	}
 
+private:
+	std::vector<std::vector<uint8_t> > receiveBuffers;
+	std::vector<SpaceWireEOPMarker::EOPType> receiveEOPTypes;
+	std::vector<RMAPPacket*> receivedRMAPPackets;
+	std::vector<RMAPPacket*> freeRMAPPackets;
+	CxxUtilities::Mutex freeRMAPPacketsMutex;
+
+public:
+	static const size_t MaximumNumberOfPacketsPerReceive = 64;
+	static const size_t MaximumNumberOfFreeRMAPPackets = 256;
+
 private:
 	RMAPTransaction* resolveTransaction(RMAPPacket* packet) throw (RMAPEngineException) {
 		using namespace std;
@@ -527,8 +634,18 @@ public:
 		commandPacket->setTransactionID(transactionID);
 		commandPacket->constructPacket();
 		if (isStarted()) {
-			sendPacket(commandPacket->getPacketBufferPointer());
+			//state should be updated before sending, since the reply may arrive
+			//(and be set to this transaction) before sendPacket() returns
 			transaction->state = RMAPTransaction::Initiated;
+			try {
+				sendPacket(commandPacket->getPacketBufferPointer());
+			} catch (RMAPEngineException& e) {
+				if (transaction->commandPacket->isReplyFlagSet()) {
+					deleteTransactionIDFromDB(transactionID);
+				}
+				transaction->state = RMAPTransaction::NotInitiated;
+				throw;
+			}
 		} else {
 			throw RMAPEngineException(RMAPEngineException::RMAPEngineIsNotStarted);
 		}
@@ -577,6 +694,10 @@ public:
 			spacewireIFActionCloseAction = new RMAPEngineSpaceWireIFActionCloseAction(this);
 		}
 		this->spwif->addSpaceWireIFCloseAction(spacewireIFActionCloseAction);
+		if (spacewireIFActionLinkStateAction == NULL) {
+			spacewireIFActionLinkStateAction = new RMAPEngineSpaceWireIFActionLinkStateAction(this);
+		}
+		this->spwif->addLinkStateAction(spacewireIFActionLinkStateAction);
 	}
 
 	SpaceWireIF * getSpaceWireIF() {
@@ -668,6 +789,16 @@ public:
 		this->useDraftECRC = useDraftEcrc;
 	}
 
+public:
+	/** Enables or disables the messages printed to std::cerr when a reply packet
+	 * without a corresponding transaction is received (e.g. the reply to a timed-out
+	 * transaction on a lossy link). Such packets are counted in nErrorneousReplyPackets
+	 * either way.
+	 */
+	void setReportErrorneousReplyPackets(bool reportErrorneousReplyPackets = true) {
+		this->reportErrorneousReplyPackets = reportErrorneousReplyPackets;
+	}
+
 public:
 	size_t getNTransactions() {
 		return transactions.size();
@@ -43,6 +43,8 @@
 #include "RMAPProtocol.hh"
 #include "RMAPMemoryObject.hh"
 
+#include "CxxUtilities/Time.hh"
+
 class RMAPInitiatorException: public CxxUtilities::Exception {
 public:
 	enum {
@@ -186,18 +188,19 @@ public:
 			delete commandPacket;
 		}
 		if (replyPacket != NULL) {
-			deleteReplyPacket();
+			delete replyPacket;
 		}
 	}
 
 public:
+	/** Gives the reply packet of the last transaction back to RMAPEngine for reuse. */
 	void deleteReplyPacket() {
 		deleteReplyPacketMutex.lock();
 		if (replyPacket == NULL) {
 			deleteReplyPacketMutex.unlock();
 			return;
 		}
-		delete replyPacket;
+		rmapEngine->releaseRMAPPacket(replyPacket);
 		replyPacket = NULL;
 		deleteReplyPacketMutex.unlock();
 	}
@@ -338,7 +341,7 @@ public:
 			transaction.state = RMAPTransaction::NotInitiated;
 			throw RMAPInitiatorException(RMAPInitiatorException::RMAPTransactionCouldNotBeInitiated);
 		}
-		transaction.condition.wait(timeoutDuration);
+		transaction.waitReply(timeoutDuration);
 		if (transaction.state == RMAPTransaction::ReplyReceived) {
 			replyPacket = transaction.replyPacket;
 			transaction.replyPacket = NULL;
@@ -634,11 +637,11 @@ public:
 				throw RMAPInitiatorException(RMAPInitiatorException::RMAPTransactionCouldNotBeInitiated);
 			}
 		}
-		transaction.state = RMAPTransaction::CommandSent;
 
 		//if reply is expected
-		transaction.condition.wait(timeoutDuration);
-		if (transaction.state == RMAPTransaction::CommandSent) {
+		//(state is not changed to CommandSent here, because the reply may already have been received)
+		transaction.waitReply(timeoutDuration);
+		if (transaction.state == RMAPTransaction::Initiated) {
 			if (replyMode) {
 				unlock();
 				//cancel transaction (return transaction ID)
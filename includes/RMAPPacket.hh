@@ -272,9 +272,35 @@ public:
 	}
 
 public:
+	/** Constructs the packet into the internal buffer (see getPacketBufferPointer()).
+	 * The buffer is resized to the exact packet size and is reused, so that
+	 * constructing packets of the same size does not allocate memory.
+	 */
 	void constructPacket() {
-		using namespace std;
+		wholePacket.resize(getPacketSize());
+		serialize(&(wholePacket[0]));
+	}
+
+	/** Constructs the packet into a caller-supplied buffer without using the internal buffer.
+	 * @returns the packet size.
+	 * @throws RMAPPacketException::InsufficientBufferSize if bufferSize is smaller than getPacketSize().
+	 */
+	size_t constructPacket(uint8_t* buffer, size_t bufferSize) throw (RMAPPacketException) {
+		size_t packetSize = getPacketSize();
+		if (bufferSize < packetSize) {
+			throw RMAPPacketException(RMAPPacketException::InsufficientBufferSize);
+		}
+		serialize(buffer);
+		return packetSize;
+	}
 
+	/** Constructs the packet into the internal buffer in the way constructPacket() did
+	 * before it wrote packets in one pass: constructHeader() builds the header vector,
+	 * and the path address, header, data, and data CRC are then concatenated.
+	 * The result is identical to constructPacket(). This method is kept as the baseline
+	 * of test_RMAPPacket_constructBenchmark.
+	 */
+	void constructPacketByConcatenation() {
 		constructHeader();
 		if (dataCRCMode == RMAPPacket::AutoCRC) {
 			calculateDataCRC();
@@ -292,6 +318,107 @@ public:
 		}
 	}
 
+	/** Returns the size of the packet created by constructPacket()
+	 * (path address, header, header CRC, data, and data CRC).
+	 */
+	size_t getPacketSize() {
+		size_t size;
+		if (isCommand()) {
+			size = targetSpaceWireAddress.size() + CommandHeaderSizeWithoutReplyAddress
+					+ (replyAddress.size() + 3) / 4 * 4;
+		} else {
+			size = replyAddress.size() + WriteReplyHeaderSize;
+			if (isRead()) {
+				size = replyAddress.size() + ReadReplyHeaderSize;
+			}
+		}
+		size++; //header CRC
+		if (hasData()) {
+			size += data.size() + 1;
+		}
+		return size;
+	}
+
+private:
+	static const size_t CommandHeaderSizeWithoutReplyAddress = 15;
+	static const size_t ReadReplyHeaderSize = 11;
+	static const size_t WriteReplyHeaderSize = 7;
+
+	/** Writes the packet in one pass (the same layout as constructHeader() and the header member).
+	 * buffer should have getPacketSize() bytes.
+	 */
+	void serialize(uint8_t* buffer) {
+		uint8_t* p = buffer;
+		if (isCommand()) {
+			p = copyBytes(p, targetSpaceWireAddress);
+		} else {
+			p = copyBytes(p, replyAddress);
+		}
+		uint8_t* headerStart = p;
+		if (isCommand()) {
+			*p++ = targetLogicalAddress;
+			*p++ = protocolID;
+			*p++ = instruction;
+			*p++ = key;
+			for (size_t i = replyAddress.size(); i % 4 != 0; i++) {
+				*p++ = 0x00;
+			}
+			p = copyBytes(p, replyAddress);
+			*p++ = initiatorLogicalAddress;
+			*p++ = (uint8_t) (transactionID >> 8);
+			*p++ = (uint8_t) transactionID;
+			*p++ = extendedAddress;
+			*p++ = (uint8_t) (address >> 24);
+			*p++ = (uint8_t) (address >> 16);
+			*p++ = (uint8_t) (address >> 8);
+			*p++ = (uint8_t) address;
+			*p++ = (uint8_t) (dataLength >> 16);
+			*p++ = (uint8_t) (dataLength >> 8);
+			*p++ = (uint8_t) dataLength;
+		} else {
+			*p++ = initiatorLogicalAddress;
+			*p++ = protocolID;
+			*p++ = instruction;
+			*p++ = status;
+			*p++ = targetLogicalAddress;
+			*p++ = (uint8_t) (transactionID >> 8);
+			*p++ = (uint8_t) transactionID;
+			if (isRead()) {
+				*p++ = 0;
+				*p++ = (uint8_t) (dataLength >> 16);
+				*p++ = (uint8_t) (dataLength >> 8);
+				*p++ = (uint8_t) dataLength;
+			}
+		}
+		if (headerCRCMode == RMAPPacket::AutoCRC) {
+			headerCRC = calculateCRC(headerStart, p - headerStart);
+		}
+		*p++ = headerCRC;
+		if (hasData()) {
+			uint8_t* dataStart = p;
+			p = copyBytes(p, data);
+			if (dataCRCMode == RMAPPacket::AutoCRC) {
+				dataCRC = calculateCRC(dataStart, data.size());
+			}
+			*p++ = dataCRC;
+		}
+	}
+
+	inline uint8_t calculateCRC(uint8_t* bytes, size_t length) {
+		if (!useDraftECRC) {
+			return RMAPUtilities::calculateCRC(bytes, length);
+		} else {
+			return RMAPUtilities::calculateCRCBasedOnDraftESpecification(bytes, length);
+		}
+	}
+
+	static inline uint8_t* copyBytes(uint8_t* p, const std::vector<uint8_t>& bytes) {
+		if (bytes.size() != 0) {
+			memcpy(p, &(bytes[0]), bytes.size());
+		}
+		return p + bytes.size();
+	}
+
 public:
 	void interpretAsAnRMAPPacket(uint8_t *packet, size_t length) throw (RMAPPacketException) {
 		using namespace std;
@@ -787,10 +914,7 @@ public:
 
 public:
 	void setData(uint8_t *data, size_t length) {
-		this->data.clear();
-		for (size_t i = 0; i < length; i++) {
-			this->data.push_back(data[i]);
-		}
+		this->data.assign(data, data + length);
 		this->dataLength = length;
 	}
 
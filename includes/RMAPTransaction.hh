@@ -37,6 +37,45 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CxxUtilities/CxxUtilities.hh"
 #include "RMAPPacket.hh"
 
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+
+/** A mutex and a condition variable which guard the reply of an RMAPTransaction.
+ * RMAPTransaction is copied by value, and a copy gets its own mutex and condition
+ * variable instead of sharing (or copying) those of the original.
+ */
+class RMAPTransactionReplyLock {
+public:
+	pthread_mutex_t mutex;
+	pthread_cond_t condition;
+
+public:
+	RMAPTransactionReplyLock() {
+		initialize();
+	}
+
+	RMAPTransactionReplyLock(const RMAPTransactionReplyLock& other) {
+		initialize();
+	}
+
+	~RMAPTransactionReplyLock() {
+		pthread_cond_destroy(&condition);
+		pthread_mutex_destroy(&mutex);
+	}
+
+public:
+	RMAPTransactionReplyLock& operator=(const RMAPTransactionReplyLock& other) {
+		return *this;
+	}
+
+private:
+	void initialize() {
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&condition, NULL);
+	}
+};
+
 class RMAPTransaction {
 public:
 	uint8_t targetLogicalAddress;
@@ -59,6 +98,9 @@ public:
 	RMAPPacket* commandPacket;
 	RMAPPacket* replyPacket;
 
+private:
+	RMAPTransactionReplyLock replyLock;
+
 public:
 	RMAPTransaction() {
 		timeoutDuration = DefaultTimeoutDuration;
@@ -132,6 +174,39 @@ public:
 		this->state = state;
 	}
 
+	/** Registers the reply packet, sets the state to ReplyReceived, and wakes up
+	 * the thread waiting in waitReply(). The state is updated under the same mutex
+	 * as waitReply() checks it, so the wakeup cannot be lost.
+	 */
+	void setReplyReceived(RMAPPacket* replyPacket) {
+		pthread_mutex_lock(&replyLock.mutex);
+		this->replyPacket = replyPacket;
+		this->state = ReplyReceived;
+		pthread_cond_broadcast(&replyLock.condition);
+		pthread_mutex_unlock(&replyLock.mutex);
+	}
+
+	/** Waits until the state becomes ReplyReceived (see setReplyReceived()), or the timeout.
+	 * @param[in] timeoutInMilliSec maximum waiting time.
+	 * @returns true if the reply has been received.
+	 */
+	bool waitReply(double timeoutInMilliSec) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		long long nanoSec = (long long) (timeoutInMilliSec * 1000000) + deadline.tv_nsec;
+		deadline.tv_sec += nanoSec / 1000000000;
+		deadline.tv_nsec = nanoSec % 1000000000;
+		pthread_mutex_lock(&replyLock.mutex);
+		while (state != ReplyReceived) {
+			if (pthread_cond_timedwait(&replyLock.condition, &replyLock.mutex, &deadline) == ETIMEDOUT) {
+				break;
+			}
+		}
+		bool received = (state == ReplyReceived);
+		pthread_mutex_unlock(&replyLock.mutex);
+		return received;
+	}
+
 	void setTargetLogicalAddress(uint8_t targetLogicalAddress) {
 		this->targetLogicalAddress = targetLogicalAddress;
 	}
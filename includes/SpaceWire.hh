@@ -36,13 +36,32 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "CxxUtilities/CommonHeader.hh"
 
+#include "SpaceWireCaptureFile.hh"
 #include "SpaceWireEOPMarker.hh"
 #include "SpaceWirePacket.hh"
+#include "SpaceWirePacketBufferPool.hh"
 #include "SpaceWireIF.hh"
+#include "SpaceWireIFAsync.hh"
+#include "SpaceWireIFFaultInjector.hh"
+#include "SpaceWireIFLinkBonding.hh"
+#include "SpaceWireIFLinkRateEmulator.hh"
+#include "SpaceWireIFMultiplexer.hh"
 #include "SpaceWireIFOverTCP.hh"
+#include "SpaceWireIFOverLoopback.hh"
+#include "SpaceWireIFOverSharedMemory.hh"
 #include "SpaceWireIFOverIPClient.hh"
+#include "SpaceWireIFOverCaptureFile.hh"
+#include "SpaceWireLockFreeQueue.hh"
 #include "SpaceWireProtocol.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+#include "SpaceWireSSDTPProtocol.hh"
+#include "SpaceWireSSDTPBuffer.hh"
+#include "SpaceWireSSDTPDecoder.hh"
+#include "SpaceWireSSDTPEncoder.hh"
 #include "SpaceWireSSDTPModule.hh"
+#include "SpaceWireSSDTPReactor.hh"
+#include "SpaceWireTap.hh"
+#include "SpaceWireTimecodeDispatcher.hh"
 #include "SpaceWireUtilities.hh"
 
 #endif /* SPACEWIRE_HH_ */
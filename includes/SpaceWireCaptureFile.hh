@@ -0,0 +1,594 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireCaptureFile.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPACEWIRECAPTUREFILE_HH_
+#define SPACEWIRECAPTUREFILE_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Exception.hh"
+#include "CxxUtilities/Mutex.hh"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "SpaceWireEOPMarker.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+
+/** An exception class used by SpaceWireCaptureWriter and SpaceWireCaptureReader.
+ */
+class SpaceWireCaptureFileException: public CxxUtilities::Exception {
+public:
+	enum {
+		OpeningFailed, //
+		NotOpened, //
+		InvalidFormat, //
+		WriteFailed, //
+		DataSizeTooLarge, //
+		Undefined
+	};
+
+public:
+	SpaceWireCaptureFileException(uint32_t status) :
+			CxxUtilities::Exception(status) {
+	}
+
+public:
+	virtual ~SpaceWireCaptureFileException() {
+	}
+
+public:
+	std::string toString() {
+		std::string result;
+		switch (status) {
+		case OpeningFailed:
+			result = "OpeningFailed";
+			break;
+		case NotOpened:
+			result = "NotOpened";
+			break;
+		case InvalidFormat:
+			result = "InvalidFormat";
+			break;
+		case WriteFailed:
+			result = "WriteFailed";
+			break;
+		case DataSizeTooLarge:
+			result = "DataSizeTooLarge";
+			break;
+		case Undefined:
+			result = "Undefined";
+			break;
+		default:
+			result = "Undefined status";
+			break;
+		}
+		return result;
+	}
+};
+
+/** Layout of SpaceWire capture files.
+ * A capture file is a file header followed by records. All integers are little endian.
+ *
+ * File header (32 bytes):
+ * - magic "SpWCaptr" (8 bytes)
+ * - format version (uint16, currently 1), file header size (uint16)
+ * - reserved (uint32)
+ * - CLOCK_REALTIME at time 0 of the record timestamps in ns (uint64)
+ * - reserved (uint64)
+ *
+ * Record (16-byte header, followed by the payload padded to a multiple of 8 bytes):
+ * - timestamp in ns since time 0 of the file (uint64)
+ * - payload length (uint32)
+ * - type (uint8, DataEOP, DataEEP, or TimeCode)
+ * - TimeCode value (uint8, 0 for data)
+ * - flags (uint16, FlagSent and FlagTruncated; 0 in files written before the flags were defined)
+ *
+ * FlagSent marks packets sent by the local node (records without it were received).
+ * FlagTruncated marks packets of which only the first length bytes were captured.
+ *
+ * Records are only appended. A record which was partially written (e.g. when
+ * the recorder was killed) is ignored by the reader, and is cut off by the
+ * writer when the file is opened again, so that new records follow the last
+ * whole record.
+ */
+class SpaceWireCaptureFileFormat {
+public:
+	static const size_t FileHeaderSize = 32;
+	static const size_t RecordHeaderSize = 16;
+	static const size_t Alignment = 8;
+	static const uint16_t Version = 1;
+	static const uint32_t MaximumPayloadSize = 0x7fffffff;
+
+public:
+	enum {
+		DataEOP = 0x00, DataEEP = 0x01, TimeCode = 0x02
+	};
+
+public:
+	enum {
+		FlagSent = 0x0001, FlagTruncated = 0x0002
+	};
+
+public:
+	static const char* getMagic() {
+		return "SpWCaptr";
+	}
+
+	static size_t getPaddedSize(size_t length) {
+		return (length + Alignment - 1) / Alignment * Alignment;
+	}
+
+public:
+	static void encode(uint8_t* p, uint64_t value, size_t nBytes) {
+		for (size_t i = 0; i < nBytes; i++) {
+			p[i] = (uint8_t) (value >> (8 * i));
+		}
+	}
+
+	static uint64_t decode(const uint8_t* p, size_t nBytes) {
+		uint64_t value = 0;
+		for (size_t i = 0; i < nBytes; i++) {
+			value |= (uint64_t) p[i] << (8 * i);
+		}
+		return value;
+	}
+};
+
+/** A record read from a capture file.
+ * data points into the memory-mapped file, and is valid while the reader is opened.
+ */
+class SpaceWireCaptureRecord {
+public:
+	uint64_t timestampInNanoSec;
+	uint8_t type;
+	uint8_t timecode;
+	uint16_t flags;
+	const uint8_t* data;
+	size_t length;
+
+public:
+	bool isData() const {
+		return type == SpaceWireCaptureFileFormat::DataEOP || type == SpaceWireCaptureFileFormat::DataEEP;
+	}
+
+	bool isTimeCode() const {
+		return type == SpaceWireCaptureFileFormat::TimeCode;
+	}
+
+	/** Returns true if the packet was sent by the local node (e.g. captured by SpaceWireTap). */
+	bool isSent() const {
+		return (flags & SpaceWireCaptureFileFormat::FlagSent) != 0;
+	}
+
+	/** Returns true if only the first length bytes of the packet were captured. */
+	bool isTruncated() const {
+		return (flags & SpaceWireCaptureFileFormat::FlagTruncated) != 0;
+	}
+
+	SpaceWireEOPMarker::EOPType getEOPType() const {
+		return (type == SpaceWireCaptureFileFormat::DataEEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP;
+	}
+};
+
+/** Appends packets and TimeCodes to a capture file.
+ * Records are accumulated in a buffer and are written with one write()
+ * per bufferSize bytes (and on flush() and close()), so that recording does
+ * not add a system call per packet to the receive loop.
+ * When the file already exists, records are appended to it (after cutting off
+ * a partially written record at the end of the file). Timestamps are
+ * measured with CLOCK_MONOTONIC, and are aligned to time 0 of the file via
+ * CLOCK_REALTIME once per open().
+ * Methods can be called from multiple threads.
+ * @code
+ * SpaceWireCaptureWriter writer("traffic.spwcap");
+ * writer.open();
+ * while (...) {
+ * 	spwif->receive(&packet);
+ * 	writer.writePacket(&packet[0], packet.size(), SpaceWireEOPMarker::EOP, spwif->getReceivedPacketTimestamp());
+ * }
+ * writer.close();
+ * @endcode
+ */
+class SpaceWireCaptureWriter {
+public:
+	static const size_t DefaultBufferSize = 4 * 1024 * 1024;
+
+private:
+	std::string fileName;
+	int fileDescriptor;
+	std::vector<uint8_t> buffer;
+	size_t bufferedSize;
+	CxxUtilities::Mutex mutex;
+
+private:
+	/* record timestamp = sessionOffsetInNanoSec + (monotonic time - sessionStartInNanoSec) */
+	uint64_t sessionStartInNanoSec;
+	uint64_t sessionOffsetInNanoSec;
+
+private:
+	size_t nWrittenRecords;
+	uint64_t nWrittenBytes;
+
+public:
+	SpaceWireCaptureWriter(std::string fileName, size_t bufferSize = DefaultBufferSize) :
+			fileName(fileName), fileDescriptor(-1), buffer(bufferSize), bufferedSize(0) {
+		sessionStartInNanoSec = 0;
+		sessionOffsetInNanoSec = 0;
+		nWrittenRecords = 0;
+		nWrittenBytes = 0;
+	}
+
+	~SpaceWireCaptureWriter() {
+		try {
+			close();
+		} catch (...) {
+		}
+	}
+
+private:
+	SpaceWireCaptureWriter(const SpaceWireCaptureWriter&);
+	SpaceWireCaptureWriter& operator=(const SpaceWireCaptureWriter&);
+
+public:
+	/** Opens (or creates) the file. */
+	void open() throw (SpaceWireCaptureFileException) {
+		if (fileDescriptor >= 0) {
+			return;
+		}
+		int descriptor = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+		if (descriptor < 0) {
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::OpeningFailed);
+		}
+		uint64_t nowMonotonic = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+		uint64_t nowRealtime = SpaceWireReceiveTimestamp::getRealtimeClockInNanoSec();
+		uint8_t header[SpaceWireCaptureFileFormat::FileHeaderSize];
+		ssize_t result = ::pread(descriptor, header, sizeof(header), 0);
+		uint64_t fileOriginRealtime;
+		if (result == 0) {
+			//new file
+			memset(header, 0, sizeof(header));
+			memcpy(header, SpaceWireCaptureFileFormat::getMagic(), 8);
+			SpaceWireCaptureFileFormat::encode(header + 8, SpaceWireCaptureFileFormat::Version, 2);
+			SpaceWireCaptureFileFormat::encode(header + 10, SpaceWireCaptureFileFormat::FileHeaderSize, 2);
+			SpaceWireCaptureFileFormat::encode(header + 16, nowRealtime, 8);
+			if (::write(descriptor, header, sizeof(header)) != (ssize_t) sizeof(header)) {
+				::close(descriptor);
+				throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::WriteFailed);
+			}
+			fileOriginRealtime = nowRealtime;
+		} else if (result == (ssize_t) sizeof(header) && memcmp(header, SpaceWireCaptureFileFormat::getMagic(), 8) == 0) {
+			fileOriginRealtime = SpaceWireCaptureFileFormat::decode(header + 16, 8);
+			if (!truncatePartialRecord(descriptor, SpaceWireCaptureFileFormat::decode(header + 10, 2))) {
+				::close(descriptor);
+				throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::InvalidFormat);
+			}
+		} else {
+			::close(descriptor);
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::InvalidFormat);
+		}
+		mutex.lock();
+		fileDescriptor = descriptor;
+		bufferedSize = 0;
+		//records of this session are placed after the existing ones on the realtime axis
+		//(if the system time has gone back since the file was created, they start at time 0)
+		sessionStartInNanoSec = nowMonotonic;
+		sessionOffsetInNanoSec = (fileOriginRealtime <= nowRealtime) ? nowRealtime - fileOriginRealtime : 0;
+		mutex.unlock();
+	}
+
+	/** Writes buffered records and closes the file. */
+	void close() throw (SpaceWireCaptureFileException) {
+		mutex.lock();
+		if (fileDescriptor < 0) {
+			mutex.unlock();
+			return;
+		}
+		bool succeeded = writeBuffer();
+		::close(fileDescriptor);
+		fileDescriptor = -1;
+		mutex.unlock();
+		if (!succeeded) {
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::WriteFailed);
+		}
+	}
+
+	bool isOpened() const {
+		return fileDescriptor >= 0;
+	}
+
+public:
+	/** Appends a packet.
+	 * @param[in] timestamp receive timestamp of the packet (if not valid, the current time is used).
+	 * @param[in] flags SpaceWireCaptureFileFormat::FlagSent and/or FlagTruncated.
+	 */
+	void writePacket(const uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType,
+			const SpaceWireReceiveTimestamp& timestamp = SpaceWireReceiveTimestamp(), uint16_t flags = 0)
+			throw (SpaceWireCaptureFileException) {
+		if (SpaceWireCaptureFileFormat::MaximumPayloadSize < length) {
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::DataSizeTooLarge);
+		}
+		uint8_t type =
+				(eopType == SpaceWireEOPMarker::EEP) ? SpaceWireCaptureFileFormat::DataEEP : SpaceWireCaptureFileFormat::DataEOP;
+		writeRecord(type, 0, data, length, timestamp, flags);
+	}
+
+	void writePacket(const std::vector<uint8_t>& packet, SpaceWireEOPMarker::EOPType eopType,
+			const SpaceWireReceiveTimestamp& timestamp = SpaceWireReceiveTimestamp()) throw (SpaceWireCaptureFileException) {
+		writePacket((packet.size() != 0) ? &packet[0] : NULL, packet.size(), eopType, timestamp);
+	}
+
+	/** Appends a TimeCode (stamped with the current time unless a timestamp is given). */
+	void writeTimeCode(uint8_t timecode, const SpaceWireReceiveTimestamp& timestamp = SpaceWireReceiveTimestamp())
+			throw (SpaceWireCaptureFileException) {
+		writeRecord(SpaceWireCaptureFileFormat::TimeCode, timecode, NULL, 0, timestamp, 0);
+	}
+
+	/** Writes buffered records to the file. */
+	void flush() throw (SpaceWireCaptureFileException) {
+		mutex.lock();
+		if (fileDescriptor < 0) {
+			mutex.unlock();
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::NotOpened);
+		}
+		bool succeeded = writeBuffer();
+		mutex.unlock();
+		if (!succeeded) {
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::WriteFailed);
+		}
+	}
+
+public:
+	size_t getNWrittenRecords() const {
+		return nWrittenRecords;
+	}
+
+	/** Returns the number of bytes written to the file by this instance (excluding the file header). */
+	uint64_t getNWrittenBytes() const {
+		return nWrittenBytes;
+	}
+
+private:
+	void writeRecord(uint8_t type, uint8_t timecode, const uint8_t* data, size_t length,
+			const SpaceWireReceiveTimestamp& timestamp, uint16_t flags) throw (SpaceWireCaptureFileException) {
+		uint64_t time = timestamp.isValid() ? timestamp.monotonicInNanoSec
+				: SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+		size_t paddedSize = SpaceWireCaptureFileFormat::getPaddedSize(length);
+		size_t recordSize = SpaceWireCaptureFileFormat::RecordHeaderSize + paddedSize;
+		mutex.lock();
+		if (fileDescriptor < 0) {
+			mutex.unlock();
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::NotOpened);
+		}
+		if (buffer.size() - bufferedSize < recordSize) {
+			if (!writeBuffer()) {
+				mutex.unlock();
+				throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::WriteFailed);
+			}
+			if (buffer.size() < recordSize) {
+				buffer.resize(recordSize);
+			}
+		}
+		uint8_t* p = &buffer[bufferedSize];
+		uint64_t offset = sessionOffsetInNanoSec + time - sessionStartInNanoSec;
+		if (time < sessionStartInNanoSec && sessionOffsetInNanoSec < sessionStartInNanoSec - time) {
+			offset = 0;
+		}
+		SpaceWireCaptureFileFormat::encode(p, offset, 8);
+		SpaceWireCaptureFileFormat::encode(p + 8, length, 4);
+		p[12] = type;
+		p[13] = timecode;
+		SpaceWireCaptureFileFormat::encode(p + 14, flags, 2);
+		if (length != 0) {
+			memcpy(p + SpaceWireCaptureFileFormat::RecordHeaderSize, data, length);
+		}
+		memset(p + SpaceWireCaptureFileFormat::RecordHeaderSize + length, 0, paddedSize - length);
+		bufferedSize += recordSize;
+		nWrittenRecords++;
+		mutex.unlock();
+	}
+
+	/** Scans the records of an existing file, and truncates the file at the end
+	 * of the last whole record, so that appended records are not hidden behind
+	 * a partially written one.
+	 * @returns false if the file cannot be scanned or truncated.
+	 */
+	static bool truncatePartialRecord(int descriptor, size_t headerSize) {
+		struct stat status;
+		if (::fstat(descriptor, &status) != 0 || (size_t) status.st_size < headerSize) {
+			return false;
+		}
+		size_t fileSize = status.st_size;
+		if (fileSize == headerSize) {
+			return true;
+		}
+		void* mapped = ::mmap(NULL, fileSize, PROT_READ, MAP_SHARED, descriptor, 0);
+		if (mapped == MAP_FAILED) {
+			return false;
+		}
+		::madvise(mapped, fileSize, MADV_SEQUENTIAL);
+		const uint8_t* file = (const uint8_t*) mapped;
+		size_t position = headerSize;
+		while (SpaceWireCaptureFileFormat::RecordHeaderSize <= fileSize - position) {
+			size_t length = SpaceWireCaptureFileFormat::decode(file + position + 8, 4);
+			size_t recordSize = SpaceWireCaptureFileFormat::RecordHeaderSize
+					+ SpaceWireCaptureFileFormat::getPaddedSize(length);
+			if (fileSize - position < recordSize) {
+				break;
+			}
+			position += recordSize;
+		}
+		::munmap(mapped, fileSize);
+		if (position == fileSize) {
+			return true;
+		}
+		return ::ftruncate(descriptor, position) == 0;
+	}
+
+	/** Writes the buffer (mutex must be locked). */
+	bool writeBuffer() {
+		size_t written = 0;
+		while (written < bufferedSize) {
+			ssize_t result = ::write(fileDescriptor, &buffer[written], bufferedSize - written);
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			written += result;
+		}
+		nWrittenBytes += bufferedSize;
+		bufferedSize = 0;
+		return true;
+	}
+};
+
+/** Reads a capture file via mmap().
+ * Payload of the records is not copied; SpaceWireCaptureRecord::data points
+ * into the mapped file. The reader sees the records which existed when open() was called.
+ */
+class SpaceWireCaptureReader {
+private:
+	std::string fileName;
+	const uint8_t* mappedFile;
+	size_t fileSize;
+	size_t position;
+	uint64_t originRealtimeInNanoSec;
+
+public:
+	SpaceWireCaptureReader(std::string fileName) :
+			fileName(fileName), mappedFile(NULL), fileSize(0), position(0), originRealtimeInNanoSec(0) {
+	}
+
+	~SpaceWireCaptureReader() {
+		close();
+	}
+
+private:
+	SpaceWireCaptureReader(const SpaceWireCaptureReader&);
+	SpaceWireCaptureReader& operator=(const SpaceWireCaptureReader&);
+
+public:
+	void open() throw (SpaceWireCaptureFileException) {
+		if (mappedFile != NULL) {
+			return;
+		}
+		int descriptor = ::open(fileName.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::OpeningFailed);
+		}
+		struct stat status;
+		if (::fstat(descriptor, &status) != 0 || status.st_size < (off_t) SpaceWireCaptureFileFormat::FileHeaderSize) {
+			::close(descriptor);
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::InvalidFormat);
+		}
+		void* mapped = ::mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+		::close(descriptor);
+		if (mapped == MAP_FAILED) {
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::OpeningFailed);
+		}
+		const uint8_t* header = (const uint8_t*) mapped;
+		size_t headerSize = SpaceWireCaptureFileFormat::decode(header + 10, 2);
+		if (memcmp(header, SpaceWireCaptureFileFormat::getMagic(), 8) != 0
+				|| SpaceWireCaptureFileFormat::decode(header + 8, 2) != SpaceWireCaptureFileFormat::Version
+				|| headerSize < SpaceWireCaptureFileFormat::FileHeaderSize || (size_t) status.st_size < headerSize) {
+			::munmap(mapped, status.st_size);
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::InvalidFormat);
+		}
+		::madvise(mapped, status.st_size, MADV_SEQUENTIAL);
+		mappedFile = header;
+		fileSize = status.st_size;
+		position = headerSize;
+		originRealtimeInNanoSec = SpaceWireCaptureFileFormat::decode(header + 16, 8);
+	}
+
+	void close() {
+		if (mappedFile != NULL) {
+			::munmap((void*) mappedFile, fileSize);
+			mappedFile = NULL;
+		}
+	}
+
+	bool isOpened() const {
+		return mappedFile != NULL;
+	}
+
+public:
+	/** Reads the next record.
+	 * @returns false at the end of the file.
+	 */
+	bool next(SpaceWireCaptureRecord& record) throw (SpaceWireCaptureFileException) {
+		if (mappedFile == NULL) {
+			throw SpaceWireCaptureFileException(SpaceWireCaptureFileException::NotOpened);
+		}
+		if (fileSize - position < SpaceWireCaptureFileFormat::RecordHeaderSize) {
+			return false;
+		}
+		const uint8_t* p = mappedFile + position;
+		size_t length = SpaceWireCaptureFileFormat::decode(p + 8, 4);
+		size_t recordSize = SpaceWireCaptureFileFormat::RecordHeaderSize + SpaceWireCaptureFileFormat::getPaddedSize(length);
+		if (fileSize - position < recordSize) {
+			return false; //partially written record
+		}
+		record.timestampInNanoSec = SpaceWireCaptureFileFormat::decode(p, 8);
+		record.length = length;
+		record.type = p[12];
+		record.timecode = p[13];
+		record.flags = SpaceWireCaptureFileFormat::decode(p + 14, 2);
+		record.data = p + SpaceWireCaptureFileFormat::RecordHeaderSize;
+		position += recordSize;
+		return true;
+	}
+
+	/** Goes back to the first record. */
+	void rewind() {
+		if (mappedFile != NULL) {
+			position = SpaceWireCaptureFileFormat::decode(mappedFile + 10, 2);
+		}
+	}
+
+public:
+	/** Returns CLOCK_REALTIME at time 0 of the record timestamps. */
+	uint64_t getOriginRealtimeInNanoSec() const {
+		return originRealtimeInNanoSec;
+	}
+
+	size_t getFileSize() const {
+		return fileSize;
+	}
+};
+
+#endif /* SPACEWIRECAPTUREFILE_HH_ */
@@ -37,6 +37,12 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <CxxUtilities/CommonHeader.hh>
 #include <CxxUtilities/Exception.hh>
 #include "SpaceWireEOPMarker.hh"
+#include "SpaceWirePacketBufferPool.hh"
+#include "SpaceWireIFAsync.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+#include "SpaceWireTap.hh"
+
+#include <sched.h>
 
 class SpaceWireIFException: public CxxUtilities::Exception {
 public:
@@ -47,7 +53,8 @@ public:
 		EEP,
 		ReceiveBufferTooSmall,
 		FunctionNotImplemented,
-		LinkIsNotOpened
+		LinkIsNotOpened,
+		PacketTooLarge
 	};
 public:
 	SpaceWireIFException(uint32_t status) :
@@ -82,6 +89,9 @@ public:
 		case LinkIsNotOpened:
 			result = "LinkIsNotOpened";
 			break;
+		case PacketTooLarge:
+			result = "PacketTooLarge";
+			break;
 		default:
 			result = "Undefined status";
 			break;
@@ -119,6 +129,25 @@ public:
 	virtual void doAction(SpaceWireIF* spwif) = 0;
 };
 
+/** An abstract class which includes methods invoked when a SpaceWire
+ * interface which reconnects by itself (e.g. SpaceWireIFOverTCP in
+ * AutoReconnect mode) has lost or restored its connection.
+ * The interface stays opened during the outage, so that users such as
+ * RMAPEngine can keep running instead of being torn down.
+ */
+class SpaceWireIFActionLinkStateAction: public SpaceWireIFAction {
+public:
+	/** Invoked when the connection has been lost and reconnection has started.
+	 * @param[in] spwif parent SpaceWireIF instance
+	 */
+	virtual void linkLost(SpaceWireIF* spwif) = 0;
+
+	/** Invoked when the connection has been restored (and queued packets have been sent).
+	 * @param[in] spwif parent SpaceWireIF instance
+	 */
+	virtual void linkRestored(SpaceWireIF* spwif) = 0;
+};
+
 /** An abstract class for encapsulation of a SpaceWire interface.
  *  This class provides virtual methods for opening/closing the interface
  *  and sending/receiving a packet via the interface.
@@ -129,8 +158,12 @@ class SpaceWireIF {
 protected:
 	std::vector<SpaceWireIFActionTimecodeScynchronizedAction*> timecodeSynchronizedActions;
 	std::vector<SpaceWireIFActionCloseAction*> spacewireIFCloseActions;
+	std::vector<SpaceWireIFActionLinkStateAction*> linkStateActions;
 	bool isTerminatedWithEEP_;
 	bool isTerminatedWithEOP_;
+	SpaceWireReceiveTimestamp receivedPacketTimestamp;
+	std::vector<SpaceWireReceiveTimestamp> receivedPacketTimestamps;
+	bool realtimeTimestampEnabled;
 
 public:
 	enum OpenCloseState {
@@ -143,6 +176,14 @@ protected:
 protected:
 	bool eepShouldBeReportedAsAnException_; //default false (no exception)
 
+protected:
+	SpaceWirePacketBufferPool* packetBufferPool;
+	SpaceWireIFCompletionQueue* completionQueue;
+
+private:
+	SpaceWireTap* volatile tap;
+	volatile size_t nTapCallsInProgress;
+
 public:
 	enum EOPType {
 		EOP = 0x00, EEP = 0x01, Undefined = 0xffff
@@ -154,6 +195,11 @@ public:
 		isTerminatedWithEEP_ = false;
 		isTerminatedWithEOP_ = false;
 		eepShouldBeReportedAsAnException_ = false;
+		realtimeTimestampEnabled = false;
+		packetBufferPool = SpaceWirePacketBufferPool::getSharedInstance();
+		completionQueue = NULL;
+		tap = NULL;
+		nTapCallsInProgress = 0;
 	}
 
 public:
@@ -228,7 +274,7 @@ public:
 public:
 	virtual void receive(uint8_t* buffer, SpaceWireEOPMarker::EOPType& eopType, size_t maxLength, size_t& length)
 			throw (SpaceWireIFException) {
-		std::vector<uint8_t>* packet = this->receive();
+		std::vector<uint8_t>* packet = this->receiveLeased();
 		size_t packetSize = packet->size();
 		if (packetSize == 0) {
 			length = 0;
@@ -238,13 +284,18 @@ public:
 				memcpy(buffer, &(packet->at(0)), packetSize);
 			} else {
 				memcpy(buffer, &(packet->at(0)), maxLength);
-				delete packet;
+				releasePacket(packet);
 				throw SpaceWireIFException(SpaceWireIFException::ReceiveBufferTooSmall);
 			}
 		}
-		delete packet;
+		releasePacket(packet);
 	}
+
 public:
+	/** Receives a packet into a newly constructed vector.
+	 * The caller owns the returned vector, and should delete it after use.
+	 * See receiveLeased() for a variant which recycles buffers.
+	 */
 	virtual std::vector<uint8_t>* receive() throw (SpaceWireIFException) {
 		std::vector<uint8_t>* buffer = new std::vector<uint8_t>();
 		try {
@@ -256,9 +307,194 @@ public:
 		}
 	}
 
+public:
+	/** Receives a packet into a buffer leased from the packet buffer pool.
+	 * The returned buffer should be given back via releasePacket() after use
+	 * (or freed via SpaceWirePacketBufferPool::discard(); it must not be deleted directly).
+	 */
+	std::vector<uint8_t>* receiveLeased() throw (SpaceWireIFException) {
+		std::vector<uint8_t>* buffer = packetBufferPool->lease();
+		try {
+			this->receive(buffer);
+			return buffer;
+		} catch (SpaceWireIFException e) {
+			packetBufferPool->returnBuffer(buffer);
+			throw e;
+		}
+	}
+
+public:
+	/** Gives back a buffer returned by receiveLeased() to the packet buffer pool. */
+	void releasePacket(std::vector<uint8_t>* packet) {
+		packetBufferPool->returnBuffer(packet);
+	}
+
+public:
+	SpaceWirePacketBufferPool* getPacketBufferPool() {
+		return packetBufferPool;
+	}
+
+	/** Replaces the packet buffer pool (default: SpaceWirePacketBufferPool::getSharedInstance()).
+	 * Buffers leased from the previous pool should be released before calling this method.
+	 * The pool is not deleted by this class.
+	 */
+	void setPacketBufferPool(SpaceWirePacketBufferPool* packetBufferPool) {
+		this->packetBufferPool = packetBufferPool;
+	}
+
 public:
 	virtual void receive(std::vector<uint8_t>* buffer) throw (SpaceWireIFException) =0;
 
+public:
+	/** Receives packets which are already available, in one call.
+	 * This method blocks until the first packet is received (or throws Timeout
+	 * in the same manner as receive()), and then returns further packets only
+	 * if they can be received without waiting, up to maxPackets packets.
+	 * EOP/EEP markers are returned via eopTypes, and EEP is not reported as an
+	 * exception. Vectors in packets are reused across calls so that their capacity
+	 * is retained, and the caller should use only the first (returned value) entries.
+	 * Receive timestamps of the packets are available via getReceivedPacketTimestamps().
+	 * The default implementation returns one packet received by receive();
+	 * subclasses which can see buffered packets override this method.
+	 * @param[out] packets vectors used to store packets (resized to at least maxPackets entries).
+	 * @param[out] eopTypes EOP marker types of the packets.
+	 * @param[in] maxPackets maximum number of packets to be received.
+	 * @returns the number of packets received (at least 1).
+	 */
+	virtual size_t receiveBatch(std::vector<std::vector<uint8_t> >& packets,
+			std::vector<SpaceWireEOPMarker::EOPType>& eopTypes, size_t maxPackets = DefaultBatchSize)
+					throw (SpaceWireIFException) {
+		if (maxPackets == 0) {
+			maxPackets = 1;
+		}
+		if (packets.size() < maxPackets) {
+			packets.resize(maxPackets);
+		}
+		eopTypes.resize(packets.size());
+		try {
+			this->receive(&packets[0]);
+		} catch (SpaceWireIFException& e) {
+			if (e.getStatus() != SpaceWireIFException::EEP) {
+				throw e;
+			}
+		}
+		eopTypes[0] = (getReceivedPacketEOPMarkerType() == EEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP;
+		receivedPacketTimestamps.resize(1);
+		receivedPacketTimestamps[0] = getReceivedPacketTimestamp();
+		return 1;
+	}
+
+	static const size_t DefaultBatchSize = 64;
+
+public:
+	/** Starts receiving a packet without blocking the caller.
+	 * When a packet has been received (or the operation has been cancelled or
+	 * has failed), handler->onCompletion() is invoked with the operation, whose
+	 * buffer holds the packet. Operations are completed in the order they were started.
+	 * Handlers are invoked by the thread which runs the completion queue set
+	 * via setCompletionQueue(), or, when no queue is set, directly by the
+	 * thread of the interface which completed the operation.
+	 * Asynchronous receive should not be mixed with receive() on the same interface.
+	 * @param[in] handler a handler invoked once when the operation finishes.
+	 * @param[in] context an arbitrary pointer passed via SpaceWireIFAsyncOperation::context.
+	 */
+	virtual void asyncReceive(SpaceWireIFAsyncHandler* handler, void* context = NULL) throw (SpaceWireIFException) {
+		throw SpaceWireIFException(SpaceWireIFException::FunctionNotImplemented);
+	}
+
+	/** Starts sending a packet without blocking the caller.
+	 * The buffer is owned by the caller and must not be modified until the
+	 * handler has been invoked.
+	 * @see asyncReceive()
+	 */
+	virtual void asyncSend(std::vector<uint8_t>* buffer, SpaceWireIFAsyncHandler* handler, void* context = NULL,
+			SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP) throw (SpaceWireIFException) {
+		throw SpaceWireIFException(SpaceWireIFException::FunctionNotImplemented);
+	}
+
+	/** Cancels asynchronous operations which have not started yet.
+	 * Their handlers are invoked with status SpaceWireIFAsyncOperation::Cancelled.
+	 * An operation which is already transferring data completes normally.
+	 * @returns the number of cancelled operations.
+	 */
+	virtual size_t cancelAsyncOperations() {
+		return 0;
+	}
+
+public:
+	/** Sets the queue to which finished asynchronous operations are posted (NULL to invoke handlers directly).
+	 * The queue is not deleted by this class.
+	 */
+	void setCompletionQueue(SpaceWireIFCompletionQueue* completionQueue) {
+		this->completionQueue = completionQueue;
+	}
+
+	SpaceWireIFCompletionQueue* getCompletionQueue() {
+		return completionQueue;
+	}
+
+protected:
+	/** Hands a finished operation to the completion queue (or to its handler if no queue is set). */
+	void completeAsyncOperation(SpaceWireIFAsyncOperation* operation) {
+		if (completionQueue != NULL) {
+			completionQueue->post(operation);
+		} else {
+			SpaceWireIFAsyncOperation::dispatch(operation);
+		}
+	}
+
+public:
+	/** Mirrors packets sent and received via this interface to a SpaceWireTap (NULL to detach).
+	 * The tap can be attached and detached while other threads are sending and receiving.
+	 * When this method returns, the previous tap is no longer accessed by this interface.
+	 * The tap is not deleted by this class. Interfaces which wrap another SpaceWireIF
+	 * (e.g. SpaceWireIFFaultInjector) tap packets as they pass their own boundary, so that
+	 * a tap attached to the wrapper and one attached to the wrapped interface may see
+	 * different packets.
+	 */
+	void setTap(SpaceWireTap* tap) {
+		this->tap = tap;
+		__sync_synchronize();
+		//wait for calls which may have read the previous tap
+		while (nTapCallsInProgress != 0) {
+			sched_yield();
+		}
+	}
+
+	SpaceWireTap* getTap() {
+		return tap;
+	}
+
+protected:
+	/** Passes a sent packet to the tap. Subclasses call this method for each packet they send
+	 * (it costs one comparison when no tap is attached).
+	 */
+	inline void tapSentPacket(const uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType) {
+		if (tap != NULL) {
+			tapPacket(SpaceWireTapRecord::Sent, data, length, eopType, SpaceWireReceiveTimestamp());
+		}
+	}
+
+	/** Passes a received packet to the tap. Subclasses call this method for each packet they receive. */
+	inline void tapReceivedPacket(const uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType,
+			const SpaceWireReceiveTimestamp& timestamp) {
+		if (tap != NULL) {
+			tapPacket(SpaceWireTapRecord::Received, data, length, eopType, timestamp);
+		}
+	}
+
+private:
+	void tapPacket(SpaceWireTapRecord::Direction direction, const uint8_t* data, size_t length,
+			SpaceWireEOPMarker::EOPType eopType, const SpaceWireReceiveTimestamp& timestamp) {
+		__sync_fetch_and_add(&nTapCallsInProgress, 1);
+		//re-read after announcing the call so that setTap() either waits for this call or is seen here
+		SpaceWireTap* currentTap = tap;
+		if (currentTap != NULL) {
+			currentTap->tap(this, direction, data, length, eopType, timestamp);
+		}
+		__sync_fetch_and_sub(&nTapCallsInProgress, 1);
+	}
+
 public:
 	virtual void emitTimecode(uint8_t timeIn, uint8_t controlFlagIn = 0x00) throw (SpaceWireIFException) =0;
 
@@ -359,6 +595,36 @@ public:
 		}
 	}
 
+public:
+	void addLinkStateAction(SpaceWireIFActionLinkStateAction* linkStateAction) {
+		for (size_t i = 0; i < linkStateActions.size(); i++) {
+			if (linkStateAction == linkStateActions[i]) {
+				return; //already registered
+			}
+		}
+		linkStateActions.push_back(linkStateAction);
+	}
+
+	void deleteLinkStateAction(SpaceWireIFActionLinkStateAction* linkStateAction) {
+		std::vector<SpaceWireIFActionLinkStateAction*> newActions;
+		for (size_t i = 0; i < linkStateActions.size(); i++) {
+			if (linkStateAction != linkStateActions[i]) {
+				newActions.push_back(linkStateActions[i]);
+			}
+		}
+		linkStateActions = newActions;
+	}
+
+	void invokeLinkStateActions(bool linkIsUp) {
+		for (size_t i = 0; i < linkStateActions.size(); i++) {
+			if (linkIsUp) {
+				linkStateActions[i]->linkRestored(this);
+			} else {
+				linkStateActions[i]->linkLost(this);
+			}
+		}
+	}
+
 public:
 	bool isTerminatedWithEEP() {
 		return isTerminatedWithEEP_;
@@ -391,6 +657,41 @@ public:
 		}
 	}
 
+public:
+	/** Returns the time when the last packet received by receive() (or the
+	 * last packet of receiveBatch()) arrived at this interface.
+	 * Interfaces which cannot see the arrival time take the timestamp when
+	 * the packet is handed to the caller, and some return an invalid timestamp.
+	 * Should be called by the thread which received the packet.
+	 */
+	SpaceWireReceiveTimestamp getReceivedPacketTimestamp() {
+		return receivedPacketTimestamp;
+	}
+
+	/** Returns receive timestamps of the packets returned by the last receiveBatch()
+	 * (the first (returned value) entries are valid).
+	 */
+	const std::vector<SpaceWireReceiveTimestamp>& getReceivedPacketTimestamps() {
+		return receivedPacketTimestamps;
+	}
+
+	/** Selects whether CLOCK_REALTIME is read in addition to CLOCK_MONOTONIC
+	 * when a receive timestamp is taken (default: false).
+	 * Subclasses override this method to pass the setting to the receive path.
+	 */
+	virtual void setRealtimeTimestampEnabled(bool enabled) {
+		realtimeTimestampEnabled = enabled;
+	}
+
+	bool isRealtimeTimestampEnabled() {
+		return realtimeTimestampEnabled;
+	}
+
+	void setReceivedPacketTimestamp(const SpaceWireReceiveTimestamp& timestamp) {
+		receivedPacketTimestamp = timestamp;
+	}
+
+public:
 	void eepShouldBeReportedAsAnException() {
 		eepShouldBeReportedAsAnException_ = true;
 	}
@@ -0,0 +1,284 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireIFAsync.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIREIFASYNC_HH_
+#define SPACEWIREIFASYNC_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#include "SpaceWireEOPMarker.hh"
+#include "SpaceWirePacketBufferPool.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+
+class SpaceWireIF;
+class SpaceWireIFAsyncOperation;
+
+/** An interface of handlers invoked when an asynchronous SpaceWireIF
+ * operation (SpaceWireIF::asyncReceive() or SpaceWireIF::asyncSend()) has finished.
+ */
+class SpaceWireIFAsyncHandler {
+public:
+	virtual ~SpaceWireIFAsyncHandler() {
+	}
+
+public:
+	/** Called once per operation, when it has been completed, cancelled, or has failed.
+	 * The operation instance is deleted after this method returns.
+	 * A handler may start new asynchronous operations from this method.
+	 */
+	virtual void onCompletion(SpaceWireIFAsyncOperation* operation) = 0;
+};
+
+/** An asynchronous send or receive operation.
+ * Instances are created by SpaceWireIF::asyncReceive()/asyncSend() and are
+ * deleted after the handler has been invoked.
+ */
+class SpaceWireIFAsyncOperation {
+public:
+	enum {
+		Send, Receive
+	};
+
+	enum {
+		Pending, Completed, Cancelled, Failed
+	};
+
+public:
+	uint32_t type;
+	uint32_t status;
+	/** SpaceWireIFException status when status is Failed. */
+	uint32_t errorStatus;
+	SpaceWireIF* spwif;
+	SpaceWireIFAsyncHandler* handler;
+	void* context;
+	/** Send: data to be sent (owned by the caller, which keeps it until completion).
+	 * Receive: the received packet (leased from pool).
+	 */
+	std::vector<uint8_t>* buffer;
+	SpaceWireEOPMarker::EOPType eopType;
+	/** Receive: time when the packet arrived (see SpaceWireIF::getReceivedPacketTimestamp()). */
+	SpaceWireReceiveTimestamp timestamp;
+
+private:
+	SpaceWirePacketBufferPool* pool;
+
+public:
+	SpaceWireIFAsyncOperation(uint32_t type, SpaceWireIF* spwif, SpaceWireIFAsyncHandler* handler, void* context) :
+			type(type), status(Pending), errorStatus(0), spwif(spwif), handler(handler), context(context), buffer(NULL), eopType(
+					SpaceWireEOPMarker::EOP), pool(NULL) {
+	}
+
+	~SpaceWireIFAsyncOperation() {
+		if (pool != NULL) {
+			pool->returnBuffer(buffer);
+		}
+	}
+
+public:
+	/** Lets this operation own a buffer leased from a pool (returned to the pool on deletion). */
+	void setLeasedBuffer(std::vector<uint8_t>* buffer, SpaceWirePacketBufferPool* pool) {
+		this->buffer = buffer;
+		this->pool = pool;
+	}
+
+	/** Takes the received packet so that it survives the operation.
+	 * The caller then owns the buffer, and should give it back via
+	 * SpaceWireIF::releasePacket() (or free it via SpaceWirePacketBufferPool::discard()).
+	 */
+	std::vector<uint8_t>* takeBuffer() {
+		std::vector<uint8_t>* result = buffer;
+		buffer = NULL;
+		pool = NULL;
+		return result;
+	}
+
+public:
+	bool isCompleted() const {
+		return status == Completed;
+	}
+
+	bool isCancelled() const {
+		return status == Cancelled;
+	}
+
+	bool isFailed() const {
+		return status == Failed;
+	}
+
+public:
+	/** Invokes the handler and deletes the operation. */
+	static void dispatch(SpaceWireIFAsyncOperation* operation) {
+		if (operation->handler != NULL) {
+			operation->handler->onCompletion(operation);
+		}
+		delete operation;
+	}
+};
+
+/** A queue of finished asynchronous operations.
+ * SpaceWireIF implementations post finished operations to the queue set via
+ * SpaceWireIF::setCompletionQueue(), and an application thread invokes the
+ * handlers by calling run() or poll(). One thread can serve any number of
+ * interfaces in this way, without per-interface receive threads or
+ * timeout polling.
+ * @code
+ * SpaceWireIFCompletionQueue queue;
+ * spwif->setCompletionQueue(&queue);
+ * spwif->asyncReceive(&handler); //handler->onCompletion() calls asyncReceive() again
+ * while (!stopped) {
+ * 	queue.run();
+ * }
+ * @endcode
+ */
+class SpaceWireIFCompletionQueue {
+private:
+	std::deque<SpaceWireIFAsyncOperation*> operations;
+	pthread_mutex_t mutex;
+	pthread_cond_t condition;
+	bool wakeupRequested;
+
+private:
+	size_t nPosted;
+	size_t nDispatched;
+
+public:
+	SpaceWireIFCompletionQueue() {
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&condition, NULL);
+		wakeupRequested = false;
+		nPosted = 0;
+		nDispatched = 0;
+	}
+
+	/** Destructor. Operations which have not been dispatched are deleted without invoking handlers. */
+	~SpaceWireIFCompletionQueue() {
+		for (size_t i = 0; i < operations.size(); i++) {
+			delete operations[i];
+		}
+		pthread_cond_destroy(&condition);
+		pthread_mutex_destroy(&mutex);
+	}
+
+private:
+	SpaceWireIFCompletionQueue(const SpaceWireIFCompletionQueue&);
+	SpaceWireIFCompletionQueue& operator=(const SpaceWireIFCompletionQueue&);
+
+public:
+	/** Adds a finished operation. Called by SpaceWireIF implementations from any thread. */
+	void post(SpaceWireIFAsyncOperation* operation) {
+		pthread_mutex_lock(&mutex);
+		operations.push_back(operation);
+		nPosted++;
+		pthread_cond_signal(&condition);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	/** Makes a thread blocked in run() return (even if no operation has finished). */
+	void wakeup() {
+		pthread_mutex_lock(&mutex);
+		wakeupRequested = true;
+		pthread_cond_broadcast(&condition);
+		pthread_mutex_unlock(&mutex);
+	}
+
+public:
+	/** Waits until at least one operation has finished, and invokes the handlers
+	 * of all the finished operations.
+	 * @param[in] timeoutInMilliSec maximum waiting time (negative to wait until an operation
+	 * finishes or wakeup() is called).
+	 * @returns the number of handlers invoked.
+	 */
+	size_t run(double timeoutInMilliSec = -1) {
+		pthread_mutex_lock(&mutex);
+		if (operations.empty() && !wakeupRequested && timeoutInMilliSec != 0) {
+			if (timeoutInMilliSec < 0) {
+				while (operations.empty() && !wakeupRequested) {
+					pthread_cond_wait(&condition, &mutex);
+				}
+			} else {
+				struct timespec deadline;
+				clock_gettime(CLOCK_REALTIME, &deadline);
+				long long nanoSec = (long long) (timeoutInMilliSec * 1000000) + deadline.tv_nsec;
+				deadline.tv_sec += nanoSec / 1000000000;
+				deadline.tv_nsec = nanoSec % 1000000000;
+				while (operations.empty() && !wakeupRequested) {
+					if (pthread_cond_timedwait(&condition, &mutex, &deadline) == ETIMEDOUT) {
+						break;
+					}
+				}
+			}
+		}
+		wakeupRequested = false;
+		pthread_mutex_unlock(&mutex);
+		return poll();
+	}
+
+	/** Invokes the handlers of operations which have already finished, without waiting.
+	 * @returns the number of handlers invoked.
+	 */
+	size_t poll() {
+		std::deque<SpaceWireIFAsyncOperation*> finishedOperations;
+		pthread_mutex_lock(&mutex);
+		finishedOperations.swap(operations);
+		pthread_mutex_unlock(&mutex);
+		for (size_t i = 0; i < finishedOperations.size(); i++) {
+			SpaceWireIFAsyncOperation::dispatch(finishedOperations[i]);
+		}
+		pthread_mutex_lock(&mutex);
+		nDispatched += finishedOperations.size();
+		pthread_mutex_unlock(&mutex);
+		return finishedOperations.size();
+	}
+
+public:
+	/** Returns the number of operations waiting for dispatch. */
+	size_t getNQueuedOperations() {
+		pthread_mutex_lock(&mutex);
+		size_t n = operations.size();
+		pthread_mutex_unlock(&mutex);
+		return n;
+	}
+
+	size_t getNPosted() const {
+		return nPosted;
+	}
+
+	size_t getNDispatched() const {
+		return nDispatched;
+	}
+};
+
+#endif /* SPACEWIREIFASYNC_HH_ */
@@ -0,0 +1,458 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireIFFaultInjector.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPACEWIREIFFAULTINJECTOR_HH_
+#define SPACEWIREIFFAULTINJECTOR_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Mutex.hh"
+#include "CxxUtilities/RandomMT.hh"
+
+#include "SpaceWireIF.hh"
+#include "SpaceWireEOPMarker.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+
+/** Probabilities of faults injected into packets passing one direction of
+ * SpaceWireIFFaultInjector. Each probability is applied per packet, and
+ * independently of the others (a dropped packet is not affected by the rest).
+ */
+class SpaceWireIFFaultModel {
+public:
+	/** the packet is lost */
+	double dropProbability;
+	/** one bit of a randomly chosen byte is flipped */
+	double corruptionProbability;
+	/** the packet is cut at a random length, and is terminated with EEP */
+	double truncationProbability;
+	/** the packet is delivered twice */
+	double duplicationProbability;
+	/** the packet is delivered after the next packet */
+	double reorderingProbability;
+	/** the packet is delayed by latencyInMicroSec */
+	double latencyProbability;
+	double latencyInMicroSec;
+
+public:
+	SpaceWireIFFaultModel() {
+		dropProbability = 0;
+		corruptionProbability = 0;
+		truncationProbability = 0;
+		duplicationProbability = 0;
+		reorderingProbability = 0;
+		latencyProbability = 0;
+		latencyInMicroSec = 0;
+	}
+
+public:
+	bool isEnabled() const {
+		return dropProbability != 0 || corruptionProbability != 0 || truncationProbability != 0
+				|| duplicationProbability != 0 || reorderingProbability != 0 || latencyProbability != 0;
+	}
+};
+
+/** Counters of SpaceWireIFFaultInjector (per direction). */
+class SpaceWireIFFaultStatistics {
+public:
+	size_t nPackets;
+	size_t nDropped;
+	size_t nCorrupted;
+	size_t nTruncated;
+	size_t nDuplicated;
+	size_t nReordered;
+	size_t nDelayed;
+
+public:
+	SpaceWireIFFaultStatistics() {
+		reset();
+	}
+
+public:
+	void reset() {
+		nPackets = 0;
+		nDropped = 0;
+		nCorrupted = 0;
+		nTruncated = 0;
+		nDuplicated = 0;
+		nReordered = 0;
+		nDelayed = 0;
+	}
+
+	std::string toString() const {
+		std::stringstream ss;
+		ss << "packets=" << nPackets << " dropped=" << nDropped << " corrupted=" << nCorrupted << " truncated="
+				<< nTruncated << " duplicated=" << nDuplicated << " reordered=" << nReordered << " delayed=" << nDelayed;
+		return ss.str();
+	}
+};
+
+/** A SpaceWireIF which injects faults into packets sent and received via another SpaceWireIF.
+ * Faults are drawn from a random number generator seeded by the constructor
+ * argument (one generator per direction), so that a run can be reproduced.
+ * Faults of the send direction are applied before packets are passed to the
+ * underlying interface, and those of the receive direction after packets have
+ * been received from it. Added latency blocks the sending or receiving thread.
+ * A reordered packet is held until the next packet of the same direction has
+ * been passed (or, on the receive side, until a receive timeout).
+ * A tap attached to this instance sees packets after the faults have been
+ * applied (as they are passed to the underlying interface or to the caller).
+ * @code
+ * SpaceWireIFFaultInjector faultInjector(spwif, 1234);
+ * SpaceWireIFFaultModel faults;
+ * faults.dropProbability = 0.01;
+ * faults.corruptionProbability = 0.001;
+ * faultInjector.setRxFaultModel(faults);
+ * faultInjector.open();
+ * RMAPEngine* rmapEngine = new RMAPEngine(&faultInjector);
+ * @endcode
+ * The underlying interface is opened and closed via this instance, but is not deleted.
+ * TimeCodes are passed through without faults. Asynchronous operations are not supported.
+ */
+class SpaceWireIFFaultInjector: public SpaceWireIF, public SpaceWireIFActionTimecodeScynchronizedAction {
+private:
+	class Direction {
+	public:
+		SpaceWireIFFaultModel model;
+		SpaceWireIFFaultStatistics statistics;
+		CxxUtilities::RandomMT random;
+		CxxUtilities::Mutex mutex;
+		std::vector<uint8_t> heldPacket;
+		SpaceWireEOPMarker::EOPType heldEOPType;
+		bool hasHeldPacket;
+
+	public:
+		Direction(uint32_t seed) :
+				random(seed), heldEOPType(SpaceWireEOPMarker::EOP), hasHeldPacket(false) {
+		}
+
+	public:
+		bool draw(double probability) {
+			return probability != 0 && random.generateRandomDoubleFrom0To1() < probability;
+		}
+
+		size_t drawIndex(size_t n) {
+			size_t index = (size_t) (random.generateRandomDoubleFrom0To1() * n);
+			return (index < n) ? index : n - 1;
+		}
+	};
+
+	/** What happens to a packet (decided by Direction::apply()). */
+	class Verdict {
+	public:
+		bool drop;
+		bool duplicate;
+		bool reorder;
+		double latencyInMicroSec;
+	};
+
+private:
+	SpaceWireIF* spwif;
+	Direction tx;
+	Direction rx;
+	std::vector<uint8_t> txBuffer;
+	std::deque<std::pair<std::vector<uint8_t>, SpaceWireEOPMarker::EOPType> > rxPending;
+
+public:
+	/** Constructor.
+	 * @param[in] spwif an underlying interface.
+	 * @param[in] seed seed of the random number generators.
+	 */
+	SpaceWireIFFaultInjector(SpaceWireIF* spwif, uint32_t seed = 1) :
+			spwif(spwif), tx(seed), rx(seed + 1) {
+		spwif->addTimecodeAction(this);
+	}
+
+	virtual ~SpaceWireIFFaultInjector() {
+		spwif->deleteTimecodeAction(this);
+	}
+
+public:
+	void open() throw (SpaceWireIFException) {
+		if (spwif->getState() != Opened) {
+			spwif->open();
+		}
+		state = Opened;
+	}
+
+	void close() throw (SpaceWireIFException) {
+		if (state == Closed) {
+			return;
+		}
+		state = Closed;
+		spwif->close();
+		invokeSpaceWireIFCloseActions();
+	}
+
+public:
+	void send(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP)
+			throw (SpaceWireIFException) {
+		tx.mutex.lock();
+		txBuffer.assign(data, data + length);
+		Verdict verdict = apply(tx, txBuffer, eopType);
+		if (verdict.latencyInMicroSec != 0) {
+			sleep(verdict.latencyInMicroSec);
+		}
+		try {
+			if (verdict.reorder) {
+				tx.heldPacket.swap(txBuffer);
+				tx.heldEOPType = eopType;
+				tx.hasHeldPacket = true;
+			} else if (!verdict.drop) {
+				sendToLink(txBuffer, eopType);
+				if (verdict.duplicate) {
+					sendToLink(txBuffer, eopType);
+				}
+				if (tx.hasHeldPacket) {
+					tx.hasHeldPacket = false;
+					sendToLink(tx.heldPacket, tx.heldEOPType);
+				}
+			}
+		} catch (...) {
+			tx.mutex.unlock();
+			throw;
+		}
+		tx.mutex.unlock();
+	}
+
+	using SpaceWireIF::send;
+
+public:
+	void receive(std::vector<uint8_t>* buffer) throw (SpaceWireIFException) {
+		SpaceWireEOPMarker::EOPType eopType;
+		rx.mutex.lock();
+		try {
+			receivePacket(buffer, eopType);
+		} catch (...) {
+			rx.mutex.unlock();
+			throw;
+		}
+		rx.mutex.unlock();
+		tapReceivedPacket((buffer->size() != 0) ? &(buffer->at(0)) : NULL, buffer->size(), eopType,
+				getReceivedPacketTimestamp());
+		if (eopType == SpaceWireEOPMarker::EEP) {
+			setReceivedPacketEOPMarkerType(EEP);
+			if (eepShouldBeReportedAsAnException_) {
+				throw SpaceWireIFException(SpaceWireIFException::EEP);
+			}
+		} else {
+			setReceivedPacketEOPMarkerType(EOP);
+		}
+	}
+
+	using SpaceWireIF::receive;
+
+public:
+	void emitTimecode(uint8_t timeIn, uint8_t controlFlagIn = 0x00) throw (SpaceWireIFException) {
+		spwif->emitTimecode(timeIn, controlFlagIn);
+	}
+
+	/** Forwards a TimeCode received by the underlying interface. */
+	void doAction(uint8_t timecode) {
+		invokeTimecodeSynchronizedActions(timecode);
+	}
+
+	void setTxLinkRate(uint32_t linkRateType) throw (SpaceWireIFException) {
+		spwif->setTxLinkRate(linkRateType);
+	}
+
+	uint32_t getTxLinkRateType() throw (SpaceWireIFException) {
+		return spwif->getTxLinkRateType();
+	}
+
+	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException) {
+		spwif->setTimeoutDuration(microsecond);
+		timeoutDurationInMicroSec = microsecond;
+	}
+
+	void setRealtimeTimestampEnabled(bool enabled) {
+		SpaceWireIF::setRealtimeTimestampEnabled(enabled);
+		spwif->setRealtimeTimestampEnabled(enabled);
+	}
+
+public:
+	/** Sets faults injected into sent packets. */
+	void setTxFaultModel(const SpaceWireIFFaultModel& model) {
+		tx.mutex.lock();
+		tx.model = model;
+		tx.mutex.unlock();
+	}
+
+	/** Sets faults injected into received packets. */
+	void setRxFaultModel(const SpaceWireIFFaultModel& model) {
+		rx.mutex.lock();
+		rx.model = model;
+		rx.mutex.unlock();
+	}
+
+	SpaceWireIFFaultModel getTxFaultModel() const {
+		return tx.model;
+	}
+
+	SpaceWireIFFaultModel getRxFaultModel() const {
+		return rx.model;
+	}
+
+	SpaceWireIFFaultStatistics getTxStatistics() {
+		tx.mutex.lock();
+		SpaceWireIFFaultStatistics statistics = tx.statistics;
+		tx.mutex.unlock();
+		return statistics;
+	}
+
+	SpaceWireIFFaultStatistics getRxStatistics() {
+		rx.mutex.lock();
+		SpaceWireIFFaultStatistics statistics = rx.statistics;
+		rx.mutex.unlock();
+		return statistics;
+	}
+
+	void resetStatistics() {
+		tx.mutex.lock();
+		tx.statistics.reset();
+		tx.mutex.unlock();
+		rx.mutex.lock();
+		rx.statistics.reset();
+		rx.mutex.unlock();
+	}
+
+	SpaceWireIF* getSpaceWireIF() {
+		return spwif;
+	}
+
+private:
+	/** Sends a packet (after the send-side faults) to the underlying interface (tx.mutex must be locked). */
+	void sendToLink(std::vector<uint8_t>& packet, SpaceWireEOPMarker::EOPType eopType) throw (SpaceWireIFException) {
+		spwif->send(packet, eopType);
+		tapSentPacket((packet.size() != 0) ? &(packet[0]) : NULL, packet.size(), eopType);
+	}
+
+	/** Receives a packet from the underlying interface, and applies the receive-side faults
+	 * (rx.mutex must be locked).
+	 */
+	void receivePacket(std::vector<uint8_t>* buffer, SpaceWireEOPMarker::EOPType& eopType) throw (SpaceWireIFException) {
+		while (true) {
+			if (rxPending.size() != 0) {
+				buffer->swap(rxPending.front().first);
+				eopType = rxPending.front().second;
+				rxPending.pop_front();
+				return;
+			}
+			try {
+				spwif->receive(buffer);
+			} catch (SpaceWireIFException& e) {
+				if (e.getStatus() == SpaceWireIFException::Timeout && rx.hasHeldPacket) {
+					//a reordered packet is not held longer than a receive timeout
+					rx.hasHeldPacket = false;
+					buffer->swap(rx.heldPacket);
+					eopType = rx.heldEOPType;
+					return;
+				} else if (e.getStatus() != SpaceWireIFException::EEP) {
+					throw;
+				}
+			}
+			eopType = (spwif->getReceivedPacketEOPMarkerType() == EEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP;
+			setReceivedPacketTimestamp(spwif->getReceivedPacketTimestamp());
+			Verdict verdict = apply(rx, *buffer, eopType);
+			if (verdict.latencyInMicroSec != 0) {
+				sleep(verdict.latencyInMicroSec);
+			}
+			if (verdict.drop) {
+				continue;
+			}
+			if (verdict.reorder) {
+				rx.heldPacket.swap(*buffer);
+				rx.heldEOPType = eopType;
+				rx.hasHeldPacket = true;
+				continue;
+			}
+			if (verdict.duplicate) {
+				rxPending.push_back(std::make_pair(*buffer, eopType));
+			}
+			if (rx.hasHeldPacket) {
+				rx.hasHeldPacket = false;
+				rxPending.push_back(std::make_pair(std::vector<uint8_t>(), rx.heldEOPType));
+				rxPending.back().first.swap(rx.heldPacket);
+			}
+			return;
+		}
+	}
+
+	/** Decides faults of a packet, and applies corruption and truncation to it
+	 * (the mutex of the direction must be locked).
+	 */
+	Verdict apply(Direction& direction, std::vector<uint8_t>& packet, SpaceWireEOPMarker::EOPType& eopType) {
+		SpaceWireIFFaultModel& model = direction.model;
+		SpaceWireIFFaultStatistics& statistics = direction.statistics;
+		Verdict verdict;
+		verdict.drop = false;
+		verdict.duplicate = false;
+		verdict.reorder = false;
+		verdict.latencyInMicroSec = 0;
+		statistics.nPackets++;
+		if (!model.isEnabled()) {
+			return verdict;
+		}
+		if (direction.draw(model.dropProbability)) {
+			verdict.drop = true;
+			statistics.nDropped++;
+			return verdict;
+		}
+		if (direction.draw(model.corruptionProbability) && packet.size() != 0) {
+			packet[direction.drawIndex(packet.size())] ^= (uint8_t) (1 << direction.drawIndex(8));
+			statistics.nCorrupted++;
+		}
+		if (direction.draw(model.truncationProbability) && packet.size() != 0) {
+			packet.resize(direction.drawIndex(packet.size()));
+			eopType = SpaceWireEOPMarker::EEP;
+			statistics.nTruncated++;
+		}
+		if (direction.draw(model.duplicationProbability)) {
+			verdict.duplicate = true;
+			statistics.nDuplicated++;
+		}
+		if (!direction.hasHeldPacket && direction.draw(model.reorderingProbability)) {
+			verdict.reorder = true;
+			statistics.nReordered++;
+		}
+		if (direction.draw(model.latencyProbability)) {
+			verdict.latencyInMicroSec = model.latencyInMicroSec;
+			statistics.nDelayed++;
+		}
+		return verdict;
+	}
+
+	static void sleep(double microsecond) {
+		SpaceWireReceiveTimestamp::sleepUntilMonotonicClock(
+				SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec() + (uint64_t) (microsecond * 1000));
+	}
+};
+
+#endif /* SPACEWIREIFFAULTINJECTOR_HH_ */
@@ -0,0 +1,809 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireIFLinkBonding.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPACEWIREIFLINKBONDING_HH_
+#define SPACEWIREIFLINKBONDING_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Mutex.hh"
+#include "CxxUtilities/Thread.hh"
+
+#include <pthread.h>
+#include <time.h>
+
+#include "SpaceWireIF.hh"
+#include "SpaceWireEOPMarker.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+
+/** Selects the link which sends a packet in SpaceWireIFLinkBonding.
+ * selectLink() is called with the lock of the bonded interface held,
+ * and should not block.
+ */
+class SpaceWireIFLinkBondingPolicy {
+public:
+	/** The value of queuedBytes for a link which has failed. */
+	static const size_t LinkNotAvailable = (size_t) -1;
+
+public:
+	virtual ~SpaceWireIFLinkBondingPolicy() {
+	}
+
+public:
+	/** Returns the index of the link which sends a packet.
+	 * If the returned link is not available, the next available link is used.
+	 * @param[in] data the packet.
+	 * @param[in] length length of the packet.
+	 * @param[in] queuedBytes bytes waiting for transmission on each link (including the packet being sent).
+	 */
+	virtual size_t selectLink(uint8_t* data, size_t length, const std::vector<size_t>& queuedBytes) = 0;
+};
+
+/** Uses the links in turn. */
+class SpaceWireIFLinkBondingRoundRobinPolicy: public SpaceWireIFLinkBondingPolicy {
+private:
+	size_t next;
+
+public:
+	SpaceWireIFLinkBondingRoundRobinPolicy() :
+			next(0) {
+	}
+
+public:
+	size_t selectLink(uint8_t* data, size_t length, const std::vector<size_t>& queuedBytes) {
+		next = (next + 1) % queuedBytes.size();
+		return next;
+	}
+};
+
+/** Uses the link with the fewest bytes waiting for transmission,
+ * so that a slower (or busier) link receives fewer packets.
+ */
+class SpaceWireIFLinkBondingLeastQueuedPolicy: public SpaceWireIFLinkBondingPolicy {
+public:
+	size_t selectLink(uint8_t* data, size_t length, const std::vector<size_t>& queuedBytes) {
+		size_t selected = 0;
+		for (size_t i = 1; i < queuedBytes.size(); i++) {
+			if (queuedBytes[i] < queuedBytes[selected]) {
+				selected = i;
+			}
+		}
+		return selected;
+	}
+};
+
+/** Selects a link from the destination logical address of a packet
+ * (the first byte which is not a path address), so that packets to one
+ * destination always use the same link and are not reordered.
+ * Packets which consist only of path addresses use the first link.
+ */
+class SpaceWireIFLinkBondingLogicalAddressHashPolicy: public SpaceWireIFLinkBondingPolicy {
+public:
+	size_t selectLink(uint8_t* data, size_t length, const std::vector<size_t>& queuedBytes) {
+		for (size_t i = 0; i < length; i++) {
+			if (0x20 <= data[i]) {
+				return data[i] % queuedBytes.size();
+			}
+		}
+		return 0;
+	}
+};
+
+/** Counters of a link of SpaceWireIFLinkBonding. */
+class SpaceWireIFLinkBondingStatistics {
+public:
+	size_t nSentPackets;
+	size_t nSentBytes;
+	size_t nReceivedPackets;
+	size_t nReceivedBytes;
+	/** packets lost when the link failed (packets which could not be moved
+	 * to another link because no link was available) */
+	size_t nDroppedPackets;
+	size_t queuedBytes;
+	bool failed;
+
+public:
+	SpaceWireIFLinkBondingStatistics() {
+		nSentPackets = 0;
+		nSentBytes = 0;
+		nReceivedPackets = 0;
+		nReceivedBytes = 0;
+		nDroppedPackets = 0;
+		queuedBytes = 0;
+		failed = false;
+	}
+
+public:
+	std::string toString() const {
+		std::stringstream ss;
+		ss << "sent=" << nSentPackets << " packets/" << nSentBytes << " bytes received=" << nReceivedPackets
+				<< " packets/" << nReceivedBytes << " bytes dropped=" << nDroppedPackets << " queued=" << queuedBytes
+				<< " bytes" << (failed ? " (failed)" : "");
+		return ss.str();
+	}
+};
+
+/** A SpaceWireIF which bonds several SpaceWireIFs (e.g. SpaceWireIFOverTCP
+ * instances connected to different ports of a bridge) into one interface.
+ * Sent packets are queued to one of the links selected by a policy, and each
+ * link is driven by its own transmit thread, so that the links transfer data
+ * in parallel. Packets received by any of the links are merged into one
+ * receive queue by per-link receive threads, and are returned by receive().
+ * The default LogicalAddressHash policy sends all packets to a destination
+ * via one link, so that they are delivered in order. RoundRobin and LeastQueued
+ * spread packets to one destination over the links, and may reorder them;
+ * callers which tolerate reordering select them explicitly:
+ * @code
+ * SpaceWireIFLinkBonding bonding;
+ * bonding.addLink(new SpaceWireIFOverTCP("bridge", 10030));
+ * bonding.addLink(new SpaceWireIFOverTCP("bridge", 10031));
+ * bonding.setPolicy(SpaceWireIFLinkBonding::LeastQueued); //packets may be reordered
+ * bonding.open();
+ * @endcode
+ * send() returns when the packet has been queued, and blocks only while the
+ * selected link has MaxQueuedBytesPerLink bytes waiting; flush() waits until
+ * all queued packets have been sent. A link whose send() or receive() throws
+ * an exception other than Timeout/EEP is regarded as failed, and is no longer
+ * used. The packet which was being sent and the packets queued on a failed
+ * link are moved to the other links (the former to the front of the queue,
+ * so it may be delivered twice if the failed link had sent it). TimeCodes are emitted via the first
+ * available link, and a received TimeCode is forwarded once even when it
+ * arrives via several links. Links are opened and closed via this instance,
+ * but are not deleted.
+ */
+class SpaceWireIFLinkBonding: public SpaceWireIF, public SpaceWireIFActionTimecodeScynchronizedAction {
+public:
+	enum PolicyType {
+		RoundRobin, LeastQueued, LogicalAddressHash
+	};
+
+public:
+	static const size_t DefaultMaxQueuedBytesPerLink = 1024 * 1024;
+	static const size_t DefaultMaxReceiveQueueSize = 4096; //packets
+
+private:
+	/** interval at which link threads check whether they should stop */
+	static const double LinkPollIntervalInMicroSec = 100000;
+
+private:
+	class Packet {
+	public:
+		std::vector<uint8_t> data;
+		SpaceWireEOPMarker::EOPType eopType;
+		SpaceWireReceiveTimestamp timestamp;
+	};
+
+	class LinkThread: public CxxUtilities::StoppableThread {
+	private:
+		SpaceWireIFLinkBonding* parent;
+		size_t index;
+		bool transmit;
+
+	public:
+		LinkThread(SpaceWireIFLinkBonding* parent, size_t index, bool transmit) :
+				parent(parent), index(index), transmit(transmit) {
+		}
+
+	public:
+		void run() {
+			if (transmit) {
+				parent->runTransmit(index);
+			} else {
+				parent->runReceive(index);
+			}
+		}
+	};
+
+	class Link {
+	public:
+		SpaceWireIF* spwif;
+		std::deque<Packet*> transmitQueue;
+		pthread_cond_t transmitCondition;
+		LinkThread* transmitThread;
+		LinkThread* receiveThread;
+		bool transmitFailed;
+		bool receiveFailed;
+		SpaceWireIFLinkBondingStatistics statistics;
+	};
+
+private:
+	std::vector<Link*> links;
+	SpaceWireIFLinkBondingPolicy* policy;
+	SpaceWireIFLinkBondingRoundRobinPolicy roundRobinPolicy;
+	SpaceWireIFLinkBondingLeastQueuedPolicy leastQueuedPolicy;
+	SpaceWireIFLinkBondingLogicalAddressHashPolicy logicalAddressHashPolicy;
+	size_t maxQueuedBytesPerLink;
+	size_t maxReceiveQueueSize;
+	volatile bool stopped;
+
+private:
+	/* transmit side */
+	pthread_mutex_t transmitMutex;
+	pthread_cond_t transmitSpaceCondition;
+	std::vector<Packet*> transmitFreePackets;
+	std::vector<size_t> queuedBytes;
+
+private:
+	/* receive side */
+	pthread_mutex_t receiveMutex;
+	pthread_cond_t receiveCondition;
+	pthread_cond_t receiveSpaceCondition;
+	std::deque<Packet*> receiveQueue;
+	std::vector<Packet*> receiveFreePackets;
+
+private:
+	CxxUtilities::Mutex timecodeMutex;
+	bool timecodeReceived;
+	uint8_t lastTimecode;
+
+public:
+	SpaceWireIFLinkBonding() {
+		policy = &logicalAddressHashPolicy;
+		maxQueuedBytesPerLink = DefaultMaxQueuedBytesPerLink;
+		maxReceiveQueueSize = DefaultMaxReceiveQueueSize;
+		stopped = true;
+		timeoutDurationInMicroSec = 0;
+		timecodeReceived = false;
+		lastTimecode = 0;
+		pthread_mutex_init(&transmitMutex, NULL);
+		pthread_cond_init(&transmitSpaceCondition, NULL);
+		pthread_mutex_init(&receiveMutex, NULL);
+		pthread_cond_init(&receiveCondition, NULL);
+		pthread_cond_init(&receiveSpaceCondition, NULL);
+	}
+
+	virtual ~SpaceWireIFLinkBonding() {
+		if (state == Opened) {
+			close();
+		}
+		for (size_t i = 0; i < links.size(); i++) {
+			links[i]->spwif->deleteTimecodeAction(this);
+			pthread_cond_destroy(&links[i]->transmitCondition);
+			delete links[i];
+		}
+		deletePackets(transmitFreePackets);
+		deletePackets(receiveFreePackets);
+		pthread_cond_destroy(&receiveSpaceCondition);
+		pthread_cond_destroy(&receiveCondition);
+		pthread_mutex_destroy(&receiveMutex);
+		pthread_cond_destroy(&transmitSpaceCondition);
+		pthread_mutex_destroy(&transmitMutex);
+	}
+
+public:
+	/** Adds a link. Should be called before open(). */
+	void addLink(SpaceWireIF* spwif) {
+		Link* link = new Link;
+		link->spwif = spwif;
+		pthread_cond_init(&link->transmitCondition, NULL);
+		link->transmitThread = NULL;
+		link->receiveThread = NULL;
+		link->transmitFailed = false;
+		link->receiveFailed = false;
+		links.push_back(link);
+		queuedBytes.push_back(0);
+		spwif->addTimecodeAction(this);
+	}
+
+	size_t getNLinks() const {
+		return links.size();
+	}
+
+	SpaceWireIF* getLink(size_t index) {
+		return links.at(index)->spwif;
+	}
+
+public:
+	/** Selects one of the built-in policies (default: LogicalAddressHash).
+	 * RoundRobin and LeastQueued may reorder packets to a destination.
+	 */
+	void setPolicy(PolicyType type) {
+		pthread_mutex_lock(&transmitMutex);
+		switch (type) {
+		case RoundRobin:
+			policy = &roundRobinPolicy;
+			break;
+		case LeastQueued:
+			policy = &leastQueuedPolicy;
+			break;
+		default:
+			policy = &logicalAddressHashPolicy;
+			break;
+		}
+		pthread_mutex_unlock(&transmitMutex);
+	}
+
+	/** Sets a user-defined policy (not deleted by this instance). */
+	void setPolicy(SpaceWireIFLinkBondingPolicy* policy) {
+		pthread_mutex_lock(&transmitMutex);
+		this->policy = policy;
+		pthread_mutex_unlock(&transmitMutex);
+	}
+
+	void setMaxQueuedBytesPerLink(size_t maxQueuedBytesPerLink) {
+		this->maxQueuedBytesPerLink = maxQueuedBytesPerLink;
+	}
+
+	void setMaxReceiveQueueSize(size_t maxReceiveQueueSize) {
+		this->maxReceiveQueueSize = maxReceiveQueueSize;
+	}
+
+public:
+	void open() throw (SpaceWireIFException) {
+		if (state == Opened) {
+			return;
+		}
+		if (links.size() == 0) {
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		for (size_t i = 0; i < links.size(); i++) {
+			Link* link = links[i];
+			if (link->spwif->getState() != Opened) {
+				link->spwif->open();
+			}
+			link->spwif->setTimeoutDuration(LinkPollIntervalInMicroSec);
+			link->transmitFailed = false;
+			link->receiveFailed = false;
+		}
+		stopped = false;
+		state = Opened;
+		for (size_t i = 0; i < links.size(); i++) {
+			Link* link = links[i];
+			link->transmitThread = new LinkThread(this, i, true);
+			link->receiveThread = new LinkThread(this, i, false);
+			link->transmitThread->start();
+			link->receiveThread->start();
+		}
+	}
+
+	/** Stops the link threads and closes the links. Packets which have not been sent are discarded. */
+	void close() throw (SpaceWireIFException) {
+		if (state == Closed) {
+			return;
+		}
+		state = Closed;
+		pthread_mutex_lock(&transmitMutex);
+		pthread_mutex_lock(&receiveMutex);
+		stopped = true;
+		for (size_t i = 0; i < links.size(); i++) {
+			pthread_cond_signal(&links[i]->transmitCondition);
+		}
+		pthread_cond_broadcast(&transmitSpaceCondition);
+		pthread_cond_broadcast(&receiveCondition);
+		pthread_cond_broadcast(&receiveSpaceCondition);
+		pthread_mutex_unlock(&receiveMutex);
+		pthread_mutex_unlock(&transmitMutex);
+		for (size_t i = 0; i < links.size(); i++) {
+			Link* link = links[i];
+			link->transmitThread->waitUntilRunMethodComplets();
+			link->receiveThread->waitUntilRunMethodComplets();
+			delete link->transmitThread;
+			delete link->receiveThread;
+			link->transmitThread = NULL;
+			link->receiveThread = NULL;
+			transmitFreePackets.insert(transmitFreePackets.end(), link->transmitQueue.begin(), link->transmitQueue.end());
+			link->transmitQueue.clear();
+			queuedBytes[i] = 0;
+			link->statistics.queuedBytes = 0;
+		}
+		receiveFreePackets.insert(receiveFreePackets.end(), receiveQueue.begin(), receiveQueue.end());
+		receiveQueue.clear();
+		for (size_t i = 0; i < links.size(); i++) {
+			try {
+				links[i]->spwif->close();
+			} catch (...) {
+			}
+		}
+		invokeSpaceWireIFCloseActions();
+	}
+
+public:
+	/** Queues a packet to a link selected by the policy. */
+	void send(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP)
+			throw (SpaceWireIFException) {
+		pthread_mutex_lock(&transmitMutex);
+		size_t index;
+		while (true) {
+			if (stopped) {
+				pthread_mutex_unlock(&transmitMutex);
+				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			}
+			index = selectLink(data, length);
+			if (index == links.size()) {
+				pthread_mutex_unlock(&transmitMutex);
+				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			}
+			if (queuedBytes[index] == 0 || queuedBytes[index] + length <= maxQueuedBytesPerLink) {
+				break;
+			}
+			waitFor(&transmitSpaceCondition, &transmitMutex, LinkPollIntervalInMicroSec);
+		}
+		Packet* packet = allocatePacket(transmitFreePackets);
+		packet->data.assign(data, data + length);
+		packet->eopType = eopType;
+		Link* link = links[index];
+		link->transmitQueue.push_back(packet);
+		queuedBytes[index] += length;
+		link->statistics.queuedBytes = queuedBytes[index];
+		pthread_cond_signal(&link->transmitCondition);
+		//tapped here (in the order of send() calls) rather than by the per-link transmit threads
+		tapSentPacket(data, length, eopType);
+		pthread_mutex_unlock(&transmitMutex);
+	}
+
+	using SpaceWireIF::send;
+
+	/** Waits until all queued packets have been sent (or dropped by failed links). */
+	void flush() throw (SpaceWireIFException) {
+		pthread_mutex_lock(&transmitMutex);
+		while (!stopped) {
+			bool empty = true;
+			for (size_t i = 0; i < links.size(); i++) {
+				if (queuedBytes[i] != 0) {
+					empty = false;
+				}
+			}
+			if (empty) {
+				break;
+			}
+			waitFor(&transmitSpaceCondition, &transmitMutex, LinkPollIntervalInMicroSec);
+		}
+		pthread_mutex_unlock(&transmitMutex);
+	}
+
+public:
+	void receive(std::vector<uint8_t>* buffer) throw (SpaceWireIFException) {
+		Packet* packet = waitForReceivedPacket();
+		buffer->swap(packet->data);
+		SpaceWireEOPMarker::EOPType eopType = packet->eopType;
+		setReceivedPacketTimestamp(packet->timestamp);
+		tapReceivedPacket((buffer->size() != 0) ? &(buffer->at(0)) : NULL, buffer->size(), eopType, packet->timestamp);
+		pthread_mutex_lock(&receiveMutex);
+		receiveFreePackets.push_back(packet);
+		pthread_mutex_unlock(&receiveMutex);
+		if (eopType == SpaceWireEOPMarker::EEP) {
+			setReceivedPacketEOPMarkerType(EEP);
+			if (eepShouldBeReportedAsAnException_) {
+				throw SpaceWireIFException(SpaceWireIFException::EEP);
+			}
+		} else {
+			setReceivedPacketEOPMarkerType(EOP);
+		}
+	}
+
+	using SpaceWireIF::receive;
+
+	size_t receiveBatch(std::vector<std::vector<uint8_t> >& packets, std::vector<SpaceWireEOPMarker::EOPType>& eopTypes,
+			size_t maxPackets = DefaultBatchSize) throw (SpaceWireIFException) {
+		if (maxPackets == 0) {
+			maxPackets = 1;
+		}
+		if (packets.size() < maxPackets) {
+			packets.resize(maxPackets);
+		}
+		eopTypes.resize(packets.size());
+		receivedPacketTimestamps.resize(maxPackets);
+		Packet* packet = waitForReceivedPacket();
+		size_t n = 0;
+		pthread_mutex_lock(&receiveMutex);
+		while (true) {
+			packets[n].swap(packet->data);
+			eopTypes[n] = packet->eopType;
+			receivedPacketTimestamps[n] = packet->timestamp;
+			receiveFreePackets.push_back(packet);
+			n++;
+			if (n == maxPackets || receiveQueue.size() == 0) {
+				break;
+			}
+			packet = receiveQueue.front();
+			receiveQueue.pop_front();
+		}
+		pthread_cond_broadcast(&receiveSpaceCondition);
+		pthread_mutex_unlock(&receiveMutex);
+		for (size_t i = 0; i < n; i++) {
+			tapReceivedPacket((packets[i].size() != 0) ? &(packets[i][0]) : NULL, packets[i].size(), eopTypes[i],
+					receivedPacketTimestamps[i]);
+		}
+		setReceivedPacketEOPMarkerType(eopTypes[n - 1] == SpaceWireEOPMarker::EEP ? EEP : EOP);
+		setReceivedPacketTimestamp(receivedPacketTimestamps[n - 1]);
+		return n;
+	}
+
+public:
+	/** Emits a TimeCode via the first available link. */
+	void emitTimecode(uint8_t timeIn, uint8_t controlFlagIn = 0x00) throw (SpaceWireIFException) {
+		for (size_t i = 0; i < links.size(); i++) {
+			if (!links[i]->transmitFailed) {
+				links[i]->spwif->emitTimecode(timeIn, controlFlagIn);
+				return;
+			}
+		}
+		throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+	}
+
+	/** Forwards a TimeCode received by one of the links (duplicates via other links are ignored). */
+	void doAction(uint8_t timecode) {
+		timecodeMutex.lock();
+		if (timecodeReceived && timecode == lastTimecode) {
+			timecodeMutex.unlock();
+			return;
+		}
+		timecodeReceived = true;
+		lastTimecode = timecode;
+		timecodeMutex.unlock();
+		invokeTimecodeSynchronizedActions(timecode);
+	}
+
+	void setTxLinkRate(uint32_t linkRateType) throw (SpaceWireIFException) {
+		for (size_t i = 0; i < links.size(); i++) {
+			links[i]->spwif->setTxLinkRate(linkRateType);
+		}
+	}
+
+	uint32_t getTxLinkRateType() throw (SpaceWireIFException) {
+		if (links.size() == 0) {
+			throw SpaceWireIFException(SpaceWireIFException::FunctionNotImplemented);
+		}
+		return links[0]->spwif->getTxLinkRateType();
+	}
+
+	/** Sets the timeout of receive() (0 disables the timeout). Links keep their own short timeout. */
+	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException) {
+		timeoutDurationInMicroSec = microsecond;
+	}
+
+	void setRealtimeTimestampEnabled(bool enabled) {
+		SpaceWireIF::setRealtimeTimestampEnabled(enabled);
+		for (size_t i = 0; i < links.size(); i++) {
+			links[i]->spwif->setRealtimeTimestampEnabled(enabled);
+		}
+	}
+
+public:
+	SpaceWireIFLinkBondingStatistics getLinkStatistics(size_t index) {
+		pthread_mutex_lock(&transmitMutex);
+		pthread_mutex_lock(&receiveMutex);
+		SpaceWireIFLinkBondingStatistics statistics = links.at(index)->statistics;
+		pthread_mutex_unlock(&receiveMutex);
+		pthread_mutex_unlock(&transmitMutex);
+		return statistics;
+	}
+
+	std::string getStatisticsAsString() {
+		std::stringstream ss;
+		for (size_t i = 0; i < links.size(); i++) {
+			ss << "link " << i << ": " << getLinkStatistics(i).toString() << std::endl;
+		}
+		return ss.str();
+	}
+
+private:
+	/** Returns the index of the link for a packet, or links.size() if no link is available
+	 * (transmitMutex must be locked).
+	 */
+	size_t selectLink(uint8_t* data, size_t length) {
+		std::vector<size_t> available(queuedBytes);
+		bool anyAvailable = false;
+		for (size_t i = 0; i < links.size(); i++) {
+			if (links[i]->transmitFailed) {
+				available[i] = SpaceWireIFLinkBondingPolicy::LinkNotAvailable;
+			} else {
+				anyAvailable = true;
+			}
+		}
+		if (!anyAvailable) {
+			return links.size();
+		}
+		size_t index = policy->selectLink(data, length, available) % links.size();
+		while (links[index]->transmitFailed) {
+			index = (index + 1) % links.size();
+		}
+		return index;
+	}
+
+	void runTransmit(size_t index) {
+		Link* link = links[index];
+		pthread_mutex_lock(&transmitMutex);
+		while (!stopped) {
+			if (link->transmitQueue.size() == 0) {
+				waitFor(&link->transmitCondition, &transmitMutex, LinkPollIntervalInMicroSec);
+				continue;
+			}
+			Packet* packet = link->transmitQueue.front();
+			link->transmitQueue.pop_front();
+			pthread_mutex_unlock(&transmitMutex);
+			bool failed = false;
+			try {
+				link->spwif->send(packet->data, packet->eopType);
+			} catch (SpaceWireIFException& e) {
+				failed = true;
+			}
+			pthread_mutex_lock(&transmitMutex);
+			if (failed) {
+				link->transmitFailed = true;
+				link->statistics.failed = true;
+				link->transmitQueue.push_front(packet);
+				requeuePackets(index);
+				pthread_cond_broadcast(&transmitSpaceCondition);
+				break;
+			}
+			size_t length = packet->data.size();
+			transmitFreePackets.push_back(packet);
+			queuedBytes[index] -= length;
+			link->statistics.queuedBytes = queuedBytes[index];
+			link->statistics.nSentPackets++;
+			link->statistics.nSentBytes += length;
+			pthread_cond_broadcast(&transmitSpaceCondition);
+		}
+		pthread_mutex_unlock(&transmitMutex);
+	}
+
+	/** Moves packets queued on a failed link to the other links (transmitMutex must be locked).
+	 * The first packet, which was being sent when the link failed, is put to the front of the
+	 * queue of its new link, and the others are appended.
+	 */
+	void requeuePackets(size_t failedIndex) {
+		Link* failedLink = links[failedIndex];
+		bool first = true;
+		while (failedLink->transmitQueue.size() != 0) {
+			Packet* packet = failedLink->transmitQueue.front();
+			failedLink->transmitQueue.pop_front();
+			uint8_t* data = (packet->data.size() != 0) ? &packet->data[0] : NULL;
+			size_t index = selectLink(data, packet->data.size());
+			if (index == links.size()) {
+				failedLink->statistics.nDroppedPackets++;
+				transmitFreePackets.push_back(packet);
+				continue;
+			}
+			if (first) {
+				links[index]->transmitQueue.push_front(packet);
+			} else {
+				links[index]->transmitQueue.push_back(packet);
+			}
+			first = false;
+			queuedBytes[index] += packet->data.size();
+			links[index]->statistics.queuedBytes = queuedBytes[index];
+			pthread_cond_signal(&links[index]->transmitCondition);
+		}
+		queuedBytes[failedIndex] = 0;
+		failedLink->statistics.queuedBytes = 0;
+	}
+
+	void runReceive(size_t index) {
+		Link* link = links[index];
+		pthread_mutex_lock(&receiveMutex);
+		Packet* packet = allocatePacket(receiveFreePackets);
+		pthread_mutex_unlock(&receiveMutex);
+		bool failed = false;
+		while (!stopped) {
+			try {
+				link->spwif->receive(&packet->data);
+			} catch (SpaceWireIFException& e) {
+				if (e.getStatus() == SpaceWireIFException::Timeout) {
+					continue;
+				} else if (e.getStatus() != SpaceWireIFException::EEP) {
+					failed = true;
+					break;
+				}
+			}
+			packet->eopType =
+					(link->spwif->getReceivedPacketEOPMarkerType() == EEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP;
+			packet->timestamp = link->spwif->getReceivedPacketTimestamp();
+			pthread_mutex_lock(&receiveMutex);
+			while (maxReceiveQueueSize <= receiveQueue.size() && !stopped) {
+				waitFor(&receiveSpaceCondition, &receiveMutex, LinkPollIntervalInMicroSec);
+			}
+			link->statistics.nReceivedPackets++;
+			link->statistics.nReceivedBytes += packet->data.size();
+			receiveQueue.push_back(packet);
+			pthread_cond_signal(&receiveCondition);
+			packet = allocatePacket(receiveFreePackets);
+			pthread_mutex_unlock(&receiveMutex);
+		}
+		pthread_mutex_lock(&receiveMutex);
+		receiveFreePackets.push_back(packet);
+		if (failed) {
+			link->receiveFailed = true;
+			link->statistics.failed = true;
+			pthread_cond_broadcast(&receiveCondition);
+		}
+		pthread_mutex_unlock(&receiveMutex);
+	}
+
+	/** Waits until a packet is in the receive queue, and removes it from the queue. */
+	Packet* waitForReceivedPacket() throw (SpaceWireIFException) {
+		uint64_t deadline = 0;
+		if (timeoutDurationInMicroSec != 0) {
+			deadline = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec()
+					+ (uint64_t) (timeoutDurationInMicroSec * 1000);
+		}
+		pthread_mutex_lock(&receiveMutex);
+		while (receiveQueue.size() == 0) {
+			if (stopped || allReceiveLinksFailed()) {
+				pthread_mutex_unlock(&receiveMutex);
+				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			}
+			double waitInMicroSec = LinkPollIntervalInMicroSec;
+			if (deadline != 0) {
+				uint64_t now = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+				if (deadline <= now) {
+					pthread_mutex_unlock(&receiveMutex);
+					throw SpaceWireIFException(SpaceWireIFException::Timeout);
+				}
+				if ((deadline - now) / 1000.0 < waitInMicroSec) {
+					waitInMicroSec = (deadline - now) / 1000.0;
+				}
+			}
+			waitFor(&receiveCondition, &receiveMutex, waitInMicroSec);
+		}
+		Packet* packet = receiveQueue.front();
+		receiveQueue.pop_front();
+		pthread_cond_signal(&receiveSpaceCondition);
+		pthread_mutex_unlock(&receiveMutex);
+		return packet;
+	}
+
+	bool allReceiveLinksFailed() {
+		for (size_t i = 0; i < links.size(); i++) {
+			if (!links[i]->receiveFailed) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static Packet* allocatePacket(std::vector<Packet*>& freePackets) {
+		if (freePackets.size() == 0) {
+			return new Packet;
+		}
+		Packet* packet = freePackets.back();
+		freePackets.pop_back();
+		return packet;
+	}
+
+	static void deletePackets(std::vector<Packet*>& packets) {
+		for (size_t i = 0; i < packets.size(); i++) {
+			delete packets[i];
+		}
+		packets.clear();
+	}
+
+	static void waitFor(pthread_cond_t* condition, pthread_mutex_t* mutex, double microsecond) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		uint64_t nanosecond = deadline.tv_nsec + (uint64_t) (microsecond * 1000);
+		deadline.tv_sec += nanosecond / 1000000000;
+		deadline.tv_nsec = nanosecond % 1000000000;
+		pthread_cond_timedwait(condition, mutex, &deadline);
+	}
+};
+
+#endif /* SPACEWIREIFLINKBONDING_HH_ */
@@ -0,0 +1,370 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireIFLinkRateEmulator.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPACEWIREIFLINKRATEEMULATOR_HH_
+#define SPACEWIREIFLINKRATEEMULATOR_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Mutex.hh"
+
+#include "SpaceWireIF.hh"
+#include "SpaceWireEOPMarker.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+
+/** Paces bits at a fixed rate as a token bucket.
+ * The bucket is implemented in the virtual scheduling form (the time when
+ * the link becomes free is tracked instead of the number of tokens).
+ * Up to bucketDepthInBits bits may be sent back to back after an idle period.
+ * A link which has been idle for less than SchedulingSlackInNanoSec is
+ * regarded as busy until then, so that the oversleep of a caller which
+ * waits for each transmission does not reduce the average rate.
+ */
+class SpaceWireLinkRatePacer {
+public:
+	static const uint64_t SchedulingSlackInNanoSec = 500000;
+
+private:
+	double bitRate; //bits per second (0 means unlimited)
+	double bucketDepthInBits;
+	uint64_t linkFreeAtInNanoSec;
+	CxxUtilities::Mutex mutex;
+
+public:
+	SpaceWireLinkRatePacer(double bitRate = 0, double bucketDepthInBits = 0) :
+			bitRate(bitRate), bucketDepthInBits(bucketDepthInBits), linkFreeAtInNanoSec(0) {
+	}
+
+public:
+	/** Reserves the link for the given number of bits.
+	 * @param[in] nBits number of bits to be transmitted.
+	 * @param[in] earliestStartInNanoSec monotonic time from which the bits are available.
+	 * @param[out] startInNanoSec monotonic time when the transmission starts.
+	 * @returns monotonic time when the last bit has been transmitted.
+	 */
+	uint64_t schedule(double nBits, uint64_t earliestStartInNanoSec, uint64_t& startInNanoSec) {
+		mutex.lock();
+		if (bitRate <= 0) {
+			mutex.unlock();
+			startInNanoSec = earliestStartInNanoSec;
+			return earliestStartInNanoSec;
+		}
+		uint64_t burstTolerance = (uint64_t) (bucketDepthInBits / bitRate * 1e9);
+		uint64_t start = (linkFreeAtInNanoSec + SchedulingSlackInNanoSec < earliestStartInNanoSec) ? earliestStartInNanoSec
+				: linkFreeAtInNanoSec;
+		linkFreeAtInNanoSec = start + (uint64_t) (nBits / bitRate * 1e9);
+		mutex.unlock();
+		//bits which fit in the bucket do not wait for the link
+		startInNanoSec = (start < earliestStartInNanoSec + burstTolerance) ? earliestStartInNanoSec : start
+				- burstTolerance;
+		uint64_t end = linkFreeAtInNanoSec - burstTolerance;
+		return (end < startInNanoSec) ? startInNanoSec : end;
+	}
+
+public:
+	void setBitRate(double bitRate) {
+		mutex.lock();
+		this->bitRate = bitRate;
+		linkFreeAtInNanoSec = 0;
+		mutex.unlock();
+	}
+
+	double getBitRate() const {
+		return bitRate;
+	}
+
+	void setBucketDepthInBits(double bucketDepthInBits) {
+		mutex.lock();
+		this->bucketDepthInBits = bucketDepthInBits;
+		mutex.unlock();
+	}
+
+	double getBucketDepthInBits() const {
+		return bucketDepthInBits;
+	}
+};
+
+/** A SpaceWireIF which emulates the bit rate of a SpaceWire link on top of
+ * another SpaceWireIF (typically SpaceWireIFOverLoopback or
+ * SpaceWireIFOverSharedMemory, which run at memory speed).
+ *
+ * A packet occupies the link for (BitsPerDataCharacter x size + BitsPerEndOfPacketMarker)
+ * bits, i.e. 10 bits per data character and 4 bits for EOP/EEP as on a real
+ * SpaceWire link, and a TimeCode for 14 bits. send() forwards a packet when the
+ * transmit side of the emulated link becomes free, and returns when its last
+ * bit has been transmitted. receive() delivers a packet when its last bit has
+ * been received via the receive side of the emulated link (paced from the
+ * receive timestamp of the underlying interface), plus the propagation delay.
+ * When both ends of a link are wrapped, each direction is therefore paced by
+ * the sender and by the receiver at the same rate, which costs the
+ * serialization time once.
+ *
+ * @code
+ * SpaceWireIFOverLoopback* end1;
+ * SpaceWireIFOverLoopback* end2;
+ * SpaceWireIFOverLoopback::createPair(end1, end2);
+ * SpaceWireIFLinkRateEmulator link1(end1, 10); //10 Mbps
+ * SpaceWireIFLinkRateEmulator link2(end2, 10);
+ * link1.open();
+ * link2.open();
+ * RMAPEngine* rmapEngine = new RMAPEngine(&link1);
+ * @endcode
+ * The underlying interface is opened and closed via this instance, but is not deleted.
+ * TimeCodes received by the underlying interface are forwarded to the actions registered
+ * to this instance without pacing. Asynchronous operations are not supported.
+ */
+class SpaceWireIFLinkRateEmulator: public SpaceWireIF, public SpaceWireIFActionTimecodeScynchronizedAction {
+public:
+	static const double DefaultLinkRateInMbps = 100;
+	static const size_t DefaultBitsPerDataCharacter = 10;
+	static const size_t DefaultBitsPerEndOfPacketMarker = 4;
+	static const size_t BitsPerTimeCode = 14;
+
+private:
+	SpaceWireIF* spwif;
+	SpaceWireLinkRatePacer txPacer;
+	SpaceWireLinkRatePacer rxPacer;
+	double propagationDelayInMicroSec;
+	size_t bitsPerDataCharacter;
+	size_t bitsPerEndOfPacketMarker;
+	uint32_t txLinkRateType;
+
+private:
+	size_t nSentPackets;
+	size_t nReceivedPackets;
+	double nSentBits;
+	double nReceivedBits;
+	CxxUtilities::Mutex statisticsMutex;
+
+public:
+	/** Constructor.
+	 * @param[in] spwif an underlying interface.
+	 * @param[in] linkRateInMbps bit rate of the emulated link in both directions (0 for unlimited).
+	 * @param[in] propagationDelayInMicroSec delay added to received packets.
+	 */
+	SpaceWireIFLinkRateEmulator(SpaceWireIF* spwif, double linkRateInMbps = DefaultLinkRateInMbps,
+			double propagationDelayInMicroSec = 0) :
+			spwif(spwif), propagationDelayInMicroSec(propagationDelayInMicroSec) {
+		bitsPerDataCharacter = DefaultBitsPerDataCharacter;
+		bitsPerEndOfPacketMarker = DefaultBitsPerEndOfPacketMarker;
+		txLinkRateType = (uint32_t) (linkRateInMbps * 1000);
+		nSentPackets = 0;
+		nReceivedPackets = 0;
+		nSentBits = 0;
+		nReceivedBits = 0;
+		setLinkRateInMbps(linkRateInMbps);
+		spwif->addTimecodeAction(this);
+	}
+
+	virtual ~SpaceWireIFLinkRateEmulator() {
+		spwif->deleteTimecodeAction(this);
+	}
+
+public:
+	void open() throw (SpaceWireIFException) {
+		if (spwif->getState() != Opened) {
+			spwif->open();
+		}
+		state = Opened;
+	}
+
+	void close() throw (SpaceWireIFException) {
+		if (state == Closed) {
+			return;
+		}
+		state = Closed;
+		spwif->close();
+		invokeSpaceWireIFCloseActions();
+	}
+
+public:
+	void send(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP)
+			throw (SpaceWireIFException) {
+		double nBits = getPacketSizeInBits(length);
+		uint64_t start;
+		uint64_t end = txPacer.schedule(nBits, SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec(), start);
+		SpaceWireReceiveTimestamp::sleepUntilMonotonicClock(start);
+		spwif->send(data, length, eopType);
+		tapSentPacket(data, length, eopType);
+		SpaceWireReceiveTimestamp::sleepUntilMonotonicClock(end);
+		statisticsMutex.lock();
+		nSentPackets++;
+		nSentBits += nBits;
+		statisticsMutex.unlock();
+	}
+
+	using SpaceWireIF::send;
+
+public:
+	void receive(std::vector<uint8_t>* buffer) throw (SpaceWireIFException) {
+		try {
+			spwif->receive(buffer);
+		} catch (SpaceWireIFException& e) {
+			if (e.getStatus() != SpaceWireIFException::EEP) {
+				throw e;
+			}
+		}
+		int eopType = spwif->getReceivedPacketEOPMarkerType();
+		SpaceWireReceiveTimestamp timestamp = spwif->getReceivedPacketTimestamp();
+		uint64_t arrival = timestamp.isValid() ? timestamp.monotonicInNanoSec
+				: SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+		double nBits = getPacketSizeInBits(buffer->size());
+		uint64_t start;
+		uint64_t end = rxPacer.schedule(nBits, arrival, start);
+		SpaceWireReceiveTimestamp::sleepUntilMonotonicClock(end + (uint64_t) (propagationDelayInMicroSec * 1000));
+		statisticsMutex.lock();
+		nReceivedPackets++;
+		nReceivedBits += nBits;
+		statisticsMutex.unlock();
+		setReceivedPacketTimestamp(timestamp);
+		setReceivedPacketEOPMarkerType(eopType);
+		tapReceivedPacket((buffer->size() != 0) ? &(buffer->at(0)) : NULL, buffer->size(),
+				(eopType == EEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP, timestamp);
+		if (eopType == EEP && eepShouldBeReportedAsAnException_) {
+			throw SpaceWireIFException(SpaceWireIFException::EEP);
+		}
+	}
+
+	using SpaceWireIF::receive;
+
+public:
+	void emitTimecode(uint8_t timeIn, uint8_t controlFlagIn = 0x00) throw (SpaceWireIFException) {
+		uint64_t start;
+		uint64_t end = txPacer.schedule(BitsPerTimeCode, SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec(), start);
+		SpaceWireReceiveTimestamp::sleepUntilMonotonicClock(start);
+		spwif->emitTimecode(timeIn, controlFlagIn);
+		SpaceWireReceiveTimestamp::sleepUntilMonotonicClock(end);
+	}
+
+	/** Forwards a TimeCode received by the underlying interface. */
+	void doAction(uint8_t timecode) {
+		invokeTimecodeSynchronizedActions(timecode);
+	}
+
+public:
+	/** Sets the transmit bit rate of the emulated link.
+	 * @param[in] linkRateType link rate in kbps (e.g. 200000 for 200 Mbps, as in SpaceWireIF::LinkRates).
+	 */
+	void setTxLinkRate(uint32_t linkRateType) throw (SpaceWireIFException) {
+		txLinkRateType = linkRateType;
+		txPacer.setBitRate(linkRateType * 1e3);
+	}
+
+	uint32_t getTxLinkRateType() throw (SpaceWireIFException) {
+		return txLinkRateType;
+	}
+
+	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException) {
+		spwif->setTimeoutDuration(microsecond);
+		timeoutDurationInMicroSec = microsecond;
+	}
+
+	void setRealtimeTimestampEnabled(bool enabled) {
+		SpaceWireIF::setRealtimeTimestampEnabled(enabled);
+		spwif->setRealtimeTimestampEnabled(enabled);
+	}
+
+public:
+	/** Sets the bit rate of both directions (0 for unlimited). */
+	void setLinkRateInMbps(double linkRateInMbps) {
+		setTxLinkRateInMbps(linkRateInMbps);
+		setRxLinkRateInMbps(linkRateInMbps);
+	}
+
+	void setTxLinkRateInMbps(double linkRateInMbps) {
+		txLinkRateType = (uint32_t) (linkRateInMbps * 1000);
+		txPacer.setBitRate(linkRateInMbps * 1e6);
+	}
+
+	void setRxLinkRateInMbps(double linkRateInMbps) {
+		rxPacer.setBitRate(linkRateInMbps * 1e6);
+	}
+
+	double getTxLinkRateInMbps() const {
+		return txPacer.getBitRate() / 1e6;
+	}
+
+	double getRxLinkRateInMbps() const {
+		return rxPacer.getBitRate() / 1e6;
+	}
+
+	void setPropagationDelayInMicroSec(double propagationDelayInMicroSec) {
+		this->propagationDelayInMicroSec = propagationDelayInMicroSec;
+	}
+
+	double getPropagationDelayInMicroSec() const {
+		return propagationDelayInMicroSec;
+	}
+
+	/** Sets the number of bytes which can be sent back to back after the link
+	 * has been idle (default 0; a real link has no burst capacity).
+	 */
+	void setBurstSizeInBytes(size_t burstSize) {
+		txPacer.setBucketDepthInBits(burstSize * bitsPerDataCharacter);
+		rxPacer.setBucketDepthInBits(burstSize * bitsPerDataCharacter);
+	}
+
+	/** Changes the character sizes used for pacing (default 10 bits per data character
+	 * and 4 bits per EOP/EEP).
+	 */
+	void setCharacterSizes(size_t bitsPerDataCharacter, size_t bitsPerEndOfPacketMarker) {
+		this->bitsPerDataCharacter = bitsPerDataCharacter;
+		this->bitsPerEndOfPacketMarker = bitsPerEndOfPacketMarker;
+	}
+
+	/** Returns the number of bits which a packet occupies on the link. */
+	double getPacketSizeInBits(size_t length) const {
+		return (double) length * bitsPerDataCharacter + bitsPerEndOfPacketMarker;
+	}
+
+public:
+	SpaceWireIF* getSpaceWireIF() {
+		return spwif;
+	}
+
+	size_t getNSentPackets() const {
+		return nSentPackets;
+	}
+
+	size_t getNReceivedPackets() const {
+		return nReceivedPackets;
+	}
+
+	double getNSentBits() const {
+		return nSentBits;
+	}
+
+	double getNReceivedBits() const {
+		return nReceivedBits;
+	}
+};
+
+#endif /* SPACEWIREIFLINKRATEEMULATOR_HH_ */
@@ -34,55 +34,385 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #ifndef SPACEWIREIFMULTIPLEXEDIF_HH_
 #define SPACEWIREIFMULTIPLEXEDIF_HH_
 
+#include "CxxUtilities/CommonHeader.hh"
+
+#include <pthread.h>
+#include <time.h>
+
 #include "SpaceWireIF.hh"
 #include "SpaceWireIFMultiplexerSuperClass.hh"
-#include "CxxUtilities/CommonHeader.hh"
+#include "SpaceWireLockFreeQueue.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+
+/** Counters of a virtual SpaceWireIF of SpaceWireIFMultiplexer. */
+class SpaceWireIFMultiplexedIFStatistics {
+public:
+	size_t nReceivedPackets;
+	size_t nDroppedPackets;
+	/** number of times the multiplexer waited for space in the queue (BlockDemultiplexer policy) */
+	size_t nBlockedDeliveries;
+	size_t queueOccupancy;
+	size_t maxQueueOccupancy;
+	size_t queueCapacity;
+
+public:
+	SpaceWireIFMultiplexedIFStatistics() {
+		nReceivedPackets = 0;
+		nDroppedPackets = 0;
+		nBlockedDeliveries = 0;
+		queueOccupancy = 0;
+		maxQueueOccupancy = 0;
+		queueCapacity = 0;
+	}
+
+public:
+	std::string toString() const {
+		std::stringstream ss;
+		ss << "received=" << nReceivedPackets << " dropped=" << nDroppedPackets << " blocked=" << nBlockedDeliveries
+				<< " occupancy=" << queueOccupancy << "/" << queueCapacity << " (max " << maxQueueOccupancy << ")";
+		return ss.str();
+	}
+};
+
+/** A virtual SpaceWireIF created by SpaceWireIFMultiplexer.
+ * Packets routed to this interface by the receive thread of the multiplexer
+ * are stored in a bounded lock-free queue, and are returned by receive().
+ * A receiver blocked in receive() is woken up only when it is actually
+ * waiting, so that delivery to a busy receiver costs one queue push.
+ * When the queue is full, a packet is handled according to the overflow policy:
+ * DropNewest (default) discards the arriving packet, DropOldest discards the
+ * oldest queued packet, and BlockDemultiplexer makes the receive thread of
+ * the multiplexer wait for the receiver. Only BlockDemultiplexer lets a
+ * stalled receiver delay packets for the other virtual SpaceWireIFs.
+ * Sent packets and TimeCodes are passed to the real SpaceWireIF via the multiplexer.
+ */
+class SpaceWireIFMultiplexedIF: public SpaceWireIF {
+public:
+	enum OverflowPolicy {
+		DropNewest, DropOldest, BlockDemultiplexer
+	};
+
+public:
+	static const size_t DefaultQueueCapacity = 1024; //packets
+
+private:
+	struct Entry {
+		std::vector<uint8_t>* buffer;
+		SpaceWireEOPMarker::EOPType eopType;
+		SpaceWireReceiveTimestamp timestamp;
+	};
 
-class SpaceWireIFMultiplexedIF : public SpaceWireIF {
 private:
 	SpaceWireIF* parent;
-	CxxUtilities::Condition receiveTimeoutCondition;
-	CxxUtilities::Mutex receiveMutex;
+	SpaceWireIFMultiplexerSuperClass* multiplexer;
+	std::string name;
+	SpaceWireLockFreeQueue<Entry> queue;
+	OverflowPolicy overflowPolicy;
+
+private:
+	/* wakeup of the receiver (and of the multiplexer waiting for space in the queue) */
+	pthread_mutex_t wakeupMutex;
+	pthread_cond_t receiverCondition;
+	pthread_cond_t spaceCondition;
+	volatile bool receiverWaiting;
+	volatile bool multiplexerWaiting;
 
 public:
-	bool packetArrived;
-	CxxUtilities::Mutex receiveRequestMutex;
+	volatile size_t nReceivedPackets;
+	volatile size_t nDroppedPackets;
+	volatile size_t nBlockedDeliveries;
+	volatile size_t maxQueueOccupancy;
 
 public:
-	SpaceWireIFMultiplexedIF(SpaceWireIF* parentMultiplexer){
-		this->parent=parentMultiplexer;
+	/** Constructor (called by SpaceWireIFMultiplexer::createVirtualSpaceWireIF()).
+	 * @param[in] parent the multiplexer as a SpaceWireIF.
+	 * @param[in] multiplexer the multiplexer.
+	 * @param[in] name name of this interface.
+	 * @param[in] queueCapacity maximum number of packets waiting for receive().
+	 */
+	SpaceWireIFMultiplexedIF(SpaceWireIF* parent, SpaceWireIFMultiplexerSuperClass* multiplexer, std::string name,
+			size_t queueCapacity = DefaultQueueCapacity) :
+			parent(parent), multiplexer(multiplexer), name(name), queue(queueCapacity), overflowPolicy(DropNewest) {
+		pthread_mutex_init(&wakeupMutex, NULL);
+		pthread_cond_init(&receiverCondition, NULL);
+		pthread_cond_init(&spaceCondition, NULL);
+		receiverWaiting = false;
+		multiplexerWaiting = false;
+		nReceivedPackets = 0;
+		nDroppedPackets = 0;
+		nBlockedDeliveries = 0;
+		maxQueueOccupancy = 0;
+		timeoutDurationInMicroSec = 0;
+	}
+
+	virtual ~SpaceWireIFMultiplexedIF() {
+		Entry entry;
+		while (queue.pop(entry)) {
+			delete entry.buffer;
+		}
+		pthread_cond_destroy(&spaceCondition);
+		pthread_cond_destroy(&receiverCondition);
+		pthread_mutex_destroy(&wakeupMutex);
 	}
 
 public:
-	void send(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP) throw (SpaceWireIFException) {
-		parent->send(data,length,eopType);
+	/** Opens the multiplexer if it has not been opened. */
+	void open() throw (SpaceWireIFException) {
+		if (parent->getState() != Opened) {
+			parent->open();
+		}
+		state = Opened;
 	}
 
+	/** Closes this interface (the multiplexer and other virtual interfaces are not affected).
+	 * A thread blocked in receive() returns with Disconnected.
+	 */
+	void close() throw (SpaceWireIFException) {
+		if (state == Closed) {
+			return;
+		}
+		state = Closed;
+		wakeUp(&receiverCondition);
+		invokeSpaceWireIFCloseActions();
+	}
+
+public:
+	void send(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP)
+			throw (SpaceWireIFException) {
+		parent->send(data, length, eopType);
+		tapSentPacket(data, length, eopType);
+	}
+
+	using SpaceWireIF::send;
+
 public:
 	void receive(std::vector<uint8_t>* buffer) throw (SpaceWireIFException) {
-		receiveMutex.lock();
-		this->packetArrived=false;
-		((SpaceWireIFMultiplexerSuperClass*)parent)->receive(buffer,this);
-		receiveTimeoutCondition(timeoutDurationInMicroSec);
-		if(packetArrived=false){
-			receiveRequestMutex.lock();
-			parent->
-			receiveRequestMutex.unlock();
-			throw SpaceWireIFException(SpaceWireIFException::Timeout);
+		Entry entry;
+		waitForEntry(entry);
+		buffer->swap(*entry.buffer);
+		multiplexer->releaseBuffer(entry.buffer);
+		setReceivedPacketTimestamp(entry.timestamp);
+		tapReceivedPacket((buffer->size() != 0) ? &(buffer->at(0)) : NULL, buffer->size(), entry.eopType, entry.timestamp);
+		if (entry.eopType == SpaceWireEOPMarker::EEP) {
+			setReceivedPacketEOPMarkerType(EEP);
+			if (eepShouldBeReportedAsAnException_) {
+				throw SpaceWireIFException(SpaceWireIFException::EEP);
+			}
+		} else {
+			setReceivedPacketEOPMarkerType(EOP);
 		}
-		receiveMutex.unlock();
+	}
+
+	using SpaceWireIF::receive;
+
+	size_t receiveBatch(std::vector<std::vector<uint8_t> >& packets, std::vector<SpaceWireEOPMarker::EOPType>& eopTypes,
+			size_t maxPackets = DefaultBatchSize) throw (SpaceWireIFException) {
+		if (maxPackets == 0) {
+			maxPackets = 1;
+		}
+		if (packets.size() < maxPackets) {
+			packets.resize(maxPackets);
+		}
+		eopTypes.resize(packets.size());
+		receivedPacketTimestamps.resize(maxPackets);
+		Entry entry;
+		waitForEntry(entry);
+		size_t n = 0;
+		do {
+			packets[n].swap(*entry.buffer);
+			multiplexer->releaseBuffer(entry.buffer);
+			eopTypes[n] = entry.eopType;
+			receivedPacketTimestamps[n] = entry.timestamp;
+			tapReceivedPacket((packets[n].size() != 0) ? &(packets[n][0]) : NULL, packets[n].size(), entry.eopType,
+					entry.timestamp);
+			n++;
+		} while (n < maxPackets && popEntry(entry));
+		setReceivedPacketEOPMarkerType(eopTypes[n - 1] == SpaceWireEOPMarker::EEP ? EEP : EOP);
+		setReceivedPacketTimestamp(receivedPacketTimestamps[n - 1]);
+		return n;
 	}
 
 public:
-	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException){
-		this->timeoutDurationInMicroSec=microsecond;
+	void emitTimecode(uint8_t timeIn, uint8_t controlFlagIn = 0x00) throw (SpaceWireIFException) {
+		parent->emitTimecode(timeIn, controlFlagIn);
+	}
+
+	void setTxLinkRate(uint32_t linkRateType) throw (SpaceWireIFException) {
+		parent->setTxLinkRate(linkRateType);
+	}
+
+	uint32_t getTxLinkRateType() throw (SpaceWireIFException) {
+		return parent->getTxLinkRateType();
+	}
+
+	/** Sets the timeout of receive() of this interface (0 disables the timeout). */
+	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException) {
+		timeoutDurationInMicroSec = microsecond;
 	}
 
 public:
-	CxxUtilities::Condition* getReceiveTimeoutCondition(){
-		return &receiveTimeoutCondition;
+	std::string getName() const {
+		return name;
+	}
+
+	/** Returns the number of packets waiting for receive(). */
+	size_t getQueueOccupancy() const {
+		return queue.size();
+	}
+
+	size_t getQueueCapacity() const {
+		return queue.getCapacity();
+	}
+
+	void setOverflowPolicy(OverflowPolicy overflowPolicy) {
+		this->overflowPolicy = overflowPolicy;
+	}
+
+	OverflowPolicy getOverflowPolicy() const {
+		return overflowPolicy;
+	}
+
+	SpaceWireIFMultiplexedIFStatistics getStatistics() const {
+		SpaceWireIFMultiplexedIFStatistics statistics;
+		statistics.nReceivedPackets = nReceivedPackets;
+		statistics.nDroppedPackets = nDroppedPackets;
+		statistics.nBlockedDeliveries = nBlockedDeliveries;
+		statistics.queueOccupancy = queue.size();
+		statistics.maxQueueOccupancy = maxQueueOccupancy;
+		statistics.queueCapacity = queue.getCapacity();
+		return statistics;
+	}
+
+	void resetStatistics() {
+		nReceivedPackets = 0;
+		nDroppedPackets = 0;
+		nBlockedDeliveries = 0;
+		maxQueueOccupancy = queue.size();
+	}
+
+public:
+	/** Appends a received packet (called by the multiplexer). The buffer is owned
+	 * by this instance until it is given back via releaseBuffer().
+	 * @returns false if the queue is full.
+	 */
+	bool push(std::vector<uint8_t>* buffer, SpaceWireEOPMarker::EOPType eopType,
+			const SpaceWireReceiveTimestamp& timestamp) {
+		Entry entry;
+		entry.buffer = buffer;
+		entry.eopType = eopType;
+		entry.timestamp = timestamp;
+		if (!queue.push(entry)) {
+			return false;
+		}
+		__sync_fetch_and_add(&nReceivedPackets, 1);
+		size_t occupancy = queue.size();
+		if (maxQueueOccupancy < occupancy) {
+			maxQueueOccupancy = occupancy;
+		}
+		__sync_synchronize();
+		if (receiverWaiting) {
+			wakeUp(&receiverCondition);
+		}
+		return true;
+	}
+
+	/** Discards the oldest packet in the queue (called by the multiplexer for DropOldest policy).
+	 * @returns false if the queue was empty.
+	 */
+	bool dropOldest() {
+		Entry entry;
+		if (!queue.pop(entry)) {
+			return false;
+		}
+		multiplexer->releaseBuffer(entry.buffer);
+		__sync_fetch_and_add(&nDroppedPackets, 1);
+		return true;
+	}
+
+	/** Counts a packet discarded by the multiplexer because the queue was full. */
+	void countDroppedPacket() {
+		__sync_fetch_and_add(&nDroppedPackets, 1);
+	}
+
+	/** Waits until the queue has space or the duration elapses (called by the multiplexer). */
+	void waitForSpace(double microsecond) {
+		__sync_fetch_and_add(&nBlockedDeliveries, 1);
+		pthread_mutex_lock(&wakeupMutex);
+		multiplexerWaiting = true;
+		__sync_synchronize();
+		if (queue.getCapacity() <= queue.size()) {
+			waitFor(&spaceCondition, microsecond);
+		}
+		multiplexerWaiting = false;
+		pthread_mutex_unlock(&wakeupMutex);
 	}
 
+	/** Wakes up a thread blocked in receive() (e.g. when the multiplexer is closed). */
+	void notifyStateChange() {
+		wakeUp(&receiverCondition);
+	}
+
+private:
+	bool popEntry(Entry& entry) {
+		if (!queue.pop(entry)) {
+			return false;
+		}
+		__sync_synchronize();
+		if (multiplexerWaiting) {
+			wakeUp(&spaceCondition);
+		}
+		return true;
+	}
+
+	void waitForEntry(Entry& entry) throw (SpaceWireIFException) {
+		uint64_t deadline = 0;
+		if (timeoutDurationInMicroSec != 0) {
+			deadline = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec()
+					+ (uint64_t) (timeoutDurationInMicroSec * 1000);
+		}
+		while (!popEntry(entry)) {
+			if (state == Closed || parent->getState() == Closed) {
+				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			}
+			double waitInMicroSec = ReceiveWaitIntervalInMicroSec;
+			if (deadline != 0) {
+				uint64_t now = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+				if (deadline <= now) {
+					throw SpaceWireIFException(SpaceWireIFException::Timeout);
+				}
+				if ((deadline - now) / 1000.0 < waitInMicroSec) {
+					waitInMicroSec = (deadline - now) / 1000.0;
+				}
+			}
+			pthread_mutex_lock(&wakeupMutex);
+			receiverWaiting = true;
+			__sync_synchronize();
+			//re-check after announcing the wait so that a push in between is not missed
+			if (queue.empty() && state == Opened) {
+				waitFor(&receiverCondition, waitInMicroSec);
+			}
+			receiverWaiting = false;
+			pthread_mutex_unlock(&wakeupMutex);
+		}
+	}
+
+	static const double ReceiveWaitIntervalInMicroSec = 100000;
+
+	void wakeUp(pthread_cond_t* condition) {
+		pthread_mutex_lock(&wakeupMutex);
+		pthread_cond_broadcast(condition);
+		pthread_mutex_unlock(&wakeupMutex);
+	}
+
+	/** Waits for a condition (wakeupMutex must be locked). */
+	void waitFor(pthread_cond_t* condition, double microsecond) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		uint64_t nanosecond = deadline.tv_nsec + (uint64_t) (microsecond * 1000);
+		deadline.tv_sec += nanosecond / 1000000000;
+		deadline.tv_nsec = nanosecond % 1000000000;
+		pthread_cond_timedwait(condition, &wakeupMutex, &deadline);
+	}
 };
 
 #endif /* SPACEWIREIFMULTIPLEXEDIF_HH_ */
@@ -31,167 +31,360 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *      Author: yuasa
  */
 
+
 #ifndef SPACEWIREIFMULTIPLEXER_HH_
 #define SPACEWIREIFMULTIPLEXER_HH_
 
-#include "SpaceWireIFMultiplexerSuperClass.hh"
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Mutex.hh"
+#include "CxxUtilities/Thread.hh"
+
 #include "SpaceWireIF.hh"
+#include "SpaceWireIFMultiplexerSuperClass.hh"
 #include "SpaceWireIFMultiplexedIF.hh"
-#include "CxxUtilities/CommonHeader.hh"
+#include "SpaceWireLockFreeQueue.hh"
 
 class SpaceWireIFMultiplexerException: public CxxUtilities::Exception {
 public:
 	enum {
 		NoSuchVirtualSpaceWireIFRegistered, NotImplemented
 	};
+
+public:
+	SpaceWireIFMultiplexerException(uint32_t status) :
+			CxxUtilities::Exception(status) {
+	}
+
+	virtual ~SpaceWireIFMultiplexerException() {
+	}
+
+public:
+	std::string toString() {
+		std::string result;
+		switch (status) {
+		case NoSuchVirtualSpaceWireIFRegistered:
+			result = "NoSuchVirtualSpaceWireIFRegistered";
+			break;
+		case NotImplemented:
+			result = "NotImplemented";
+			break;
+		default:
+			result = "Undefined status";
+			break;
+		}
+		return result;
+	}
 };
 
+/** Shares one SpaceWireIF among several users (e.g. an RMAPEngine and a
+ * SpaceWireREngine) by logical address and protocol ID.
+ * A receive thread of the multiplexer receives packets from the real
+ * SpaceWireIF, and delivers each packet to a virtual SpaceWireIF selected
+ * by the logical address of the packet (the first byte which is not a path
+ * address) and its protocol ID (the following byte).
+ * Routes are held in two levels: a 257-entry array indexed by logical
+ * address (the last entry is for any logical address) points to 256-entry
+ * tables indexed by protocol ID. A route for a specific logical address
+ * takes precedence over the one for any logical address. Packets without a
+ * protocol ID, or with no matching route, are delivered to the default
+ * virtual SpaceWireIF (or discarded if it is not set).
+ * Tables are never modified in place: a route change publishes a modified
+ * copy, so that the receive thread looks up a packet with two or three
+ * loads and no lock. Replaced tables are freed once the receive thread has
+ * started a new batch.
+ * @code
+ * SpaceWireIFMultiplexer multiplexer(spwif);
+ * std::vector<uint8_t> rmapProtocolIDs(1, RMAPProtocol::ProtocolIdentifier);
+ * SpaceWireIFMultiplexedIF* rmapIF = multiplexer.createVirtualSpaceWireIF(rmapProtocolIDs, "RMAP");
+ * std::vector<uint8_t> spwrProtocolIDs(1, SpaceWireRProtocol::ProtocolID);
+ * SpaceWireIFMultiplexedIF* spwrIF = multiplexer.createVirtualSpaceWireIF(spwrProtocolIDs, "SpaceWire-R");
+ * //replies to initiator logical address 0x80 go to a separate RMAPEngine
+ * SpaceWireIFMultiplexedIF* instrumentIF = multiplexer.createVirtualSpaceWireIF(0x80, rmapProtocolIDs, "Instrument");
+ * multiplexer.open(); //opens the real SpaceWireIF, and starts the receive thread
+ * rmapIF->open();
+ * spwrIF->open();
+ * RMAPEngine* rmapEngine = new RMAPEngine(rmapIF);
+ * @endcode
+ * Each virtual SpaceWireIF has a bounded queue, and its overflow policy
+ * (SpaceWireIFMultiplexedIF::setOverflowPolicy()) decides what happens when
+ * the queue is full. With the default policy (DropNewest), a stalled receiver
+ * loses packets but never delays the other virtual SpaceWireIFs; use
+ * BlockDemultiplexer only where no packet may be lost. Virtual SpaceWireIFs are owned by
+ * the multiplexer, and are deleted with it. Sent packets of all virtual
+ * SpaceWireIFs are serialized by the multiplexer. The multiplexer itself
+ * does not support receive().
+ */
 class SpaceWireIFMultiplexer: public SpaceWireIF,
 		public CxxUtilities::StoppableThread,
 		public SpaceWireIFMultiplexerSuperClass,
 		public SpaceWireIFActionTimecodeScynchronizedAction {
+public:
+	static const size_t NProtocolIDs = 256;
+	static const size_t NLogicalAddresses = 256;
+	/** logical address argument which matches any logical address */
+	static const int AnyLogicalAddress = -1;
+	static const size_t FreeBufferQueueCapacity = 4096;
+
+private:
+	/** timeout of the real SpaceWireIF, at which the receive thread checks whether it should stop */
+	static const double ReceivePollIntervalInMicroSec = 100000;
+
+private:
+	/** The second level of the routing table (indexed by protocol ID). */
+	struct RoutingTable {
+		SpaceWireIFMultiplexedIF* spwifs[NProtocolIDs];
+	};
+
+	struct RetiredRoutingTable {
+		RoutingTable* table;
+		size_t epoch;
+	};
+
 private:
-	SpaceWireIF** spwifs;
-	SpaceWireIF** spwifs_default;
-	std::list<SpaceWireIF*> spwif_list;
-	std::map<std::string, SpaceWireIF*> spwif_map;
-	std::map<SpaceWireIF*, std::string> spwif_name_map;
-	std::map<SpaceWireIF*, std::vector<uint8_t> > acceptableProtocolIDMap;
-	std::map<SpaceWireIF*, std::vector<uint8_t>* > receiving_spwif_map;
-	CxxUtilities::Mutex receiving_spwif_map_mutex;
 	SpaceWireIF* realSpaceWireIF;
+	/** indexed by logical address, and the last entry is for any logical address */
+	RoutingTable* volatile routingTables[NLogicalAddresses + 1];
+	SpaceWireIFMultiplexedIF* volatile defaultSpaceWireIF;
+	std::list<SpaceWireIFMultiplexedIF*> spwif_list;
+	std::list<SpaceWireIFMultiplexedIF*> removed_spwif_list;
+	std::map<std::string, SpaceWireIFMultiplexedIF*> spwif_map;
+	CxxUtilities::Mutex registrationMutex;
+	std::deque<RetiredRoutingTable> retiredRoutingTables;
+	/** incremented when a routing table is replaced */
+	volatile size_t routingEpoch;
+	/** routingEpoch seen by the receive thread when it started the current batch */
+	volatile size_t quiescentEpoch;
 	CxxUtilities::Mutex sendMutex;
-	CxxUtilities::Mutex receiveMutex;
-	CxxUtilities::Mutex emitTimecodeMutex;
-	std::list<SpaceWireIF*> spwif_receivewait_list;
-	bool isDefaultSpaceWireIFSet;
-	SpaceWireIF* defaultSpaceWireIF;
-
-public:
-	static const double WaitDurationInMilliSecForReceiveIFSearch=10;//ms
+	SpaceWireLockFreeQueue<std::vector<uint8_t>*> freeBuffers;
+	bool threadStarted;
 
 public:
-	int nReceivedPackets;
-	int nEmptyPacket;
+	volatile size_t nReceivedPackets;
+	volatile size_t nEmptyPacket;
+	volatile size_t nDiscardedPackets;
 
 public:
-	SpaceWireIFMultiplexer(SpaceWireIF* realSpaceWireIF) {
+	SpaceWireIFMultiplexer(SpaceWireIF* realSpaceWireIF) :
+			freeBuffers(FreeBufferQueueCapacity) {
 		this->realSpaceWireIF = realSpaceWireIF;
-		this->spwifs=(SpaceWireIF**)malloc(256*sizeof(SpaceWireIF*));
-		this->spwifs_default=(SpaceWireIF**)malloc(256*sizeof(SpaceWireIF*));
-		this->isDefaultSpaceWireIFSet=false;
-		this->defaultSpaceWireIF=NULL;
+		for (size_t i = 0; i <= NLogicalAddresses; i++) {
+			routingTables[i] = NULL;
+		}
+		routingEpoch = 0;
+		quiescentEpoch = 0;
+		defaultSpaceWireIF = NULL;
+		threadStarted = false;
+		timeoutDurationInMicroSec = 0;
 		realSpaceWireIF->addTimecodeAction(this);
-		nReceivedPackets=0;
-		nEmptyPacket=0;
+		nReceivedPackets = 0;
+		nEmptyPacket = 0;
+		nDiscardedPackets = 0;
 	}
 
-	~SpaceWireIFMultiplexer(){
-		free(this->spwifs);
-		free(this->spwifs_default);
+	~SpaceWireIFMultiplexer() {
+		if (state == Opened) {
+			close();
+		}
+		realSpaceWireIF->deleteTimecodeAction(this);
+		std::list<SpaceWireIFMultiplexedIF*>::iterator it;
+		for (it = spwif_list.begin(); it != spwif_list.end(); it++) {
+			delete *it;
+		}
+		for (it = removed_spwif_list.begin(); it != removed_spwif_list.end(); it++) {
+			delete *it;
+		}
+		std::vector<uint8_t>* buffer;
+		while (freeBuffers.pop(buffer)) {
+			delete buffer;
+		}
+		for (size_t i = 0; i <= NLogicalAddresses; i++) {
+			delete routingTables[i];
+		}
+		for (size_t i = 0; i < retiredRoutingTables.size(); i++) {
+			delete retiredRoutingTables[i].table;
+		}
 	}
 
 	SpaceWireIF* getRealSpaceWireIF() {
 		return realSpaceWireIF;
 	}
 
-	SpaceWireIF* getDefaultSpaceWireIF(){
+	SpaceWireIFMultiplexedIF* getDefaultSpaceWireIF() {
 		return defaultSpaceWireIF;
 	}
 
-	void setDefaultVirtualSpaceWireIF(SpaceWireIF* spwif){
-		for(size_t i=0;i<256;i++){
-			spwifs[i]=spwif;
-			spwifs_default[i]=spwif;
-		}
-		isDefaultSpaceWireIFSet=true;
-		defaultSpaceWireIF=spwif;
+public:
+	/** Creates a virtual SpaceWireIF which receives packets with the given protocol IDs
+	 * (with any logical address). The first virtual SpaceWireIF becomes the default one.
+	 * @param[in] acceptableProtocolIDs protocol IDs routed to the new interface.
+	 * @param[in] name name used by getVirtualSpaceWireIF().
+	 * @param[in] queueCapacity maximum number of packets waiting for receive().
+	 */
+	SpaceWireIFMultiplexedIF* createVirtualSpaceWireIF(std::vector<uint8_t> acceptableProtocolIDs, std::string name = "",
+			size_t queueCapacity = SpaceWireIFMultiplexedIF::DefaultQueueCapacity) {
+		return createVirtualSpaceWireIF(AnyLogicalAddress, acceptableProtocolIDs, name, queueCapacity);
 	}
 
-	void addVirtuaSpaceWirelIF(SpaceWireIF* spwif, std::vector<uint8_t> acceptableProtocolIDs,std::string name="") {
-		if(isDefaultSpaceWireIFSet==false){
-			setDefaultVirtualSpaceWireIF(spwif);
-		}
+	/** Creates a virtual SpaceWireIF which receives packets with the given logical address
+	 * and protocol IDs. The first virtual SpaceWireIF becomes the default one.
+	 * @param[in] logicalAddress logical address routed to the new interface (or AnyLogicalAddress).
+	 * @param[in] acceptableProtocolIDs protocol IDs routed to the new interface.
+	 * @param[in] name name used by getVirtualSpaceWireIF().
+	 * @param[in] queueCapacity maximum number of packets waiting for receive().
+	 */
+	SpaceWireIFMultiplexedIF* createVirtualSpaceWireIF(int logicalAddress, std::vector<uint8_t> acceptableProtocolIDs,
+			std::string name = "", size_t queueCapacity = SpaceWireIFMultiplexedIF::DefaultQueueCapacity) {
+		SpaceWireIFMultiplexedIF* spwif = new SpaceWireIFMultiplexedIF(this, this, name, queueCapacity);
+		registrationMutex.lock();
 		spwif_list.push_back(spwif);
 		spwif_map[name] = spwif;
-		acceptableProtocolIDMap[spwif] = acceptableProtocolIDMap;
-		for(size_t i=0;i<acceptableProtocolIDMap.size();i++){
-			spwifs[acceptableProtocolIDMap[i]]=spwif;
+		for (size_t i = 0; i < acceptableProtocolIDs.size(); i++) {
+			setRoute(logicalAddress, acceptableProtocolIDs[i], spwif);
+		}
+		if (defaultSpaceWireIF == NULL) {
+			defaultSpaceWireIF = spwif;
 		}
+		registrationMutex.unlock();
+		return spwif;
 	}
 
-	SpaceWireIFMultiplexedIF* createVirtualSpaceWireIF(std::vector<uint8_t> acceptableProtocolIDs,std::string name="") {
-		SpaceWireIFMultiplexedIF* spwif = new SpaceWireIFMultiplexedIF(this);
-		addVirtualIF(acceptableProtocolIDs,name);
+	/** Routes packets with a logical address and a protocol ID to a virtual SpaceWireIF
+	 * (replacing an existing route). The receive thread is not blocked.
+	 * @param[in] logicalAddress a logical address (or AnyLogicalAddress).
+	 * @param[in] protocolID a protocol ID.
+	 * @param[in] spwif a virtual SpaceWireIF created by this instance (NULL removes the route).
+	 */
+	void addRoute(int logicalAddress, uint8_t protocolID, SpaceWireIFMultiplexedIF* spwif) {
+		registrationMutex.lock();
+		setRoute(logicalAddress, protocolID, spwif);
+		registrationMutex.unlock();
 	}
 
-	void removeVirtualIF(SpaceWireIF* spwif) throw (SpaceWireIFMultiplexerException) {
-		using namespace std;
-		std::list<SpaceWireIF*>::iterator it_spwif_list = spwif_list.find(spwif);
-		std::map<SpaceWireIF*, std::string>::iterator it_spwif_name_map = spwif_name_map.find(spwif);
-		if (it_spwif_list == spwif_list.end()) {
-			throw SpaceWireIFMultiplexerException(SpaceWireIFMultiplexerException::NoSuchVirtualSpaceWireIFRegistered);
-		}
-		if (it_spwif_name_map == spwif_name_map.end()) {
-			throw SpaceWireIFMultiplexerException(SpaceWireIFMultiplexerException::NoSuchVirtualSpaceWireIFRegistered);
-		}
+	void removeRoute(int logicalAddress, uint8_t protocolID) {
+		addRoute(logicalAddress, protocolID, NULL);
+	}
+
+	/** Returns the virtual SpaceWireIF to which a packet with a logical address and a protocol ID is routed
+	 * (NULL if the packet would be discarded).
+	 */
+	SpaceWireIFMultiplexedIF* findRoute(uint8_t logicalAddress, uint8_t protocolID) {
+		registrationMutex.lock();
+		SpaceWireIFMultiplexedIF* spwif = lookUp(logicalAddress, protocolID);
+		registrationMutex.unlock();
+		return spwif;
+	}
+
+	/** Sets the virtual SpaceWireIF which receives packets not routed by protocol ID (NULL discards them). */
+	void setDefaultVirtualSpaceWireIF(SpaceWireIFMultiplexedIF* spwif) {
+		defaultSpaceWireIF = spwif;
+	}
 
-		std::map<std::string, SpaceWireIF*>::iterator it_spwif_map = spwif_map.find(it_spwif_name_map->second);
-		if (it_spwif_map == spwif_map.end()) {
+	SpaceWireIFMultiplexedIF* getVirtualSpaceWireIF(std::string name) throw (SpaceWireIFMultiplexerException) {
+		registrationMutex.lock();
+		std::map<std::string, SpaceWireIFMultiplexedIF*>::iterator it = spwif_map.find(name);
+		if (it == spwif_map.end()) {
+			registrationMutex.unlock();
 			throw SpaceWireIFMultiplexerException(SpaceWireIFMultiplexerException::NoSuchVirtualSpaceWireIFRegistered);
 		}
+		SpaceWireIFMultiplexedIF* spwif = it->second;
+		registrationMutex.unlock();
+		return spwif;
+	}
 
-		std::map<SpaceWireIF*, std::vector<uint8_t> >::iterator it_acceptableProtocolIDMap =
-				acceptableProtocolIDMap.find(spwif);
-		std::map<SpaceWireIF*, std::vector<uint8_t> >::iterator it_unacceptableProtocolIDMap =
-				unacceptableProtocolIDMap.find(spwif);
-		if (it_acceptableProtocolIDMap == acceptableProtocolIDMap.end()) {
+	/** Stops routing packets to a virtual SpaceWireIF, and closes it.
+	 * The instance is kept (and deleted with the multiplexer) because the
+	 * receive thread may still be delivering a packet to it.
+	 */
+	void removeVirtualIF(SpaceWireIFMultiplexedIF* spwif) throw (SpaceWireIFMultiplexerException) {
+		registrationMutex.lock();
+		std::list<SpaceWireIFMultiplexedIF*>::iterator it_spwif_list = std::find(spwif_list.begin(), spwif_list.end(),
+				spwif);
+		if (it_spwif_list == spwif_list.end()) {
+			registrationMutex.unlock();
 			throw SpaceWireIFMultiplexerException(SpaceWireIFMultiplexerException::NoSuchVirtualSpaceWireIFRegistered);
 		}
-		if (it_unacceptableProtocolIDMap == unacceptableProtocolIDMap.end()) {
-			throw SpaceWireIFMultiplexerException(SpaceWireIFMultiplexerException::NoSuchVirtualSpaceWireIFRegistered);
+		for (size_t i = 0; i <= NLogicalAddresses; i++) {
+			int logicalAddress = (i == NLogicalAddresses) ? AnyLogicalAddress : (int) i;
+			for (size_t protocolID = 0; protocolID < NProtocolIDs; protocolID++) {
+				if (routingTables[i] != NULL && routingTables[i]->spwifs[protocolID] == spwif) {
+					setRoute(logicalAddress, protocolID, NULL);
+				}
+			}
+		}
+		if (defaultSpaceWireIF == spwif) {
+			defaultSpaceWireIF = NULL;
 		}
+		std::map<std::string, SpaceWireIFMultiplexedIF*>::iterator it_spwif_map = spwif_map.find(spwif->getName());
+		if (it_spwif_map != spwif_map.end() && it_spwif_map->second == spwif) {
+			spwif_map.erase(it_spwif_map);
+		}
+		spwif_list.erase(it_spwif_list);
+		removed_spwif_list.push_back(spwif);
+		registrationMutex.unlock();
+		spwif->close();
+	}
 
-		//revert SpaceWireIF array
-		std::vector<uint8_t> acceptableProtocolIDs=it_acceptableProtocolIDMap->second;
-		for(size_t i=0;i<acceptableProtocolIDs.size();i++){
-			spwifs[i]=spwifs_default[i];
+public:
+	/** Opens the real SpaceWireIF (if not opened yet), and starts the receive thread. */
+	void open() throw (SpaceWireIFException) {
+		if (state == Opened) {
+			return;
 		}
+		if (realSpaceWireIF->getState() != Opened) {
+			realSpaceWireIF->open();
+		}
+		realSpaceWireIF->setTimeoutDuration(ReceivePollIntervalInMicroSec);
+		state = Opened;
+		threadStarted = true;
+		this->start();
+	}
 
-		spwif_list.erase(it_spwif_list);
-		spwif_name_map.erase(it_spwif_name_map);
-		spwif_map.erase(it_spwif_map);
-		acceptableProtocolIDMap.erase(it_acceptableProtocolIDMap);
+	/** Stops the receive thread, and closes the real SpaceWireIF.
+	 * Threads blocked in receive() of virtual SpaceWireIFs return with Disconnected.
+	 */
+	void close() throw (SpaceWireIFException) {
+		if (state == Closed) {
+			return;
+		}
+		state = Closed;
+		this->stop();
+		if (threadStarted) {
+			this->waitUntilRunMethodComplets();
+			threadStarted = false;
+		}
+		realSpaceWireIF->close();
+		registrationMutex.lock();
+		std::list<SpaceWireIFMultiplexedIF*>::iterator it;
+		for (it = spwif_list.begin(); it != spwif_list.end(); it++) {
+			(*it)->notifyStateChange();
+		}
+		registrationMutex.unlock();
+		invokeSpaceWireIFCloseActions();
 	}
 
 public:
-	void send(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP) throw (SpaceWireIFException) {
+	void send(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP)
+			throw (SpaceWireIFException) {
 		sendMutex.lock();
-		realSpaceWireIF->send(data, length, eopType);
+		try {
+			realSpaceWireIF->send(data, length, eopType);
+		} catch (...) {
+			sendMutex.unlock();
+			throw;
+		}
 		sendMutex.unlock();
+		tapSentPacket(data, length, eopType);
 	}
 
+	using SpaceWireIF::send;
+
 public:
+	/** Not supported (packets should be received via virtual SpaceWireIFs). */
 	void receive(std::vector<uint8_t>* buffer) throw (SpaceWireIFException) {
-		throw SpaceWireIFMultiplexerException(SpaceWireIFMultiplexerException::NotImplemented);
+		throw SpaceWireIFException(SpaceWireIFException::FunctionNotImplemented);
 	}
 
-	virtual void receive(std::vector<uint8_t>* buffer, SpaceWireIF* spwif) throw (SpaceWireIFException) {
-		receiving_spwif_map_mutex.lock();
-		receiving_spwif_map[spwif]=buffer;
-		receiving_spwif_map_mutex.unlock();
-	}
-
-public:
-	virtual void cancelReceive(SpaceWireIF* spwif) throw (SpaceWireIFException) {
-		receiving_spwif_map_mutex.lock();
-		//delete spwif from receive_spwif_map
-		map<SpaceWireIF*,std::vector<uint8_t>*>::iterator it=receiving_spwif_map.find(receiving_spwif);
-		if(it!=receiving_spwif_map.end()){
-			receiving_spwif_map.erase(it);
-		}
-		receiving_spwif_map_mutex.unlock();
-	}
+	using SpaceWireIF::receive;
 
 public:
 	void emitTimecode(uint8_t timeIn, uint8_t controlFlagIn = 0x00) throw (SpaceWireIFException) {
@@ -206,102 +399,193 @@ public:
 		return realSpaceWireIF->getTxLinkRateType();
 	}
 
-public:
+	/** Has no effect on routing (timeouts are set to each virtual SpaceWireIF). */
 	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException) {
-		realSpaceWireIF->setTimeoutDuration(microsecond);
+		timeoutDurationInMicroSec = microsecond;
 	}
 
 public:
-	uint8_t getTimeCode() throw (SpaceWireIFException) {
-		return realSpaceWireIF->getTimeCode();
+	/** Forwards a TimeCode received by the real SpaceWireIF to all virtual SpaceWireIFs. */
+	void doAction(uint8_t timecode) {
+		invokeTimecodeSynchronizedActions(timecode);
+		registrationMutex.lock();
+		std::list<SpaceWireIFMultiplexedIF*>::iterator it;
+		for (it = spwif_list.begin(); it != spwif_list.end(); it++) {
+			(*it)->invokeTimecodeSynchronizedActions(timecode);
+		}
+		registrationMutex.unlock();
 	}
 
-	void doAction(uint8_t timecode) {
-		this->invokeTimecodeSynchronizedActions(timecode);
+public:
+	void releaseBuffer(std::vector<uint8_t>* buffer) {
+		if (!freeBuffers.push(buffer)) {
+			delete buffer;
+		}
 	}
 
 public:
+	/** Finds the logical address and the protocol ID of a packet.
+	 * Leading path address bytes (0x00-0x1f) are skipped, and the byte following
+	 * the logical address is the protocol ID.
+	 * @returns false if the packet has no protocol ID.
+	 */
+	static bool getRoutingKey(const std::vector<uint8_t>& packet, uint8_t& logicalAddress, uint8_t& protocolID) {
+		size_t size = packet.size();
+		for (size_t i = 0; i < size; i++) {
+			if (0x20 <= packet[i]) {
+				if (size <= i + 1) {
+					return false;
+				}
+				logicalAddress = packet[i];
+				protocolID = packet[i + 1];
+				return true;
+			}
+		}
+		return false;
+	}
+
+public:
+	/** Receives packets from the real SpaceWireIF, and delivers them until close() is called. */
 	void run() {
 		stopped = false;
-		while_loop: while (!stopped) {
-			std::vector<uint8_t> buffer = new std::vector<uint8_t>;
+		std::vector<std::vector<uint8_t> > packets;
+		std::vector<SpaceWireEOPMarker::EOPType> eopTypes;
+		while (!stopped) {
+			//routing tables looked up in the previous batch are no longer referenced
+			quiescentEpoch = routingEpoch;
+			__sync_synchronize();
+			size_t nPackets;
 			try {
-				realSpaceWireIF->receive(buffer);
-			} catch (SpaceWireIFException e) {
+				nPackets = realSpaceWireIF->receiveBatch(packets, eopTypes);
+			} catch (SpaceWireIFException& e) {
 				if (e.getStatus() == SpaceWireIFException::Timeout) {
-					goto while_loop;
-				} else {
-					this->stop();
+					continue;
 				}
+				break;
 			}
-			//search SpaceWire IF that should receive this packet
-			if(buffer->size()!=0){
-				//find protocolID
-				uint8_t logicalAddress;
-				static const int state_path_address=0;
-				static const int state_logical_address=1;
-				static const int state_protocol_id=2;
-				static const int state_cargo=3;
-				int state=state_path_address;
-				uint8_t protocolID=0x00;
-				for(size_t i=0;i<buffer->size();i++){
-					if(state==state_path_address){
-						if(buffer->at(i)>=0x20){
-							state=state_logical_address;
-						}
-					}else if(state==state_logical_address){
-						if(i!=buffer->size()-1){
-							state=state_protocol_id;
-						}
-					}else if(state==state_protocol_id){
-						protocolID=buffer->at(i);
-						state=state_cargo;
-					}else{
-						break;
-					}
+			const std::vector<SpaceWireReceiveTimestamp>& timestamps = realSpaceWireIF->getReceivedPacketTimestamps();
+			for (size_t i = 0; i < nPackets; i++) {
+				if (packets[i].size() == 0) {
+					tapReceivedPacket(NULL, 0, eopTypes[i], timestamps[i]);
+					nEmptyPacket++;
+					continue;
 				}
-				if(state==state_cargo){//protocol id has been found
-					waitUntilVirtualIFReceives(buffer,spwifs[protocolID]);
-				}else{//no protocol id. the packet should be passed to the default SpaceWireIF
-					waitUntilVirtualIFReceives(buffer,defaultSpaceWireIF);
+				tapReceivedPacket(&(packets[i][0]), packets[i].size(), eopTypes[i], timestamps[i]);
+				uint8_t logicalAddress, protocolID;
+				SpaceWireIFMultiplexedIF* spwif;
+				if (getRoutingKey(packets[i], logicalAddress, protocolID)) {
+					spwif = lookUp(logicalAddress, protocolID);
+				} else {
+					spwif = defaultSpaceWireIF;
 				}
+				if (spwif == NULL) {
+					nDiscardedPackets++;
+					continue;
+				}
+				std::vector<uint8_t>* buffer = allocateBuffer();
+				buffer->swap(packets[i]);
+				deliver(spwif, buffer, eopTypes[i], timestamps[i]);
 				nReceivedPackets++;
-			}else{
-				nEmptyPacket++;
 			}
 		}
+		registrationMutex.lock();
+		std::list<SpaceWireIFMultiplexedIF*>::iterator it;
+		for (it = spwif_list.begin(); it != spwif_list.end(); it++) {
+			(*it)->notifyStateChange();
+		}
+		registrationMutex.unlock();
+	}
 
+private:
+	SpaceWireIFMultiplexedIF* lookUp(uint8_t logicalAddress, uint8_t protocolID) {
+		RoutingTable* table = routingTables[logicalAddress];
+		if (table != NULL && table->spwifs[protocolID] != NULL) {
+			return table->spwifs[protocolID];
+		}
+		table = routingTables[NLogicalAddresses];
+		if (table != NULL && table->spwifs[protocolID] != NULL) {
+			return table->spwifs[protocolID];
+		}
+		return defaultSpaceWireIF;
 	}
 
-public:
-	void waitUntilVirtualIFReceives(std::vector<uint8_t>* packet,SpaceWireIF* receiving_spwif){
-		using namespace std;
-		using namespace CxxUtilities;
-		Condition c;
-		while(true){//?? kokode packet wo haki suruka?
-			//find buffer
-			map<SpaceWireIF*,std::vector<uint8_t>* >::iterator it=receiving_spwif_map.find(receiving_spwif_map);
-			if(it!=receiving_spwif_map.end()){//found
-				*(it->second)=*packet;
-				delete packet;
-			}else{//not registered as receiving IF
-				c.wait(WaitDurationInMilliSecForReceiveIFSearch);
+	/** Publishes a copy of a routing table with one entry changed (registrationMutex must be locked). */
+	void setRoute(int logicalAddress, uint8_t protocolID, SpaceWireIFMultiplexedIF* spwif) {
+		size_t index = (logicalAddress == AnyLogicalAddress) ? NLogicalAddresses : (logicalAddress & 0xff);
+		RoutingTable* oldTable = routingTables[index];
+		RoutingTable* table = new RoutingTable;
+		if (oldTable != NULL) {
+			*table = *oldTable;
+		} else {
+			for (size_t i = 0; i < NProtocolIDs; i++) {
+				table->spwifs[i] = NULL;
+			}
+		}
+		table->spwifs[protocolID] = spwif;
+		bool empty = true;
+		for (size_t i = 0; i < NProtocolIDs; i++) {
+			if (table->spwifs[i] != NULL) {
+				empty = false;
+				break;
 			}
 		}
-		//set eop type
-		receiving_spwif->setReceivedPacketEOPMarkerType(realSpaceWireIF->getReceivedPacketEOPMarkerType());
-		//delete spwif from receive request map
-		cancelReceive(receiving_spwif);
+		if (empty) {
+			delete table;
+			table = NULL;
+		}
+		__sync_synchronize();
+		routingTables[index] = table;
+		if (oldTable != NULL) {
+			RetiredRoutingTable retired;
+			retired.table = oldTable;
+			retired.epoch = routingEpoch;
+			retiredRoutingTables.push_back(retired);
+		}
+		__sync_fetch_and_add(&routingEpoch, 1);
+		reclaimRoutingTables();
 	}
 
-public:
-	void doAction(unsigned char timeOut){
-		using namespace std;
-		list<SpaceWireIF*>::iterator it=spwif_list.begin();
-		while(it!=spwif_list.end()){
-			it->second->doAction(timeOut);
-			it++;
+	/** Frees replaced routing tables which the receive thread can no longer reference. */
+	void reclaimRoutingTables() {
+		bool receiveThreadIsRunning = threadStarted;
+		while (retiredRoutingTables.size() != 0) {
+			RetiredRoutingTable& retired = retiredRoutingTables.front();
+			if (receiveThreadIsRunning && quiescentEpoch <= retired.epoch) {
+				break;
+			}
+			delete retired.table;
+			retiredRoutingTables.pop_front();
+		}
+	}
+
+	/** Pushes a packet to a virtual SpaceWireIF, applying its overflow policy if the queue is full. */
+	void deliver(SpaceWireIFMultiplexedIF* spwif, std::vector<uint8_t>* buffer, SpaceWireEOPMarker::EOPType eopType,
+			const SpaceWireReceiveTimestamp& timestamp) {
+		while (!spwif->push(buffer, eopType, timestamp)) {
+			switch (spwif->getOverflowPolicy()) {
+			case SpaceWireIFMultiplexedIF::DropOldest:
+				spwif->dropOldest();
+				break;
+			case SpaceWireIFMultiplexedIF::BlockDemultiplexer:
+				if (!stopped) {
+					spwif->waitForSpace(ReceivePollIntervalInMicroSec);
+					break;
+				}
+				//falls through to discard the packet when stopped
+			default:
+				spwif->countDroppedPacket();
+				releaseBuffer(buffer);
+				return;
+			}
+		}
+	}
+
+	std::vector<uint8_t>* allocateBuffer() {
+		std::vector<uint8_t>* buffer;
+		if (freeBuffers.pop(buffer)) {
+			return buffer;
 		}
+		return new std::vector<uint8_t>;
 	}
 };
 
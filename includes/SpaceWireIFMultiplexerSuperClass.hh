@@ -36,10 +36,17 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "SpaceWireIF.hh"
 
+/** Methods of SpaceWireIFMultiplexer used by SpaceWireIFMultiplexedIF
+ * (separated to avoid mutual inclusion of the two headers).
+ */
 class SpaceWireIFMultiplexerSuperClass {
 public:
-	virtual void receive(std::vector<uint8_t>* buffer, SpaceWireIF* spwif) throw (SpaceWireIFException) {}
-	virtual void cancelReceive(SpaceWireIF* spwif) throw (SpaceWireIFException) {}
+	virtual ~SpaceWireIFMultiplexerSuperClass() {
+	}
+
+public:
+	/** Returns a packet buffer, whose content has been handed to a receiver, to the multiplexer. */
+	virtual void releaseBuffer(std::vector<uint8_t>* buffer) = 0;
 };
 
 #endif /* SPACEWIREIFMULTIPLEXERSUPERCLASS_HH_ */
@@ -0,0 +1,436 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireIFOverCaptureFile.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPACEWIREIFOVERCAPTUREFILE_HH_
+#define SPACEWIREIFOVERCAPTUREFILE_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+
+#include <pthread.h>
+
+#include "SpaceWireIF.hh"
+#include "SpaceWireEOPMarker.hh"
+#include "SpaceWireCaptureFile.hh"
+
+/** A SpaceWireIF which replays packets and TimeCodes recorded in a capture file
+ * (see SpaceWireCaptureFileFormat and SpaceWireCaptureWriter).
+ *
+ * In RecordedTiming mode, a record is delivered when the time elapsed since
+ * the first record, divided by the speed factor, has passed since the
+ * replay started. In AsFastAsPossible mode, records are delivered without waiting.
+ * Received TimeCodes are passed to the registered TimeCode actions by the thread
+ * which calls receive(). When all records have been replayed, receive() throws
+ * SpaceWireIFException::Disconnected, or starts again from the first record
+ * if looping is enabled (unless the file has no packet to replay).
+ * receive() waits for a record without holding the lock of the replay state,
+ * and close() wakes up the waiting threads.
+ *
+ * Records flagged as sent (SpaceWireCaptureFileFormat::FlagSent) are skipped.
+ * Packets sent to this interface are discarded, or are recorded (flagged as sent)
+ * if a writer is set via setSentPacketWriter(). RMAPEngine and SpaceWireREngine can be driven by this
+ * class to regression-test and benchmark them against recorded traffic.
+ * @code
+ * SpaceWireIFOverCaptureFile spwif("traffic.spwcap", SpaceWireIFOverCaptureFile::AsFastAsPossible);
+ * spwif.open();
+ * RMAPEngine* rmapEngine = new RMAPEngine(&spwif);
+ * @endcode
+ */
+class SpaceWireIFOverCaptureFile: public SpaceWireIF {
+public:
+	enum {
+		RecordedTiming, AsFastAsPossible
+	};
+
+private:
+	SpaceWireCaptureReader reader;
+	uint32_t replayMode;
+	double speedFactor;
+	bool loop;
+	pthread_mutex_t receiveMutex;
+	pthread_cond_t closeCondition;
+	SpaceWireCaptureWriter* sentPacketWriter;
+	uint8_t lastTimecode;
+
+private:
+	/* timing */
+	bool replayStarted;
+	uint64_t replayStartInNanoSec;
+	uint64_t firstRecordTimestampInNanoSec;
+	SpaceWireCaptureRecord pendingRecord;
+	bool hasPendingRecord;
+	bool packetFoundInPass;
+
+private:
+	size_t nReplayedPackets;
+	size_t nReplayedTimeCodes;
+	size_t nSentPackets;
+	size_t nLoops;
+
+public:
+	/** Constructor.
+	 * @param[in] fileName a capture file.
+	 * @param[in] replayMode RecordedTiming or AsFastAsPossible.
+	 */
+	SpaceWireIFOverCaptureFile(std::string fileName, uint32_t replayMode = RecordedTiming) :
+			reader(fileName), replayMode(replayMode) {
+		speedFactor = 1;
+		loop = false;
+		timeoutDurationInMicroSec = 0;
+		sentPacketWriter = NULL;
+		lastTimecode = 0;
+		replayStarted = false;
+		replayStartInNanoSec = 0;
+		firstRecordTimestampInNanoSec = 0;
+		hasPendingRecord = false;
+		packetFoundInPass = false;
+		nReplayedPackets = 0;
+		nReplayedTimeCodes = 0;
+		nSentPackets = 0;
+		nLoops = 0;
+		pthread_mutex_init(&receiveMutex, NULL);
+		//waits are measured with CLOCK_MONOTONIC, as the record timestamps
+		pthread_condattr_t attributes;
+		pthread_condattr_init(&attributes);
+		pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+		pthread_cond_init(&closeCondition, &attributes);
+		pthread_condattr_destroy(&attributes);
+	}
+
+	virtual ~SpaceWireIFOverCaptureFile() {
+		reader.close();
+		pthread_cond_destroy(&closeCondition);
+		pthread_mutex_destroy(&receiveMutex);
+	}
+
+public:
+	void open() throw (SpaceWireIFException) {
+		if (state == Opened) {
+			return;
+		}
+		try {
+			reader.open();
+		} catch (SpaceWireCaptureFileException& e) {
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		rewind();
+		state = Opened;
+	}
+
+	void close() throw (SpaceWireIFException) {
+		if (state == Closed) {
+			return;
+		}
+		pthread_mutex_lock(&receiveMutex);
+		state = Closed;
+		pthread_cond_broadcast(&closeCondition);
+		reader.close();
+		pthread_mutex_unlock(&receiveMutex);
+		invokeSpaceWireIFCloseActions();
+	}
+
+public:
+	/** Restarts the replay from the first record. */
+	void rewind() {
+		pthread_mutex_lock(&receiveMutex);
+		reader.rewind();
+		replayStarted = false;
+		hasPendingRecord = false;
+		packetFoundInPass = false;
+		pthread_mutex_unlock(&receiveMutex);
+	}
+
+public:
+	void send(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP)
+			throw (SpaceWireIFException) {
+		if (state != Opened) {
+			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
+		}
+		if (sentPacketWriter != NULL) {
+			try {
+				sentPacketWriter->writePacket(data, length, eopType, SpaceWireReceiveTimestamp(),
+						SpaceWireCaptureFileFormat::FlagSent);
+			} catch (SpaceWireCaptureFileException& e) {
+				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			}
+		}
+		__sync_add_and_fetch(&nSentPackets, 1);
+		tapSentPacket(data, length, eopType);
+	}
+
+	using SpaceWireIF::send;
+
+public:
+	void receive(std::vector<uint8_t>* buffer) throw (SpaceWireIFException) {
+		SpaceWireCaptureRecord record;
+		pthread_mutex_lock(&receiveMutex);
+		try {
+			nextPacket(record, true);
+		} catch (...) {
+			pthread_mutex_unlock(&receiveMutex);
+			throw;
+		}
+		buffer->resize(record.length);
+		if (record.length != 0) {
+			memcpy(&(buffer->at(0)), record.data, record.length);
+		}
+		nReplayedPackets++;
+		pthread_mutex_unlock(&receiveMutex);
+		packetReplayed(*buffer, record.getEOPType());
+	}
+
+	using SpaceWireIF::receive;
+
+public:
+	/** Returns the packets which are due (all the remaining ones, up to maxPackets,
+	 * in AsFastAsPossible mode) in one call.
+	 * @see SpaceWireIF::receiveBatch()
+	 */
+	size_t receiveBatch(std::vector<std::vector<uint8_t> >& packets, std::vector<SpaceWireEOPMarker::EOPType>& eopTypes,
+			size_t maxPackets = DefaultBatchSize) throw (SpaceWireIFException) {
+		if (maxPackets == 0) {
+			maxPackets = 1;
+		}
+		if (packets.size() < maxPackets) {
+			packets.resize(maxPackets);
+		}
+		eopTypes.resize(packets.size());
+		receivedPacketTimestamps.resize(packets.size());
+		size_t nPackets = 0;
+		SpaceWireCaptureRecord record;
+		pthread_mutex_lock(&receiveMutex);
+		try {
+			while (nPackets < maxPackets && nextPacket(record, nPackets == 0)) {
+				packets[nPackets].assign(record.data, record.data + record.length);
+				eopTypes[nPackets] = record.getEOPType();
+				receivedPacketTimestamps[nPackets].capture(realtimeTimestampEnabled);
+				nPackets++;
+			}
+		} catch (SpaceWireIFException& e) {
+			if (nPackets == 0) {
+				pthread_mutex_unlock(&receiveMutex);
+				throw;
+			}
+		}
+		nReplayedPackets += nPackets;
+		pthread_mutex_unlock(&receiveMutex);
+		for (size_t i = 0; i < nPackets; i++) {
+			tapReceivedPacket((packets[i].size() != 0) ? &(packets[i][0]) : NULL, packets[i].size(), eopTypes[i],
+					receivedPacketTimestamps[i]);
+		}
+		setReceivedPacketTimestamp(receivedPacketTimestamps[nPackets - 1]);
+		setReceivedPacketEOPMarkerType((eopTypes[nPackets - 1] == SpaceWireEOPMarker::EEP) ? EEP : EOP);
+		return nPackets;
+	}
+
+public:
+	/** Discards TimeCodes (the recorded ones are replayed via the TimeCode actions). */
+	void emitTimecode(uint8_t timeIn, uint8_t controlFlagIn = 0x00) throw (SpaceWireIFException) {
+	}
+
+	/** Returns the last replayed TimeCode. */
+	uint8_t getTimeCode() {
+		return lastTimecode;
+	}
+
+	virtual void setTxLinkRate(uint32_t linkRateType) throw (SpaceWireIFException) {
+		throw SpaceWireIFException(SpaceWireIFException::FunctionNotImplemented);
+	}
+
+	virtual uint32_t getTxLinkRateType() throw (SpaceWireIFException) {
+		throw SpaceWireIFException(SpaceWireIFException::FunctionNotImplemented);
+	}
+
+	/** Sets the timeout of receive() in RecordedTiming mode (0 waits forever). */
+	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException) {
+		timeoutDurationInMicroSec = microsecond;
+	}
+
+public:
+	void setReplayMode(uint32_t replayMode) {
+		this->replayMode = replayMode;
+		replayStarted = false;
+	}
+
+	uint32_t getReplayMode() const {
+		return replayMode;
+	}
+
+	/** Sets the replay speed in RecordedTiming mode (e.g. 2 replays twice as fast as recorded). */
+	void setSpeedFactor(double speedFactor) {
+		if (speedFactor <= 0) {
+			speedFactor = 1;
+		}
+		this->speedFactor = speedFactor;
+		replayStarted = false;
+	}
+
+	double getSpeedFactor() const {
+		return speedFactor;
+	}
+
+	/** Enables starting again from the first record after the last one. */
+	void setLoop(bool loop) {
+		this->loop = loop;
+	}
+
+	/** Sets a writer which records packets sent to this interface (NULL to discard them).
+	 * The writer is not opened, closed, or deleted by this class.
+	 */
+	void setSentPacketWriter(SpaceWireCaptureWriter* sentPacketWriter) {
+		this->sentPacketWriter = sentPacketWriter;
+	}
+
+public:
+	size_t getNReplayedPackets() const {
+		return nReplayedPackets;
+	}
+
+	size_t getNReplayedTimeCodes() const {
+		return nReplayedTimeCodes;
+	}
+
+	size_t getNSentPackets() const {
+		return nSentPackets;
+	}
+
+	size_t getNLoops() const {
+		return nLoops;
+	}
+
+	SpaceWireCaptureReader* getReader() {
+		return &reader;
+	}
+
+private:
+	/** Returns the next data record when it is due, processing TimeCode records on the way
+	 * (receiveMutex must be locked; it is released while waiting for a record).
+	 * @param[in] blocking if false, returns false instead of waiting.
+	 */
+	bool nextPacket(SpaceWireCaptureRecord& record, bool blocking) throw (SpaceWireIFException) {
+		uint64_t start = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+		while (true) {
+			if (state != Opened) {
+				throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
+			}
+			if (!hasPendingRecord) {
+				if (!reader.next(pendingRecord)) {
+					//a file without packets to replay would make receive() loop forever
+					if (!loop || !packetFoundInPass) {
+						throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+					}
+					reader.rewind();
+					replayStarted = false;
+					packetFoundInPass = false;
+					nLoops++;
+					continue;
+				}
+				hasPendingRecord = true;
+			}
+			if (pendingRecord.isSent()) {
+				//packets sent by the capturing node (see SpaceWireTap) are not replayed
+				hasPendingRecord = false;
+				continue;
+			}
+			if (pendingRecord.isData()) {
+				packetFoundInPass = true;
+			}
+			uint64_t now = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+			uint64_t due = getDueTime(pendingRecord, now);
+			if (now < due) {
+				if (!blocking) {
+					return false;
+				}
+				if (timeoutDurationInMicroSec != 0) {
+					uint64_t deadline = start + (uint64_t) (timeoutDurationInMicroSec * 1000);
+					if (deadline <= now) {
+						throw SpaceWireIFException(SpaceWireIFException::Timeout);
+					}
+					if (deadline < due) {
+						due = deadline;
+					}
+				}
+				//another thread may have taken the record, or close() may have been called, meanwhile
+				waitUntil(due);
+				continue;
+			}
+			hasPendingRecord = false;
+			if (pendingRecord.isTimeCode()) {
+				lastTimecode = pendingRecord.timecode;
+				nReplayedTimeCodes++;
+				invokeTimecodeSynchronizedActions(pendingRecord.timecode);
+				continue;
+			}
+			record = pendingRecord;
+			return true;
+		}
+	}
+
+	/** Returns the monotonic time when the record is due (0 in AsFastAsPossible mode). */
+	uint64_t getDueTime(const SpaceWireCaptureRecord& record, uint64_t now) {
+		if (replayMode == AsFastAsPossible) {
+			return 0;
+		}
+		if (!replayStarted) {
+			replayStarted = true;
+			replayStartInNanoSec = now;
+			firstRecordTimestampInNanoSec = record.timestampInNanoSec;
+		}
+		uint64_t elapsed =
+				(firstRecordTimestampInNanoSec < record.timestampInNanoSec) ? record.timestampInNanoSec
+						- firstRecordTimestampInNanoSec : 0;
+		return replayStartInNanoSec + (uint64_t) (elapsed / speedFactor);
+	}
+
+	/** Waits until the monotonic time, or until close() is called (receiveMutex must be locked). */
+	void waitUntil(uint64_t timeInNanoSec) {
+		struct timespec until;
+		until.tv_sec = timeInNanoSec / 1000000000;
+		until.tv_nsec = timeInNanoSec % 1000000000;
+		pthread_cond_timedwait(&closeCondition, &receiveMutex, &until);
+	}
+
+	void packetReplayed(const std::vector<uint8_t>& packet, SpaceWireEOPMarker::EOPType eopType)
+			throw (SpaceWireIFException) {
+		receivedPacketTimestamp.capture(realtimeTimestampEnabled);
+		tapReceivedPacket((packet.size() != 0) ? &(packet[0]) : NULL, packet.size(), eopType, receivedPacketTimestamp);
+		if (eopType == SpaceWireEOPMarker::EEP) {
+			setReceivedPacketEOPMarkerType(EEP);
+			if (eepShouldBeReportedAsAnException_) {
+				throw SpaceWireIFException(SpaceWireIFException::EEP);
+			}
+		} else {
+			setReceivedPacketEOPMarkerType(EOP);
+		}
+	}
+};
+
+#endif /* SPACEWIREIFOVERCAPTUREFILE_HH_ */
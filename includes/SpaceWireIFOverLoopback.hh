@@ -0,0 +1,153 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireIFOverLoopback.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIREIFOVERLOOPBACK_HH_
+#define SPACEWIREIFOVERLOOPBACK_HH_
+
+#include "CxxUtilities/CxxUtilities.hh"
+
+#include "SpaceWireIF.hh"
+#include "SpaceWireIFOverTCP.hh"
+#include "SpaceWireSSDTPModule.hh"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/** SpaceWire IF class which is connected to another instance in the same
+ * process via a UNIX domain stream socket pair.
+ * Both ends speak real SSDTP over the socket, and behave in the same manner
+ * as SpaceWireIFOverTCP connected to a SpaceWire-to-GigabitEther bridge
+ * (packets, EEP, TimeCodes, timeout and disconnection).
+ * This allows RMAPEngine, RMAPInitiator, and SpaceWireREngine to be run end to end
+ * without hardware, e.g. to measure the overhead of the library itself.
+ * @code
+ * SpaceWireIFOverLoopback* initiatorSide;
+ * SpaceWireIFOverLoopback* targetSide;
+ * SpaceWireIFOverLoopback::createPair(initiatorSide, targetSide);
+ * initiatorSide->open();
+ * targetSide->open();
+ * @endcode
+ */
+class SpaceWireIFOverLoopback: public SpaceWireIFOverTCP {
+private:
+	int socketDescriptor;
+
+public:
+	/** Constructor.
+	 * @param[in] socketDescriptor one end of a connected stream socket. The descriptor
+	 * is owned by this instance, and is closed by close().
+	 */
+	SpaceWireIFOverLoopback(int socketDescriptor) :
+			SpaceWireIFOverTCP(), socketDescriptor(socketDescriptor) {
+		ssdtp = NULL;
+		datasocket = NULL;
+		serverSocket = NULL;
+		setOperationMode(ClientMode);
+	}
+
+	virtual ~SpaceWireIFOverLoopback() {
+		close();
+		closeSocket();
+	}
+
+public:
+	/** Creates a pair of interfaces connected to each other.
+	 * Instances should be opened by open(), and be deleted by the caller.
+	 */
+	static void createPair(SpaceWireIFOverLoopback*& end1, SpaceWireIFOverLoopback*& end2) throw (SpaceWireIFException) {
+		int socketDescriptors[2];
+		if (::socketpair(AF_UNIX, SOCK_STREAM, 0, socketDescriptors) != 0) {
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		end1 = new SpaceWireIFOverLoopback(socketDescriptors[0]);
+		end2 = new SpaceWireIFOverLoopback(socketDescriptors[1]);
+	}
+
+public:
+	void open() throw (SpaceWireIFException) {
+		if (socketDescriptor < 0) {
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		if (state == Opened) {
+			return;
+		}
+		ssdtp = new SpaceWireSSDTPModule(socketDescriptor, ssdtpBufferPool);
+		ssdtp->setRealtimeTimestampEnabled(realtimeTimestampEnabled);
+		if (timecodeDispatcher != NULL) {
+			ssdtp->setTimeCodeAction(timecodeDispatcher);
+		} else {
+			ssdtp->setTimeCodeAction(this);
+		}
+		setTimeoutDuration(500000);
+		state = Opened;
+	}
+
+	/** Closes the interface. The other end will see disconnection.
+	 * A closed instance cannot be opened again.
+	 */
+	void close() throw (SpaceWireIFException) {
+		if (state == Closed) {
+			return;
+		}
+		state = Closed;
+		//invoke SpaceWireIFCloseActions to tell other instances
+		//closing of this SpaceWire interface
+		invokeSpaceWireIFCloseActions();
+		stopAsyncWorker();
+		//wake up threads blocked in receive
+		::shutdown(socketDescriptor, SHUT_RDWR);
+		if (ssdtp != NULL) {
+			delete ssdtp;
+		}
+		ssdtp = NULL;
+		closeSocket();
+	}
+
+public:
+	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException) {
+		if (ssdtp != NULL) {
+			ssdtp->setTimeout(microsecond / 1000.);
+		}
+		timeoutDurationInMicroSec = microsecond;
+	}
+
+private:
+	void closeSocket() {
+		if (socketDescriptor >= 0) {
+			::close(socketDescriptor);
+			socketDescriptor = -1;
+		}
+	}
+};
+
+#endif /* SPACEWIREIFOVERLOOPBACK_HH_ */
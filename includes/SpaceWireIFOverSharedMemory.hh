@@ -0,0 +1,715 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireIFOverSharedMemory.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIREIFOVERSHAREDMEMORY_HH_
+#define SPACEWIREIFOVERSHAREDMEMORY_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Mutex.hh"
+#include "CxxUtilities/Time.hh"
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "SpaceWireIF.hh"
+#include "SpaceWireEOPMarker.hh"
+
+/** Control block of a single-producer single-consumer ring in shared memory.
+ * Positions are free-running byte counters (modulo 2^32), and the ring
+ * size is a power of two. Each member written by the producer and each member
+ * written by the consumer is placed on its own cache line.
+ */
+struct SpaceWireSharedMemoryRingHeader {
+	/** written by the producer */
+	volatile uint32_t head;
+	volatile int32_t dataSequence; //futex word, incremented when records are published
+	volatile int32_t producerWaiting;
+	uint8_t padding0[52];
+	/** written by the consumer */
+	volatile uint32_t tail;
+	volatile int32_t spaceSequence; //futex word, incremented when records are consumed
+	volatile int32_t consumerWaiting;
+	uint8_t padding1[52];
+};
+
+/** Header placed at the top of the shared memory object. */
+struct SpaceWireSharedMemoryHeader {
+	volatile uint32_t magic;
+	uint32_t version;
+	uint32_t ringSize;
+	/** indexed by SpaceWireIFOverSharedMemory::ServerMode/ClientMode */
+	volatile int32_t opened[2];
+	volatile int32_t attached[2]; //set once the side has opened
+	uint8_t padding[36];
+};
+
+/** One direction of SpaceWireIFOverSharedMemory.
+ * A record consists of an 8-byte header (length, type, TimeCode value)
+ * followed by the payload padded to 8 bytes. Records wrap around the end of
+ * the ring. Consumers are woken via futex on Linux only when they are
+ * actually sleeping, so that a busy link does not issue system calls per packet.
+ */
+class SpaceWireSharedMemoryRing {
+public:
+	enum RecordType {
+		DataEOP = 0x00, DataEEP = 0x01, TimeCode = 0x02
+	};
+
+	static const size_t RecordHeaderSize = 8;
+
+private:
+	SpaceWireSharedMemoryRingHeader* header;
+	uint8_t* data;
+	uint32_t ringSize;
+
+public:
+	SpaceWireSharedMemoryRing() :
+			header(NULL), data(NULL), ringSize(0) {
+	}
+
+public:
+	void attach(SpaceWireSharedMemoryRingHeader* header, uint8_t* data, uint32_t ringSize) {
+		this->header = header;
+		this->data = data;
+		this->ringSize = ringSize;
+	}
+
+	void initialize() {
+		memset(header, 0, sizeof(SpaceWireSharedMemoryRingHeader));
+	}
+
+public:
+	/** Returns the number of ring bytes consumed by a record with the given payload length. */
+	static size_t getRecordSize(size_t length) {
+		return RecordHeaderSize + ((length + 7) & ~(size_t) 7);
+	}
+
+	bool canHold(size_t length) const {
+		return getRecordSize(length) <= ringSize;
+	}
+
+	bool isEmpty() const {
+		return header->head == header->tail;
+	}
+
+	size_t getFreeSize() const {
+		return ringSize - (header->head - header->tail);
+	}
+
+public:
+	/** Publishes a record. Callers should have checked that the ring has enough space.
+	 */
+	void write(uint8_t type, uint8_t timecode, const uint8_t* payload, size_t length) {
+		uint32_t head = header->head;
+		uint8_t recordHeader[RecordHeaderSize];
+		recordHeader[0] = length & 0xff;
+		recordHeader[1] = (length >> 8) & 0xff;
+		recordHeader[2] = (length >> 16) & 0xff;
+		recordHeader[3] = (length >> 24) & 0xff;
+		recordHeader[4] = type;
+		recordHeader[5] = timecode;
+		recordHeader[6] = 0;
+		recordHeader[7] = 0;
+		copyIn(head, recordHeader, RecordHeaderSize);
+		if (length != 0) {
+			copyIn(head + RecordHeaderSize, payload, length);
+		}
+		__sync_synchronize(); //payload should be visible before head
+		header->head = head + getRecordSize(length);
+		__sync_fetch_and_add(&header->dataSequence, 1);
+		if (header->consumerWaiting) {
+			wake(&header->dataSequence);
+		}
+	}
+
+	/** Reads the header of the oldest record. The ring should not be empty. */
+	void peek(uint8_t& type, uint8_t& timecode, size_t& length) {
+		uint8_t recordHeader[RecordHeaderSize];
+		__sync_synchronize(); //head should be read before the record
+		copyOut(header->tail, recordHeader, RecordHeaderSize);
+		length = recordHeader[0] + (recordHeader[1] << 8) + (recordHeader[2] << 16) + (recordHeader[3] << 24);
+		type = recordHeader[4];
+		timecode = recordHeader[5];
+	}
+
+	/** Copies (up to maxLength bytes of) the payload of the oldest record, and removes the record. */
+	void consume(uint8_t* destination, size_t length, size_t maxLength) {
+		uint32_t tail = header->tail;
+		if (length != 0 && maxLength != 0) {
+			copyOut(tail + RecordHeaderSize, destination, (length < maxLength) ? length : maxLength);
+		}
+		__sync_synchronize(); //payload should be read before the space is released
+		header->tail = tail + getRecordSize(length);
+		__sync_fetch_and_add(&header->spaceSequence, 1);
+		if (header->producerWaiting) {
+			wake(&header->spaceSequence);
+		}
+	}
+
+public:
+	/** Blocks until a record is published or the timeout expires.
+	 * Spurious returns are allowed; callers should re-check the ring.
+	 */
+	void waitData(int32_t observedSequence, double timeoutInMilliSec) {
+		header->consumerWaiting = 1;
+		__sync_synchronize();
+		if (isEmpty()) {
+			wait(&header->dataSequence, observedSequence, timeoutInMilliSec);
+		}
+		header->consumerWaiting = 0;
+	}
+
+	/** Blocks until a record is consumed or the timeout expires. */
+	void waitSpace(int32_t observedSequence, size_t requiredSize, double timeoutInMilliSec) {
+		header->producerWaiting = 1;
+		__sync_synchronize();
+		if (getFreeSize() < requiredSize) {
+			wait(&header->spaceSequence, observedSequence, timeoutInMilliSec);
+		}
+		header->producerWaiting = 0;
+	}
+
+	int32_t getDataSequence() const {
+		return header->dataSequence;
+	}
+
+	int32_t getSpaceSequence() const {
+		return header->spaceSequence;
+	}
+
+	/** Wakes all the threads waiting on this ring (used when a side is closed). */
+	void wakeAll() {
+		__sync_fetch_and_add(&header->dataSequence, 1);
+		__sync_fetch_and_add(&header->spaceSequence, 1);
+		wake(&header->dataSequence);
+		wake(&header->spaceSequence);
+	}
+
+private:
+	void copyIn(uint32_t position, const uint8_t* source, size_t length) {
+		size_t offset = position & (ringSize - 1);
+		size_t firstPart = ringSize - offset;
+		if (length <= firstPart) {
+			memcpy(data + offset, source, length);
+		} else {
+			memcpy(data + offset, source, firstPart);
+			memcpy(data, source + firstPart, length - firstPart);
+		}
+	}
+
+	void copyOut(uint32_t position, uint8_t* destination, size_t length) {
+		size_t offset = position & (ringSize - 1);
+		size_t firstPart = ringSize - offset;
+		if (length <= firstPart) {
+			memcpy(destination, data + offset, length);
+		} else {
+			memcpy(destination, data + offset, firstPart);
+			memcpy(destination + firstPart, data, length - firstPart);
+		}
+	}
+
+private:
+	static void wait(volatile int32_t* address, int32_t value, double timeoutInMilliSec) {
+#ifdef __linux__
+		struct timespec timeout;
+		timeout.tv_sec = (time_t) (timeoutInMilliSec / 1000);
+		timeout.tv_nsec = (long) ((timeoutInMilliSec - timeout.tv_sec * 1000.0) * 1000000);
+		syscall(SYS_futex, address, FUTEX_WAIT, value, &timeout, NULL, 0);
+#else
+		//no futex; poll
+		if (*address == value) {
+			usleep(PollingIntervalInMicroSec);
+		}
+#endif
+	}
+
+	static void wake(volatile int32_t* address) {
+#ifdef __linux__
+		syscall(SYS_futex, address, FUTEX_WAKE, 0x7fffffff, NULL, NULL, 0);
+#endif
+	}
+
+private:
+	static const useconds_t PollingIntervalInMicroSec = 50;
+};
+
+/** SpaceWire IF class which exchanges packets and TimeCodes with another
+ * process on the same host via POSIX shared memory.
+ * The shared memory object holds a pair of single-producer single-consumer
+ * rings (server-to-client and client-to-server), so packets are copied once into
+ * the ring and once out of it, without a TCP stack or SSDTP framing.
+ * The server side creates the object in open() (a stale object of the same name
+ * is removed), and the client side attaches to it. Packets sent before the
+ * peer opens stay in the ring. Closing one side is reported to the other side
+ * as SpaceWireIFException::Disconnected once the ring has been drained.
+ * @code
+ * //simulator process
+ * SpaceWireIFOverSharedMemory spwif("/egse_link0", SpaceWireIFOverSharedMemory::ServerMode);
+ * //control software process
+ * SpaceWireIFOverSharedMemory spwif("/egse_link0", SpaceWireIFOverSharedMemory::ClientMode);
+ * @endcode
+ */
+class SpaceWireIFOverSharedMemory: public SpaceWireIF {
+public:
+	enum {
+		ServerMode = 0, ClientMode = 1
+	};
+
+public:
+	static const uint32_t Magic = 0x53574d31; //"SWM1"
+	static const uint32_t Version = 1;
+	static const size_t DefaultRingSize = 4 * 1024 * 1024;
+
+private:
+	std::string name;
+	uint32_t operationMode;
+	size_t requestedRingSize;
+	SpaceWireSharedMemoryHeader* header;
+	void* mapping;
+	size_t mappingSize;
+	SpaceWireSharedMemoryRing sendRing;
+	SpaceWireSharedMemoryRing receiveRing;
+	CxxUtilities::Mutex sendMutex;
+	CxxUtilities::Mutex receiveMutex;
+	uint8_t lastTimecode;
+
+public:
+	/** Constructor.
+	 * @param[in] name name of the POSIX shared memory object (e.g. "/spw0").
+	 * @param[in] operationMode ServerMode (creates the object) or ClientMode (attaches to it).
+	 * @param[in] ringSize size of each ring in bytes, rounded up to a power of two
+	 * (used only in ServerMode; a client uses the size chosen by the server).
+	 * Sending a packet larger than the ring size minus 8 bytes throws
+	 * SpaceWireIFException::PacketTooLarge.
+	 */
+	SpaceWireIFOverSharedMemory(std::string name, uint32_t operationMode, size_t ringSize = DefaultRingSize) :
+			SpaceWireIF(), name(name), operationMode(operationMode), requestedRingSize(ringSize), header(NULL), mapping(
+					NULL), mappingSize(0), lastTimecode(0x00) {
+		timeoutDurationInMicroSec = 0;
+	}
+
+	virtual ~SpaceWireIFOverSharedMemory() {
+		close();
+		unmap();
+	}
+
+public:
+	void open() throw (SpaceWireIFException) {
+		if (state == Opened) {
+			return;
+		}
+		unmap();
+		if (operationMode == ServerMode) {
+			create();
+		} else {
+			attach();
+		}
+		setTimeoutDuration(500000);
+		state = Opened;
+	}
+
+	/** Closes this side. The peer receives SpaceWireIFException::Disconnected.
+	 * The server side also removes the name of the shared memory object.
+	 */
+	void close() throw (SpaceWireIFException) {
+		if (state == Closed) {
+			return;
+		}
+		state = Closed;
+		//invoke SpaceWireIFCloseActions to tell other instances
+		//closing of this SpaceWire interface
+		invokeSpaceWireIFCloseActions();
+		header->opened[operationMode] = 0;
+		__sync_synchronize();
+		sendRing.wakeAll();
+		receiveRing.wakeAll();
+		if (operationMode == ServerMode) {
+			::shm_unlink(name.c_str());
+		}
+	}
+
+public:
+	void send(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP)
+			throw (SpaceWireIFException) {
+		uint8_t type = (eopType == SpaceWireEOPMarker::EEP) ? SpaceWireSharedMemoryRing::DataEEP
+				: SpaceWireSharedMemoryRing::DataEOP;
+		sendRecord(type, 0x00, data, length);
+		tapSentPacket(data, length, eopType);
+	}
+
+	using SpaceWireIF::send;
+
+public:
+	void receive(std::vector<uint8_t>* buffer) throw (SpaceWireIFException) {
+		receiveMutex.lock();
+		try {
+			uint8_t type;
+			size_t length;
+			waitPacket(type, length);
+			buffer->resize(length);
+			receiveRing.consume((length != 0) ? &(buffer->at(0)) : NULL, length, length);
+			tapReceivedPacket((length != 0) ? &(buffer->at(0)) : NULL, length, getEOPType(type), receivedPacketTimestamp);
+			receiveMutex.unlock();
+			packetReceived(type);
+		} catch (...) {
+			receiveMutex.unlock();
+			throw;
+		}
+	}
+
+	/** Receives a packet directly into a caller-owned buffer.
+	 * When the packet is longer than maxLength, the first maxLength bytes are stored,
+	 * the rest is discarded, and SpaceWireIFException::ReceiveBufferTooSmall is thrown.
+	 */
+	void receive(uint8_t* buffer, SpaceWireEOPMarker::EOPType& eopType, size_t maxLength, size_t& length)
+			throw (SpaceWireIFException) {
+		receiveMutex.lock();
+		uint8_t type;
+		try {
+			waitPacket(type, length);
+			receiveRing.consume(buffer, length, maxLength);
+			tapReceivedPacket(buffer, (length < maxLength) ? length : maxLength, getEOPType(type), receivedPacketTimestamp);
+		} catch (...) {
+			receiveMutex.unlock();
+			throw;
+		}
+		receiveMutex.unlock();
+		eopType = getEOPType(type);
+		if (maxLength < length) {
+			throw SpaceWireIFException(SpaceWireIFException::ReceiveBufferTooSmall);
+		}
+		packetReceived(type);
+	}
+
+	using SpaceWireIF::receive;
+
+public:
+	/** Receives the packets which are already in the ring (up to maxPackets) in one call.
+	 * @see SpaceWireIF::receiveBatch()
+	 */
+	size_t receiveBatch(std::vector<std::vector<uint8_t> >& packets, std::vector<SpaceWireEOPMarker::EOPType>& eopTypes,
+			size_t maxPackets = DefaultBatchSize) throw (SpaceWireIFException) {
+		if (maxPackets == 0) {
+			maxPackets = 1;
+		}
+		if (packets.size() < maxPackets) {
+			packets.resize(maxPackets);
+		}
+		eopTypes.resize(packets.size());
+		receivedPacketTimestamps.resize(packets.size());
+		size_t nPackets = 0;
+		uint8_t type;
+		size_t length;
+		receiveMutex.lock();
+		try {
+			while (nPackets < maxPackets && waitPacket(type, length, nPackets == 0)) {
+				std::vector<uint8_t>& packet = packets[nPackets];
+				packet.resize(length);
+				receiveRing.consume((length != 0) ? &(packet[0]) : NULL, length, length);
+				eopTypes[nPackets] = getEOPType(type);
+				receivedPacketTimestamps[nPackets] = receivedPacketTimestamp;
+				tapReceivedPacket((length != 0) ? &(packet[0]) : NULL, length, eopTypes[nPackets], receivedPacketTimestamp);
+				nPackets++;
+			}
+		} catch (...) {
+			receiveMutex.unlock();
+			throw;
+		}
+		receiveMutex.unlock();
+		this->setReceivedPacketEOPMarkerType(
+				(eopTypes[nPackets - 1] == SpaceWireEOPMarker::EEP) ? SpaceWireIF::EEP : SpaceWireIF::EOP);
+		return nPackets;
+	}
+
+public:
+	void emitTimecode(uint8_t timeIn, uint8_t controlFlagIn = 0x00) throw (SpaceWireIFException) {
+		timeIn = timeIn % 64 + (controlFlagIn << 6);
+		sendRecord(SpaceWireSharedMemoryRing::TimeCode, timeIn, NULL, 0);
+		//invoke timecode synchronized action
+		if (timecodeSynchronizedActions.size() != 0) {
+			this->invokeTimecodeSynchronizedActions(timeIn);
+		}
+	}
+
+	/** Returns the last TimeCode received from the peer. */
+	uint8_t getTimeCode() {
+		return lastTimecode;
+	}
+
+public:
+	virtual void setTxLinkRate(uint32_t linkRateType) throw (SpaceWireIFException) {
+		throw SpaceWireIFException(SpaceWireIFException::FunctionNotImplemented);
+	}
+
+	virtual uint32_t getTxLinkRateType() throw (SpaceWireIFException) {
+		throw SpaceWireIFException(SpaceWireIFException::FunctionNotImplemented);
+	}
+
+public:
+	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException) {
+		timeoutDurationInMicroSec = microsecond;
+	}
+
+public:
+	std::string getName() const {
+		return name;
+	}
+
+	uint32_t getOperationMode() const {
+		return operationMode;
+	}
+
+	/** Returns the size of each ring in bytes (0 before open()). */
+	size_t getRingSize() const {
+		return (header != NULL) ? header->ringSize : 0;
+	}
+
+private:
+	void sendRecord(uint8_t type, uint8_t timecode, const uint8_t* data, size_t length) throw (SpaceWireIFException) {
+		if (state != Opened) {
+			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
+		}
+		if (!sendRing.canHold(length)) {
+			throw SpaceWireIFException(SpaceWireIFException::PacketTooLarge);
+		}
+		size_t recordSize = SpaceWireSharedMemoryRing::getRecordSize(length);
+		sendMutex.lock();
+		double start = 0;
+		while (true) {
+			int32_t sequence = sendRing.getSpaceSequence();
+			if (state != Opened || isPeerClosed()) {
+				sendMutex.unlock();
+				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			}
+			if (recordSize <= sendRing.getFreeSize()) {
+				break;
+			}
+			double remaining;
+			if (!getRemainingTime(start, remaining)) {
+				sendMutex.unlock();
+				throw SpaceWireIFException(SpaceWireIFException::Timeout);
+			}
+			sendRing.waitSpace(sequence, recordSize, remaining);
+		}
+		sendRing.write(type, timecode, data, length);
+		sendMutex.unlock();
+	}
+
+	/** Waits for a data record. TimeCode records found on the way are processed here.
+	 * The receive timestamp is taken when a data record is found.
+	 * @param[in] blocking if false, returns false instead of waiting when no data record is available.
+	 */
+	bool waitPacket(uint8_t& type, size_t& length, bool blocking = true) throw (SpaceWireIFException) {
+		double start = 0;
+		while (true) {
+			int32_t sequence = receiveRing.getDataSequence();
+			if (!receiveRing.isEmpty()) {
+				uint8_t timecode;
+				receiveRing.peek(type, timecode, length);
+				if (type != SpaceWireSharedMemoryRing::TimeCode) {
+					//the record is visible to the receiver from now on
+					receivedPacketTimestamp.capture(realtimeTimestampEnabled);
+					return true;
+				}
+				receiveRing.consume(NULL, 0, 0);
+				lastTimecode = timecode;
+				this->invokeTimecodeSynchronizedActions(timecode);
+				continue;
+			}
+			if (!blocking) {
+				return false;
+			}
+			if (state != Opened) {
+				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			}
+			if (isPeerClosed()) {
+				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			}
+			double remaining;
+			if (!getRemainingTime(start, remaining)) {
+				throw SpaceWireIFException(SpaceWireIFException::Timeout);
+			}
+			receiveRing.waitData(sequence, remaining);
+		}
+	}
+
+	static SpaceWireEOPMarker::EOPType getEOPType(uint8_t type) {
+		return (type == SpaceWireSharedMemoryRing::DataEEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP;
+	}
+
+	void packetReceived(uint8_t type) throw (SpaceWireIFException) {
+		if (type == SpaceWireSharedMemoryRing::DataEEP) {
+			this->setReceivedPacketEOPMarkerType(SpaceWireIF::EEP);
+			if (this->eepShouldBeReportedAsAnException_) {
+				throw SpaceWireIFException(SpaceWireIFException::EEP);
+			}
+		} else {
+			this->setReceivedPacketEOPMarkerType(SpaceWireIF::EOP);
+		}
+	}
+
+	/** Computes the remaining time until the timeout (start is set at the first call).
+	 * Returns false if the timeout has expired. The wait is sliced so that closing is noticed.
+	 */
+	bool getRemainingTime(double& start, double& remaining) {
+		double now = CxxUtilities::Time::getClockValueInMilliSec();
+		if (start == 0) {
+			start = now;
+		}
+		if (timeoutDurationInMicroSec == 0) {
+			remaining = WaitSliceInMilliSec;
+			return true;
+		}
+		remaining = timeoutDurationInMicroSec / 1000.0 - (now - start);
+		if (remaining <= 0) {
+			return false;
+		}
+		if (WaitSliceInMilliSec < remaining) {
+			remaining = WaitSliceInMilliSec;
+		}
+		return true;
+	}
+
+	/** The server may be opened before the client attaches; absence of a client
+	 * which has never attached is not a disconnection.
+	 */
+	bool isPeerClosed() const {
+		uint32_t peer = (operationMode == ServerMode) ? ClientMode : ServerMode;
+		return header->attached[peer] != 0 && header->opened[peer] == 0;
+	}
+
+private:
+	static const double WaitSliceInMilliSec = 100.0;
+
+private:
+	void create() throw (SpaceWireIFException) {
+		uint32_t ringSize = 4096;
+		while (ringSize < requestedRingSize && ringSize < 0x40000000) {
+			ringSize <<= 1;
+		}
+		::shm_unlink(name.c_str());
+		int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		mappingSize = getMappingSize(ringSize);
+		if (::ftruncate(fd, mappingSize) != 0) {
+			::close(fd);
+			::shm_unlink(name.c_str());
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		map(fd);
+		memset(header, 0, sizeof(SpaceWireSharedMemoryHeader));
+		header->version = Version;
+		header->ringSize = ringSize;
+		setupRings();
+		sendRing.initialize();
+		receiveRing.initialize();
+		header->opened[ServerMode] = 1;
+		header->attached[ServerMode] = 1;
+		__sync_synchronize();
+		header->magic = Magic;
+	}
+
+	void attach() throw (SpaceWireIFException) {
+		int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+		if (fd < 0) {
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		struct stat status;
+		if (::fstat(fd, &status) != 0 || (size_t) status.st_size < sizeof(SpaceWireSharedMemoryHeader)) {
+			::close(fd);
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		mappingSize = status.st_size;
+		map(fd);
+		if (header->magic != Magic || header->version != Version
+				|| getMappingSize(header->ringSize) != mappingSize) {
+			unmap();
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		setupRings();
+		header->opened[ClientMode] = 1;
+		__sync_synchronize();
+		header->attached[ClientMode] = 1;
+	}
+
+	void map(int fd) throw (SpaceWireIFException) {
+		mapping = ::mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (mapping == MAP_FAILED) {
+			mapping = NULL;
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		}
+		header = (SpaceWireSharedMemoryHeader*) mapping;
+	}
+
+	void unmap() {
+		if (mapping != NULL) {
+			::munmap(mapping, mappingSize);
+		}
+		mapping = NULL;
+		header = NULL;
+	}
+
+	void setupRings() {
+		uint8_t* top = (uint8_t*) mapping + sizeof(SpaceWireSharedMemoryHeader);
+		size_t ringSize = header->ringSize;
+		SpaceWireSharedMemoryRingHeader* serverToClient = (SpaceWireSharedMemoryRingHeader*) top;
+		SpaceWireSharedMemoryRingHeader* clientToServer = (SpaceWireSharedMemoryRingHeader*) (top
+				+ sizeof(SpaceWireSharedMemoryRingHeader) + ringSize);
+		uint8_t* serverToClientData = top + sizeof(SpaceWireSharedMemoryRingHeader);
+		uint8_t* clientToServerData = (uint8_t*) clientToServer + sizeof(SpaceWireSharedMemoryRingHeader);
+		if (operationMode == ServerMode) {
+			sendRing.attach(serverToClient, serverToClientData, ringSize);
+			receiveRing.attach(clientToServer, clientToServerData, ringSize);
+		} else {
+			sendRing.attach(clientToServer, clientToServerData, ringSize);
+			receiveRing.attach(serverToClient, serverToClientData, ringSize);
+		}
+	}
+
+	static size_t getMappingSize(size_t ringSize) {
+		return sizeof(SpaceWireSharedMemoryHeader) + 2 * (sizeof(SpaceWireSharedMemoryRingHeader) + ringSize);
+	}
+};
+
+#endif /* SPACEWIREIFOVERSHAREDMEMORY_HH_ */
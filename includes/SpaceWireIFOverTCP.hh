@@ -39,9 +39,67 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "SpaceWireIF.hh"
 #include "SpaceWireUtilities.hh"
 #include "SpaceWireSSDTPModule.hh"
+#include "SpaceWireTimecodeDispatcher.hh"
+
+#include <sys/socket.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/** Connection statistics of SpaceWireIFOverTCP in AutoReconnect mode.
+ */
+class SpaceWireIFOverTCPReconnectStatistics {
+public:
+	size_t nDisconnections;
+	size_t nReconnections;
+	size_t nConnectAttempts;
+	/** Outage durations (from detection of disconnection until queued packets have been sent). */
+	double totalOutageInMilliSec;
+	double lastOutageInMilliSec;
+	double maxOutageInMilliSec;
+	/** Packets sent while the link was down. */
+	size_t nQueuedPackets; //currently queued
+	size_t maxQueuedPackets;
+	size_t nResentPackets;
+	size_t nRejectedPackets; //the queue was full
+
+public:
+	SpaceWireIFOverTCPReconnectStatistics() {
+		nDisconnections = 0;
+		nReconnections = 0;
+		nConnectAttempts = 0;
+		totalOutageInMilliSec = 0;
+		lastOutageInMilliSec = 0;
+		maxOutageInMilliSec = 0;
+		nQueuedPackets = 0;
+		maxQueuedPackets = 0;
+		nResentPackets = 0;
+		nRejectedPackets = 0;
+	}
+
+public:
+	std::string toString() {
+		std::stringstream ss;
+		ss << "disconnections=" << nDisconnections << " reconnections=" << nReconnections << " connect attempts="
+				<< nConnectAttempts << std::endl;
+		ss << "outage total=" << totalOutageInMilliSec << "ms last=" << lastOutageInMilliSec << "ms max="
+				<< maxOutageInMilliSec << "ms" << std::endl;
+		ss << "queued=" << nQueuedPackets << " max queued=" << maxQueuedPackets << " resent=" << nResentPackets
+				<< " rejected=" << nRejectedPackets;
+		return ss.str();
+	}
+};
 
 /** SpaceWire IF class which is connected to a real SpaceWire IF
  * via TCP/IP network and spw-tcpip bridge server running on SpaceCube.
+ *
+ * In AutoReconnect mode (see setReconnectMode()), a lost connection does not
+ * close the interface. A background thread reconnects with exponential
+ * backoff (client mode) or accepts a new connection (server mode), while
+ * receive() reports Timeout, and send() stores packets in a bounded queue
+ * which is sent in order once the connection has been restored.
+ * Users such as RMAPEngine therefore keep running across the outage, and can
+ * follow it via SpaceWireIFActionLinkStateAction.
  */
 class SpaceWireIFOverTCP: public SpaceWireIF, public SpaceWireIFActionTimecodeScynchronizedAction {
 private:
@@ -51,39 +109,108 @@ public:
 		ClientMode, ServerMode
 	};
 
+	enum {
+		SynchronousTimecodeDispatch, AsynchronousTimecodeDispatch
+	};
+
+	enum {
+		NoReconnect, AutoReconnect
+	};
+
+public:
+	static const size_t DefaultSendQueueCapacity = 1024;
+	static const double DefaultInitialReconnectIntervalInMilliSec = 100;
+	static const double DefaultMaximumReconnectIntervalInMilliSec = 10000;
+	/** Waiting time of receive() during an outage when no timeout is set. */
+	static const double DefaultLinkWaitInMilliSec = 1000;
+	/** Upper limit of a single connection attempt, so that close() does not wait long. */
+	static const double MaximumConnectTimeoutInMilliSec = 1000;
+
 private:
 	std::string iphostname;
 	uint32_t portnumber;
+
+protected:
 	SpaceWireSSDTPModule* ssdtp;
 	CxxUtilities::TCPSocket* datasocket;
 	CxxUtilities::TCPServerSocket* serverSocket;
+	SpaceWireSSDTPBufferPool* ssdtpBufferPool;
+	SpaceWireTimecodeDispatcher* timecodeDispatcher;
 
+private:
 	uint32_t operationMode;
 
+private:
+	class AsyncWorker;
+	AsyncWorker* asyncWorker;
+	CxxUtilities::Mutex asyncWorkerMutex;
+
+private:
+	/* AutoReconnect mode */
+	class Reconnector;
+	struct QueuedPacket {
+		std::vector<uint8_t>* data;
+		SpaceWireEOPMarker::EOPType eopType;
+	};
+	uint32_t reconnectMode;
+	Reconnector* reconnector;
+	pthread_mutex_t linkMutex;
+	pthread_cond_t linkCondition;
+	volatile bool linkUp;
+	volatile uint32_t connectionGeneration;
+	std::deque<QueuedPacket> sendQueue;
+	size_t sendQueueCapacity;
+	double initialReconnectIntervalInMilliSec;
+	double maximumReconnectIntervalInMilliSec;
+	uint64_t linkDownTimeInNanoSec;
+	SpaceWireIFOverTCPReconnectStatistics reconnectStatistics;
+
 public:
 	/** Constructor (client mode).
 	 */
 	SpaceWireIFOverTCP(std::string iphostname, uint32_t portnumber) :
-			SpaceWireIF(), iphostname(iphostname), portnumber(portnumber) {
+			SpaceWireIF(), iphostname(iphostname), portnumber(portnumber), ssdtpBufferPool(NULL), timecodeDispatcher(NULL), asyncWorker(NULL) {
 		setOperationMode(ClientMode);
+		initializeReconnection();
 	}
 
 	/** Constructor (server mode).
 	 */
 	SpaceWireIFOverTCP(uint32_t portnumber) :
-			SpaceWireIF(), portnumber(portnumber) {
+			SpaceWireIF(), portnumber(portnumber), ssdtpBufferPool(NULL), timecodeDispatcher(NULL), asyncWorker(NULL) {
 		setOperationMode(ServerMode);
+		initializeReconnection();
 	}
 
 	/** Constructor. Server/client mode will be determined later via
 	 * the setClientMode() or setServerMode() method.
 	 */
 	SpaceWireIFOverTCP() :
-			SpaceWireIF() {
-
+			SpaceWireIF(), ssdtpBufferPool(NULL), timecodeDispatcher(NULL), asyncWorker(NULL) {
+		initializeReconnection();
 	}
 
 	virtual ~SpaceWireIFOverTCP() {
+		stopReconnector();
+		stopAsyncWorker();
+		clearSendQueue();
+		setTimecodeDispatchMode(SynchronousTimecodeDispatch);
+		pthread_cond_destroy(&linkCondition);
+		pthread_mutex_destroy(&linkMutex);
+	}
+
+private:
+	void initializeReconnection() {
+		reconnectMode = NoReconnect;
+		reconnector = NULL;
+		pthread_mutex_init(&linkMutex, NULL);
+		pthread_cond_init(&linkCondition, NULL);
+		linkUp = true;
+		connectionGeneration = 0;
+		sendQueueCapacity = DefaultSendQueueCapacity;
+		initialReconnectIntervalInMilliSec = DefaultInitialReconnectIntervalInMilliSec;
+		maximumReconnectIntervalInMilliSec = DefaultMaximumReconnectIntervalInMilliSec;
+		linkDownTimeInNanoSec = 0;
 	}
 
 public:
@@ -131,9 +258,19 @@ public:
 			}
 		}
 		datasocket->setNoDelay();
-		ssdtp = new SpaceWireSSDTPModule(datasocket);
-		ssdtp->setTimeCodeAction(this);
+		ssdtp = new SpaceWireSSDTPModule(datasocket, ssdtpBufferPool);
+		ssdtp->setRealtimeTimestampEnabled(realtimeTimestampEnabled);
+		if (timecodeDispatcher != NULL) {
+			ssdtp->setTimeCodeAction(timecodeDispatcher);
+		} else {
+			ssdtp->setTimeCodeAction(this);
+		}
+		linkUp = true;
+		connectionGeneration++;
 		state = Opened;
+		if (reconnectMode == AutoReconnect) {
+			startReconnector();
+		}
 	}
 
 	void close() throw (SpaceWireIFException) {
@@ -146,6 +283,9 @@ public:
 		//invoke SpaceWireIFCloseActions to tell other instances
 		//closing of this SpaceWire interface
 		invokeSpaceWireIFCloseActions();
+		stopReconnector();
+		stopAsyncWorker();
+		clearSendQueue();
 		if (ssdtp != NULL) {
 			delete ssdtp;
 		}
@@ -175,14 +315,62 @@ public:
 		if (ssdtp == NULL) {
 			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
 		}
+		if (queuePacketIfLinkIsDown(data, length, eopType)) {
+			tapSentPacket(data, length, eopType); //sent after reconnection
+			return;
+		}
+		uint32_t generation = connectionGeneration;
 		try {
 			ssdtp->send(data, length, eopType);
+			tapSentPacket(data, length, eopType);
 		} catch (SpaceWireSSDTPException& e) {
 			if (e.getStatus() == SpaceWireSSDTPException::Timeout) {
 				throw SpaceWireIFException(SpaceWireIFException::Timeout);
-			} else {
+			} else if (reconnector == NULL) {
 				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
 			}
+			//AutoReconnect mode: the packet is sent again after reconnection
+			markLinkDown(generation);
+			send(data, length, eopType);
+		}
+	}
+
+public:
+	/** Sends multiple packets with a single gather write.
+	 * @see SpaceWireSSDTPModule::sendMany()
+	 */
+	void sendMany(std::vector<std::vector<uint8_t>*>& packets, SpaceWireEOPMarker::EOPType eopType =
+			SpaceWireEOPMarker::EOP) throw (SpaceWireIFException) {
+		if (ssdtp == NULL) {
+			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
+		}
+		if (reconnector != NULL && !linkUp) {
+			//AutoReconnect mode: packets are queued one by one
+			for (size_t i = 0; i < packets.size(); i++) {
+				sendVectorPointer(packets[i], eopType);
+			}
+			return;
+		}
+		uint32_t generation = connectionGeneration;
+		try {
+			ssdtp->sendMany(packets, eopType);
+			if (getTap() != NULL) {
+				for (size_t i = 0; i < packets.size(); i++) {
+					std::vector<uint8_t>* packet = packets[i];
+					tapSentPacket((packet->size() != 0) ? &(packet->at(0)) : NULL, packet->size(), eopType);
+				}
+			}
+		} catch (SpaceWireSSDTPException& e) {
+			if (e.getStatus() == SpaceWireSSDTPException::Timeout) {
+				throw SpaceWireIFException(SpaceWireIFException::Timeout);
+			} else if (reconnector == NULL) {
+				throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			}
+			//AutoReconnect mode: all the packets are sent again after reconnection
+			markLinkDown(generation);
+			for (size_t i = 0; i < packets.size(); i++) {
+				sendVectorPointer(packets[i], eopType);
+			}
 		}
 	}
 
@@ -191,9 +379,15 @@ public:
 		if (ssdtp == NULL) {
 			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
 		}
+		waitForLink();
+		uint32_t generation = connectionGeneration;
 		try {
 			uint32_t eopType;
 			ssdtp->receive(buffer, eopType);
+			this->setReceivedPacketTimestamp(ssdtp->getLastReceivedPacketTimestamp());
+			tapReceivedPacket((buffer->size() != 0) ? &(buffer->at(0)) : NULL, buffer->size(),
+					(eopType == SpaceWireEOPMarker::EEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP,
+					receivedPacketTimestamp);
 			if (eopType == SpaceWireEOPMarker::EEP) {
 				this->setReceivedPacketEOPMarkerType(SpaceWireIF::EEP);
 				if (this->eepShouldBeReportedAsAnException_) {
@@ -207,13 +401,157 @@ public:
 				throw SpaceWireIFException(SpaceWireIFException::Timeout);
 			}
 			using namespace std;
-			throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			connectionLost(generation);
 		} catch (CxxUtilities::TCPSocketException& e) {
 			if (e.getStatus() == CxxUtilities::TCPSocketException::Timeout) {
 				throw SpaceWireIFException(SpaceWireIFException::Timeout);
 			}
 			using namespace std;
-			throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			connectionLost(generation);
+		}
+	}
+
+public:
+	/** Receives a packet directly into a caller-owned buffer without
+	 * an intermediate copy.
+	 */
+	void receive(uint8_t* buffer, SpaceWireEOPMarker::EOPType& eopType, size_t maxLength, size_t& length)
+			throw (SpaceWireIFException) {
+		if (ssdtp == NULL) {
+			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
+		}
+		waitForLink();
+		uint32_t generation = connectionGeneration;
+		try {
+			uint32_t receivedEOPType;
+			ssdtp->receive(buffer, maxLength, length, receivedEOPType);
+			this->setReceivedPacketTimestamp(ssdtp->getLastReceivedPacketTimestamp());
+			tapReceivedPacket(buffer, length,
+					(receivedEOPType == SpaceWireEOPMarker::EEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP,
+					receivedPacketTimestamp);
+			if (receivedEOPType == SpaceWireEOPMarker::EEP) {
+				eopType = SpaceWireEOPMarker::EEP;
+				this->setReceivedPacketEOPMarkerType(SpaceWireIF::EEP);
+				if (this->eepShouldBeReportedAsAnException_) {
+					throw SpaceWireIFException(SpaceWireIFException::EEP);
+				}
+			} else {
+				eopType = SpaceWireEOPMarker::EOP;
+				this->setReceivedPacketEOPMarkerType(SpaceWireIF::EOP);
+			}
+		} catch (SpaceWireSSDTPException& e) {
+			if (e.getStatus() == SpaceWireSSDTPException::Timeout) {
+				throw SpaceWireIFException(SpaceWireIFException::Timeout);
+			} else if (e.getStatus() == SpaceWireSSDTPException::DataSizeTooLarge) {
+				throw SpaceWireIFException(SpaceWireIFException::ReceiveBufferTooSmall);
+			}
+			connectionLost(generation);
+		}
+	}
+
+	using SpaceWireIF::receive;
+
+public:
+	/** Receives packets which are already buffered in one call.
+	 * @see SpaceWireIF::receiveBatch() and SpaceWireSSDTPModule::receiveBatch()
+	 */
+	size_t receiveBatch(std::vector<std::vector<uint8_t> >& packets, std::vector<SpaceWireEOPMarker::EOPType>& eopTypes,
+			size_t maxPackets = DefaultBatchSize) throw (SpaceWireIFException) {
+		if (ssdtp == NULL) {
+			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
+		}
+		waitForLink();
+		uint32_t generation = connectionGeneration;
+		try {
+			size_t nPackets = ssdtp->receiveBatch(packets, eopTypes, maxPackets, &receivedPacketTimestamps);
+			this->setReceivedPacketTimestamp(receivedPacketTimestamps[nPackets - 1]);
+			this->setReceivedPacketEOPMarkerType(
+					(eopTypes[nPackets - 1] == SpaceWireEOPMarker::EEP) ? SpaceWireIF::EEP : SpaceWireIF::EOP);
+			if (getTap() != NULL) {
+				for (size_t i = 0; i < nPackets; i++) {
+					tapReceivedPacket((packets[i].size() != 0) ? &(packets[i][0]) : NULL, packets[i].size(), eopTypes[i],
+							receivedPacketTimestamps[i]);
+				}
+			}
+			return nPackets;
+		} catch (SpaceWireSSDTPException& e) {
+			if (e.getStatus() == SpaceWireSSDTPException::Timeout) {
+				throw SpaceWireIFException(SpaceWireIFException::Timeout);
+			}
+			connectionLost(generation);
+		}
+		return 0; //not reached (connectionLost() always throws)
+	}
+
+public:
+	/** Starts receiving a packet asynchronously.
+	 * Asynchronous operations of an instance are performed by one worker thread,
+	 * which is started by the first asynchronous operation after open(). The thread
+	 * sleeps in poll() until an operation is requested or data arrive, and reads the
+	 * socket only while a receive is pending, so that the TCP flow control
+	 * throttles the peer when the application does not keep up. Reads do not
+	 * block, so a send requested while a packet is partially received is not
+	 * delayed until the rest of the packet arrives.
+	 * EEP is reported via SpaceWireIFAsyncOperation::eopType (not as Failed).
+	 * @see SpaceWireIF::asyncReceive()
+	 */
+	void asyncReceive(SpaceWireIFAsyncHandler* handler, void* context = NULL) throw (SpaceWireIFException) {
+		getAsyncWorker()->submit(
+				new SpaceWireIFAsyncOperation(SpaceWireIFAsyncOperation::Receive, this, handler, context));
+	}
+
+	/** Starts sending a packet asynchronously. Packets are sent in the order of the calls.
+	 * @see SpaceWireIF::asyncSend()
+	 */
+	void asyncSend(std::vector<uint8_t>* buffer, SpaceWireIFAsyncHandler* handler, void* context = NULL,
+			SpaceWireEOPMarker::EOPType eopType = SpaceWireEOPMarker::EOP) throw (SpaceWireIFException) {
+		SpaceWireIFAsyncOperation* operation = new SpaceWireIFAsyncOperation(SpaceWireIFAsyncOperation::Send, this,
+				handler, context);
+		operation->buffer = buffer;
+		operation->eopType = eopType;
+		getAsyncWorker()->submit(operation);
+	}
+
+	size_t cancelAsyncOperations() {
+		asyncWorkerMutex.lock();
+		size_t nCancelled = 0;
+		if (asyncWorker != NULL) {
+			nCancelled = asyncWorker->cancel();
+		}
+		asyncWorkerMutex.unlock();
+		return nCancelled;
+	}
+
+protected:
+	AsyncWorker* getAsyncWorker() throw (SpaceWireIFException) {
+		asyncWorkerMutex.lock();
+		if (state != Opened || ssdtp == NULL) {
+			asyncWorkerMutex.unlock();
+			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
+		}
+		if (asyncWorker == NULL) {
+			asyncWorker = new AsyncWorker(this, ssdtp);
+			asyncWorker->start();
+		}
+		AsyncWorker* worker = asyncWorker;
+		asyncWorkerMutex.unlock();
+		return worker;
+	}
+
+	/** Stops the worker thread of asynchronous operations (if started), and
+	 * cancels operations which are still pending. Called by close() before
+	 * the SSDTP module is deleted.
+	 */
+	void stopAsyncWorker() {
+		asyncWorkerMutex.lock();
+		AsyncWorker* worker = asyncWorker;
+		asyncWorker = NULL;
+		asyncWorkerMutex.unlock();
+		if (worker != NULL) {
+			worker->stop();
+			worker->waitUntilRunMethodComplets();
+			worker->cancel();
+			delete worker;
 		}
 	}
 
@@ -224,6 +562,7 @@ public:
 			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
 		}
 		timeIn = timeIn % 64 + (controlFlagIn << 6);
+		uint32_t generation = connectionGeneration;
 		try {
 			//emit timecode via SSDTP module
 			ssdtp->sendTimeCode(timeIn);
@@ -231,12 +570,12 @@ public:
 			if (e.getStatus() == SpaceWireSSDTPException::Timeout) {
 				throw SpaceWireIFException(SpaceWireIFException::Timeout);
 			}
-			throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			connectionLost(generation);
 		} catch (CxxUtilities::TCPSocketException& e) {
 			if (e.getStatus() == CxxUtilities::TCPSocketException::Timeout) {
 				throw SpaceWireIFException(SpaceWireIFException::Timeout);
 			}
-			throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			connectionLost(generation);
 		}
 		//invoke timecode synchronized action
 		if (timecodeSynchronizedActions.size() != 0) {
@@ -263,25 +602,39 @@ public:
 		if (ssdtp == NULL) {
 			throw SpaceWireIFException(SpaceWireIFException::LinkIsNotOpened);
 		}
+		uint32_t generation = connectionGeneration;
 		try {
 			ssdtp->setTxDivCount(txdivcount);
 		} catch (SpaceWireSSDTPException& e) {
 			if (e.getStatus() == SpaceWireSSDTPException::Timeout) {
 				throw SpaceWireIFException(SpaceWireIFException::Timeout);
 			}
-			throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			connectionLost(generation);
 		} catch (CxxUtilities::TCPSocketException& e) {
 			if (e.getStatus() == CxxUtilities::TCPSocketException::Timeout) {
 				throw SpaceWireIFException(SpaceWireIFException::Timeout);
 			}
-			throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+			connectionLost(generation);
 		}
 	}
 
 public:
 	void setTimeoutDuration(double microsecond) throw (SpaceWireIFException) {
+		pthread_mutex_lock(&linkMutex);
 		datasocket->setTimeout(microsecond / 1000.);
 		timeoutDurationInMicroSec = microsecond;
+		pthread_mutex_unlock(&linkMutex);
+	}
+
+public:
+	/** Receive timestamps are taken by SpaceWireSSDTPModule when the header
+	 * of the first SSDTP data frame of a packet has been received.
+	 */
+	void setRealtimeTimestampEnabled(bool enabled) {
+		SpaceWireIF::setRealtimeTimestampEnabled(enabled);
+		if (ssdtp != NULL) {
+			ssdtp->setRealtimeTimestampEnabled(enabled);
+		}
 	}
 
 public:
@@ -296,11 +649,370 @@ public:
 		this->invokeTimecodeSynchronizedActions(timecode);
 	}
 
+public:
+	/** Selects the thread which invokes registered TimeCode actions.
+	 * In SynchronousTimecodeDispatch mode (default), actions are invoked by the
+	 * thread which receives packets. In AsynchronousTimecodeDispatch mode, the
+	 * receive thread only queues TimeCodes with timestamps, and a
+	 * SpaceWireTimecodeDispatcher thread invokes the actions, so that slow
+	 * actions do not delay packet delivery.
+	 * The mode should be changed while no packet is being received.
+	 * @param[in] mode SynchronousTimecodeDispatch or AsynchronousTimecodeDispatch.
+	 */
+	void setTimecodeDispatchMode(uint32_t mode) {
+		if (mode == AsynchronousTimecodeDispatch && timecodeDispatcher == NULL) {
+			timecodeDispatcher = new SpaceWireTimecodeDispatcher(this);
+			timecodeDispatcher->start();
+			if (ssdtp != NULL) {
+				ssdtp->setTimeCodeAction(timecodeDispatcher);
+			}
+		} else if (mode == SynchronousTimecodeDispatch && timecodeDispatcher != NULL) {
+			if (ssdtp != NULL) {
+				ssdtp->setTimeCodeAction(this);
+			}
+			timecodeDispatcher->stop();
+			timecodeDispatcher->waitUntilRunMethodComplets();
+			delete timecodeDispatcher;
+			timecodeDispatcher = NULL;
+		}
+	}
+
+	uint32_t getTimecodeDispatchMode() const {
+		return (timecodeDispatcher != NULL) ? AsynchronousTimecodeDispatch : SynchronousTimecodeDispatch;
+	}
+
+	/** Returns the dispatcher used in AsynchronousTimecodeDispatch mode (NULL in the other mode).
+	 * Its getStatistics() reports TimeCode arrival jitter and dispatch latency.
+	 */
+	SpaceWireTimecodeDispatcher* getTimecodeDispatcher() {
+		return timecodeDispatcher;
+	}
+
+public:
+	/** Selects what happens when the connection is lost.
+	 * In NoReconnect mode (default), operations throw Disconnected.
+	 * In AutoReconnect mode, the interface reconnects by itself (see the class
+	 * description). Packets which were being sent when the connection was lost
+	 * are sent again, so the peer may receive such a packet twice.
+	 * The mode should be set before open().
+	 * @param[in] mode NoReconnect or AutoReconnect.
+	 */
+	void setReconnectMode(uint32_t mode) {
+		reconnectMode = mode;
+	}
+
+	uint32_t getReconnectMode() const {
+		return reconnectMode;
+	}
+
+	/** Sets the number of packets which can be queued while the link is down.
+	 * send() throws Timeout when the queue is full.
+	 */
+	void setSendQueueCapacity(size_t capacity) {
+		sendQueueCapacity = capacity;
+	}
+
+	size_t getSendQueueCapacity() const {
+		return sendQueueCapacity;
+	}
+
+	/** Sets the interval between connection attempts. The interval starts from the
+	 * initial value, and is doubled after every failed attempt up to the maximum value.
+	 */
+	void setReconnectInterval(double initialIntervalInMilliSec, double maximumIntervalInMilliSec) {
+		initialReconnectIntervalInMilliSec = initialIntervalInMilliSec;
+		maximumReconnectIntervalInMilliSec = maximumIntervalInMilliSec;
+	}
+
+	/** Returns false while the connection is being restored in AutoReconnect mode. */
+	bool isLinkUp() const {
+		return linkUp;
+	}
+
+	SpaceWireIFOverTCPReconnectStatistics getReconnectStatistics() {
+		pthread_mutex_lock(&linkMutex);
+		SpaceWireIFOverTCPReconnectStatistics statistics = reconnectStatistics;
+		statistics.nQueuedPackets = sendQueue.size();
+		pthread_mutex_unlock(&linkMutex);
+		return statistics;
+	}
+
+private:
+	void startReconnector() {
+		if (reconnector == NULL) {
+			reconnector = new Reconnector(this);
+			reconnector->start();
+		}
+	}
+
+	void stopReconnector() {
+		if (reconnector == NULL) {
+			return;
+		}
+		pthread_mutex_lock(&linkMutex);
+		reconnector->stop();
+		if (datasocket != NULL) {
+			//interrupts a flush of the send queue
+			::shutdown(datasocket->getSocketDescriptor(), SHUT_RDWR);
+		}
+		pthread_cond_broadcast(&linkCondition);
+		pthread_mutex_unlock(&linkMutex);
+		reconnector->waitUntilRunMethodComplets();
+		delete reconnector;
+		reconnector = NULL;
+	}
+
+	/** Records that the connection used by an operation has been lost.
+	 * Ignored if the connection has already been replaced.
+	 */
+	void markLinkDown(uint32_t generation) {
+		pthread_mutex_lock(&linkMutex);
+		if (linkUp && generation == connectionGeneration) {
+			linkUp = false;
+			linkDownTimeInNanoSec = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+			reconnectStatistics.nDisconnections++;
+			pthread_cond_broadcast(&linkCondition);
+		}
+		pthread_mutex_unlock(&linkMutex);
+	}
+
+	/** Reports a lost connection to the caller of a receive operation.
+	 * In AutoReconnect mode, reconnection is started and Timeout is thrown
+	 * instead of Disconnected, so that the caller keeps running.
+	 */
+	void connectionLost(uint32_t generation) throw (SpaceWireIFException) {
+		if (reconnector == NULL || state != Opened) {
+			throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+		}
+		markLinkDown(generation);
+		throw SpaceWireIFException(SpaceWireIFException::Timeout);
+	}
+
+	/** Waits until the link is restored, up to the timeout duration (AutoReconnect mode only). */
+	void waitForLink() throw (SpaceWireIFException) {
+		if (reconnector == NULL || linkUp) {
+			return;
+		}
+		double waitInMilliSec = (timeoutDurationInMicroSec > 0) ? timeoutDurationInMicroSec / 1000. : DefaultLinkWaitInMilliSec;
+		pthread_mutex_lock(&linkMutex);
+		if (!linkUp && state == Opened) {
+			waitLinkCondition(waitInMilliSec);
+		}
+		bool up = linkUp;
+		pthread_mutex_unlock(&linkMutex);
+		if (state != Opened) {
+			throw SpaceWireIFException(SpaceWireIFException::Disconnected);
+		}
+		if (!up) {
+			throw SpaceWireIFException(SpaceWireIFException::Timeout);
+		}
+	}
+
+	/** Waits for linkCondition. linkMutex should be locked by the caller. */
+	void waitLinkCondition(double milliSec) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		long long nanoSec = (long long) (milliSec * 1000000) + deadline.tv_nsec;
+		deadline.tv_sec += nanoSec / 1000000000;
+		deadline.tv_nsec = nanoSec % 1000000000;
+		pthread_cond_timedwait(&linkCondition, &linkMutex, &deadline);
+	}
+
+	/** Queues a packet if the link is down (AutoReconnect mode only).
+	 * @returns true if the packet has been queued.
+	 */
+	bool queuePacketIfLinkIsDown(uint8_t* data, size_t length, SpaceWireEOPMarker::EOPType eopType)
+			throw (SpaceWireIFException) {
+		if (reconnector == NULL || linkUp) {
+			return false;
+		}
+		pthread_mutex_lock(&linkMutex);
+		if (linkUp) {
+			pthread_mutex_unlock(&linkMutex);
+			return false;
+		}
+		if (sendQueueCapacity <= sendQueue.size()) {
+			reconnectStatistics.nRejectedPackets++;
+			pthread_mutex_unlock(&linkMutex);
+			throw SpaceWireIFException(SpaceWireIFException::Timeout);
+		}
+		QueuedPacket packet;
+		packet.data = packetBufferPool->lease();
+		packet.data->assign(data, data + length);
+		packet.eopType = eopType;
+		sendQueue.push_back(packet);
+		if (reconnectStatistics.maxQueuedPackets < sendQueue.size()) {
+			reconnectStatistics.maxQueuedPackets = sendQueue.size();
+		}
+		pthread_mutex_unlock(&linkMutex);
+		return true;
+	}
+
+	void clearSendQueue() {
+		pthread_mutex_lock(&linkMutex);
+		for (size_t i = 0; i < sendQueue.size(); i++) {
+			packetBufferPool->returnBuffer(sendQueue[i].data);
+		}
+		sendQueue.clear();
+		pthread_mutex_unlock(&linkMutex);
+	}
+
+	/** Opens a new connection, or returns NULL if it failed. */
+	CxxUtilities::TCPSocket* connect(double timeoutInMilliSec) {
+		using namespace CxxUtilities;
+		if (isClientMode()) {
+			TCPClientSocket* socket = new TCPClientSocket(iphostname, portnumber);
+			try {
+				socket->open(timeoutInMilliSec);
+			} catch (...) {
+				delete socket;
+				return NULL;
+			}
+			return socket;
+		} else {
+			struct pollfd descriptor;
+			descriptor.fd = serverSocket->getSocketDescriptor();
+			descriptor.events = POLLIN;
+			descriptor.revents = 0;
+			if (::poll(&descriptor, 1, (int) timeoutInMilliSec) <= 0) {
+				return NULL;
+			}
+			try {
+				return serverSocket->accept();
+			} catch (...) {
+				return NULL;
+			}
+		}
+	}
+
+	void deleteSocket(CxxUtilities::TCPSocket* socket) {
+		using namespace CxxUtilities;
+		if (isClientMode()) {
+			((TCPClientSocket*) socket)->close();
+			delete (TCPClientSocket*) socket;
+		} else {
+			((TCPServerAcceptedSocket*) socket)->close();
+			delete (TCPServerAcceptedSocket*) socket;
+		}
+	}
+
+	/** Sends queued packets in order, and marks the link up when the queue has become empty.
+	 * @returns false if the connection was lost again.
+	 */
+	bool flushSendQueue() {
+		while (true) {
+			pthread_mutex_lock(&linkMutex);
+			if (sendQueue.empty()) {
+				linkUp = true;
+				double outage = (SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec() - linkDownTimeInNanoSec) / 1e6;
+				reconnectStatistics.nReconnections++;
+				reconnectStatistics.lastOutageInMilliSec = outage;
+				reconnectStatistics.totalOutageInMilliSec += outage;
+				if (reconnectStatistics.maxOutageInMilliSec < outage) {
+					reconnectStatistics.maxOutageInMilliSec = outage;
+				}
+				pthread_cond_broadcast(&linkCondition);
+				pthread_mutex_unlock(&linkMutex);
+				return true;
+			}
+			QueuedPacket packet = sendQueue.front();
+			pthread_mutex_unlock(&linkMutex);
+			try {
+				if (packet.data->size() != 0) {
+					ssdtp->send(&(packet.data->at(0)), packet.data->size(), packet.eopType);
+				}
+			} catch (...) {
+				return false;
+			}
+			pthread_mutex_lock(&linkMutex);
+			sendQueue.pop_front();
+			reconnectStatistics.nResentPackets++;
+			pthread_mutex_unlock(&linkMutex);
+			packetBufferPool->returnBuffer(packet.data);
+		}
+	}
+
+	/** Body of the reconnection thread. */
+	void runReconnection() {
+		bool linkLostHasBeenReported = false;
+		while (!reconnector->isStopped()) {
+			pthread_mutex_lock(&linkMutex);
+			while (linkUp && !reconnector->isStopped()) {
+				pthread_cond_wait(&linkCondition, &linkMutex);
+			}
+			pthread_mutex_unlock(&linkMutex);
+			if (reconnector->isStopped()) {
+				break;
+			}
+			if (!linkLostHasBeenReported) {
+				invokeLinkStateActions(false);
+				linkLostHasBeenReported = true;
+			}
+			//asynchronous operations on the lost connection fail
+			stopAsyncWorker();
+			CxxUtilities::TCPSocket* oldSocket = datasocket;
+			::shutdown(oldSocket->getSocketDescriptor(), SHUT_RDWR);
+
+			//reconnect with exponential backoff
+			CxxUtilities::TCPSocket* newSocket = NULL;
+			double interval = initialReconnectIntervalInMilliSec;
+			while (!reconnector->isStopped()) {
+				pthread_mutex_lock(&linkMutex);
+				reconnectStatistics.nConnectAttempts++;
+				pthread_mutex_unlock(&linkMutex);
+				newSocket = connect((interval < MaximumConnectTimeoutInMilliSec) ? interval : MaximumConnectTimeoutInMilliSec);
+				if (newSocket != NULL || reconnector->isStopped()) {
+					break;
+				}
+				if (isClientMode()) {
+					pthread_mutex_lock(&linkMutex);
+					if (!reconnector->isStopped()) {
+						waitLinkCondition(interval);
+					}
+					pthread_mutex_unlock(&linkMutex);
+				}
+				interval = (maximumReconnectIntervalInMilliSec < interval * 2) ? maximumReconnectIntervalInMilliSec : interval * 2;
+			}
+			if (newSocket == NULL) {
+				break;
+			}
+			if (reconnector->isStopped()) {
+				deleteSocket(newSocket);
+				break;
+			}
+			newSocket->setNoDelay();
+			//a worker started during the outage is bound to the previous socket
+			stopAsyncWorker();
+			pthread_mutex_lock(&linkMutex);
+			newSocket->setTimeout(timeoutDurationInMicroSec / 1000.);
+			ssdtp->replaceSocket(newSocket);
+			datasocket = newSocket;
+			connectionGeneration++;
+			pthread_mutex_unlock(&linkMutex);
+			deleteSocket(oldSocket);
+			if (flushSendQueue()) {
+				invokeLinkStateActions(true);
+				linkLostHasBeenReported = false;
+			}
+		}
+	}
+
 public:
 	SpaceWireSSDTPModule* getSSDTPModule() {
 		return ssdtp;
 	}
 
+	/** Sets a slab pool from which the SSDTP module created by open() takes
+	 * its buffers. Pass SpaceWireSSDTPBufferPool::getSharedInstance() to share
+	 * buffers among all the links in the process.
+	 */
+	void setSSDTPBufferPool(SpaceWireSSDTPBufferPool* pool) {
+		ssdtpBufferPool = pool;
+		if (ssdtp != NULL) {
+			ssdtp->setBufferPool(pool);
+		}
+	}
+
 	uint32_t getOperationMode() const {
 		return operationMode;
 	}
@@ -324,6 +1036,347 @@ public:
 			return false;
 		}
 	}
+
+private:
+	/** A thread which performs asynchronous operations of an instance.
+	 * Sends are performed in order before receives. Received bytes are read
+	 * with non-blocking recv() calls after poll() has reported the socket
+	 * readable, and are fed to a SpaceWireSSDTPDecoder, so that the thread never
+	 * waits for the rest of a frame and a send submitted meanwhile is performed
+	 * at the next wakeup. The thread sleeps in poll() on a wakeup pipe (and on
+	 * the socket while a receive is pending).
+	 * The SSDTP module should not be used for synchronous receive while
+	 * asynchronous receives are in use, because the decoder keeps the state of
+	 * a partially received packet.
+	 */
+	class AsyncWorker: public CxxUtilities::StoppableThread, public SpaceWireSSDTPDecoderListener {
+	private:
+		/** A packet which has been decoded but not yet passed to a receive operation. */
+		class ReceivedPacket {
+		public:
+			std::vector<uint8_t>* buffer;
+			SpaceWireEOPMarker::EOPType eopType;
+			SpaceWireReceiveTimestamp timestamp;
+		};
+
+	public:
+		static const size_t ChunkSize = 64 * 1024;
+		/** The number of recv() calls per wakeup, so that sends are not delayed by a fast peer. */
+		static const size_t MaxReadsPerWakeup = 16;
+
+	private:
+		SpaceWireIFOverTCP* spwif;
+		SpaceWireSSDTPModule* ssdtp;
+		int socketDescriptor;
+		int wakeupPipe[2];
+		pthread_mutex_t mutex;
+		std::deque<SpaceWireIFAsyncOperation*> sendOperations;
+		std::deque<SpaceWireIFAsyncOperation*> receiveOperations;
+		bool failed;
+
+	private:
+		//used only by the worker thread
+		SpaceWireSSDTPDecoder decoder;
+		std::vector<uint8_t> chunk;
+		std::vector<uint8_t>* packet;
+		SpaceWireReceiveTimestamp packetTimestamp;
+		std::deque<ReceivedPacket> receivedPackets;
+
+	public:
+		AsyncWorker(SpaceWireIFOverTCP* spwif, SpaceWireSSDTPModule* ssdtp) :
+				spwif(spwif), ssdtp(ssdtp), decoder(this), packet(NULL) {
+			socketDescriptor = ssdtp->getSocketDescriptor();
+			if (::pipe(wakeupPipe) != 0) {
+				wakeupPipe[0] = -1;
+				wakeupPipe[1] = -1;
+			} else {
+				::fcntl(wakeupPipe[0], F_SETFL, O_NONBLOCK);
+				::fcntl(wakeupPipe[1], F_SETFL, O_NONBLOCK);
+			}
+			pthread_mutex_init(&mutex, NULL);
+			failed = false;
+			stopped = false;
+		}
+
+		~AsyncWorker() {
+			if (wakeupPipe[0] >= 0) {
+				::close(wakeupPipe[0]);
+				::close(wakeupPipe[1]);
+			}
+			releaseReceivedPackets();
+			pthread_mutex_destroy(&mutex);
+		}
+
+	public:
+		void submit(SpaceWireIFAsyncOperation* operation) {
+			pthread_mutex_lock(&mutex);
+			if (failed) {
+				pthread_mutex_unlock(&mutex);
+				finish(operation, SpaceWireIFAsyncOperation::Failed, SpaceWireIFException::Disconnected);
+				return;
+			}
+			if (operation->type == SpaceWireIFAsyncOperation::Send) {
+				sendOperations.push_back(operation);
+			} else {
+				receiveOperations.push_back(operation);
+			}
+			pthread_mutex_unlock(&mutex);
+			wakeup();
+		}
+
+		/** Cancels operations which have not started. */
+		size_t cancel() {
+			std::deque<SpaceWireIFAsyncOperation*> operations;
+			pthread_mutex_lock(&mutex);
+			operations.insert(operations.end(), sendOperations.begin(), sendOperations.end());
+			operations.insert(operations.end(), receiveOperations.begin(), receiveOperations.end());
+			sendOperations.clear();
+			receiveOperations.clear();
+			pthread_mutex_unlock(&mutex);
+			for (size_t i = 0; i < operations.size(); i++) {
+				finish(operations[i], SpaceWireIFAsyncOperation::Cancelled, 0);
+			}
+			return operations.size();
+		}
+
+		/** Stops the thread. The thread does not block in recv(), so waking it up is enough. */
+		void stop() {
+			stopped = true;
+			wakeup();
+		}
+
+	public:
+		void run() {
+			while (!stopped) {
+				SpaceWireIFAsyncOperation* sendOperation = NULL;
+				pthread_mutex_lock(&mutex);
+				if (!sendOperations.empty()) {
+					sendOperation = sendOperations.front();
+					sendOperations.pop_front();
+				}
+				bool receivePending = !receiveOperations.empty();
+				pthread_mutex_unlock(&mutex);
+				if (sendOperation != NULL) {
+					performSend(sendOperation);
+				} else if (receivePending && !receivedPackets.empty()) {
+					performReceive();
+				} else if (waitForEvent(receivePending)) {
+					readAvailableData();
+				}
+				if (failed) {
+					fail();
+					return;
+				}
+			}
+		}
+
+	private:
+		void performSend(SpaceWireIFAsyncOperation* operation) {
+			try {
+				if (operation->buffer != NULL && operation->buffer->size() != 0) {
+					ssdtp->send(&(operation->buffer->at(0)), operation->buffer->size(), operation->eopType);
+					spwif->tapSentPacket(&(operation->buffer->at(0)), operation->buffer->size(), operation->eopType);
+				}
+			} catch (SpaceWireSSDTPException& e) {
+				if (e.getStatus() == SpaceWireSSDTPException::Timeout) {
+					finish(operation, SpaceWireIFAsyncOperation::Failed, SpaceWireIFException::Timeout);
+					return;
+				}
+				setFailed(operation);
+				return;
+			} catch (CxxUtilities::TCPSocketException& e) {
+				setFailed(operation);
+				return;
+			}
+			finish(operation, SpaceWireIFAsyncOperation::Completed, 0);
+		}
+
+		/** Passes the oldest decoded packet to the oldest pending receive operation. */
+		void performReceive() {
+			pthread_mutex_lock(&mutex);
+			if (receiveOperations.empty()) { //cancelled
+				pthread_mutex_unlock(&mutex);
+				return;
+			}
+			SpaceWireIFAsyncOperation* operation = receiveOperations.front();
+			receiveOperations.pop_front();
+			pthread_mutex_unlock(&mutex);
+			ReceivedPacket receivedPacket = receivedPackets.front();
+			receivedPackets.pop_front();
+			SpaceWirePacketBufferPool* pool = spwif->getPacketBufferPool();
+			if (operation->buffer == NULL) {
+				operation->setLeasedBuffer(receivedPacket.buffer, pool);
+			} else {
+				operation->buffer->swap(*receivedPacket.buffer);
+				pool->returnBuffer(receivedPacket.buffer);
+			}
+			operation->timestamp = receivedPacket.timestamp;
+			operation->eopType = receivedPacket.eopType;
+			spwif->tapReceivedPacket(&(operation->buffer->at(0)), operation->buffer->size(), operation->eopType,
+					operation->timestamp);
+			finish(operation, SpaceWireIFAsyncOperation::Completed, 0);
+		}
+
+		/** Reads the bytes which have arrived without blocking, and decodes them.
+		 * A disconnection or a corrupted stream is recorded via setFailed().
+		 */
+		void readAvailableData() {
+			if (chunk.size() == 0) {
+				chunk.resize(ChunkSize);
+			}
+			for (size_t i = 0; i < MaxReadsPerWakeup && !stopped; i++) {
+				ssize_t result = ::recv(socketDescriptor, &chunk[0], chunk.size(), MSG_DONTWAIT);
+				if (result < 0) {
+					if (errno == EINTR) {
+						continue;
+					} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+						return;
+					}
+					setFailed(NULL);
+					return;
+				}
+				if (result == 0) {
+					setFailed(NULL);
+					return;
+				}
+				decoder.decode(&chunk[0], result);
+				if (decoder.hasError()) {
+					setFailed(NULL);
+					return;
+				}
+				if ((size_t) result < chunk.size()) {
+					//the socket has been drained
+					return;
+				}
+			}
+		}
+
+	public:
+		void onDataFrameStart(uint8_t flag, size_t size) {
+			if (packet == NULL) {
+				packet = spwif->getPacketBufferPool()->lease();
+				packetTimestamp.capture(ssdtp->isRealtimeTimestampEnabled());
+			}
+		}
+
+		void onData(uint8_t* data, size_t length) {
+			packet->insert(packet->end(), data, data + length);
+		}
+
+		void onPacketEnd(uint32_t eopType) {
+			if (packet->size() == 0) {
+				//an empty packet is not passed to the application (as in SpaceWireSSDTPModule::receive())
+				return;
+			}
+			ReceivedPacket receivedPacket;
+			receivedPacket.buffer = packet;
+			receivedPacket.eopType = (eopType == SpaceWireEOPMarker::EEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP;
+			receivedPacket.timestamp = packetTimestamp;
+			receivedPackets.push_back(receivedPacket);
+			packet = NULL;
+		}
+
+		void onTimeCode(uint8_t flag, uint8_t timecode) {
+			ssdtp->gotTimeCode(timecode);
+		}
+
+		void onRegisterAccess(uint8_t flag, uint32_t address, uint32_t value) {
+			if (flag == SpaceWireSSDTPProtocol::ControlFlag_RegisterAccess_ReadReply
+					|| flag == SpaceWireSSDTPProtocol::ControlFlag_RegisterAccess_WriteReply) {
+				ssdtp->processRegisterReply(flag, address, value);
+			}
+		}
+
+	private:
+		/** Sleeps until an operation is submitted, or (while a receive is pending) the socket becomes readable.
+		 * @returns true if the socket is readable (or has been closed by the peer).
+		 */
+		bool waitForEvent(bool receivePending) {
+			struct pollfd descriptors[2];
+			descriptors[0].fd = wakeupPipe[0];
+			descriptors[0].events = POLLIN;
+			descriptors[0].revents = 0;
+			descriptors[1].fd = socketDescriptor;
+			descriptors[1].events = POLLIN;
+			descriptors[1].revents = 0;
+			::poll(descriptors, receivePending ? 2 : 1, -1);
+			if (descriptors[0].revents != 0) {
+				uint8_t bytes[64];
+				while (::read(wakeupPipe[0], bytes, sizeof(bytes)) > 0) {
+				}
+			}
+			return receivePending && descriptors[1].revents != 0;
+		}
+
+		void releaseReceivedPackets() {
+			SpaceWirePacketBufferPool* pool = spwif->getPacketBufferPool();
+			for (size_t i = 0; i < receivedPackets.size(); i++) {
+				pool->returnBuffer(receivedPackets[i].buffer);
+			}
+			receivedPackets.clear();
+			pool->returnBuffer(packet);
+			packet = NULL;
+		}
+
+		void wakeup() {
+			uint8_t byte = 0;
+			if (::write(wakeupPipe[1], &byte, 1) < 0) {
+				//the pipe is full, which means that a wakeup is already pending
+			}
+		}
+
+		/** Records disconnection. The operation (if any, and those pending) are finished by run(). */
+		void setFailed(SpaceWireIFAsyncOperation* operation) {
+			pthread_mutex_lock(&mutex);
+			failed = true;
+			if (operation != NULL) {
+				receiveOperations.push_front(operation);
+			}
+			pthread_mutex_unlock(&mutex);
+		}
+
+		/** Finishes all the pending operations as Failed (or Cancelled when stopping). */
+		void fail() {
+			std::deque<SpaceWireIFAsyncOperation*> operations;
+			pthread_mutex_lock(&mutex);
+			operations.insert(operations.end(), receiveOperations.begin(), receiveOperations.end());
+			operations.insert(operations.end(), sendOperations.begin(), sendOperations.end());
+			sendOperations.clear();
+			receiveOperations.clear();
+			pthread_mutex_unlock(&mutex);
+			for (size_t i = 0; i < operations.size(); i++) {
+				if (stopped) {
+					finish(operations[i], SpaceWireIFAsyncOperation::Cancelled, 0);
+				} else {
+					finish(operations[i], SpaceWireIFAsyncOperation::Failed, SpaceWireIFException::Disconnected);
+				}
+			}
+		}
+
+		void finish(SpaceWireIFAsyncOperation* operation, uint32_t status, uint32_t errorStatus) {
+			operation->status = status;
+			operation->errorStatus = errorStatus;
+			spwif->completeAsyncOperation(operation);
+		}
+	};
+
+private:
+	/** A thread which restores the connection in AutoReconnect mode. */
+	class Reconnector: public CxxUtilities::StoppableThread {
+	private:
+		SpaceWireIFOverTCP* spwif;
+
+	public:
+		Reconnector(SpaceWireIFOverTCP* spwif) :
+				spwif(spwif) {
+			stopped = false;
+		}
+
+	public:
+		void run() {
+			spwif->runReconnection();
+		}
+	};
 };
 
 /** History
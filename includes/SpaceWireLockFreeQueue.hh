@@ -0,0 +1,165 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireLockFreeQueue.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIRELOCKFREEQUEUE_HH_
+#define SPACEWIRELOCKFREEQUEUE_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+
+/** A bounded multi-producer multi-consumer queue which does not use locks.
+ * Each slot carries a sequence number which tells producers and consumers
+ * whether the slot is free or filled, so that push() and pop() only need
+ * one compare-and-swap each and never block (D. Vyukov's bounded MPMC queue).
+ * push() fails when the queue is full, and pop() fails when it is empty.
+ * T should be a small copyable type (e.g. a pointer or a POD struct).
+ */
+template<class T>
+class SpaceWireLockFreeQueue {
+private:
+	struct Cell {
+		volatile size_t sequence;
+		T data;
+	};
+
+private:
+	static const size_t CacheLineSize = 64;
+
+private:
+	Cell* buffer;
+	size_t mask;
+	uint8_t padding0[CacheLineSize];
+	volatile size_t enqueuePosition;
+	uint8_t padding1[CacheLineSize];
+	volatile size_t dequeuePosition;
+	uint8_t padding2[CacheLineSize];
+
+public:
+	/** Constructor.
+	 * @param[in] capacity maximum number of elements (rounded up to a power of two).
+	 */
+	SpaceWireLockFreeQueue(size_t capacity) {
+		size_t size = 2;
+		while (size < capacity) {
+			size = size * 2;
+		}
+		buffer = new Cell[size];
+		mask = size - 1;
+		for (size_t i = 0; i < size; i++) {
+			buffer[i].sequence = i;
+		}
+		enqueuePosition = 0;
+		dequeuePosition = 0;
+	}
+
+	~SpaceWireLockFreeQueue() {
+		delete[] buffer;
+	}
+
+private:
+	SpaceWireLockFreeQueue(const SpaceWireLockFreeQueue&);
+	SpaceWireLockFreeQueue& operator=(const SpaceWireLockFreeQueue&);
+
+public:
+	/** Appends an element.
+	 * @returns false if the queue is full.
+	 */
+	bool push(const T& data) {
+		Cell* cell;
+		size_t position = enqueuePosition;
+		while (true) {
+			cell = &buffer[position & mask];
+			size_t sequence = cell->sequence;
+			__sync_synchronize();
+			intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+			if (difference == 0) {
+				if (__sync_bool_compare_and_swap(&enqueuePosition, position, position + 1)) {
+					break;
+				}
+				position = enqueuePosition;
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = enqueuePosition;
+			}
+		}
+		cell->data = data;
+		__sync_synchronize();
+		cell->sequence = position + 1;
+		return true;
+	}
+
+	/** Removes the oldest element.
+	 * @returns false if the queue is empty.
+	 */
+	bool pop(T& data) {
+		Cell* cell;
+		size_t position = dequeuePosition;
+		while (true) {
+			cell = &buffer[position & mask];
+			size_t sequence = cell->sequence;
+			__sync_synchronize();
+			intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+			if (difference == 0) {
+				if (__sync_bool_compare_and_swap(&dequeuePosition, position, position + 1)) {
+					break;
+				}
+				position = dequeuePosition;
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = dequeuePosition;
+			}
+		}
+		data = cell->data;
+		__sync_synchronize();
+		cell->sequence = position + mask + 1;
+		return true;
+	}
+
+public:
+	size_t getCapacity() const {
+		return mask + 1;
+	}
+
+	/** Returns the number of elements. The value is approximate while other threads push or pop. */
+	size_t size() const {
+		size_t enqueued = enqueuePosition;
+		size_t dequeued = dequeuePosition;
+		return (dequeued < enqueued) ? enqueued - dequeued : 0;
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+};
+
+#endif /* SPACEWIRELOCKFREEQUEUE_HH_ */
@@ -35,6 +35,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define SPACEWIREPACKET_HH_
 
 #include "SpaceWireEOPMarker.hh"
+#include "SpaceWireReceiveTimestamp.hh"
 #include <vector>
 
 /**
@@ -53,6 +54,7 @@ protected:
 	uint8_t protocolID;
 //	std::vector<uint8_t> cargo;
 	SpaceWireEOPMarker::EOPType eopType;
+	SpaceWireReceiveTimestamp receiveTimestamp;
 
 public:
 	SpaceWirePacket() {
@@ -132,6 +134,20 @@ public:
 		this->eopType = eopType;
 	}
 
+public:
+	/** Returns the time when this packet arrived at the SpaceWireIF
+	 * (invalid for packets which were not received).
+	 * receiveTimestamp.getElapsedTimeInMicroSec() gives the latency from the wire.
+	 */
+	const SpaceWireReceiveTimestamp& getReceiveTimestamp() const {
+		return receiveTimestamp;
+	}
+
+public:
+	void setReceiveTimestamp(const SpaceWireReceiveTimestamp& receiveTimestamp) {
+		this->receiveTimestamp = receiveTimestamp;
+	}
+
 	/*
 public:
 	virtual std::vector<uint8_t>* getPacketBufferPointer() {
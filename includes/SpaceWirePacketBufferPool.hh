@@ -0,0 +1,227 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWirePacketBufferPool.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIREPACKETBUFFERPOOL_HH_
+#define SPACEWIREPACKETBUFFERPOOL_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Mutex.hh"
+
+/** A pool of packet buffers (std::vector<uint8_t>) which are leased to
+ * receive paths and returned after use, so that a packet stream does not
+ * allocate and free a vector (and its storage) per packet.
+ * Returned buffers are cleared but keep their capacity, so a buffer which
+ * has once held a large packet does not reallocate for the next one.
+ * Buffers whose capacity exceeds maximumRetainedCapacity, and buffers
+ * returned while maximumPooledBuffers buffers are already pooled, are freed.
+ * A buffer obtained via lease() must be given back via returnBuffer(), or
+ * freed via discard() if it should not be recycled; deleting it directly
+ * would leave it counted as outstanding.
+ */
+class SpaceWirePacketBufferPool {
+public:
+	static const size_t DefaultMaximumPooledBuffers = 256;
+	static const size_t DefaultMaximumRetainedCapacity = 1024 * 1024;
+
+private:
+	std::vector<std::vector<uint8_t>*> pooledBuffers;
+	size_t maximumPooledBuffers;
+	size_t maximumRetainedCapacity;
+	CxxUtilities::Mutex mutex;
+
+private:
+	size_t nHits;
+	size_t nMisses;
+	size_t nOutstandingBuffers;
+	size_t nOutstandingBuffersHighWaterMark;
+
+public:
+	SpaceWirePacketBufferPool(size_t maximumPooledBuffers = DefaultMaximumPooledBuffers, size_t maximumRetainedCapacity =
+			DefaultMaximumRetainedCapacity) :
+			maximumPooledBuffers(maximumPooledBuffers), maximumRetainedCapacity(maximumRetainedCapacity) {
+		nHits = 0;
+		nMisses = 0;
+		nOutstandingBuffers = 0;
+		nOutstandingBuffersHighWaterMark = 0;
+	}
+
+	~SpaceWirePacketBufferPool() {
+		trim();
+	}
+
+private:
+	SpaceWirePacketBufferPool(const SpaceWirePacketBufferPool&);
+	SpaceWirePacketBufferPool& operator=(const SpaceWirePacketBufferPool&);
+
+public:
+	/** Returns a pool instance shared in the process. */
+	static SpaceWirePacketBufferPool* getSharedInstance() {
+		static SpaceWirePacketBufferPool sharedInstance;
+		return &sharedInstance;
+	}
+
+public:
+	/** Leases an empty buffer. The buffer should be given back via returnBuffer(). */
+	std::vector<uint8_t>* lease() {
+		std::vector<uint8_t>* buffer;
+		mutex.lock();
+		if (pooledBuffers.size() != 0) {
+			buffer = pooledBuffers.back();
+			pooledBuffers.pop_back();
+			nHits++;
+		} else {
+			buffer = NULL;
+			nMisses++;
+		}
+		nOutstandingBuffers++;
+		if (nOutstandingBuffersHighWaterMark < nOutstandingBuffers) {
+			nOutstandingBuffersHighWaterMark = nOutstandingBuffers;
+		}
+		mutex.unlock();
+		if (buffer == NULL) {
+			buffer = new std::vector<uint8_t>();
+		}
+		return buffer;
+	}
+
+	/** Gives back a buffer obtained via lease(). NULL is ignored. */
+	void returnBuffer(std::vector<uint8_t>* buffer) {
+		if (buffer == NULL) {
+			return;
+		}
+		buffer->clear();
+		bool retained = false;
+		mutex.lock();
+		if (nOutstandingBuffers != 0) {
+			nOutstandingBuffers--;
+		}
+		if (pooledBuffers.size() < maximumPooledBuffers && buffer->capacity() <= maximumRetainedCapacity) {
+			pooledBuffers.push_back(buffer);
+			retained = true;
+		}
+		mutex.unlock();
+		if (!retained) {
+			delete buffer;
+		}
+	}
+
+	/** Frees a buffer obtained via lease() instead of returning it to the pool. NULL is ignored. */
+	void discard(std::vector<uint8_t>* buffer) {
+		if (buffer == NULL) {
+			return;
+		}
+		mutex.lock();
+		if (nOutstandingBuffers != 0) {
+			nOutstandingBuffers--;
+		}
+		mutex.unlock();
+		delete buffer;
+	}
+
+	/** Frees all the pooled buffers. */
+	void trim() {
+		mutex.lock();
+		for (size_t i = 0; i < pooledBuffers.size(); i++) {
+			delete pooledBuffers[i];
+		}
+		pooledBuffers.clear();
+		mutex.unlock();
+	}
+
+public:
+	/** Returns the number of leases served by a pooled buffer. */
+	size_t getNHits() {
+		mutex.lock();
+		size_t n = nHits;
+		mutex.unlock();
+		return n;
+	}
+
+	/** Returns the number of leases which required a new buffer. */
+	size_t getNMisses() {
+		mutex.lock();
+		size_t n = nMisses;
+		mutex.unlock();
+		return n;
+	}
+
+	/** Returns the number of buffers currently leased. */
+	size_t getNOutstandingBuffers() {
+		mutex.lock();
+		size_t n = nOutstandingBuffers;
+		mutex.unlock();
+		return n;
+	}
+
+	/** Returns the largest number of buffers which were leased at the same time. */
+	size_t getNOutstandingBuffersHighWaterMark() {
+		mutex.lock();
+		size_t n = nOutstandingBuffersHighWaterMark;
+		mutex.unlock();
+		return n;
+	}
+
+	size_t getNPooledBuffers() {
+		mutex.lock();
+		size_t n = pooledBuffers.size();
+		mutex.unlock();
+		return n;
+	}
+
+	void resetCounters() {
+		mutex.lock();
+		nHits = 0;
+		nMisses = 0;
+		nOutstandingBuffersHighWaterMark = nOutstandingBuffers;
+		mutex.unlock();
+	}
+
+	void setMaximumPooledBuffers(size_t maximumPooledBuffers) {
+		this->maximumPooledBuffers = maximumPooledBuffers;
+	}
+
+	void setMaximumRetainedCapacity(size_t maximumRetainedCapacity) {
+		this->maximumRetainedCapacity = maximumRetainedCapacity;
+	}
+
+public:
+	std::string toString() {
+		std::stringstream ss;
+		mutex.lock();
+		ss << "hits=" << nHits << " misses=" << nMisses << " outstanding=" << nOutstandingBuffers << " peak="
+				<< nOutstandingBuffersHighWaterMark << " pooled=" << pooledBuffers.size();
+		mutex.unlock();
+		return ss.str();
+	}
+};
+
+#endif /* SPACEWIREPACKETBUFFERPOOL_HH_ */
@@ -128,8 +128,59 @@ public:
 		nReceivedPackets = 0;
 	}
 
+public:
+	virtual ~SpaceWireREngine() {
+		for (size_t i = 0; i < freePackets.size(); i++) {
+			delete freePackets[i];
+		}
+	}
+
 public:
 	static const double DefaultReceiveTimeoutDurationInMicroSec = 1000000;
+	static const size_t MaximumNumberOfPacketsPerReceive = 64;
+	static const size_t MaximumNumberOfFreePackets = 256;
+
+private:
+	std::vector<SpaceWireRPacket*> freePackets;
+	CxxUtilities::Mutex freePacketsMutex;
+
+public:
+	/** Gives back a SpaceWireRPacket instance which was received by this engine
+	 * (TEPs call this for received packets which they have processed).
+	 * The instance is reused for a later received packet instead of being deleted.
+	 * NULL is ignored.
+	 */
+	void releasePacket(SpaceWireRPacket* packet) {
+		if (packet == NULL) {
+			return;
+		}
+		freePacketsMutex.lock();
+		if (freePackets.size() < MaximumNumberOfFreePackets) {
+			freePackets.push_back(packet);
+			packet = NULL;
+		}
+		freePacketsMutex.unlock();
+		delete packet;
+	}
+
+private:
+	/** Returns a released SpaceWireRPacket instance, or a new instance.
+	 * A released instance is not reset, because interpretPacket() sets all the
+	 * fields of a received packet (and its vectors keep their capacity).
+	 */
+	SpaceWireRPacket* leasePacket() {
+		SpaceWireRPacket* packet = NULL;
+		freePacketsMutex.lock();
+		if (freePackets.size() != 0) {
+			packet = freePackets.back();
+			freePackets.pop_back();
+		}
+		freePacketsMutex.unlock();
+		if (packet == NULL) {
+			return new SpaceWireRPacket;
+		}
+		return packet;
+	}
 
 public:
 	void processReceivedSpaceWireRPacket(SpaceWireRPacket* packet) throw (SpaceWireREngineException) {
@@ -159,7 +210,7 @@ public:
 				cout << "SpaceWireREngine::processReceivedSpaceWireRPacket() TEP is not found." << endl;
 #endif
 				nDiscardedReceivedPackets++;
-				delete packet;
+				releasePacket(packet);
 			}
 		} else { //ack packet
 #ifdef DebugSpaceWireREngine
@@ -182,7 +233,7 @@ public:
 				cout << "SpaceWireREngine::processReceivedSpaceWireRPacket() TEP is not found." << endl;
 #endif
 				nDiscardedReceivedPackets++;
-				delete packet;
+				releasePacket(packet);
 			}
 		}
 	}
@@ -198,9 +249,16 @@ public:
 #ifdef DebugSpaceWireREngine
 			cout << "SpaceWireREngine::sendPacket() sending packet." << endl;
 #endif
-			std::vector<uint8_t>* packetBuffer=packet->getPacketBufferPointer();
-			spwif->send(packetBuffer);
-			delete packetBuffer;
+			SpaceWirePacketBufferPool* pool = spwif->getPacketBufferPool();
+			std::vector<uint8_t>* packetBuffer = pool->lease();
+			packet->getPacket(packetBuffer);
+			try {
+				spwif->send(packetBuffer);
+			} catch (...) {
+				pool->returnBuffer(packetBuffer);
+				throw;
+			}
+			pool->returnBuffer(packetBuffer);
 #ifdef SpaceWireREngineDumpPacket
 			SpaceWireUtilities::dumpPacket(packet->getPacketBufferPointer());
 #endif
@@ -265,30 +323,42 @@ public:
 	void run() {
 		using namespace std;
 		spwif->setTimeoutDuration(DefaultReceiveTimeoutDurationInMicroSec);
-		std::vector<uint8_t>* data;
-		SpaceWireRPacket* packet;
+		//packets which arrived in a burst are received in one call, and buffers are reused
+		std::vector<std::vector<uint8_t> > receivedPackets;
+		std::vector<SpaceWireEOPMarker::EOPType> eopTypes;
+		std::vector<uint8_t>* data = NULL;
+		SpaceWireRPacket* packet = NULL;
 		_SpaceWireREngine_run_loop: //
 		while (!stopped) {
 			try {
 #ifdef DebugSpaceWireREngine
 				cout << "SpaceWireREngine::run() Waiting for a packet to be received." << endl;
 #endif
-				data = spwif->receive();
+				size_t nPackets = spwif->receiveBatch(receivedPackets, eopTypes, MaximumNumberOfPacketsPerReceive);
+				const std::vector<SpaceWireReceiveTimestamp>& timestamps = spwif->getReceivedPacketTimestamps();
+				for (size_t i = 0; i < nPackets; i++) {
+					data = &receivedPackets[i];
 #ifdef DebugSpaceWireREngine
-				cout << "SpaceWireREngine::run() A packet was received." << endl;
+					cout << "SpaceWireREngine::run() A packet was received." << endl;
 #endif
 #ifdef SpaceWireREngineDumpPacket
-			SpaceWireUtilities::dumpPacket(data);
+					SpaceWireUtilities::dumpPacket(data);
 #endif
-				nReceivedPackets++;
-				packet = new SpaceWireRPacket;
-				packet->interpretPacket(data);
+					nReceivedPackets++;
+					if (eopTypes[i] == SpaceWireEOPMarker::EEP) {
+						//a packet terminated with EEP may be truncated, and is not interpreted
+						nDiscardedReceivedPackets++;
+						continue;
+					}
+					packet = leasePacket();
+					packet->interpretPacket(data);
+					packet->setReceiveTimestamp((i < timestamps.size()) ? timestamps[i] : SpaceWireReceiveTimestamp());
 #ifdef DebugSpaceWireREngine
-				cout << "SpaceWireREngine::run() Packet was successfully interpreted. ChannelID="
-						<< (uint32_t) packet->getChannelNumber() << endl;
+					cout << "SpaceWireREngine::run() Packet was successfully interpreted. ChannelID="
+							<< (uint32_t) packet->getChannelNumber() << endl;
 #endif
-				processReceivedSpaceWireRPacket(packet);
-				delete data;
+					processReceivedSpaceWireRPacket(packet);
+				}
 			} catch (SpaceWireIFException& e) {
 				//todo
 #ifdef DebugSpaceWireREngine
@@ -307,8 +377,8 @@ public:
 				cerr << "SpaceWireREngine::run() got SpaceWireRPacketException " << e.toString() << endl;
 				dumpReceivedPacket(data);
 				this->stop();
-				delete data;
-				delete packet;
+				releasePacket(packet);
+				packet = NULL;
 				goto _SpaceWireREngine_run_loop;
 			} catch (...) {
 				//todo
@@ -242,6 +242,16 @@ public:
 public:
 	std::vector<uint8_t>* getPacketBufferPointer() {
 		std::vector<uint8_t>* buffer = new std::vector<uint8_t>();
+		getPacket(buffer);
+		return buffer;
+	}
+
+public:
+	/** Constructs the packet in the given buffer (e.g. one leased from SpaceWirePacketBufferPool).
+	 * Previous content of the buffer is discarded, but its capacity is reused.
+	 */
+	void getPacket(std::vector<uint8_t>* buffer) {
+		buffer->clear();
 		constructHeader();
 
 		//Target SpaceWire Address
@@ -268,8 +278,6 @@ public:
 		//Trailer
 		buffer->push_back(crc16 / 0x100);
 		buffer->push_back(crc16 % 0x100);
-
-		return buffer;
 	}
 
 public:
@@ -318,7 +318,7 @@ private:
 				cout << "SpaceWireRReceiveTEP::consumeReceivedPackets() processing Close command." << endl;
 				this->state = SpaceWireRTEPState::Closing;
 				replyAckForPacket(packet);
-				delete packet;
+				spwREngine->releasePacket(packet);
 				continue;
 			}
 
@@ -327,7 +327,7 @@ private:
 				cout << "SpaceWireRReceiveTEP::consumeReceivedPackets() processing Keep Alive command." << endl;
 #endif
 				processKeepAlivePacket(packet);
-				delete packet;
+				spwREngine->releasePacket(packet);
 				continue;
 			}
 		}
@@ -367,7 +367,7 @@ private:
 				slideSlidingWindow();
 			} else {
 				replyAckForPacket(packet);
-				delete packet;
+				spwREngine->releasePacket(packet);
 			}
 		} else if (insideBackwardSlidingWindow(sequenceNumber)) {
 #ifdef DebugSpaceWireRReceiveTEP
@@ -386,7 +386,7 @@ private:
 					<< (uint32_t) this->slidingWindowFrom << endl;
 			CxxUtilities::TerminalControl::displayInCyan(ss.str());
 			replyAckForPacket(packet);
-			delete packet;
+			spwREngine->releasePacket(packet);
 		} else { //outside sliding window
 			//debug
 			CxxUtilities::TerminalControl::displayInCyan("SpaceWireRReceiveTEP::processDataPacket() outside sliding window");
@@ -416,7 +416,7 @@ private:
 			cout << "SpaceWireRReceiveTEP::slideSlidingWindow() n=" << (uint32_t) n << endl;
 #endif
 			reconstructApplicationData(this->slidingWindowBuffer[n]);
-			delete this->slidingWindowBuffer[n];
+			spwREngine->releasePacket(this->slidingWindowBuffer[n]);
 			this->slidingWindowBuffer[n] = NULL;
 			n = (uint8_t) (n + 1);
 		}
@@ -626,7 +626,7 @@ public:
 					if (packet->isControlPacketCloseCommand()) {
 						replyAckForPacket(packet);
 					}
-					delete packet;
+					spwREngine->releasePacket(packet);
 				}
 				waitTimer.wait(WaitDurationForTransitionFromClosingToClosed);
 				this->state = SpaceWireRTEPState::Closed;
@@ -225,7 +225,7 @@ public:
 protected:
 	inline void discardReceivedPackets() {
 		while (receivedPackets.size() != 0) {
-			delete receivedPackets.front();
+			spwREngine->releasePacket(receivedPackets.front());
 			receivedPackets.pop_front();
 		}
 	}
@@ -262,14 +262,14 @@ private:
 			SpaceWireRPacket* packet = this->popReceivedSpaceWireRPacket();
 			if (packet->isAckPacket()) {
 				processAckPacket(packet);
-				delete packet;
+				spwREngine->releasePacket(packet);
 				continue;
 			} else {
 #ifdef DebugSpaceWireRTransmitTEP
 				cout << "SpaceWireRTransmitTEP::consumeReceivedPackets() invalid packet. Stops this TEP." << endl;
 #endif
 				malfunctioningTransportChannel();
-				delete packet;
+				spwREngine->releasePacket(packet);
 				return;
 			}
 		}
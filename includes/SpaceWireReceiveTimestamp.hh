@@ -0,0 +1,122 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireReceiveTimestamp.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPACEWIRERECEIVETIMESTAMP_HH_
+#define SPACEWIRERECEIVETIMESTAMP_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+
+#include <time.h>
+#include <errno.h>
+
+/** Time when a packet arrived at a SpaceWireIF.
+ * The monotonic clock value is used to compute latencies (it is not
+ * affected by changes of the system time), while the optional realtime
+ * clock value can be compared with timestamps taken in other hosts.
+ * A value of 0 means that the clock was not read.
+ */
+class SpaceWireReceiveTimestamp {
+public:
+	uint64_t monotonicInNanoSec;
+	uint64_t realtimeInNanoSec;
+
+public:
+	SpaceWireReceiveTimestamp() :
+			monotonicInNanoSec(0), realtimeInNanoSec(0) {
+	}
+
+public:
+	/** Reads the clocks.
+	 * @param[in] withRealtime if false, only the monotonic clock is read.
+	 */
+	void capture(bool withRealtime = false) {
+		monotonicInNanoSec = getMonotonicClockInNanoSec();
+		realtimeInNanoSec = withRealtime ? getRealtimeClockInNanoSec() : 0;
+	}
+
+	void clear() {
+		monotonicInNanoSec = 0;
+		realtimeInNanoSec = 0;
+	}
+
+	bool isValid() const {
+		return monotonicInNanoSec != 0;
+	}
+
+	bool hasRealtime() const {
+		return realtimeInNanoSec != 0;
+	}
+
+public:
+	/** Returns time elapsed since the packet arrived (0 if the timestamp is not valid). */
+	double getElapsedTimeInMicroSec() const {
+		if (!isValid()) {
+			return 0;
+		}
+		return (getMonotonicClockInNanoSec() - monotonicInNanoSec) / 1e3;
+	}
+
+public:
+	std::string toString() const {
+		std::stringstream ss;
+		ss << "monotonic=" << monotonicInNanoSec << "ns";
+		if (hasRealtime()) {
+			ss << " realtime=" << realtimeInNanoSec / 1000000000 << "." << std::setw(9) << std::setfill('0')
+					<< realtimeInNanoSec % 1000000000 << std::setfill(' ') << "s";
+		}
+		return ss.str();
+	}
+
+public:
+	static uint64_t getMonotonicClockInNanoSec() {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+	}
+
+	static uint64_t getRealtimeClockInNanoSec() {
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+	}
+
+	/** Sleeps until the monotonic clock reaches the given value. */
+	static void sleepUntilMonotonicClock(uint64_t timeInNanoSec) {
+		struct timespec until;
+		until.tv_sec = timeInNanoSec / 1000000000;
+		until.tv_nsec = timeInNanoSec % 1000000000;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+		}
+	}
+};
+
+#endif /* SPACEWIRERECEIVETIMESTAMP_HH_ */
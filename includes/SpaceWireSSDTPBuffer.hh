@@ -0,0 +1,291 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireSSDTPBuffer.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIRESSDTPBUFFER_HH_
+#define SPACEWIRESSDTPBUFFER_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Mutex.hh"
+
+/** A process-wide pool of power-of-two sized memory slabs used by
+ * SpaceWireSSDTPModule instances which share it.
+ * Released slabs are kept in per-size free lists (up to a configurable
+ * number of slabs per size class) and are handed out again to the
+ * next module which needs a buffer of the same size class.
+ * Sizes above the largest size class (MinimumSlabSize << (NSizeClasses - 1))
+ * are allocated with the exact size, and are freed instead of being pooled.
+ */
+class SpaceWireSSDTPBufferPool {
+public:
+	static const size_t MinimumSlabSize = 4096;
+	static const size_t NSizeClasses = 32;
+	static const size_t DefaultMaximumFreeSlabsPerSizeClass = 16;
+
+private:
+	std::vector<uint8_t*> freeSlabs[NSizeClasses];
+	size_t maximumFreeSlabsPerSizeClass;
+	CxxUtilities::Mutex mutex;
+
+private:
+	size_t nBytesInUse;
+	size_t nBytesInUseHighWaterMark;
+	size_t nBytesAllocated;
+	size_t nBytesAllocatedHighWaterMark;
+	size_t nHits;
+	size_t nMisses;
+
+public:
+	SpaceWireSSDTPBufferPool(size_t maximumFreeSlabsPerSizeClass = DefaultMaximumFreeSlabsPerSizeClass) :
+			maximumFreeSlabsPerSizeClass(maximumFreeSlabsPerSizeClass) {
+		nBytesInUse = 0;
+		nBytesInUseHighWaterMark = 0;
+		nBytesAllocated = 0;
+		nBytesAllocatedHighWaterMark = 0;
+		nHits = 0;
+		nMisses = 0;
+	}
+
+	~SpaceWireSSDTPBufferPool() {
+		trim();
+	}
+
+public:
+	/** Returns a pool instance shared in the process. */
+	static SpaceWireSSDTPBufferPool* getSharedInstance() {
+		static SpaceWireSSDTPBufferPool sharedInstance;
+		return &sharedInstance;
+	}
+
+public:
+	/** Allocates a slab which can hold at least size bytes.
+	 * @param[in] size requested size.
+	 * @param[out] capacity actual size of the returned slab.
+	 */
+	uint8_t* allocate(size_t size, size_t& capacity) {
+		size_t sizeClass = getSizeClass(size);
+		capacity = (sizeClass < NSizeClasses) ? MinimumSlabSize << sizeClass : size;
+		uint8_t* slab;
+		mutex.lock();
+		if (sizeClass < NSizeClasses && freeSlabs[sizeClass].size() != 0) {
+			slab = freeSlabs[sizeClass].back();
+			freeSlabs[sizeClass].pop_back();
+			nHits++;
+		} else {
+			slab = (uint8_t*) malloc(capacity);
+			if (slab == NULL) {
+				mutex.unlock();
+				throw std::bad_alloc();
+			}
+			nMisses++;
+			nBytesAllocated += capacity;
+			if (nBytesAllocatedHighWaterMark < nBytesAllocated) {
+				nBytesAllocatedHighWaterMark = nBytesAllocated;
+			}
+		}
+		nBytesInUse += capacity;
+		if (nBytesInUseHighWaterMark < nBytesInUse) {
+			nBytesInUseHighWaterMark = nBytesInUse;
+		}
+		mutex.unlock();
+		return slab;
+	}
+
+	/** Returns a slab obtained via allocate() to the pool. */
+	void release(uint8_t* slab, size_t capacity) {
+		size_t sizeClass = getSizeClass(capacity);
+		mutex.lock();
+		nBytesInUse -= capacity;
+		if (sizeClass < NSizeClasses && freeSlabs[sizeClass].size() < maximumFreeSlabsPerSizeClass) {
+			freeSlabs[sizeClass].push_back(slab);
+		} else {
+			free(slab);
+			nBytesAllocated -= capacity;
+		}
+		mutex.unlock();
+	}
+
+	/** Frees all the slabs kept in the free lists. */
+	void trim() {
+		mutex.lock();
+		for (size_t i = 0; i < NSizeClasses; i++) {
+			for (size_t o = 0; o < freeSlabs[i].size(); o++) {
+				free(freeSlabs[i][o]);
+				nBytesAllocated -= MinimumSlabSize << i;
+			}
+			freeSlabs[i].clear();
+		}
+		mutex.unlock();
+	}
+
+private:
+	/** Returns the size class of a size, or NSizeClasses if it is larger than the largest class. */
+	static size_t getSizeClass(size_t size) {
+		size_t sizeClass = 0;
+		while (sizeClass < NSizeClasses && (MinimumSlabSize << sizeClass) < size) {
+			sizeClass++;
+		}
+		return sizeClass;
+	}
+
+	size_t getCounter(const size_t& counter) {
+		mutex.lock();
+		size_t value = counter;
+		mutex.unlock();
+		return value;
+	}
+
+public:
+	size_t getNBytesInUse() {
+		return getCounter(nBytesInUse);
+	}
+
+	/** Returns the largest number of bytes which were handed out at the same time. */
+	size_t getNBytesInUseHighWaterMark() {
+		return getCounter(nBytesInUseHighWaterMark);
+	}
+
+	/** Returns the number of bytes currently obtained from the system (in use or cached). */
+	size_t getNBytesAllocated() {
+		return getCounter(nBytesAllocated);
+	}
+
+	size_t getNBytesAllocatedHighWaterMark() {
+		return getCounter(nBytesAllocatedHighWaterMark);
+	}
+
+	size_t getNHits() {
+		return getCounter(nHits);
+	}
+
+	size_t getNMisses() {
+		return getCounter(nMisses);
+	}
+
+	void setMaximumFreeSlabsPerSizeClass(size_t maximumFreeSlabsPerSizeClass) {
+		mutex.lock();
+		this->maximumFreeSlabsPerSizeClass = maximumFreeSlabsPerSizeClass;
+		mutex.unlock();
+	}
+};
+
+/** A byte buffer which starts small and grows geometrically to the
+ * largest size requested so far. Memory is taken either from malloc()
+ * or from a SpaceWireSSDTPBufferPool.
+ */
+class SpaceWireSSDTPBuffer {
+public:
+	static const size_t InitialSize = 4096;
+
+private:
+	uint8_t* pointer;
+	size_t capacity;
+	SpaceWireSSDTPBufferPool* pool;
+
+public:
+	SpaceWireSSDTPBuffer(SpaceWireSSDTPBufferPool* pool = NULL) :
+			pointer(NULL), capacity(0), pool(pool) {
+	}
+
+	~SpaceWireSSDTPBuffer() {
+		release();
+	}
+
+private:
+	SpaceWireSSDTPBuffer(const SpaceWireSSDTPBuffer&);
+	SpaceWireSSDTPBuffer& operator=(const SpaceWireSSDTPBuffer&);
+
+public:
+	/** Ensures that the buffer can hold size bytes.
+	 * @param[in] size required size.
+	 * @param[in] preservedSize number of leading bytes which are kept when the buffer is reallocated.
+	 * @returns pointer to the buffer.
+	 */
+	uint8_t* reserve(size_t size, size_t preservedSize = 0) {
+		if (size <= capacity) {
+			return pointer;
+		}
+		size_t newCapacity = (capacity == 0) ? InitialSize : capacity;
+		while (newCapacity < size) {
+			if (((size_t) -1) / 2 < newCapacity) {
+				newCapacity = size;
+				break;
+			}
+			newCapacity *= 2;
+		}
+		uint8_t* newPointer;
+		if (pool != NULL) {
+			newPointer = pool->allocate(newCapacity, newCapacity);
+		} else {
+			newPointer = (uint8_t*) malloc(newCapacity);
+			if (newPointer == NULL) {
+				throw std::bad_alloc();
+			}
+		}
+		if (preservedSize != 0) {
+			memcpy(newPointer, pointer, preservedSize);
+		}
+		release();
+		pointer = newPointer;
+		capacity = newCapacity;
+		return pointer;
+	}
+
+	/** Frees the buffer (or returns it to the pool). */
+	void release() {
+		if (pointer != NULL) {
+			if (pool != NULL) {
+				pool->release(pointer, capacity);
+			} else {
+				free(pointer);
+			}
+		}
+		pointer = NULL;
+		capacity = 0;
+	}
+
+	/** Changes the memory source. The current content is discarded. */
+	void setPool(SpaceWireSSDTPBufferPool* pool) {
+		release();
+		this->pool = pool;
+	}
+
+public:
+	uint8_t* getPointer() {
+		return pointer;
+	}
+
+	size_t getCapacity() const {
+		return capacity;
+	}
+};
+
+#endif /* SPACEWIRESSDTPBUFFER_HH_ */
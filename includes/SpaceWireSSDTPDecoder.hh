@@ -0,0 +1,310 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireSSDTPDecoder.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIRESSDTPDECODER_HH_
+#define SPACEWIRESSDTPDECODER_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+
+#include "SpaceWireEOPMarker.hh"
+#include "SpaceWireSSDTPProtocol.hh"
+
+/** An interface of classes which receive events from SpaceWireSSDTPDecoder.
+ * Pointers passed to the methods point into the byte slice given to
+ * SpaceWireSSDTPDecoder::decode(), and are valid only until the method returns.
+ */
+class SpaceWireSSDTPDecoderListener {
+public:
+	virtual ~SpaceWireSSDTPDecoderListener() {
+	}
+
+public:
+	/** Called when the header of a data frame has been decoded.
+	 * @param[in] flag DataFlag_Complete_EOP, DataFlag_Complete_EEP, or DataFlag_Flagmented.
+	 * @param[in] size payload size of the frame.
+	 */
+	virtual void onDataFrameStart(uint8_t flag, size_t size) {
+	}
+
+	/** Called with payload bytes of the current data frame. A frame may be
+	 * passed in several calls depending on how the input is sliced.
+	 */
+	virtual void onData(uint8_t* data, size_t length) = 0;
+
+	/** Called when a DataFlag_Flagmented frame has ended (the packet continues). */
+	virtual void onFragmentEnd() {
+	}
+
+	/** Called when a data frame which ends a packet has ended.
+	 * @param[in] eopType SpaceWireEOPMarker::EOP or SpaceWireEOPMarker::EEP.
+	 */
+	virtual void onPacketEnd(uint32_t eopType) = 0;
+
+	/** Called when a TimeCode frame (ControlFlag_SendTimeCode or ControlFlag_GotTimeCode) has been decoded. */
+	virtual void onTimeCode(uint8_t flag, uint8_t timecode) {
+	}
+
+	/** Called when a register access frame has been decoded.
+	 * value is 0 for a read command.
+	 */
+	virtual void onRegisterAccess(uint8_t flag, uint32_t address, uint32_t value) {
+	}
+
+	/** Called when another control frame (e.g. ControlFlag_ChangeTxSpeed) has been decoded. */
+	virtual void onControlFrame(uint8_t flag, uint8_t* payload, size_t size) {
+	}
+};
+
+/** An incremental, push-based SSDTP frame decoder.
+ * Arbitrary slices of an SSDTP byte stream are fed via decode(), and
+ * frames are reported to a SpaceWireSSDTPDecoderListener as soon as their
+ * bytes are available. The decoder does not allocate memory, does not
+ * copy payload, and does not perform I/O, so that it can be driven by
+ * blocking sockets, event loops, or data read from files.
+ * @code
+ * SpaceWireSSDTPDecoder decoder(&listener);
+ * while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+ * 	decoder.decode(buffer, n);
+ * 	if (decoder.hasError()) {
+ * 		break;
+ * 	}
+ * }
+ * @endcode
+ */
+class SpaceWireSSDTPDecoder: public SpaceWireSSDTPProtocol {
+public:
+	enum {
+		NoError, InvalidFlag, ControlFrameTooLarge, Aborted
+	};
+
+public:
+	static const size_t MaxControlPayloadSize = 16;
+
+private:
+	SpaceWireSSDTPDecoderListener* listener;
+	uint8_t header[HeaderSize];
+	size_t headerSize;
+	size_t remaining; //payload bytes of the current frame which have not been decoded
+	uint8_t control[MaxControlPayloadSize];
+	size_t controlSize;
+	uint32_t error;
+	size_t nDecodedFrames;
+
+public:
+	/** Constructor.
+	 * @param[in] listener a listener which receives decoded frames (must not be NULL).
+	 */
+	SpaceWireSSDTPDecoder(SpaceWireSSDTPDecoderListener* listener) :
+			listener(listener) {
+		reset();
+		nDecodedFrames = 0;
+	}
+
+public:
+	/** Replaces the listener (must not be NULL). */
+	void setListener(SpaceWireSSDTPDecoderListener* listener) {
+		this->listener = listener;
+	}
+
+	/** Discards a partially decoded frame and clears the error state. */
+	void reset() {
+		headerSize = 0;
+		remaining = 0;
+		controlSize = 0;
+		error = NoError;
+	}
+
+	/** Stops decoding. This can be called by a listener, for example, when
+	 * a packet is too large. decode() returns immediately after the
+	 * listener method returns, and subsequent calls do nothing until reset().
+	 */
+	void abort(uint32_t status = Aborted) {
+		error = status;
+	}
+
+	bool hasError() const {
+		return error != NoError;
+	}
+
+	uint32_t getError() const {
+		return error;
+	}
+
+	size_t getNDecodedFrames() const {
+		return nDecodedFrames;
+	}
+
+public:
+	/** Returns true if the header of a data frame has been decoded and its payload is incomplete. */
+	bool isInDataPayload() const {
+		return headerSize == HeaderSize && isDataFlag(header[0]) && remaining != 0;
+	}
+
+	/** Returns the number of payload bytes of the current frame which have not been decoded yet. */
+	size_t getRemainingPayloadSize() const {
+		return (headerSize == HeaderSize) ? remaining : 0;
+	}
+
+	/** Accounts for payload bytes of the current data frame which the caller
+	 * received by other means (e.g. read directly into a packet buffer).
+	 * onData() is not called for them, but onFragmentEnd()/onPacketEnd() is
+	 * called when the frame ends.
+	 * @param[in] length number of bytes (at most getRemainingPayloadSize()).
+	 */
+	void skipPayload(size_t length) {
+		if (!isInDataPayload() || remaining < length) {
+			return;
+		}
+		remaining -= length;
+		if (remaining == 0) {
+			endDataFrame();
+		}
+	}
+
+public:
+	/** Decodes a slice of an SSDTP byte stream.
+	 * @returns the number of bytes consumed, which is smaller than length
+	 * only when an error occurred or abort() was called.
+	 */
+	size_t decode(uint8_t* data, size_t length) {
+		size_t offset = 0;
+		while (offset != length && error == NoError) {
+			if (headerSize != HeaderSize) {
+				if (headerSize == 0 && HeaderSize <= length - offset) {
+					//whole header available in the input
+					memcpy(header, data + offset, HeaderSize);
+					headerSize = HeaderSize;
+					offset += HeaderSize;
+				} else {
+					size_t n = HeaderSize - headerSize;
+					if (length - offset < n) {
+						n = length - offset;
+					}
+					memcpy(header + headerSize, data + offset, n);
+					headerSize += n;
+					offset += n;
+					if (headerSize != HeaderSize) {
+						break;
+					}
+				}
+				startFrame();
+			} else {
+				size_t n = (remaining < length - offset) ? remaining : length - offset;
+				if (isDataFlag(header[0])) {
+					listener->onData(data + offset, n);
+					remaining -= n;
+					offset += n;
+					if (remaining == 0 && error == NoError) {
+						endDataFrame();
+					}
+				} else {
+					memcpy(control + controlSize, data + offset, n);
+					controlSize += n;
+					remaining -= n;
+					offset += n;
+					if (remaining == 0) {
+						endControlFrame();
+					}
+				}
+			}
+		}
+		return offset;
+	}
+
+public:
+	/** Returns the payload size written in a 12-byte header. */
+	static size_t decodeSize(const uint8_t* header) {
+		size_t size = 0;
+		for (size_t i = 2; i < HeaderSize; i++) {
+			size = size * 0x100 + header[i];
+		}
+		return size;
+	}
+
+	static uint32_t decodeUInt32(const uint8_t* data) {
+		return ((uint32_t) data[0] << 24) + ((uint32_t) data[1] << 16) + ((uint32_t) data[2] << 8) + data[3];
+	}
+
+private:
+	void startFrame() {
+		remaining = decodeSize(header);
+		if (isDataFlag(header[0])) {
+			listener->onDataFrameStart(header[0], remaining);
+			if (remaining == 0 && error == NoError) {
+				endDataFrame();
+			}
+		} else if (isControlFlag(header[0])) {
+			if (MaxControlPayloadSize < remaining) {
+				error = ControlFrameTooLarge;
+				return;
+			}
+			controlSize = 0;
+			if (remaining == 0) {
+				endControlFrame();
+			}
+		} else {
+			error = InvalidFlag;
+		}
+	}
+
+	void endDataFrame() {
+		headerSize = 0;
+		nDecodedFrames++;
+		switch (header[0]) {
+		case DataFlag_Complete_EOP:
+			listener->onPacketEnd(SpaceWireEOPMarker::EOP);
+			break;
+		case DataFlag_Complete_EEP:
+			listener->onPacketEnd(SpaceWireEOPMarker::EEP);
+			break;
+		default:
+			listener->onFragmentEnd();
+			break;
+		}
+	}
+
+	void endControlFrame() {
+		headerSize = 0;
+		nDecodedFrames++;
+		uint8_t flag = header[0];
+		if (flag == ControlFlag_SendTimeCode || flag == ControlFlag_GotTimeCode) {
+			listener->onTimeCode(flag, (controlSize != 0) ? control[0] : 0);
+		} else if (isRegisterAccessFlag(flag) && RegisterReadCommandSize <= controlSize) {
+			uint32_t value = (RegisterReplySize <= controlSize) ? decodeUInt32(control + 4) : 0;
+			listener->onRegisterAccess(flag, decodeUInt32(control), value);
+		} else {
+			listener->onControlFrame(flag, control, controlSize);
+		}
+	}
+};
+
+#endif /* SPACEWIRESSDTPDECODER_HH_ */
@@ -0,0 +1,115 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireSSDTPEncoder.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIRESSDTPENCODER_HH_
+#define SPACEWIRESSDTPENCODER_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+
+#include "SpaceWireEOPMarker.hh"
+#include "SpaceWireSSDTPProtocol.hh"
+
+/** A class that writes SSDTP headers and control frames into caller memory.
+ * No memory is allocated, and no I/O is performed. Each method returns
+ * the number of bytes written.
+ * @code
+ * uint8_t header[SpaceWireSSDTPProtocol::HeaderSize];
+ * SpaceWireSSDTPEncoder::encodeDataHeader(header, data.size(), SpaceWireEOPMarker::EOP);
+ * //send header and data
+ * @endcode
+ */
+class SpaceWireSSDTPEncoder: public SpaceWireSSDTPProtocol {
+public:
+	/** Writes a 12-byte header. */
+	static size_t encodeHeader(uint8_t* header, uint8_t flag, size_t size) {
+		header[0] = flag;
+		header[1] = 0x00; //Reserved
+		for (size_t i = HeaderSize - 1; i > 1; i--) {
+			header[i] = size % 0x100;
+			size = size / 0x100;
+		}
+		return HeaderSize;
+	}
+
+	/** Writes the header of a data frame which ends a packet.
+	 * @param[in] eopType SpaceWireEOPMarker::EOP or SpaceWireEOPMarker::EEP.
+	 */
+	static size_t encodeDataHeader(uint8_t* header, size_t size, uint32_t eopType = SpaceWireEOPMarker::EOP) {
+		return encodeHeader(header, (eopType == SpaceWireEOPMarker::EOP) ? DataFlag_Complete_EOP : DataFlag_Complete_EEP,
+				size);
+	}
+
+	/** Writes the header of a data frame which is followed by other frames of the same packet. */
+	static size_t encodeFragmentHeader(uint8_t* header, size_t size) {
+		return encodeHeader(header, DataFlag_Flagmented, size);
+	}
+
+	/** Writes a TimeCode or ChangeTxSpeed frame (ControlFrameSize bytes). */
+	static size_t encodeControlFrame(uint8_t* frame, uint8_t flag, uint8_t value) {
+		encodeHeader(frame, flag, 2); //1-byte value + 1-byte reserved
+		frame[12] = value;
+		frame[13] = 0x00;
+		return ControlFrameSize;
+	}
+
+	static size_t encodeTimeCode(uint8_t* frame, uint8_t timecode) {
+		return encodeControlFrame(frame, ControlFlag_SendTimeCode, timecode);
+	}
+
+	/** Writes a register read command frame (16 bytes). */
+	static size_t encodeRegisterReadCommand(uint8_t* frame, uint32_t address) {
+		encodeHeader(frame, ControlFlag_RegisterAccess_ReadCommand, RegisterReadCommandSize);
+		encodeUInt32(frame + HeaderSize, address);
+		return HeaderSize + RegisterReadCommandSize;
+	}
+
+	/** Writes a register access frame with an address and a value (20 bytes).
+	 * @param[in] flag ControlFlag_RegisterAccess_WriteCommand, ControlFlag_RegisterAccess_ReadReply,
+	 * or ControlFlag_RegisterAccess_WriteReply.
+	 */
+	static size_t encodeRegisterFrame(uint8_t* frame, uint8_t flag, uint32_t address, uint32_t value) {
+		encodeHeader(frame, flag, RegisterWriteCommandSize);
+		encodeUInt32(frame + HeaderSize, address);
+		encodeUInt32(frame + HeaderSize + 4, value);
+		return HeaderSize + RegisterWriteCommandSize;
+	}
+
+public:
+	static void encodeUInt32(uint8_t* data, uint32_t value) {
+		data[0] = value >> 24;
+		data[1] = value >> 16;
+		data[2] = value >> 8;
+		data[3] = value;
+	}
+};
+
+#endif /* SPACEWIRESSDTPENCODER_HH_ */
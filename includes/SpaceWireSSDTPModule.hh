@@ -32,8 +32,23 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CxxUtilities/Mutex.hh"
 #include "CxxUtilities/Condition.hh"
 #include "CxxUtilities/TCPSocket.hh"
+#include "CxxUtilities/Time.hh"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <errno.h>
 
 #include "SpaceWireIF.hh"
+#include "SpaceWireSSDTPBuffer.hh"
+#include "SpaceWireSSDTPProtocol.hh"
+#include "SpaceWireSSDTPEncoder.hh"
+#include "SpaceWireSSDTPDecoder.hh"
+#include "SpaceWireReceiveTimestamp.hh"
 
 /** An exception class used by SpaceWireSSDTPModule.
  */
@@ -48,6 +63,7 @@ public:
 		EEP,
 		SequenceError,
 		NotImplemented,
+		FragmentHandlerFailed,
 		Undefined
 	};
 
@@ -89,6 +105,9 @@ public:
 		case NotImplemented:
 			result = "NotImplemented";
 			break;
+		case FragmentHandlerFailed:
+			result = "FragmentHandlerFailed";
+			break;
 		case Undefined:
 			result = "Undefined";
 			break;
@@ -101,61 +120,254 @@ public:
 	}
 };
 
+/** A register access request sent to an SSDTP2 bridge.
+ * An instance is owned by the caller, and is passed to
+ * SpaceWireSSDTPModule::requestRegisterRead() or requestRegisterWrite().
+ * It must stay alive until it is completed or cancelled.
+ */
+class SpaceWireSSDTPRegisterRequest {
+public:
+	enum {
+		Read, Write
+	};
+
+public:
+	uint32_t type;
+	uint32_t address;
+	/** Value to be written, or value reported by the bridge after completion. */
+	uint32_t value;
+	volatile bool completed;
+
+public:
+	SpaceWireSSDTPRegisterRequest() :
+			type(Read), address(0), value(0), completed(false) {
+	}
+
+public:
+	bool isCompleted() const {
+		return completed;
+	}
+};
+
+/** An interface of handlers which receive a packet fragment by fragment.
+ * If onFragment() throws, the exception is caught by the module, the rest of
+ * the packet is read and discarded without calling the handler, and
+ * SpaceWireSSDTPException::FragmentHandlerFailed is thrown to the caller of
+ * receiveStreaming() (the original exception is not propagated).
+ * @see SpaceWireSSDTPModule::receiveStreaming()
+ */
+class SpaceWireSSDTPFragmentHandler {
+public:
+	virtual ~SpaceWireSSDTPFragmentHandler() {
+	}
+
+public:
+	/** Called for each fragment of a packet as it arrives.
+	 * @param[in] data fragment content, which is valid only until this method returns.
+	 * @param[in] length fragment size (can be 0 for the last fragment).
+	 * @param[in] isLastFragment true if this fragment ends the packet.
+	 * @param[in] eopType SpaceWireEOPMarker::EOP or SpaceWireEOPMarker::EEP (valid only for the last fragment).
+	 */
+	virtual void onFragment(uint8_t* data, size_t length, bool isLastFragment, uint32_t eopType) = 0;
+};
+
 /** A class that performs synchronous data transfer via
  * TCP/IP network using "Simple- Synchronous- Data Transfer Protocol"
  * which is defined for this class.
  */
-class SpaceWireSSDTPModule {
+class SpaceWireSSDTPModule: public SpaceWireSSDTPProtocol {
 public:
+	/** Maximum packet size accepted by receive(std::vector<uint8_t>*, uint32_t&) and receiveBatch()
+	 * (in both receive modes). A larger packet is discarded, and DataSizeTooLarge is thrown.
+	 */
 	static const uint32_t BufferSize = 10 * 1024 * 1024;
 
+public:
+	enum {
+		ReceiveDirectlyToCallerBuffer, CopyViaReceiveBuffer
+	};
+
 private:
-	CxxUtilities::TCPSocket* datasocket;
-	uint8_t* sendbuffer;
-	uint8_t* receivebuffer;
+	CxxUtilities::TCPSocket* datasocket; //NULL when constructed with a socket descriptor
+	int socketDescriptor;
+	SpaceWireSSDTPBuffer sendbuffer;
+	SpaceWireSSDTPBuffer receivebuffer;
+	size_t bufferHighWaterMark;
 	std::stringstream ss;
 	uint8_t internal_timecode;
 	uint32_t latest_sentsize;
 	CxxUtilities::Mutex sendmutex;
 	CxxUtilities::Mutex receivemutex;
 	SpaceWireIFActionTimecodeScynchronizedAction* timecodeaction;
+	uint32_t receiveMode;
 
 private:
 	/* for SSDTP2 */
-	CxxUtilities::Mutex registermutex;
-	CxxUtilities::Condition registercondition;
-	std::map<uint32_t, uint32_t> registers;
+	pthread_mutex_t registermutex;
+	pthread_cond_t registercondition; //broadcast when a request is completed
+	std::map<uint32_t, uint32_t> registers; //last value reported by the bridge for each address
+	std::map<uint32_t, std::list<SpaceWireSSDTPRegisterRequest*> > pendingRegisterRequests;
+
+public:
+	static const double DefaultRegisterAccessTimeoutInMilliSec = 1000;
 
 private:
 	uint8_t rheader[12];
 	uint8_t r_tmp[30];
 	uint8_t sheader[12];
+	std::vector<uint8_t> sendManyHeaders;
+	std::vector<struct iovec> sendManyIOVectors;
+
+private:
+	/* for read-ahead receive */
+	SpaceWireSSDTPBuffer readaheadbuffer;
+	size_t readaheadbuffersize; //0 when read-ahead is disabled
+	size_t nReceiveSystemCalls;
+	size_t nReceivedPackets;
+	bool batchOverflowPending; //a packet larger than BufferSize ended the previous batch
+
+private:
+	/* for receive timestamps */
+	SpaceWireReceiveTimestamp lastReceivedPacketTimestamp;
+	bool realtimeTimestampEnabled;
+
+public:
+	static const size_t DefaultReadAheadBufferSize = 256 * 1024;
 
 public:
-	size_t receivedsize;
-	size_t rbuf_index;
+	size_t receivedsize; //number of valid bytes in readaheadbuffer
+	size_t rbuf_index; //index of the next unread byte in readaheadbuffer
 
 public:
-	/** Constructor. */
-	SpaceWireSSDTPModule(CxxUtilities::TCPSocket* newdatasocket) {
+	/** Constructor.
+	 * Buffers are allocated when they are first used, and grow to the
+	 * largest frame seen.
+	 * @param[in] newdatasocket a connected socket.
+	 * @param[in] pool a slab pool shared with other modules (NULL to use malloc()).
+	 */
+	SpaceWireSSDTPModule(CxxUtilities::TCPSocket* newdatasocket, SpaceWireSSDTPBufferPool* pool = NULL) :
+			sendbuffer(pool), receivebuffer(pool), readaheadbuffer(pool) {
 		datasocket = newdatasocket;
-		sendbuffer = (uint8_t*) malloc(SpaceWireSSDTPModule::BufferSize);
-		receivebuffer = (uint8_t*) malloc(SpaceWireSSDTPModule::BufferSize);
+		socketDescriptor = datasocket->getSocketDescriptor();
+		initialize();
+	}
+
+	/** Constructor for a connected stream socket which is not wrapped by
+	 * CxxUtilities::TCPSocket (e.g. one end of socketpair()).
+	 * The descriptor is not closed by this module.
+	 * @param[in] newSocketDescriptor a connected stream socket.
+	 * @param[in] pool a slab pool shared with other modules (NULL to use malloc()).
+	 */
+	SpaceWireSSDTPModule(int newSocketDescriptor, SpaceWireSSDTPBufferPool* pool = NULL) :
+			sendbuffer(pool), receivebuffer(pool), readaheadbuffer(pool) {
+		datasocket = NULL;
+		socketDescriptor = newSocketDescriptor;
+		initialize();
+	}
+
+private:
+	void initialize() {
+		bufferHighWaterMark = 0;
 		internal_timecode = 0x00;
 		latest_sentsize = 0;
 		timecodeaction = NULL;
+		receiveMode = ReceiveDirectlyToCallerBuffer;
+		readaheadbuffersize = 0;
 		rbuf_index = 0;
 		receivedsize = 0;
+		nReceiveSystemCalls = 0;
+		nReceivedPackets = 0;
+		batchOverflowPending = false;
+		realtimeTimestampEnabled = false;
+		pthread_mutex_init(&registermutex, NULL);
+		pthread_cond_init(&registercondition, NULL);
 	}
 
 public:
 	/** Destructor. */
 	~SpaceWireSSDTPModule() {
-		if (sendbuffer != NULL) {
-			free(sendbuffer);
+		pthread_cond_destroy(&registercondition);
+		pthread_mutex_destroy(&registermutex);
+	}
+
+public:
+	/** Returns the descriptor of the socket used by this module.
+	 * This is used, for example, by SpaceWireSSDTPReactor to wait for
+	 * incoming data on many modules at once.
+	 */
+	int getSocketDescriptor() {
+		return socketDescriptor;
+	}
+
+	/** Sets the receive timeout.
+	 * Equivalent to CxxUtilities::TCPSocket::setTimeout() of the socket given
+	 * to the constructor, and also works for a bare socket descriptor.
+	 * @param[in] durationInMilliSec timeout duration (0 to wait indefinitely).
+	 */
+	void setTimeout(double durationInMilliSec) {
+		if (datasocket != NULL) {
+			datasocket->setTimeout(durationInMilliSec);
+			return;
 		}
-		if (receivebuffer != NULL) {
-			free(receivebuffer);
+		struct timeval timeout;
+		timeout.tv_sec = (time_t) (durationInMilliSec / 1000);
+		timeout.tv_usec = (suseconds_t) ((durationInMilliSec - timeout.tv_sec * 1000.0) * 1000);
+		::setsockopt(socketDescriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	}
+
+public:
+	/** Switches the module to a new connection (e.g. after reconnection).
+	 * Waits until ongoing send/receive calls return, and discards bytes
+	 * read ahead from the previous socket. The previous socket is neither closed
+	 * nor deleted; the caller should shut it down beforehand so that threads
+	 * blocked on it return.
+	 * @param[in] newdatasocket a connected socket.
+	 */
+	void replaceSocket(CxxUtilities::TCPSocket* newdatasocket) {
+		sendmutex.lock();
+		receivemutex.lock();
+		datasocket = newdatasocket;
+		socketDescriptor = datasocket->getSocketDescriptor();
+		rbuf_index = 0;
+		receivedsize = 0;
+		receivemutex.unlock();
+		sendmutex.unlock();
+	}
+
+public:
+	/** Changes the memory source of the buffers of this module.
+	 * This method should be called before the module is used, since
+	 * buffered content is discarded.
+	 * @param[in] pool a slab pool shared with other modules (NULL to use malloc()).
+	 */
+	void setBufferPool(SpaceWireSSDTPBufferPool* pool) {
+		sendmutex.lock();
+		receivemutex.lock();
+		sendbuffer.setPool(pool);
+		receivebuffer.setPool(pool);
+		readaheadbuffer.setPool(pool);
+		rbuf_index = 0;
+		receivedsize = 0;
+		receivemutex.unlock();
+		sendmutex.unlock();
+	}
+
+public:
+	/** Returns the number of bytes currently held by the buffers of this module. */
+	size_t getBufferSize() const {
+		return sendbuffer.getCapacity() + receivebuffer.getCapacity() + readaheadbuffer.getCapacity();
+	}
+
+	/** Returns the largest number of bytes held by the buffers of this module. */
+	size_t getBufferHighWaterMark() const {
+		return bufferHighWaterMark;
+	}
+
+private:
+	void updateBufferHighWaterMark() {
+		size_t size = getBufferSize();
+		if (bufferHighWaterMark < size) {
+			bufferHighWaterMark = size;
 		}
 	}
 
@@ -178,30 +390,13 @@ public:
 	 * @param[in] eopType End-of-Packet marker. SpaceWireEOPMarker::EOP or SpaceWireEOPMarker::EEP.
 	 */
 	void send(std::vector<uint8_t>* data, uint32_t eopType = SpaceWireEOPMarker::EOP) throw (SpaceWireSSDTPException) {
-		sendmutex.lock();
-		size_t size = data->size();
-		if (eopType == SpaceWireEOPMarker::EOP) {
-			sheader[0] = 0x00;
-		} else {
-			sheader[0] = 0x01;
-		}
-		sheader[1] = 0x00;
-		for (uint32_t i = 11; i > 1; i--) {
-			sheader[i] = size % 0x100;
-			size = size / 0x100;
-		}
-		try {
-			datasocket->send(sheader, 12);
-			datasocket->send(&(data->at(0)), data->size());
-		} catch (...) {
-			sendmutex.unlock();
-			throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
-		}
-		sendmutex.unlock();
+		send((data->size() == 0) ? NULL : &(data->at(0)), data->size(), eopType);
 	}
 
 public:
 	/** Sends a SpaceWire packet via the SpaceWire interface.
+	 * The SSDTP header and the packet content are written with a single
+	 * gather write so that they leave the host in the same TCP segment.
 	 * This is a blocking method.
 	 * @param[in] data packet content.
 	 * @param[in] the length length of the packet.
@@ -209,27 +404,127 @@ public:
 	 */
 	void send(uint8_t* data, size_t length, uint32_t eopType = SpaceWireEOPMarker::EOP) throw (SpaceWireSSDTPException) {
 		sendmutex.lock();
-		if (eopType == SpaceWireEOPMarker::EOP) {
-			sheader[0] = 0x00;
-		} else {
-			sheader[0] = 0x01;
+		SpaceWireSSDTPEncoder::encodeDataHeader(sheader, length, eopType);
+		struct iovec iov[2];
+		iov[0].iov_base = sheader;
+		iov[0].iov_len = 12;
+		iov[1].iov_base = data;
+		iov[1].iov_len = length;
+		try {
+			sendIOVector(iov, 2);
+		} catch (SpaceWireSSDTPException& e) {
+			sendmutex.unlock();
+			throw e;
 		}
-		sheader[1] = 0x00;
-		size_t asize = length;
-		for (size_t i = 11; i > 1; i--) {
-			sheader[i] = asize % 0x100;
-			asize = asize / 0x100;
+		sendmutex.unlock();
+	}
+
+public:
+	/** Sends multiple SpaceWire packets with as few gather writes as possible
+	 * (one write per IOV_MAX/2 packets). This is useful for a burst of small
+	 * packets such as a sequence of RMAP register writes.
+	 * This is a blocking method. When Timeout is thrown, none of the packets
+	 * of the write that timed out has been sent, while those of preceding
+	 * writes have been; with up to IOV_MAX/2 packets, either all or none are sent.
+	 * @param[in] packets packet contents.
+	 * @param[in] eopType End-of-Packet marker used for all the packets.
+	 */
+	void sendMany(std::vector<std::vector<uint8_t>*>& packets, uint32_t eopType = SpaceWireEOPMarker::EOP)
+			throw (SpaceWireSSDTPException) {
+		size_t nPackets = packets.size();
+		if (nPackets == 0) {
+			return;
+		}
+		sendmutex.lock();
+		sendManyHeaders.resize(nPackets * 12);
+		sendManyIOVectors.resize(nPackets * 2);
+		for (size_t i = 0; i < nPackets; i++) {
+			std::vector<uint8_t>* packet = packets[i];
+			SpaceWireSSDTPEncoder::encodeDataHeader(&(sendManyHeaders[i * 12]), packet->size(), eopType);
+			sendManyIOVectors[i * 2].iov_base = &(sendManyHeaders[i * 12]);
+			sendManyIOVectors[i * 2].iov_len = 12;
+			sendManyIOVectors[i * 2 + 1].iov_base = (packet->size() == 0) ? NULL : &(packet->at(0));
+			sendManyIOVectors[i * 2 + 1].iov_len = packet->size();
 		}
 		try {
-			datasocket->send(sheader, 12);
-			datasocket->send(data, length);
-		} catch (...) {
+			size_t nIOVectors = nPackets * 2;
+			for (size_t offset = 0; offset < nIOVectors; offset += MaxIOVectorsPerWrite) {
+				size_t n = nIOVectors - offset;
+				if (MaxIOVectorsPerWrite < n) {
+					n = MaxIOVectorsPerWrite;
+				}
+				sendIOVector(&(sendManyIOVectors[offset]), n);
+			}
+		} catch (SpaceWireSSDTPException& e) {
 			sendmutex.unlock();
-			throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
+			throw e;
 		}
 		sendmutex.unlock();
 	}
 
+private:
+	static const size_t MaxIOVectorsPerWrite = 512;
+
+private:
+	/** Writes all the bytes pointed by an iovec array to the socket.
+	 * The array is modified when a write completes only partially.
+	 * Timeout is thrown only if no byte has been written. Once a part of
+	 * the array has been written, a send timeout is waited out, since the
+	 * peer would otherwise lose the frame boundary.
+	 */
+	void sendIOVector(struct iovec* iov, size_t iovcnt) throw (SpaceWireSSDTPException) {
+		bool started = false;
+		while (iovcnt != 0) {
+			struct msghdr message;
+			memset(&message, 0, sizeof(message));
+			message.msg_iov = iov;
+			message.msg_iovlen = iovcnt;
+			ssize_t result = ::sendmsg(socketDescriptor, &message, SendFlags);
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					if (!started) {
+						throw SpaceWireSSDTPException(SpaceWireSSDTPException::Timeout);
+					}
+					waitUntilWritable();
+					continue;
+				} else {
+					throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
+				}
+			}
+			started = true;
+			size_t written = result;
+			while (iovcnt != 0 && iov->iov_len <= written) {
+				written -= iov->iov_len;
+				iov++;
+				iovcnt--;
+			}
+			if (iovcnt != 0) {
+				iov->iov_base = (uint8_t*) iov->iov_base + written;
+				iov->iov_len -= written;
+			}
+		}
+	}
+
+	/** Blocks until the socket can accept more bytes (or has failed,
+	 * in which case the next write reports the error).
+	 */
+	void waitUntilWritable() {
+		struct pollfd descriptor;
+		descriptor.fd = socketDescriptor;
+		descriptor.events = POLLOUT;
+		descriptor.revents = 0;
+		while (::poll(&descriptor, 1, -1) < 0 && errno == EINTR) {
+		}
+	}
+
+#ifdef MSG_NOSIGNAL
+	static const int SendFlags = MSG_NOSIGNAL;
+#else
+	static const int SendFlags = 0;
+#endif
+
 public:
 	/** Tries to receive a pcket from the SpaceWire interface.
 	 * This method will block the thread for a certain length of time.
@@ -264,7 +559,9 @@ public:
 public:
 	/** Tries to receive a pcket from the SpaceWire interface.
 	 * This method will block the thread for a certain length of time.
-	 * Timeout can happen via the TCPSocket provided to the instance.
+	 * Timeout can happen via the TCPSocket provided to the instance, but only
+	 * before the first frame of a packet arrives; a packet which has started is
+	 * received until its EOP/EEP.
 	 * The code below shows how the timeout duration can be changed.
 	 * @code
 	 * TCPClientSocket* socket=new TCPClientSocket("192.168.1.100", 10030);
@@ -285,89 +582,614 @@ public:
 	 * @param[out] eopType contains an EOP marker type (SpaceWireEOPMarker::EOP or SpaceWireEOPMarker::EEP).
 	 */
 	int receive(std::vector<uint8_t>* data, uint32_t& eopType) throw (SpaceWireSSDTPException) {
+		if (receiveMode == CopyViaReceiveBuffer) {
+			ReceiveDestination destination(&receivebuffer, BufferSize);
+			receivemutex.lock();
+			try {
+				size_t size = receivePacket(destination, eopType);
+				updateBufferHighWaterMark();
+				if (destination.overflowed) {
+					throw SpaceWireSSDTPException(SpaceWireSSDTPException::DataSizeTooLarge);
+				}
+				data->resize(size);
+				memcpy(&(data->at(0)), receivebuffer.getPointer(), size);
+				receivemutex.unlock();
+				return size;
+			} catch (SpaceWireSSDTPException& e) {
+				receivemutex.unlock();
+				throw e;
+			}
+		} else {
+			ReceiveDestination destination(data, BufferSize);
+			size_t size = receivePacket(destination, eopType);
+			if (destination.overflowed) {
+				throw SpaceWireSSDTPException(SpaceWireSSDTPException::DataSizeTooLarge);
+			}
+			return size;
+		}
+	}
+
+public:
+	/** Tries to receive a packet into a caller-owned buffer.
+	 * Payload bytes are written by the socket read directly into the buffer,
+	 * and are not copied afterwards. The timeout behavior is the same as
+	 * that of receive(std::vector<uint8_t>*, uint32_t&).
+	 * If the packet is longer than maxLength, the first maxLength bytes are
+	 * stored, the remaining bytes are discarded, length is set to the
+	 * packet size, and SpaceWireSSDTPException::DataSizeTooLarge is thrown.
+	 * @param[out] buffer a buffer which is used to store received data.
+	 * @param[in] maxLength size of the buffer.
+	 * @param[out] length size of the received packet.
+	 * @param[out] eopType contains an EOP marker type (SpaceWireEOPMarker::EOP or SpaceWireEOPMarker::EEP).
+	 */
+	void receive(uint8_t* buffer, size_t maxLength, size_t& length, uint32_t& eopType)
+			throw (SpaceWireSSDTPException) {
+		ReceiveDestination destination(buffer, maxLength);
+		length = receivePacket(destination, eopType);
+		if (destination.overflowed) {
+			throw SpaceWireSSDTPException(SpaceWireSSDTPException::DataSizeTooLarge);
+		}
+	}
+
+public:
+	/** Receives a packet fragment by fragment without buffering the whole packet.
+	 * Each SSDTP data frame is passed to the handler in pieces of up to
+	 * maxFragmentSize bytes as soon as they have been read from the socket,
+	 * and the last piece is flagged with the EOP/EEP marker of the packet.
+	 * Memory used by this method is therefore bounded by maxFragmentSize,
+	 * whatever the packet size is, and packets larger than BufferSize can be received.
+	 * The handler is invoked in the calling thread. If it throws, the rest of the packet
+	 * is discarded, and FragmentHandlerFailed is thrown when the packet has ended.
+	 * The timeout behavior is the same as that of receive(std::vector<uint8_t>*, uint32_t&):
+	 * Timeout is thrown only before the first frame of a packet; once a fragment has been
+	 * passed to the handler, this method waits for the rest of the packet until EOP/EEP.
+	 * @param[in] handler a handler which receives fragments.
+	 * @param[out] eopType contains an EOP marker type (SpaceWireEOPMarker::EOP or SpaceWireEOPMarker::EEP).
+	 * @param[in] maxFragmentSize maximum size of a fragment passed to the handler.
+	 * @returns packet size.
+	 */
+	size_t receiveStreaming(SpaceWireSSDTPFragmentHandler* handler, uint32_t& eopType, size_t maxFragmentSize =
+			DefaultStreamingFragmentSize) throw (SpaceWireSSDTPException) {
+		if (maxFragmentSize == 0) {
+			maxFragmentSize = DefaultStreamingFragmentSize;
+		}
+		ReceiveDestination destination(handler, &receivebuffer, maxFragmentSize);
+		size_t size = receivePacket(destination, eopType);
+		if (destination.handlerFailed) {
+			throw SpaceWireSSDTPException(SpaceWireSSDTPException::FragmentHandlerFailed);
+		}
+		return size;
+	}
+
+public:
+	static const size_t DefaultStreamingFragmentSize = 256 * 1024;
+
+public:
+	/** Receives a burst of packets under a single lock.
+	 * This method blocks until the first packet is received (the timeout behavior
+	 * is the same as that of receive(std::vector<uint8_t>*, uint32_t&)), and then
+	 * continues to receive packets as long as a whole packet is already available
+	 * in the read-ahead buffer or in the socket, up to maxPackets packets. The batch
+	 * therefore never waits for a packet which has arrived only partially.
+	 * Payload is received directly into the vectors regardless of the receive mode.
+	 * Vectors in packets are reused across calls so that their capacity is retained.
+	 * An error after the first packet ends the batch; it is reported by the next call
+	 * (a packet larger than BufferSize is discarded, and DataSizeTooLarge is thrown by the next call).
+	 * @param[out] packets vectors used to store packets (resized to at least maxPackets entries).
+	 * @param[out] eopTypes EOP marker types of the packets (resized as packets).
+	 * @param[in] maxPackets maximum number of packets to be received.
+	 * @param[out] timestamps if not NULL, receive timestamps of the packets (resized as packets).
+	 * @returns the number of packets received (at least 1).
+	 */
+	size_t receiveBatch(std::vector<std::vector<uint8_t> >& packets, std::vector<SpaceWireEOPMarker::EOPType>& eopTypes,
+			size_t maxPackets, std::vector<SpaceWireReceiveTimestamp>* timestamps = NULL)
+					throw (SpaceWireSSDTPException) {
+		if (maxPackets == 0) {
+			maxPackets = 1;
+		}
+		if (packets.size() < maxPackets) {
+			packets.resize(maxPackets);
+		}
+		eopTypes.resize(packets.size());
+		if (timestamps != NULL) {
+			timestamps->resize(packets.size());
+		}
+		size_t nPackets = 0;
+		uint32_t eopType;
+		receivemutex.lock();
+		if (batchOverflowPending) {
+			batchOverflowPending = false;
+			receivemutex.unlock();
+			throw SpaceWireSSDTPException(SpaceWireSSDTPException::DataSizeTooLarge);
+		}
+		try {
+			ReceiveDestination first(&packets[0], BufferSize);
+			receivePacket(first, eopType);
+			if (first.overflowed) {
+				throw SpaceWireSSDTPException(SpaceWireSSDTPException::DataSizeTooLarge);
+			}
+			eopTypes[0] = (SpaceWireEOPMarker::EOPType) eopType;
+			if (timestamps != NULL) {
+				(*timestamps)[0] = lastReceivedPacketTimestamp;
+			}
+			nPackets = 1;
+			while (nPackets < maxPackets && isCompletePacketAvailable()) {
+				ReceiveDestination destination(&packets[nPackets], BufferSize);
+				receivePacket(destination, eopType);
+				if (destination.overflowed) {
+					batchOverflowPending = true;
+					break;
+				}
+				eopTypes[nPackets] = (SpaceWireEOPMarker::EOPType) eopType;
+				if (timestamps != NULL) {
+					(*timestamps)[nPackets] = lastReceivedPacketTimestamp;
+				}
+				nPackets++;
+			}
+		} catch (SpaceWireSSDTPException& e) {
+			if (nPackets == 0) {
+				receivemutex.unlock();
+				throw e;
+			}
+		}
+		receivemutex.unlock();
+		return nPackets;
+	}
+
+public:
+	/** Returns true if bytes can be received without blocking
+	 * (read-ahead data are buffered, or the socket is readable).
+	 */
+	bool isDataAvailable() {
+		if (rbuf_index != receivedsize) {
+			return true;
+		}
+		struct pollfd descriptor;
+		descriptor.fd = socketDescriptor;
+		descriptor.events = POLLIN;
+		descriptor.revents = 0;
+		return ::poll(&descriptor, 1, 0) > 0;
+	}
+
+private:
+	/** Returns true if the frames of a whole packet (and control frames before it)
+	 * can be received without blocking. Frame headers are parsed from the
+	 * read-ahead buffer, and from the first PeekSize bytes in the socket which
+	 * are peeked when needed. false is returned when a header cannot be seen
+	 * in either of them.
+	 */
+	bool isCompletePacketAvailable() {
+		size_t nBufferedBytes = receivedsize - rbuf_index;
+		int nBytesInSocket = 0;
+		if (::ioctl(socketDescriptor, FIONREAD, &nBytesInSocket) < 0) {
+			nBytesInSocket = 0;
+		}
+		size_t nAvailableBytes = nBufferedBytes + nBytesInSocket;
+		size_t position = 0;
+		size_t packetSize = 0;
+		uint8_t header[HeaderSize];
+		uint8_t peeked[PeekSize];
+		size_t nPeekedBytes = 0;
+		while (position + HeaderSize <= nAvailableBytes) {
+			if (position + HeaderSize <= nBufferedBytes) {
+				memcpy(header, readaheadbuffer.getPointer() + rbuf_index + position, HeaderSize);
+			} else if (nBufferedBytes <= position && position - nBufferedBytes + HeaderSize <= PeekSize) {
+				size_t offset = position - nBufferedBytes;
+				if (nPeekedBytes < offset + HeaderSize) {
+					ssize_t result = ::recv(socketDescriptor, peeked, PeekSize, MSG_PEEK | MSG_DONTWAIT);
+					nPeekedBytes = (result < 0) ? 0 : result;
+					if (nPeekedBytes < offset + HeaderSize) {
+						return false;
+					}
+				}
+				memcpy(header, peeked + offset, HeaderSize);
+			} else {
+				return false;
+			}
+			size_t payloadSize = SpaceWireSSDTPDecoder::decodeSize(header);
+			if (header[0] == ControlFlag_SendTimeCode || header[0] == ControlFlag_GotTimeCode) {
+				payloadSize = 2; //as read by receivePacket()
+			}
+			if (nAvailableBytes < position + HeaderSize + payloadSize) {
+				return false;
+			}
+			position += HeaderSize + payloadSize;
+			if (header[0] == DataFlag_Complete_EOP || header[0] == DataFlag_Complete_EEP) {
+				packetSize += payloadSize;
+				if (packetSize != 0) {
+					return true;
+				}
+				//empty packets are skipped by receivePacket()
+			} else if (header[0] == DataFlag_Flagmented) {
+				packetSize += payloadSize;
+			} else if (header[0] != ControlFlag_SendTimeCode && header[0] != ControlFlag_GotTimeCode
+					&& header[0] != ControlFlag_RegisterAccess_ReadReply
+					&& header[0] != ControlFlag_RegisterAccess_WriteReply) {
+				//an invalid flag is reported by receivePacket() without waiting
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static const size_t PeekSize = 4096;
+
+public:
+	/** Selects how receive(std::vector<uint8_t>*, uint32_t&) stores payload.
+	 * @param[in] receiveMode SpaceWireSSDTPModule::ReceiveDirectlyToCallerBuffer (default) or
+	 * SpaceWireSSDTPModule::CopyViaReceiveBuffer.
+	 */
+	void setReceiveMode(uint32_t receiveMode) {
+		this->receiveMode = receiveMode;
+	}
+
+	uint32_t getReceiveMode() const {
+		return receiveMode;
+	}
+
+public:
+	/** Returns the time when the header of the first data frame of the last
+	 * received packet was completed, i.e. before its payload was read.
+	 * Should be called by the thread which received the packet.
+	 */
+	SpaceWireReceiveTimestamp getLastReceivedPacketTimestamp() const {
+		return lastReceivedPacketTimestamp;
+	}
+
+	/** Selects whether CLOCK_REALTIME is read in addition to CLOCK_MONOTONIC
+	 * when a receive timestamp is taken (default: false).
+	 */
+	void setRealtimeTimestampEnabled(bool enabled) {
+		realtimeTimestampEnabled = enabled;
+	}
+
+	bool isRealtimeTimestampEnabled() const {
+		return realtimeTimestampEnabled;
+	}
+
+private:
+	/** Describes where receivePacket() stores payload bytes.
+	 * A vector is grown as fragments arrive (and is never shrunk before
+	 * the final size is known, so that a reused vector is not zero-filled again),
+	 * while a fixed buffer is filled up to its capacity. A growable buffer
+	 * is grown up to the given capacity. When a fragment handler is set,
+	 * payload is instead streamed to it via the growable buffer, which
+	 * then holds at most one fragment (capacity bytes) at a time.
+	 */
+	class ReceiveDestination {
+	public:
+		std::vector<uint8_t>* vector;
+		SpaceWireSSDTPBuffer* growableBuffer;
+		SpaceWireSSDTPFragmentHandler* fragmentHandler;
+		uint8_t* buffer;
+		size_t capacity;
+		bool overflowed;
+		bool handlerFailed;
+
+	public:
+		ReceiveDestination(std::vector<uint8_t>* vector, size_t capacity) :
+				vector(vector), growableBuffer(NULL), fragmentHandler(NULL), buffer(NULL), capacity(capacity), overflowed(
+						false), handlerFailed(false) {
+		}
+
+		ReceiveDestination(uint8_t* buffer, size_t capacity) :
+				vector(NULL), growableBuffer(NULL), fragmentHandler(NULL), buffer(buffer), capacity(capacity), overflowed(
+						false), handlerFailed(false) {
+		}
+
+		ReceiveDestination(SpaceWireSSDTPBuffer* growableBuffer, size_t capacity) :
+				vector(NULL), growableBuffer(growableBuffer), fragmentHandler(NULL), buffer(NULL), capacity(capacity), overflowed(
+						false), handlerFailed(false) {
+		}
+
+		ReceiveDestination(SpaceWireSSDTPFragmentHandler* fragmentHandler, SpaceWireSSDTPBuffer* growableBuffer,
+				size_t capacity) :
+				vector(NULL), growableBuffer(growableBuffer), fragmentHandler(fragmentHandler), buffer(NULL), capacity(
+						capacity), overflowed(false), handlerFailed(false) {
+		}
+
+	public:
+		/** Returns a pointer to which a fragment of the given length should be written,
+		 * and updates writableLength to the number of bytes which fit.
+		 */
+		uint8_t* reserve(size_t offset, size_t length, size_t& writableLength) {
+			if (vector != NULL) {
+				//the size claimed by a frame header is not trusted beyond capacity
+				size_t requiredSize = (offset + length < capacity) ? offset + length : capacity;
+				if (vector->size() < requiredSize) {
+					vector->resize(requiredSize);
+				}
+				if (offset + length <= capacity) {
+					writableLength = length;
+				} else {
+					overflowed = true;
+					writableLength = (offset < capacity) ? capacity - offset : 0;
+				}
+				return (writableLength == 0) ? NULL : &(vector->at(offset));
+			}
+			if (growableBuffer != NULL) {
+				size_t requiredSize = (offset + length < capacity) ? offset + length : capacity;
+				buffer = growableBuffer->reserve(requiredSize, (offset < capacity) ? offset : capacity);
+			}
+			if (offset + length <= capacity) {
+				writableLength = length;
+			} else {
+				overflowed = true;
+				writableLength = (offset < capacity) ? capacity - offset : 0;
+			}
+			return buffer + offset;
+		}
+
+		void finalize(size_t size) {
+			if (vector != NULL) {
+				vector->resize(overflowed ? capacity : size);
+			}
+		}
+	};
+
+public:
+	/** Enables read-ahead receive.
+	 * In this mode, the socket is read in chunks of up to bufferSize bytes,
+	 * and subsequent SSDTP frames (headers, small payloads, TimeCodes) are
+	 * parsed from the buffered chunk without further system calls.
+	 * Payload parts which are larger than half of the buffer are still read
+	 * directly into the destination once the buffered bytes are consumed.
+	 * @param[in] bufferSize size of the read-ahead buffer.
+	 */
+	void enableReadAhead(size_t bufferSize = DefaultReadAheadBufferSize) {
+		receivemutex.lock();
+		size_t pendingSize = receivedsize - rbuf_index;
+		if (bufferSize < pendingSize) {
+			bufferSize = pendingSize;
+		}
+		if (pendingSize != 0) {
+			memmove(readaheadbuffer.getPointer(), readaheadbuffer.getPointer() + rbuf_index, pendingSize);
+		}
+		readaheadbuffer.reserve(bufferSize, pendingSize);
+		readaheadbuffersize = bufferSize;
+		rbuf_index = 0;
+		receivedsize = pendingSize;
+		updateBufferHighWaterMark();
+		receivemutex.unlock();
+	}
+
+	/** Disables read-ahead receive. Bytes which have already been read ahead
+	 * are not discarded; they are consumed by subsequent receive calls before
+	 * the socket is read again, and the buffer is released when the last of
+	 * them has been consumed.
+	 */
+	void disableReadAhead() {
+		receivemutex.lock();
+		readaheadbuffersize = 0;
+		if (rbuf_index == receivedsize) {
+			readaheadbuffer.release();
+			rbuf_index = 0;
+			receivedsize = 0;
+		}
+		receivemutex.unlock();
+	}
+
+	bool isReadAheadEnabled() const {
+		return readaheadbuffersize != 0;
+	}
+
+public:
+	/** Returns the number of recv() system calls issued by receive methods. */
+	size_t getNReceiveSystemCalls() const {
+		return nReceiveSystemCalls;
+	}
+
+	/** Returns the number of packets returned by receive methods. */
+	size_t getNReceivedPackets() const {
+		return nReceivedPackets;
+	}
+
+	/** Returns the average number of recv() system calls per received packet. */
+	double getNReceiveSystemCallsPerPacket() const {
+		if (nReceivedPackets == 0) {
+			return 0;
+		}
+		return (double) nReceiveSystemCalls / nReceivedPackets;
+	}
+
+	void resetReceiveCounters() {
+		nReceiveSystemCalls = 0;
+		nReceivedPackets = 0;
+	}
+
+private:
+	/** Receives up to length bytes from the byte stream.
+	 * Bytes which have been read ahead are returned first. When the read-ahead
+	 * buffer is empty, either a new chunk is read into it or, for large
+	 * requests, the socket is read directly into the destination.
+	 * @returns the number of bytes stored (at least 1).
+	 */
+	size_t receiveFromStream(uint8_t* destination, size_t length) {
+		if (rbuf_index == receivedsize && readaheadbuffersize != 0 && length < readaheadbuffersize / 2) {
+			rbuf_index = 0;
+			receivedsize = 0;
+			nReceiveSystemCalls++;
+			receivedsize = receiveFromSocket(readaheadbuffer.getPointer(), readaheadbuffersize);
+		}
+		if (rbuf_index != receivedsize) {
+			size_t available = receivedsize - rbuf_index;
+			if (length < available) {
+				available = length;
+			}
+			memcpy(destination, readaheadbuffer.getPointer() + rbuf_index, available);
+			rbuf_index += available;
+			if (rbuf_index == receivedsize && readaheadbuffersize == 0) {
+				//the last bytes read ahead before disableReadAhead() have been consumed
+				readaheadbuffer.release();
+				rbuf_index = 0;
+				receivedsize = 0;
+			}
+			return available;
+		}
+		nReceiveSystemCalls++;
+		return receiveFromSocket(destination, length);
+	}
+
+private:
+	/** Reads the socket once. Errors are reported with CxxUtilities::TCPSocketException
+	 * in the same manner as CxxUtilities::TCPSocket::receive().
+	 */
+	size_t receiveFromSocket(uint8_t* destination, size_t length) {
+		if (datasocket != NULL) {
+			return datasocket->receive(destination, length);
+		}
+		while (true) {
+			ssize_t result = ::recv(socketDescriptor, destination, length, 0);
+			if (0 < result) {
+				return result;
+			} else if (result == 0) {
+				throw CxxUtilities::TCPSocketException(CxxUtilities::TCPSocketException::Disconnected);
+			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				throw CxxUtilities::TCPSocketException(CxxUtilities::TCPSocketException::Timeout);
+			} else if (errno != EINTR) {
+				throw CxxUtilities::TCPSocketException(CxxUtilities::TCPSocketException::TCPSocketError);
+			}
+		}
+	}
+
+	/** Writes all the bytes to the socket. Errors are reported with
+	 * CxxUtilities::TCPSocketException as CxxUtilities::TCPSocket::send() does.
+	 * As in sendIOVector(), Timeout is thrown only if no byte has been written.
+	 */
+	void sendToSocket(uint8_t* data, size_t length) {
+		if (datasocket != NULL) {
+			datasocket->send(data, length);
+			return;
+		}
+		bool started = false;
+		while (length != 0) {
+			ssize_t result = ::send(socketDescriptor, data, length, SendFlags);
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					if (!started) {
+						throw CxxUtilities::TCPSocketException(CxxUtilities::TCPSocketException::Timeout);
+					}
+					waitUntilWritable();
+					continue;
+				}
+				throw CxxUtilities::TCPSocketException(CxxUtilities::TCPSocketException::Disconnected);
+			}
+			started = true;
+			data += result;
+			length -= result;
+		}
+	}
+
+private:
+	/** Receives exactly length bytes of a data frame into the given pointer.
+	 * Timeouts in the middle of a frame are retried, since the stream would
+	 * otherwise lose synchronization.
+	 */
+	void receiveDataPart(uint8_t* data_pointer, size_t length) {
+		size_t received_size = 0;
+		while (received_size != length) {
+			long result;
+			try {
+				result = receiveFromStream(data_pointer + received_size, length - received_size);
+			} catch (CxxUtilities::TCPSocketException& e) {
+				if (e.getStatus() == CxxUtilities::TCPSocketException::Timeout) {
+					continue;
+				}
+				throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
+			}
+			received_size += result;
+		}
+	}
+
+private:
+	/** Discards length bytes of a data frame which did not fit the destination. */
+	void discardDataPart(size_t length) {
+		uint8_t discarded[4096];
+		while (length != 0) {
+			size_t chunk = (length < sizeof(discarded)) ? length : sizeof(discarded);
+			receiveDataPart(discarded, chunk);
+			length -= chunk;
+		}
+	}
+
+private:
+	/** Receives SSDTP frames until a complete packet (EOP/EEP) has been
+	 * stored in the destination. TimeCodes received in between are processed
+	 * via gotTimeCode().
+	 * @returns packet size (which may exceed the capacity of a fixed destination).
+	 */
+	size_t receivePacket(ReceiveDestination& destination, uint32_t& eopType) throw (SpaceWireSSDTPException) {
 		size_t size = 0;
 		size_t hsize = 0;
 		size_t flagment_size = 0;
-		size_t received_size = 0;
+		bool packetStarted;
 
 		try {
 			using namespace std;
-//		cout << "#1" << endl;
 			receivemutex.lock();
 			//header
 			receive_header: //
+			packetStarted = false;
 			rheader[0] = 0xFF;
 			rheader[1] = 0x00;
 			while (rheader[0] != DataFlag_Complete_EOP && rheader[0] != DataFlag_Complete_EEP) {
-//			cout << "#2" << endl;
-
-//			cout << "#2-1" << endl;
 				hsize = 0;
 				flagment_size = 0;
-				received_size = 0;
 				//flag and size part
 				try {
-//				cout << "#2-2" << endl;
 					while (hsize != 12) {
-//					cout << "#2-3" << endl;
-						long result = datasocket->receive(rheader + hsize, 12 - hsize);
-						hsize += result;
-//					cout << "#2-4" << endl;
+						try {
+							long result = receiveFromStream(rheader + hsize, 12 - hsize);
+							hsize += result;
+						} catch (CxxUtilities::TCPSocketException& e) {
+							//once a part of a header, or a frame of a packet, has been consumed, wait for
+							//the rest so that the stream does not lose synchronization and the packet
+							//is not split into two
+							if (e.getStatus() != CxxUtilities::TCPSocketException::Timeout
+									|| (hsize == 0 && !packetStarted)) {
+								throw e;
+							}
+						}
 					}
-				} catch (CxxUtilities::TCPSocketException e) {
-//				cout << "#2-5" << endl;
+				} catch (CxxUtilities::TCPSocketException& e) {
 					if (e.getStatus() == CxxUtilities::TCPSocketException::Timeout) {
-//					cout << "#2-6" << endl;
 						throw SpaceWireSSDTPException(SpaceWireSSDTPException::Timeout);
 					} else {
-//					cout << "#2-7" << endl;
 						throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
 					}
+				} catch (SpaceWireSSDTPException& e) {
+					throw e;
 				} catch (...) {
 					throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
 				}
 
-//			cout << "#3" << endl;
 				//data or control code part
 				if (rheader[0] == DataFlag_Complete_EOP || rheader[0] == DataFlag_Complete_EEP
 						|| rheader[0] == DataFlag_Flagmented) {
-//				cout << "#4" << endl;
 					//data
-					for (uint32_t i = 2; i < 12; i++) {
-						flagment_size = flagment_size * 0x100 + rheader[i];
+					if (!packetStarted) {
+						lastReceivedPacketTimestamp.capture(realtimeTimestampEnabled);
+						packetStarted = true;
 					}
-					//uint8_t* data_pointer=&(data->at(0));
-					uint8_t* data_pointer = receivebuffer;
-//				cout << "#5" << endl;
-					while (received_size != flagment_size) {
-//					cout << "#6" << endl;
-						long result;
-						_loop_receiveDataPart: //
-						try {
-							result = datasocket->receive(data_pointer + size + received_size, flagment_size - received_size);
-						} catch (CxxUtilities::TCPSocketException e) {
-							if (e.getStatus() == CxxUtilities::TCPSocketException::Timeout) {
-								goto _loop_receiveDataPart;
-							}
-							cout << "SSDTPModule::receive() exception when receiving data" << endl;
-							cout << "rheader[0]=0x" << setw(2) << setfill('0') << hex << (uint32_t) rheader[0] << endl;
-							cout << "rheader[1]=0x" << setw(2) << setfill('0') << hex << (uint32_t) rheader[1] << endl;
-							cout << "size=" << dec << size << endl;
-							cout << "flagment_size=" << dec << flagment_size << endl;
-							cout << "received_size=" << dec << received_size << endl;
-							exit(-1);
-						}
-						received_size += result;
+					flagment_size = SpaceWireSSDTPDecoder::decodeSize(rheader);
+					if (destination.fragmentHandler != NULL) {
+						streamDataPart(destination, size, flagment_size);
+					} else {
+						size_t writable_size;
+						uint8_t* data_pointer = destination.reserve(size, flagment_size, writable_size);
+						receiveDataPart(data_pointer, writable_size);
+						discardDataPart(flagment_size - writable_size);
 					}
-//				cout << "#7" << endl;
-					size += received_size;
+					size += flagment_size;
 				} else if (rheader[0] == ControlFlag_SendTimeCode || rheader[0] == ControlFlag_GotTimeCode) {
 					//control
 					uint8_t timecode_and_reserved[2];
 					uint32_t tmp_size = 0;
 					try {
 						while (tmp_size != 2) {
-							int result = datasocket->receive(timecode_and_reserved + tmp_size, 2 - tmp_size);
+							int result = receiveFromStream(timecode_and_reserved + tmp_size, 2 - tmp_size);
 							tmp_size += result;
 						}
 					} catch (...) {
@@ -383,19 +1205,25 @@ public:
 						gotTimeCode(internal_timecode);
 						break;
 					}
-//				cout << "#11" << endl;
+				} else if (rheader[0] == ControlFlag_RegisterAccess_ReadReply
+						|| rheader[0] == ControlFlag_RegisterAccess_WriteReply) {
+					//register access reply
+					size_t reply_size = SpaceWireSSDTPDecoder::decodeSize(rheader);
+					if (sizeof(r_tmp) < reply_size) {
+						throw SpaceWireSSDTPException(SpaceWireSSDTPException::TCPSocketError);
+					}
+					receiveDataPart(r_tmp, reply_size);
+					processRegisterReply(rheader[0], r_tmp, reply_size);
 				} else {
-					cout << "SSDTP fatal error with flag value of 0x" << hex << (uint32_t) rheader[0] << dec << endl;
+					//an unknown flag; the stream cannot be resynchronized
 					throw SpaceWireSSDTPException(SpaceWireSSDTPException::TCPSocketError);
 				}
 			}
-//		cout << "#8 " << size << endl;
-			data->resize(size);
-			if (size != 0) {
-				memcpy(&(data->at(0)), receivebuffer, size);
-			} else {
+			if (size == 0) {
 				goto receive_header;
 			}
+			destination.finalize(size);
+			nReceivedPackets++;
 			if (rheader[0] == DataFlag_Complete_EOP) {
 				eopType = SpaceWireEOPMarker::EOP;
 			} else if (rheader[0] == DataFlag_Complete_EEP) {
@@ -403,32 +1231,56 @@ public:
 			} else {
 				eopType = SpaceWireEOPMarker::Continued;
 			}
-//		cout << "#9" << endl;
 			receivemutex.unlock();
 			return size;
 		} catch (SpaceWireSSDTPException& e) {
 			receivemutex.unlock();
 			throw e;
 		} catch (CxxUtilities::TCPSocketException& e) {
-			using namespace std;
-//			cout << "#SpaceWireSSDTPModule::receive() caught TCPSocketException(" << e.toString() << ")" << endl;
 			receivemutex.unlock();
 			throw SpaceWireSSDTPException(SpaceWireSSDTPException::TCPSocketError);
-		}/* catch (...) {
-			using namespace std;
-			cout << "#SpaceWireSSDTPModule::receive() caught an unexpected exception" << endl;
-			cout << "Receive Header: ";
-			for (size_t i = 0; i < 12; i++) {
-				cout << "0x" << hex << right << setw(2) << setfill('0') << (uint32_t) rheader[i] << " ";
-			}
-			cout << endl;
-			cout << "size=" << size << endl;
-			cout << "hsize=" << hsize << endl;
-			cout << "flagment_size=" << flagment_size << endl;
-			cout << "received_size=" << received_size << endl;
+		} catch (...) {
+			//e.g. std::bad_alloc; reported within the exception specification
 			receivemutex.unlock();
-			throw SpaceWireSSDTPException(SpaceWireSSDTPException::TCPSocketError);
-		}*/
+			throw SpaceWireSSDTPException(SpaceWireSSDTPException::Undefined);
+		}
+	}
+
+private:
+	/** Receives a data frame in pieces of up to destination.capacity bytes,
+	 * and passes each piece to the fragment handler of the destination.
+	 * The frame header is in rheader.
+	 * @param[in] offset number of bytes of the packet passed to the handler before this frame.
+	 * @param[in] length frame size.
+	 */
+	void streamDataPart(ReceiveDestination& destination, size_t offset, size_t length) {
+		bool isLastFrame = (rheader[0] != DataFlag_Flagmented);
+		uint32_t eopType = (rheader[0] == DataFlag_Complete_EEP) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP;
+		size_t remaining = length;
+		do {
+			size_t fragmentSize = (remaining < destination.capacity) ? remaining : destination.capacity;
+			uint8_t* fragment = destination.growableBuffer->reserve(fragmentSize);
+			updateBufferHighWaterMark();
+			receiveDataPart(fragment, fragmentSize);
+			remaining -= fragmentSize;
+			bool isLastFragment = isLastFrame && remaining == 0;
+			//empty packets are skipped as in the other receive methods; after the handler
+			//has thrown, the rest of the packet is read but not passed to it
+			if (!destination.handlerFailed && (fragmentSize != 0 || (isLastFragment && offset != 0))) {
+				try {
+					destination.fragmentHandler->onFragment(fragment, fragmentSize, isLastFragment, eopType);
+				} catch (...) {
+					destination.handlerFailed = true;
+				}
+			}
+		} while (remaining != 0);
+	}
+
+private:
+	uint8_t* reserveSendBuffer(size_t size) {
+		uint8_t* pointer = sendbuffer.reserve(size);
+		updateBufferHighWaterMark();
+		return pointer;
 	}
 
 public:
@@ -437,16 +1289,10 @@ public:
 	 */
 	void sendTimeCode(uint8_t timecode) throw (SpaceWireSSDTPException) {
 		sendmutex.lock();
-		sendbuffer[0] = SpaceWireSSDTPModule::ControlFlag_SendTimeCode;
-		sendbuffer[1] = 0x00; //Reserved
-		for (uint32_t i = 0; i < LengthOfSizePart - 1; i++) {
-			sendbuffer[i + 2] = 0x00;
-		}
-		sendbuffer[11] = 0x02; //2bytes = 1byte timecode + 1byte reserved
-		sendbuffer[12] = timecode;
-		sendbuffer[13] = 0;
+		uint8_t* frame = reserveSendBuffer(ControlFrameSize);
+		SpaceWireSSDTPEncoder::encodeTimeCode(frame, timecode);
 		try {
-			datasocket->send(sendbuffer, 14);
+			sendToSocket(frame, ControlFrameSize);
 			sendmutex.unlock();
 		} catch (CxxUtilities::TCPSocketException& e) {
 			sendmutex.unlock();
@@ -507,16 +1353,214 @@ public:
 		}
 	}
 
-private:
-	void registerRead(uint32_t address) {
-		throw SpaceWireSSDTPException(SpaceWireSSDTPException::NotImplemented);
+public:
+	/** Reads a register of the SSDTP2 bridge.
+	 * The reply is processed by the receive methods, and therefore another
+	 * thread (e.g. RMAPEngine or SpaceWireSSDTPReactor) should be receiving
+	 * packets from this module while this method waits.
+	 * @param[in] address register address.
+	 * @param[in] timeoutInMilliSec maximum waiting time for the reply.
+	 * @returns register value.
+	 */
+	uint32_t registerRead(uint32_t address, double timeoutInMilliSec = DefaultRegisterAccessTimeoutInMilliSec)
+			throw (SpaceWireSSDTPException) {
+		SpaceWireSSDTPRegisterRequest request;
+		requestRegisterRead(&request, address);
+		if (!waitRegisterRequest(&request, timeoutInMilliSec)) {
+			cancelRegisterRequest(&request);
+			throw SpaceWireSSDTPException(SpaceWireSSDTPException::Timeout);
+		}
+		return request.value;
+	}
+
+public:
+	/** Writes a register of the SSDTP2 bridge, and waits for the reply.
+	 * @see registerRead()
+	 * @param[in] address register address.
+	 * @param[in] value value to be written.
+	 * @param[in] timeoutInMilliSec maximum waiting time for the reply.
+	 */
+	void registerWrite(uint32_t address, uint32_t value, double timeoutInMilliSec =
+			DefaultRegisterAccessTimeoutInMilliSec) throw (SpaceWireSSDTPException) {
+		SpaceWireSSDTPRegisterRequest request;
+		requestRegisterWrite(&request, address, value);
+		if (!waitRegisterRequest(&request, timeoutInMilliSec)) {
+			cancelRegisterRequest(&request);
+			throw SpaceWireSSDTPException(SpaceWireSSDTPException::Timeout);
+		}
+	}
+
+public:
+	/** Sends a register read command without waiting for the reply.
+	 * Multiple requests can be outstanding at the same time. Replies are
+	 * matched to requests by address, in the order the requests were sent.
+	 * @param[in] request a caller-owned request instance.
+	 * @param[in] address register address.
+	 */
+	void requestRegisterRead(SpaceWireSSDTPRegisterRequest* request, uint32_t address) throw (SpaceWireSSDTPException) {
+		request->type = SpaceWireSSDTPRegisterRequest::Read;
+		request->address = address;
+		request->value = 0;
+		sendRegisterCommand(request, ControlFlag_RegisterAccess_ReadCommand);
+	}
+
+	/** Sends a register write command without waiting for the reply.
+	 * @see requestRegisterRead()
+	 * @param[in] request a caller-owned request instance.
+	 * @param[in] address register address.
+	 * @param[in] value value to be written.
+	 */
+	void requestRegisterWrite(SpaceWireSSDTPRegisterRequest* request, uint32_t address, uint32_t value)
+			throw (SpaceWireSSDTPException) {
+		request->type = SpaceWireSSDTPRegisterRequest::Write;
+		request->address = address;
+		request->value = value;
+		sendRegisterCommand(request, ControlFlag_RegisterAccess_WriteCommand);
+	}
+
+	/** Waits until a request is completed.
+	 * The waiting thread is woken up by the receive path as soon as the reply
+	 * has been processed.
+	 * @returns true if completed, false if timed out (the request is still outstanding).
+	 */
+	bool waitRegisterRequest(SpaceWireSSDTPRegisterRequest* request, double timeoutInMilliSec =
+			DefaultRegisterAccessTimeoutInMilliSec) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		long long timeoutInNanoSec = (long long) (timeoutInMilliSec * 1e6);
+		deadline.tv_sec += timeoutInNanoSec / 1000000000;
+		deadline.tv_nsec += timeoutInNanoSec % 1000000000;
+		if (1000000000 <= deadline.tv_nsec) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+		//completed is set under registermutex, so a reply cannot slip in between the check and the wait
+		pthread_mutex_lock(&registermutex);
+		while (!request->completed) {
+			if (pthread_cond_timedwait(&registercondition, &registermutex, &deadline) == ETIMEDOUT) {
+				break;
+			}
+		}
+		bool completed = request->completed;
+		pthread_mutex_unlock(&registermutex);
+		return completed;
+	}
+
+	/** Withdraws an outstanding request. A reply which arrives later is ignored. */
+	void cancelRegisterRequest(SpaceWireSSDTPRegisterRequest* request) {
+		pthread_mutex_lock(&registermutex);
+		std::map<uint32_t, std::list<SpaceWireSSDTPRegisterRequest*> >::iterator it = pendingRegisterRequests.find(
+				request->address);
+		if (it != pendingRegisterRequests.end()) {
+			it->second.remove(request);
+			if (it->second.empty()) {
+				pendingRegisterRequests.erase(it);
+			}
+		}
+		pthread_mutex_unlock(&registermutex);
+	}
+
+	/** Returns the number of requests waiting for replies. */
+	size_t getNOutstandingRegisterRequests() {
+		pthread_mutex_lock(&registermutex);
+		size_t n = 0;
+		std::map<uint32_t, std::list<SpaceWireSSDTPRegisterRequest*> >::iterator it;
+		for (it = pendingRegisterRequests.begin(); it != pendingRegisterRequests.end(); it++) {
+			n += it->second.size();
+		}
+		pthread_mutex_unlock(&registermutex);
+		return n;
+	}
+
+	/** Returns the value last reported by the bridge for an address.
+	 * @returns false if no reply has been received for the address.
+	 */
+	bool getLastRegisterValue(uint32_t address, uint32_t& value) {
+		pthread_mutex_lock(&registermutex);
+		std::map<uint32_t, uint32_t>::iterator it = registers.find(address);
+		bool found = (it != registers.end());
+		if (found) {
+			value = it->second;
+		}
+		pthread_mutex_unlock(&registermutex);
+		return found;
+	}
+
+public:
+	/** Completes the oldest outstanding request which matches a received reply.
+	 * This method is called by the receive methods (and by SpaceWireSSDTPReactor),
+	 * and users do not need to use this method.
+	 * @param[in] flag ControlFlag_RegisterAccess_ReadReply or ControlFlag_RegisterAccess_WriteReply.
+	 * @param[in] payload reply payload (4-byte address followed by 4-byte value, big endian).
+	 * @param[in] size payload size.
+	 */
+	void processRegisterReply(uint8_t flag, uint8_t* payload, size_t size) {
+		if (size < RegisterReplySize) {
+			return;
+		}
+		processRegisterReply(flag, SpaceWireSSDTPDecoder::decodeUInt32(payload),
+				SpaceWireSSDTPDecoder::decodeUInt32(payload + 4));
+	}
+
+	/** Completes the oldest outstanding request which matches a decoded reply.
+	 * @see processRegisterReply(uint8_t, uint8_t*, size_t)
+	 */
+	void processRegisterReply(uint8_t flag, uint32_t address, uint32_t value) {
+		uint32_t type =
+				(flag == ControlFlag_RegisterAccess_ReadReply) ?
+						SpaceWireSSDTPRegisterRequest::Read : SpaceWireSSDTPRegisterRequest::Write;
+		pthread_mutex_lock(&registermutex);
+		registers[address] = value;
+		std::map<uint32_t, std::list<SpaceWireSSDTPRegisterRequest*> >::iterator it = pendingRegisterRequests.find(
+				address);
+		if (it != pendingRegisterRequests.end()) {
+			std::list<SpaceWireSSDTPRegisterRequest*>::iterator request;
+			for (request = it->second.begin(); request != it->second.end(); request++) {
+				if ((*request)->type == type) {
+					(*request)->value = value;
+					(*request)->completed = true;
+					it->second.erase(request);
+					break;
+				}
+			}
+			if (it->second.empty()) {
+				pendingRegisterRequests.erase(it);
+			}
+		}
+		pthread_cond_broadcast(&registercondition);
+		pthread_mutex_unlock(&registermutex);
 	}
 
 private:
-	void registerWrite(uint32_t address, std::vector<uint8_t> data) {
-		//send command
+	/** Registers a request as outstanding, and sends its command frame.
+	 * The payload of a command is a 4-byte address, followed by a 4-byte
+	 * value for a write command (big endian).
+	 */
+	void sendRegisterCommand(SpaceWireSSDTPRegisterRequest* request, uint8_t flag) throw (SpaceWireSSDTPException) {
+		request->completed = false;
+		pthread_mutex_lock(&registermutex);
+		pendingRegisterRequests[request->address].push_back(request);
+		pthread_mutex_unlock(&registermutex);
+
 		sendmutex.lock();
-		sendbuffer[0] = ControlFlag_RegisterAccess_WriteCommand;
+		uint8_t* frame = reserveSendBuffer(HeaderSize + RegisterWriteCommandSize);
+		size_t frameSize;
+		if (flag == ControlFlag_RegisterAccess_ReadCommand) {
+			frameSize = SpaceWireSSDTPEncoder::encodeRegisterReadCommand(frame, request->address);
+		} else {
+			frameSize = SpaceWireSSDTPEncoder::encodeRegisterFrame(frame, flag, request->address, request->value);
+		}
+		try {
+			sendToSocket(frame, frameSize);
+		} catch (CxxUtilities::TCPSocketException& e) {
+			sendmutex.unlock();
+			cancelRegisterRequest(request);
+			if (e.getStatus() == CxxUtilities::TCPSocketException::Timeout) {
+				throw SpaceWireSSDTPException(SpaceWireSSDTPException::Timeout);
+			} else {
+				throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
+			}
+		}
 		sendmutex.unlock();
 	}
 
@@ -527,16 +1571,10 @@ public:
 	 */
 	void setTxDivCount(uint8_t txdivcount) {
 		sendmutex.lock();
-		sendbuffer[0] = SpaceWireSSDTPModule::ControlFlag_ChangeTxSpeed;
-		sendbuffer[1] = 0x00; //Reserved
-		for (uint32_t i = 0; i < LengthOfSizePart - 1; i++) {
-			sendbuffer[i + 2] = 0x00;
-		}
-		sendbuffer[11] = 0x02; //2bytes = 1byte txdivcount + 1byte reserved
-		sendbuffer[12] = txdivcount;
-		sendbuffer[13] = 0;
+		uint8_t* frame = reserveSendBuffer(ControlFrameSize);
+		SpaceWireSSDTPEncoder::encodeControlFrame(frame, ControlFlag_ChangeTxSpeed, txdivcount);
 		try {
-			datasocket->send(sendbuffer, 14);
+			sendToSocket(frame, ControlFrameSize);
 		} catch (CxxUtilities::TCPSocketException& e) {
 			sendmutex.unlock();
 			if (e.getStatus() == CxxUtilities::TCPSocketException::Timeout) {
@@ -555,7 +1593,7 @@ public:
 	void sendRawData(uint8_t* data, size_t length) throw (SpaceWireSSDTPException) {
 		sendmutex.lock();
 		try {
-			datasocket->send(data, length);
+			sendToSocket(data, length);
 		} catch (CxxUtilities::TCPSocketException& e) {
 			sendmutex.unlock();
 			if (e.getStatus() == CxxUtilities::TCPSocketException::Timeout) {
@@ -566,20 +1604,6 @@ public:
 		}
 		sendmutex.unlock();
 	}
-
-public:
-	/* for SSDTP2 */
-	static const uint8_t DataFlag_Complete_EOP = 0x00;
-	static const uint8_t DataFlag_Complete_EEP = 0x01;
-	static const uint8_t DataFlag_Flagmented = 0x02;
-	static const uint8_t ControlFlag_SendTimeCode = 0x30;
-	static const uint8_t ControlFlag_GotTimeCode = 0x31;
-	static const uint8_t ControlFlag_ChangeTxSpeed = 0x38;
-	static const uint8_t ControlFlag_RegisterAccess_ReadCommand = 0x40;
-	static const uint8_t ControlFlag_RegisterAccess_ReadReply = 0x41;
-	static const uint8_t ControlFlag_RegisterAccess_WriteCommand = 0x50;
-	static const uint8_t ControlFlag_RegisterAccess_WriteReply = 0x51;
-	static const uint32_t LengthOfSizePart = 10;
 };
 
 #endif /*SPACEWIRESSDTPMODULE_HH_*/
@@ -0,0 +1,93 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireSSDTPProtocol.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIRESSDTPPROTOCOL_HH_
+#define SPACEWIRESSDTPPROTOCOL_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+
+/** A class that collects constant parameters of the Simple- Synchronous-
+ * Data Transfer Protocol (SSDTP and SSDTP2).
+ * A frame consists of a 12-byte header (1-byte flag, 1-byte reserved,
+ * and 10-byte big-endian payload size) followed by the payload.
+ * Payloads of register access frames are a 4-byte address followed by
+ * a 4-byte value (not present in a read command), both in big endian.
+ */
+class SpaceWireSSDTPProtocol {
+public:
+	static const uint8_t DataFlag_Complete_EOP = 0x00;
+	static const uint8_t DataFlag_Complete_EEP = 0x01;
+	static const uint8_t DataFlag_Flagmented = 0x02;
+	static const uint8_t ControlFlag_SendTimeCode = 0x30;
+	static const uint8_t ControlFlag_GotTimeCode = 0x31;
+	static const uint8_t ControlFlag_ChangeTxSpeed = 0x38;
+	static const uint8_t ControlFlag_RegisterAccess_ReadCommand = 0x40;
+	static const uint8_t ControlFlag_RegisterAccess_ReadReply = 0x41;
+	static const uint8_t ControlFlag_RegisterAccess_WriteCommand = 0x50;
+	static const uint8_t ControlFlag_RegisterAccess_WriteReply = 0x51;
+
+public:
+	static const uint32_t LengthOfSizePart = 10;
+	static const size_t HeaderSize = 12;
+	/** Size of a TimeCode or ChangeTxSpeed frame (header + 1-byte value + 1-byte reserved). */
+	static const size_t ControlFrameSize = 14;
+	static const size_t RegisterReadCommandSize = 4;
+	static const size_t RegisterWriteCommandSize = 8;
+	static const size_t RegisterReplySize = 8;
+
+public:
+	static bool isDataFlag(uint8_t flag) {
+		return flag == DataFlag_Complete_EOP || flag == DataFlag_Complete_EEP || flag == DataFlag_Flagmented;
+	}
+
+	static bool isControlFlag(uint8_t flag) {
+		switch (flag) {
+		case ControlFlag_SendTimeCode:
+		case ControlFlag_GotTimeCode:
+		case ControlFlag_ChangeTxSpeed:
+		case ControlFlag_RegisterAccess_ReadCommand:
+		case ControlFlag_RegisterAccess_ReadReply:
+		case ControlFlag_RegisterAccess_WriteCommand:
+		case ControlFlag_RegisterAccess_WriteReply:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static bool isRegisterAccessFlag(uint8_t flag) {
+		return flag == ControlFlag_RegisterAccess_ReadCommand || flag == ControlFlag_RegisterAccess_ReadReply
+				|| flag == ControlFlag_RegisterAccess_WriteCommand || flag == ControlFlag_RegisterAccess_WriteReply;
+	}
+};
+
+#endif /* SPACEWIRESSDTPPROTOCOL_HH_ */
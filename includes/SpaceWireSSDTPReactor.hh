@@ -0,0 +1,508 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireSSDTPReactor.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIRESSDTPREACTOR_HH_
+#define SPACEWIRESSDTPREACTOR_HH_
+
+#ifdef __linux__
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Exception.hh"
+#include "CxxUtilities/Mutex.hh"
+#include "CxxUtilities/Thread.hh"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "SpaceWireSSDTPModule.hh"
+#include "SpaceWireSSDTPBuffer.hh"
+#include "SpaceWireSSDTPDecoder.hh"
+#include "SpaceWireIFOverTCP.hh"
+
+class SpaceWireSSDTPReactorLink;
+
+/** An exception class used by SpaceWireSSDTPReactor.
+ */
+class SpaceWireSSDTPReactorException: public CxxUtilities::Exception {
+public:
+	enum {
+		EpollError, LinkIsNotOpened, Undefined
+	};
+
+public:
+	SpaceWireSSDTPReactorException(uint32_t status) :
+			CxxUtilities::Exception(status) {
+	}
+
+public:
+	virtual ~SpaceWireSSDTPReactorException() {
+	}
+
+public:
+	std::string toString() {
+		std::string result;
+		switch (status) {
+		case EpollError:
+			result = "EpollError";
+			break;
+		case LinkIsNotOpened:
+			result = "LinkIsNotOpened";
+			break;
+		case Undefined:
+			result = "Undefined";
+			break;
+		default:
+			result = "Undefined status";
+			break;
+		}
+		return result;
+	}
+};
+
+/** An interface of per-link handlers invoked by SpaceWireSSDTPReactor.
+ * All the methods are called from the thread which runs the reactor, and
+ * therefore should return quickly.
+ */
+class SpaceWireSSDTPReactorHandler {
+public:
+	virtual ~SpaceWireSSDTPReactorHandler() {
+	}
+
+public:
+	/** Called when a packet has been received.
+	 * @param[in] link the link via which the packet was received.
+	 * @param[in] data packet content, which is valid only until this method returns.
+	 * @param[in] length packet size.
+	 * @param[in] eopType SpaceWireEOPMarker::EOP or SpaceWireEOPMarker::EEP.
+	 * The receive timestamp of the packet is available via link->getPacketTimestamp().
+	 */
+	virtual void onPacket(SpaceWireSSDTPReactorLink* link, uint8_t* data, size_t length, uint32_t eopType) = 0;
+
+	/** Called when a TimeCode has been received.
+	 * By default, the TimeCode is forwarded to SpaceWireSSDTPModule::gotTimeCode()
+	 * so that the TimeCode action registered to the module is invoked.
+	 */
+	virtual void onTimeCode(SpaceWireSSDTPReactorLink* link, uint8_t timecode);
+
+	/** Called when the peer has closed the connection, or when the SSDTP
+	 * stream became corrupted. The link has already been removed from the
+	 * reactor when this method is called. The socket is not closed by the reactor.
+	 */
+	virtual void onDisconnected(SpaceWireSSDTPReactorLink* link) {
+	}
+};
+
+/** A link served by SpaceWireSSDTPReactor.
+ * A link holds the SpaceWireSSDTPDecoder and the packet buffer of a single
+ * socket. Instances are created by SpaceWireSSDTPReactor::addLink(), and
+ * are deleted by the reactor after they have been removed.
+ */
+class SpaceWireSSDTPReactorLink: private SpaceWireSSDTPDecoderListener {
+	friend class SpaceWireSSDTPReactor;
+
+public:
+	/** Size of a chunk read from the socket at once. */
+	static const size_t ChunkSize = 64 * 1024;
+	/** Payload parts of at least this size are read directly into the packet buffer. */
+	static const size_t DirectReadThreshold = ChunkSize / 2;
+	/** Maximum packet size. Larger packets are regarded as a corrupted stream. */
+	static const size_t MaxPacketSize = SpaceWireSSDTPModule::BufferSize;
+
+private:
+	SpaceWireSSDTPModule* ssdtp;
+	SpaceWireSSDTPReactorHandler* handler;
+	int socketDescriptor;
+	void* context;
+	volatile bool removed;
+
+private:
+	SpaceWireSSDTPDecoder decoder;
+	SpaceWireSSDTPBuffer chunk;
+	SpaceWireSSDTPBuffer packet;
+	size_t packetSize;
+	SpaceWireReceiveTimestamp packetTimestamp;
+
+private:
+	size_t nReceivedPackets;
+	size_t nReceivedBytes;
+	size_t nReceiveSystemCalls;
+
+private:
+	SpaceWireSSDTPReactorLink(SpaceWireSSDTPModule* ssdtp, SpaceWireSSDTPReactorHandler* handler,
+			SpaceWireSSDTPBufferPool* pool) :
+			ssdtp(ssdtp), handler(handler), context(NULL), removed(false), decoder(this), chunk(pool), packet(pool) {
+		socketDescriptor = ssdtp->getSocketDescriptor();
+		packetSize = 0;
+		nReceivedPackets = 0;
+		nReceivedBytes = 0;
+		nReceiveSystemCalls = 0;
+	}
+
+public:
+	SpaceWireSSDTPModule* getSSDTPModule() {
+		return ssdtp;
+	}
+
+	SpaceWireSSDTPReactorHandler* getHandler() {
+		return handler;
+	}
+
+	/** Sets an arbitrary pointer which the handler can use to identify this link. */
+	void setContext(void* context) {
+		this->context = context;
+	}
+
+	void* getContext() {
+		return context;
+	}
+
+	bool isRemoved() const {
+		return removed;
+	}
+
+public:
+	/** Returns the time when the header of the first data frame of the packet
+	 * being passed to (or last passed to) the handler was parsed.
+	 * CLOCK_REALTIME is also read if it is enabled in the SpaceWireSSDTPModule.
+	 */
+	const SpaceWireReceiveTimestamp& getPacketTimestamp() const {
+		return packetTimestamp;
+	}
+
+public:
+	size_t getNReceivedPackets() const {
+		return nReceivedPackets;
+	}
+
+	size_t getNReceivedBytes() const {
+		return nReceivedBytes;
+	}
+
+	size_t getNReceiveSystemCalls() const {
+		return nReceiveSystemCalls;
+	}
+
+private:
+	/** Reads the socket until it has no more data (or until a read limit is reached)
+	 * and dispatches completed packets to the handler.
+	 * @returns false if the connection has been closed or the stream is corrupted.
+	 */
+	bool readAvailableData(size_t maxReads) {
+		for (size_t i = 0; i < maxReads && !removed; i++) {
+			bool direct = (decoder.isInDataPayload() && DirectReadThreshold <= decoder.getRemainingPayloadSize());
+			uint8_t* destination;
+			size_t capacity;
+			if (direct) {
+				destination = packet.getPointer() + packetSize;
+				capacity = decoder.getRemainingPayloadSize();
+			} else {
+				destination = chunk.reserve(ChunkSize);
+				capacity = ChunkSize;
+			}
+			ssize_t result = ::recv(socketDescriptor, destination, capacity, MSG_DONTWAIT);
+			nReceiveSystemCalls++;
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					return true;
+				}
+				return false;
+			}
+			if (result == 0) {
+				return false;
+			}
+			if (direct) {
+				packetSize += result;
+				decoder.skipPayload(result);
+			} else {
+				decoder.decode(destination, result);
+			}
+			if (decoder.hasError()) {
+				return false;
+			}
+			if ((size_t) result < capacity) {
+				//the socket has been drained
+				return true;
+			}
+		}
+		return true;
+	}
+
+private:
+	/* SpaceWireSSDTPDecoderListener */
+	void onDataFrameStart(uint8_t flag, size_t size) {
+		if (MaxPacketSize - packetSize < size) {
+			decoder.abort();
+			return;
+		}
+		if (packetSize == 0) {
+			packetTimestamp.capture(ssdtp->isRealtimeTimestampEnabled());
+		}
+		packet.reserve(packetSize + size, packetSize);
+	}
+
+	void onData(uint8_t* data, size_t length) {
+		memcpy(packet.getPointer() + packetSize, data, length);
+		packetSize += length;
+	}
+
+	void onPacketEnd(uint32_t eopType) {
+		if (packetSize == 0) {
+			return;
+		}
+		size_t size = packetSize;
+		packetSize = 0;
+		nReceivedPackets++;
+		nReceivedBytes += size;
+		handler->onPacket(this, packet.getPointer(), size, eopType);
+		if (removed) {
+			decoder.abort();
+		}
+	}
+
+	void onTimeCode(uint8_t flag, uint8_t timecode) {
+		handler->onTimeCode(this, timecode);
+		if (removed) {
+			decoder.abort();
+		}
+	}
+
+	void onRegisterAccess(uint8_t flag, uint32_t address, uint32_t value) {
+		if (flag == SpaceWireSSDTPProtocol::ControlFlag_RegisterAccess_ReadReply
+				|| flag == SpaceWireSSDTPProtocol::ControlFlag_RegisterAccess_WriteReply) {
+			ssdtp->processRegisterReply(flag, address, value);
+		}
+	}
+};
+
+inline void SpaceWireSSDTPReactorHandler::onTimeCode(SpaceWireSSDTPReactorLink* link, uint8_t timecode) {
+	link->getSSDTPModule()->gotTimeCode(timecode);
+}
+
+/** An event-driven receiver which serves many SSDTP links from one thread.
+ * Sockets of the registered links are watched with epoll, SSDTP frames are
+ * parsed without blocking, and completed packets are passed to the handler
+ * of each link. Sending is still done via the SpaceWireSSDTPModule or
+ * SpaceWireIFOverTCP instance of a link.
+ *
+ * One reactor uses one thread. To use more cores, create one reactor per
+ * core and distribute links among them.
+ * @code
+ * SpaceWireSSDTPReactor reactor;
+ * for (size_t i = 0; i < spwifs.size(); i++) {
+ * 	reactor.addLink(spwifs[i], &handler);
+ * }
+ * reactor.start();
+ * ...
+ * reactor.stop();
+ * reactor.waitUntilRunMethodComplets();
+ * @endcode
+ * @attention Once a link is added, its socket must not be read by other
+ * means (e.g. SpaceWireIF::receive() or RMAPEngine) until it is removed.
+ */
+class SpaceWireSSDTPReactor: public CxxUtilities::StoppableThread {
+public:
+	static const int DefaultPollTimeoutInMilliSec = 100;
+	static const size_t MaxEventsPerPoll = 64;
+	/** Maximum number of reads from a link per event so that busy links do not starve others. */
+	static const size_t MaxReadsPerEvent = 16;
+
+private:
+	int epollDescriptor;
+	SpaceWireSSDTPBufferPool* pool;
+	CxxUtilities::Mutex linksMutex;
+	std::set<SpaceWireSSDTPReactorLink*> links;
+	std::vector<SpaceWireSSDTPReactorLink*> removedLinks;
+	struct epoll_event events[MaxEventsPerPoll];
+
+private:
+	size_t nPolls;
+	size_t nEvents;
+
+public:
+	/** Constructor.
+	 * @param[in] pool a slab pool from which link buffers are taken (NULL to use malloc()).
+	 */
+	SpaceWireSSDTPReactor(SpaceWireSSDTPBufferPool* pool = NULL) throw (SpaceWireSSDTPReactorException) :
+			pool(pool) {
+		epollDescriptor = ::epoll_create(MaxEventsPerPoll);
+		if (epollDescriptor < 0) {
+			throw SpaceWireSSDTPReactorException(SpaceWireSSDTPReactorException::EpollError);
+		}
+		stopped = false;
+		nPolls = 0;
+		nEvents = 0;
+	}
+
+	/** Destructor. Links which are still registered are deleted.
+	 * The reactor thread should be stopped before the destructor is called.
+	 */
+	virtual ~SpaceWireSSDTPReactor() {
+		std::set<SpaceWireSSDTPReactorLink*>::iterator it;
+		for (it = links.begin(); it != links.end(); it++) {
+			delete *it;
+		}
+		deleteRemovedLinks();
+		::close(epollDescriptor);
+	}
+
+public:
+	/** Registers an SSDTP module.
+	 * @param[in] ssdtp a module whose socket is watched.
+	 * @param[in] handler a handler which receives packets and TimeCodes.
+	 * @returns a link instance owned by the reactor.
+	 */
+	SpaceWireSSDTPReactorLink* addLink(SpaceWireSSDTPModule* ssdtp, SpaceWireSSDTPReactorHandler* handler)
+			throw (SpaceWireSSDTPReactorException) {
+		SpaceWireSSDTPReactorLink* link = new SpaceWireSSDTPReactorLink(ssdtp, handler, pool);
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN | EPOLLRDHUP;
+		event.data.ptr = link;
+		linksMutex.lock();
+		if (::epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, link->socketDescriptor, &event) != 0) {
+			linksMutex.unlock();
+			delete link;
+			throw SpaceWireSSDTPReactorException(SpaceWireSSDTPReactorException::EpollError);
+		}
+		links.insert(link);
+		linksMutex.unlock();
+		return link;
+	}
+
+	/** Registers an opened SpaceWireIFOverTCP instance.
+	 * TimeCodes are forwarded to the TimeCode actions of the interface by default.
+	 */
+	SpaceWireSSDTPReactorLink* addLink(SpaceWireIFOverTCP* spwif, SpaceWireSSDTPReactorHandler* handler)
+			throw (SpaceWireSSDTPReactorException) {
+		if (spwif->getSSDTPModule() == NULL) {
+			throw SpaceWireSSDTPReactorException(SpaceWireSSDTPReactorException::LinkIsNotOpened);
+		}
+		return addLink(spwif->getSSDTPModule(), handler);
+	}
+
+	/** Unregisters a link. The link instance is deleted by the reactor thread
+	 * later, and must not be used after this method returns. The handler of
+	 * the link may still be invoked once if the reactor is dispatching
+	 * a packet of the link at the moment.
+	 */
+	void removeLink(SpaceWireSSDTPReactorLink* link) {
+		linksMutex.lock();
+		if (!link->removed) {
+			::epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, link->socketDescriptor, NULL);
+			link->removed = true;
+			links.erase(link);
+			removedLinks.push_back(link);
+		}
+		linksMutex.unlock();
+	}
+
+	size_t getNLinks() {
+		linksMutex.lock();
+		size_t n = links.size();
+		linksMutex.unlock();
+		return n;
+	}
+
+public:
+	/** Waits for incoming data once and processes all the links which became readable.
+	 * This method can be used instead of start() when the caller drives the loop.
+	 * It should not be called from more than one thread at a time.
+	 * @param[in] timeoutInMilliSec maximum waiting time (-1 to wait indefinitely).
+	 * @returns the number of links which were processed.
+	 */
+	size_t processEvents(int timeoutInMilliSec = DefaultPollTimeoutInMilliSec) throw (SpaceWireSSDTPReactorException) {
+		int nReadyLinks = ::epoll_wait(epollDescriptor, events, MaxEventsPerPoll, timeoutInMilliSec);
+		nPolls++;
+		if (nReadyLinks < 0) {
+			if (errno == EINTR) {
+				return 0;
+			}
+			throw SpaceWireSSDTPReactorException(SpaceWireSSDTPReactorException::EpollError);
+		}
+		for (int i = 0; i < nReadyLinks; i++) {
+			SpaceWireSSDTPReactorLink* link = (SpaceWireSSDTPReactorLink*) events[i].data.ptr;
+			if (link->removed) {
+				continue;
+			}
+			if (!link->readAvailableData(MaxReadsPerEvent) && !link->removed) {
+				removeLink(link);
+				link->handler->onDisconnected(link);
+			}
+		}
+		nEvents += nReadyLinks;
+		deleteRemovedLinks();
+		return nReadyLinks;
+	}
+
+public:
+	/** Processes events until stop() is called. */
+	void run() {
+		stopped = false;
+		while (!stopped) {
+			try {
+				processEvents();
+			} catch (SpaceWireSSDTPReactorException& e) {
+				using namespace std;
+				cerr << "SpaceWireSSDTPReactor::run() got SpaceWireSSDTPReactorException " << e.toString() << endl;
+				break;
+			}
+		}
+	}
+
+public:
+	/** Returns the number of epoll_wait() calls. */
+	size_t getNPolls() const {
+		return nPolls;
+	}
+
+	/** Returns the number of readiness events processed. */
+	size_t getNEvents() const {
+		return nEvents;
+	}
+
+private:
+	void deleteRemovedLinks() {
+		linksMutex.lock();
+		for (size_t i = 0; i < removedLinks.size(); i++) {
+			delete removedLinks[i];
+		}
+		removedLinks.clear();
+		linksMutex.unlock();
+	}
+};
+
+#endif /* __linux__ */
+
+#endif /* SPACEWIRESSDTPREACTOR_HH_ */
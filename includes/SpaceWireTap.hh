@@ -0,0 +1,388 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireTap.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPACEWIRETAP_HH_
+#define SPACEWIRETAP_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Thread.hh"
+
+#include <pthread.h>
+#include <time.h>
+
+#include "SpaceWireEOPMarker.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+#include "SpaceWireLockFreeQueue.hh"
+#include "SpaceWireCaptureFile.hh"
+
+class SpaceWireIF;
+
+/** A packet captured by SpaceWireTap.
+ * data points into a slot of the tap, and is valid only during SpaceWireTapAction::doAction().
+ */
+class SpaceWireTapRecord {
+public:
+	enum Direction {
+		Sent, Received
+	};
+
+public:
+	/** The interface which sent or received the packet. */
+	SpaceWireIF* spwif;
+	Direction direction;
+	SpaceWireEOPMarker::EOPType eopType;
+	/** Receive timestamp for received packets, time of send() for sent packets. */
+	SpaceWireReceiveTimestamp timestamp;
+	/** Length of the packet. */
+	size_t length;
+	/** Number of bytes stored in data (smaller than length if the packet was truncated to the snap length). */
+	size_t capturedLength;
+	uint8_t* data;
+
+public:
+	bool isSent() const {
+		return direction == Sent;
+	}
+
+	bool isTruncated() const {
+		return capturedLength < length;
+	}
+};
+
+/** An abstract class which includes a method invoked by the writer thread
+ * of SpaceWireTap for each captured packet.
+ */
+class SpaceWireTapAction {
+public:
+	virtual ~SpaceWireTapAction() {
+	}
+
+public:
+	virtual void doAction(const SpaceWireTapRecord& record) = 0;
+};
+
+/** Statistics of SpaceWireTap.
+ */
+class SpaceWireTapStatistics {
+public:
+	/** Packets copied into the ring. */
+	size_t nTapped;
+	/** Packets not captured because the ring was full. */
+	size_t nDropped;
+	/** Captured packets which were longer than the snap length. */
+	size_t nTruncated;
+	/** Packets handed to the capture file or the action. */
+	size_t nWritten;
+	/** Packets (or flushes) which the capture file writer failed to write. */
+	size_t nWriteErrors;
+	/** Packets waiting in the ring. */
+	size_t occupancy;
+	size_t capacity;
+
+public:
+	SpaceWireTapStatistics() {
+		nTapped = 0;
+		nDropped = 0;
+		nTruncated = 0;
+		nWritten = 0;
+		nWriteErrors = 0;
+		occupancy = 0;
+		capacity = 0;
+	}
+
+public:
+	std::string toString() {
+		std::stringstream ss;
+		ss << "tapped=" << nTapped << " dropped=" << nDropped << " truncated=" << nTruncated << " written=" << nWritten
+				<< " writeErrors=" << nWriteErrors << " occupancy=" << occupancy << "/" << capacity;
+		return ss.str();
+	}
+};
+
+/** Live capture of the packets sent and received by SpaceWireIF instances.
+ * SpaceWireIF::setTap() attaches a tap to an interface, and the interface then
+ * calls tap() for each packet it sends or receives. tap() copies the packet
+ * (up to the snap length) into a preallocated slot, and passes the slot to the
+ * writer thread via a lock-free queue. It does not lock, allocate, or make system
+ * calls, and when all the slots are in use the packet is dropped and counted
+ * instead of blocking the caller, so that RMAP and SpaceWire-R latency is
+ * essentially unchanged while capturing. The writer thread drains the ring and
+ * appends the packets to a capture file (flagged with
+ * SpaceWireCaptureFileFormat::FlagSent for sent packets), or passes them to a SpaceWireTapAction.
+ *
+ * One tap can be attached to several interfaces. SpaceWireIFOverTCP (and its
+ * subclasses) and SpaceWireIFOverSharedMemory call tap().
+ * @code
+ * SpaceWireCaptureWriter writer("traffic.spwcap");
+ * writer.open();
+ * SpaceWireTap tap(&writer);
+ * tap.start();
+ * spwif->setTap(&tap); //the interface may be in use by RMAPEngine
+ * ...
+ * spwif->setTap(NULL);
+ * tap.stop();
+ * tap.waitUntilRunMethodComplets();
+ * std::cout << tap.getStatistics().toString() << std::endl;
+ * writer.close();
+ * @endcode
+ */
+class SpaceWireTap: public CxxUtilities::StoppableThread {
+public:
+	static const size_t DefaultNSlots = 4096;
+	static const size_t DefaultSnapLength = 2048;
+	/** The writer thread looks for captured packets at this interval when the ring is empty. */
+	static const long PollingIntervalInNanoSec = 1000000;
+	/** Interval of flushing the capture file while packets are written. */
+	static const uint64_t FlushIntervalInNanoSec = 1000000000;
+
+private:
+	SpaceWireCaptureWriter* writer;
+	SpaceWireTapAction* action;
+	size_t nSlots;
+	size_t snapLength;
+	uint8_t* slotData;
+	SpaceWireTapRecord* slots;
+	SpaceWireLockFreeQueue<SpaceWireTapRecord*> freeSlots;
+	SpaceWireLockFreeQueue<SpaceWireTapRecord*> filledSlots;
+
+private:
+	volatile size_t nTapped;
+	volatile size_t nDropped;
+	volatile size_t nTruncated;
+	volatile size_t nWritten;
+	volatile size_t nWriteErrors;
+
+private:
+	/* used only by stop() to wake the writer thread up */
+	pthread_mutex_t wakeupMutex;
+	pthread_cond_t wakeupCondition;
+
+public:
+	/** Constructor which writes captured packets to a capture file.
+	 * The writer should be opened by the caller, and is not deleted by this class.
+	 * @param[in] nSlots number of packets which can wait for the writer thread.
+	 * @param[in] snapLength maximum number of bytes captured per packet.
+	 */
+	SpaceWireTap(SpaceWireCaptureWriter* writer, size_t nSlots = DefaultNSlots, size_t snapLength = DefaultSnapLength) :
+			writer(writer), action(NULL), nSlots(nSlots), snapLength(snapLength), freeSlots(nSlots), filledSlots(nSlots) {
+		initialize();
+	}
+
+	/** Constructor which passes captured packets to an action (invoked by the writer thread). */
+	SpaceWireTap(SpaceWireTapAction* action, size_t nSlots = DefaultNSlots, size_t snapLength = DefaultSnapLength) :
+			writer(NULL), action(action), nSlots(nSlots), snapLength(snapLength), freeSlots(nSlots), filledSlots(nSlots) {
+		initialize();
+	}
+
+	virtual ~SpaceWireTap() {
+		delete[] slots;
+		delete[] slotData;
+		pthread_cond_destroy(&wakeupCondition);
+		pthread_mutex_destroy(&wakeupMutex);
+	}
+
+private:
+	SpaceWireTap(const SpaceWireTap&);
+	SpaceWireTap& operator=(const SpaceWireTap&);
+
+	void initialize() {
+		if (nSlots == 0) {
+			nSlots = 1;
+		}
+		slotData = new uint8_t[nSlots * snapLength + 1];
+		slots = new SpaceWireTapRecord[nSlots];
+		for (size_t i = 0; i < nSlots; i++) {
+			slots[i].data = slotData + i * snapLength;
+			freeSlots.push(&slots[i]);
+		}
+		pthread_mutex_init(&wakeupMutex, NULL);
+		pthread_cond_init(&wakeupCondition, NULL);
+		resetStatistics();
+	}
+
+public:
+	/** Captures a packet. This method does not block, and is called by SpaceWireIF.
+	 * @param[in] timestamp time of the packet (if not valid, the current time is used).
+	 */
+	void tap(SpaceWireIF* spwif, SpaceWireTapRecord::Direction direction, const uint8_t* data, size_t length,
+			SpaceWireEOPMarker::EOPType eopType, const SpaceWireReceiveTimestamp& timestamp) {
+		SpaceWireTapRecord* slot;
+		if (!freeSlots.pop(slot)) {
+			__sync_fetch_and_add(&nDropped, 1);
+			return;
+		}
+		size_t capturedLength = length;
+		if (snapLength < length) {
+			capturedLength = snapLength;
+			__sync_fetch_and_add(&nTruncated, 1);
+		}
+		if (capturedLength != 0) {
+			memcpy(slot->data, data, capturedLength);
+		}
+		slot->spwif = spwif;
+		slot->direction = direction;
+		slot->eopType = eopType;
+		slot->length = length;
+		slot->capturedLength = capturedLength;
+		if (timestamp.isValid()) {
+			slot->timestamp = timestamp;
+		} else {
+			slot->timestamp.capture();
+		}
+		__sync_fetch_and_add(&nTapped, 1);
+		filledSlots.push(slot); //never fails because there are only nSlots slots
+	}
+
+public:
+	/** Writes captured packets until stop() is called.
+	 * Packets which are in the ring when stop() is called are written before this method returns.
+	 */
+	void run() {
+		//stopped is not reset here, so that stop() called before the thread runs is not lost
+		SpaceWireTapRecord* slot;
+		uint64_t lastFlushTime = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+		bool flushPending = false;
+		while (true) {
+			if (filledSlots.pop(slot)) {
+				write(slot);
+				freeSlots.push(slot);
+				flushPending = true;
+				continue;
+			}
+			if (stopped) {
+				break;
+			}
+			if (flushPending
+					&& lastFlushTime + FlushIntervalInNanoSec <= SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec()) {
+				flush();
+				flushPending = false;
+				lastFlushTime = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+			}
+			waitForPackets();
+		}
+		if (flushPending) {
+			flush();
+		}
+	}
+
+	/** Stops the writer thread. */
+	void stop() {
+		stopped = true;
+		pthread_mutex_lock(&wakeupMutex);
+		pthread_cond_signal(&wakeupCondition);
+		pthread_mutex_unlock(&wakeupMutex);
+	}
+
+private:
+	void write(SpaceWireTapRecord* slot) {
+		if (action != NULL) {
+			action->doAction(*slot);
+			__sync_fetch_and_add(&nWritten, 1);
+			return;
+		}
+		if (writer == NULL) {
+			return;
+		}
+		uint16_t flags = 0;
+		if (slot->isSent()) {
+			flags |= SpaceWireCaptureFileFormat::FlagSent;
+		}
+		if (slot->isTruncated()) {
+			flags |= SpaceWireCaptureFileFormat::FlagTruncated;
+		}
+		try {
+			writer->writePacket(slot->data, slot->capturedLength, slot->eopType, slot->timestamp, flags);
+			__sync_fetch_and_add(&nWritten, 1);
+		} catch (SpaceWireCaptureFileException& e) {
+			__sync_fetch_and_add(&nWriteErrors, 1);
+		}
+	}
+
+	void flush() {
+		if (writer == NULL) {
+			return;
+		}
+		try {
+			writer->flush();
+		} catch (SpaceWireCaptureFileException& e) {
+			__sync_fetch_and_add(&nWriteErrors, 1);
+		}
+	}
+
+	/** Sleeps for the polling interval (tap() does not signal, so that capturing costs no system call). */
+	void waitForPackets() {
+		pthread_mutex_lock(&wakeupMutex);
+		if (!stopped) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += PollingIntervalInNanoSec;
+			if (1000000000 <= deadline.tv_nsec) {
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&wakeupCondition, &wakeupMutex, &deadline);
+		}
+		pthread_mutex_unlock(&wakeupMutex);
+	}
+
+public:
+	size_t getSnapLength() const {
+		return snapLength;
+	}
+
+	size_t getNSlots() const {
+		return nSlots;
+	}
+
+public:
+	SpaceWireTapStatistics getStatistics() {
+		SpaceWireTapStatistics statistics;
+		statistics.nTapped = nTapped;
+		statistics.nDropped = nDropped;
+		statistics.nTruncated = nTruncated;
+		statistics.nWritten = nWritten;
+		statistics.nWriteErrors = nWriteErrors;
+		statistics.occupancy = filledSlots.size();
+		statistics.capacity = nSlots;
+		return statistics;
+	}
+
+	void resetStatistics() {
+		nTapped = 0;
+		nDropped = 0;
+		nTruncated = 0;
+		nWritten = 0;
+		nWriteErrors = 0;
+	}
+};
+
+#endif /* SPACEWIRETAP_HH_ */
@@ -0,0 +1,317 @@
+/* 
+============================================================================
+SpaceWire/RMAP Library is provided under the MIT License.
+============================================================================
+
+Copyright (c) 2006-2013 Takayuki Yuasa and The Open-source SpaceWire Project
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the 
+"Software"), to deal in the Software without restriction, including 
+without limitation the rights to use, copy, modify, merge, publish, 
+distribute, sublicense, and/or sell copies of the Software, and to 
+permit persons to whom the Software is furnished to do so, subject to 
+the following conditions:
+
+The above copyright notice and this permission notice shall be included 
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS 
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+/*
+ * SpaceWireTimecodeDispatcher.hh
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef SPACEWIRETIMECODEDISPATCHER_HH_
+#define SPACEWIRETIMECODEDISPATCHER_HH_
+
+#include "CxxUtilities/CommonHeader.hh"
+#include "CxxUtilities/Mutex.hh"
+#include "CxxUtilities/Thread.hh"
+
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+
+#include "SpaceWireIF.hh"
+#include "SpaceWireLockFreeQueue.hh"
+#include "SpaceWireReceiveTimestamp.hh"
+
+/** Arrival and dispatch statistics of TimeCodes collected by SpaceWireTimecodeDispatcher.
+ */
+class SpaceWireTimecodeStatistics {
+public:
+	size_t nReceived;
+	size_t nDispatched;
+	size_t nDropped;
+	/** Statistics of intervals between consecutive arrivals. */
+	double meanIntervalInMilliSec;
+	double intervalJitterInMilliSec; //standard deviation
+	double minIntervalInMilliSec;
+	double maxIntervalInMilliSec;
+	/** Largest difference between an interval and the expected interval. */
+	double maxDeviationFromExpectedIntervalInMilliSec;
+	/** Statistics of time from arrival to the start of the dispatch. */
+	double meanLatencyInMicroSec;
+	double maxLatencyInMicroSec;
+
+public:
+	SpaceWireTimecodeStatistics() {
+		nReceived = 0;
+		nDispatched = 0;
+		nDropped = 0;
+		meanIntervalInMilliSec = 0;
+		intervalJitterInMilliSec = 0;
+		minIntervalInMilliSec = 0;
+		maxIntervalInMilliSec = 0;
+		maxDeviationFromExpectedIntervalInMilliSec = 0;
+		meanLatencyInMicroSec = 0;
+		maxLatencyInMicroSec = 0;
+	}
+
+public:
+	std::string toString() {
+		std::stringstream ss;
+		ss << "received=" << nReceived << " dispatched=" << nDispatched << " dropped=" << nDropped << std::endl;
+		ss << "interval mean=" << meanIntervalInMilliSec << "ms jitter=" << intervalJitterInMilliSec << "ms min="
+				<< minIntervalInMilliSec << "ms max=" << maxIntervalInMilliSec << "ms max deviation="
+				<< maxDeviationFromExpectedIntervalInMilliSec << "ms" << std::endl;
+		ss << "dispatch latency mean=" << meanLatencyInMicroSec << "us max=" << maxLatencyInMicroSec << "us";
+		return ss.str();
+	}
+};
+
+/** A TimeCode action which moves TimeCode processing off the receive thread.
+ * doAction() is called by the thread which receives packets (e.g. via
+ * SpaceWireSSDTPModule::gotTimeCode()). It only records the TimeCode
+ * with a monotonic timestamp into a lock-free queue. A dedicated thread
+ * drains the queue and invokes the target action, so that a slow TimeCode
+ * subscriber does not delay delivery of packets such as RMAP replies.
+ * @code
+ * SpaceWireTimecodeDispatcher dispatcher(&myTimecodeAction);
+ * dispatcher.start();
+ * ssdtpModule->setTimeCodeAction(&dispatcher);
+ * ...
+ * std::cout << dispatcher.getStatistics().toString() << std::endl;
+ * @endcode
+ * SpaceWireIFOverTCP::setTimecodeDispatchMode() sets this up for an interface.
+ */
+class SpaceWireTimecodeDispatcher: public SpaceWireIFActionTimecodeScynchronizedAction,
+		public CxxUtilities::StoppableThread {
+public:
+	static const size_t DefaultQueueCapacity = 256;
+	/** Expected interval of a 64-Hz tick. */
+	static const double DefaultExpectedIntervalInMilliSec = 1000.0 / 64;
+
+private:
+	struct Entry {
+		uint8_t timecode;
+		uint64_t arrivalTimeInNanoSec;
+	};
+
+private:
+	SpaceWireIFActionTimecodeScynchronizedAction* target;
+	SpaceWireLockFreeQueue<Entry> queue;
+	volatile size_t nReceived;
+	volatile size_t nDropped;
+
+private:
+	/* wakeup of the dispatcher thread */
+	pthread_mutex_t wakeupMutex;
+	pthread_cond_t wakeupCondition;
+	volatile bool waiting;
+
+private:
+	/* statistics (updated only by the dispatcher thread) */
+	CxxUtilities::Mutex statisticsMutex;
+	double expectedIntervalInMilliSec;
+	size_t nDispatched;
+	uint64_t lastArrivalTimeInNanoSec;
+	size_t nIntervals;
+	double intervalSum;
+	double intervalSquareSum;
+	double minInterval;
+	double maxInterval;
+	double maxDeviation;
+	double latencySum;
+	double maxLatency;
+
+public:
+	/** Constructor.
+	 * @param[in] target an action invoked by the dispatcher thread for each TimeCode.
+	 * @param[in] queueCapacity maximum number of TimeCodes waiting for dispatch.
+	 */
+	SpaceWireTimecodeDispatcher(SpaceWireIFActionTimecodeScynchronizedAction* target, size_t queueCapacity =
+			DefaultQueueCapacity) :
+			target(target), queue(queueCapacity) {
+		pthread_mutex_init(&wakeupMutex, NULL);
+		pthread_cond_init(&wakeupCondition, NULL);
+		waiting = false;
+		expectedIntervalInMilliSec = DefaultExpectedIntervalInMilliSec;
+		resetStatistics();
+	}
+
+	virtual ~SpaceWireTimecodeDispatcher() {
+		pthread_cond_destroy(&wakeupCondition);
+		pthread_mutex_destroy(&wakeupMutex);
+	}
+
+public:
+	/** Records a TimeCode. This method does not block, and is called by the receive thread. */
+	void doAction(unsigned char timecode) {
+		Entry entry;
+		entry.timecode = timecode;
+		entry.arrivalTimeInNanoSec = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+		__sync_fetch_and_add(&nReceived, 1);
+		if (!queue.push(entry)) {
+			__sync_fetch_and_add(&nDropped, 1);
+			return;
+		}
+		if (waiting) {
+			pthread_mutex_lock(&wakeupMutex);
+			pthread_cond_signal(&wakeupCondition);
+			pthread_mutex_unlock(&wakeupMutex);
+		}
+	}
+
+public:
+	/** Dispatches TimeCodes until stop() is called. */
+	void run() {
+		Entry entry;
+		while (!stopped) {
+			if (!queue.pop(entry)) {
+				waitForTimecode();
+				continue;
+			}
+			uint64_t dispatchTime = SpaceWireReceiveTimestamp::getMonotonicClockInNanoSec();
+			updateStatistics(entry, dispatchTime);
+			if (target != NULL) {
+				target->doAction(entry.timecode);
+			}
+		}
+	}
+
+	/** Stops the dispatcher thread. TimeCodes still in the queue are discarded. */
+	void stop() {
+		stopped = true;
+		pthread_mutex_lock(&wakeupMutex);
+		pthread_cond_signal(&wakeupCondition);
+		pthread_mutex_unlock(&wakeupMutex);
+	}
+
+private:
+	void waitForTimecode() {
+		pthread_mutex_lock(&wakeupMutex);
+		waiting = true;
+		__sync_synchronize();
+		//re-check after announcing the wait so that a push in between is not missed
+		if (queue.empty() && !stopped) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += WaitTimeoutInNanoSec;
+			if (1000000000 <= deadline.tv_nsec) {
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&wakeupCondition, &wakeupMutex, &deadline);
+		}
+		waiting = false;
+		pthread_mutex_unlock(&wakeupMutex);
+	}
+
+	static const long WaitTimeoutInNanoSec = 100000000;
+
+public:
+	/** Sets the nominal TimeCode interval used for the deviation statistics. */
+	void setExpectedInterval(double intervalInMilliSec) {
+		expectedIntervalInMilliSec = intervalInMilliSec;
+	}
+
+	double getExpectedInterval() const {
+		return expectedIntervalInMilliSec;
+	}
+
+	void setTarget(SpaceWireIFActionTimecodeScynchronizedAction* target) {
+		this->target = target;
+	}
+
+public:
+	SpaceWireTimecodeStatistics getStatistics() {
+		SpaceWireTimecodeStatistics statistics;
+		statisticsMutex.lock();
+		statistics.nReceived = nReceived;
+		statistics.nDispatched = nDispatched;
+		statistics.nDropped = nDropped;
+		if (nIntervals != 0) {
+			double mean = intervalSum / nIntervals;
+			double variance = intervalSquareSum / nIntervals - mean * mean;
+			statistics.meanIntervalInMilliSec = mean;
+			statistics.intervalJitterInMilliSec = (0 < variance) ? sqrt(variance) : 0;
+			statistics.minIntervalInMilliSec = minInterval;
+			statistics.maxIntervalInMilliSec = maxInterval;
+			statistics.maxDeviationFromExpectedIntervalInMilliSec = maxDeviation;
+		}
+		if (nDispatched != 0) {
+			statistics.meanLatencyInMicroSec = latencySum / nDispatched;
+			statistics.maxLatencyInMicroSec = maxLatency;
+		}
+		statisticsMutex.unlock();
+		return statistics;
+	}
+
+	void resetStatistics() {
+		statisticsMutex.lock();
+		nReceived = 0;
+		nDispatched = 0;
+		nDropped = 0;
+		lastArrivalTimeInNanoSec = 0;
+		nIntervals = 0;
+		intervalSum = 0;
+		intervalSquareSum = 0;
+		minInterval = 0;
+		maxInterval = 0;
+		maxDeviation = 0;
+		latencySum = 0;
+		maxLatency = 0;
+		statisticsMutex.unlock();
+	}
+
+private:
+	void updateStatistics(Entry& entry, uint64_t dispatchTime) {
+		statisticsMutex.lock();
+		nDispatched++;
+		if (lastArrivalTimeInNanoSec != 0) {
+			double interval = (entry.arrivalTimeInNanoSec - lastArrivalTimeInNanoSec) / 1e6;
+			if (nIntervals == 0 || interval < minInterval) {
+				minInterval = interval;
+			}
+			if (nIntervals == 0 || maxInterval < interval) {
+				maxInterval = interval;
+			}
+			double deviation = fabs(interval - expectedIntervalInMilliSec);
+			if (maxDeviation < deviation) {
+				maxDeviation = deviation;
+			}
+			nIntervals++;
+			intervalSum += interval;
+			intervalSquareSum += interval * interval;
+		}
+		lastArrivalTimeInNanoSec = entry.arrivalTimeInNanoSec;
+		double latency = (dispatchTime - entry.arrivalTimeInNanoSec) / 1e3;
+		latencySum += latency;
+		if (maxLatency < latency) {
+			maxLatency = latency;
+		}
+		statisticsMutex.unlock();
+	}
+};
+
+#endif /* SPACEWIRETIMECODEDISPATCHER_HH_ */
@@ -8,6 +8,8 @@
 #include "CxxUtilities/CxxUtilities.hh"
 #include "SpaceWire.hh"
 
+#include <signal.h>
+
 using namespace CxxUtilities;
 using namespace std;
 
@@ -18,14 +20,50 @@ public:
 	}
 };
 
+class SpaceWireTimecodeAction_RecordTimecode : public SpaceWireIFActionTimecodeScynchronizedAction {
+private:
+	SpaceWireCaptureWriter* writer;
+
+public:
+	SpaceWireTimecodeAction_RecordTimecode(SpaceWireCaptureWriter* writer) :
+			writer(writer) {
+	}
+
+public:
+	void doAction(uint8_t timecode){
+		writer->writeTimeCode(timecode);
+	}
+};
+
+volatile sig_atomic_t stopRequested = 0;
+
+void requestStop(int signalNumber) {
+	stopRequested = 1;
+}
+
+const double RecordingReportIntervalInMilliSec = 1000;
+
 int main(int argc, char* argv[]) {
 	if (argc < 3) {
 		cerr << "Give IP address and port number of SpaceWire-to-GigabitEther" << endl;
+		cerr << "(and a capture file name to record packets instead of dumping them)" << endl;
 		exit(-1);
 	}
 
 	string ipaddress(argv[1]);
 	int portNumber = String::toInteger(argv[2]);
+	SpaceWireCaptureWriter* writer = NULL;
+	if (argc >= 4) {
+		writer = new SpaceWireCaptureWriter(argv[3]);
+		try {
+			writer->open();
+		} catch (SpaceWireCaptureFileException& e) {
+			cerr << "Could not open " << argv[3] << " (" << e.toString() << ")." << endl;
+			exit(-1);
+		}
+		signal(SIGINT, requestStop);
+		signal(SIGTERM, requestStop);
+	}
 
 	SpaceWireIFOverTCP* spwif = new SpaceWireIFOverTCP(ipaddress, portNumber);
 	try {
@@ -34,18 +72,46 @@ int main(int argc, char* argv[]) {
 		cerr << "Could not connect to " << ipaddress << "." << endl;
 		exit(-1);
 	}
-	SpaceWireTimecodeAction_DumpTimecode* timecodeAction_DumpTimecode=new SpaceWireTimecodeAction_DumpTimecode();
-	spwif->addTimecodeAction(timecodeAction_DumpTimecode);
+	if (writer == NULL) {
+		SpaceWireTimecodeAction_DumpTimecode* timecodeAction_DumpTimecode=new SpaceWireTimecodeAction_DumpTimecode();
+		spwif->addTimecodeAction(timecodeAction_DumpTimecode);
+	} else {
+		spwif->addTimecodeAction(new SpaceWireTimecodeAction_RecordTimecode(writer));
+		spwif->setTimeoutDuration(RecordingReportIntervalInMilliSec * 1000); //to notice Ctrl-C
+		cout << "Recording to " << argv[3] << " (Ctrl-C to stop)." << endl;
+	}
 
-	std::vector<uint8_t> buffer;
-	while (true) {
+	std::vector<std::vector<uint8_t> > packets;
+	std::vector<SpaceWireEOPMarker::EOPType> eopTypes;
+	double lastReport = Time::getClockValueInMilliSec();
+	while (!stopRequested) {
 		try {
-			cout << "Waiting for a packet." << endl;
-			spwif->receive(&buffer);
-			SpaceWireUtilities::dumpPacket(buffer);
+			if (writer == NULL) {
+				cout << "Waiting for a packet." << endl;
+			}
+			size_t nPackets = spwif->receiveBatch(packets, eopTypes);
+			if (writer == NULL) {
+				for (size_t i = 0; i < nPackets; i++) {
+					SpaceWireUtilities::dumpPacket(packets[i]);
+				}
+			} else {
+				const std::vector<SpaceWireReceiveTimestamp>& timestamps = spwif->getReceivedPacketTimestamps();
+				for (size_t i = 0; i < nPackets; i++) {
+					writer->writePacket(packets[i], eopTypes[i], timestamps[i]);
+				}
+				if (lastReport + RecordingReportIntervalInMilliSec < Time::getClockValueInMilliSec()) {
+					lastReport = Time::getClockValueInMilliSec();
+					cout << writer->getNWrittenRecords() << " records" << endl;
+				}
+			}
+		} catch (SpaceWireCaptureFileException& e) {
+			cerr << "Could not record a packet (" << e.toString() << ")" << endl;
+			goto finalize;
 		} catch (SpaceWireIFException& e) {
 			if (e.getStatus() == SpaceWireIFException::Timeout) {
-				cout << "Timeout." << endl;
+				if (writer == NULL) {
+					cout << "Timeout." << endl;
+				}
 			} else {
 				cerr << "Exception while receiving a packet (status=" << e.toString() << ")" << endl;
 				goto finalize;
@@ -55,5 +121,10 @@ int main(int argc, char* argv[]) {
 	finalize: //
 	spwif->close();
 	delete spwif;
+	if (writer != NULL) {
+		writer->close();
+		cout << writer->getNWrittenRecords() << " records were recorded." << endl;
+		delete writer;
+	}
 }
 
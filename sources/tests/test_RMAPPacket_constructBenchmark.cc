@@ -0,0 +1,149 @@
+/*
+ * test_RMAPPacket_constructBenchmark.cc
+ *
+ * Checks that RMAPPacket::constructPacket() reproduces a known packet
+ * and that the internal-buffer and caller-buffer variants, and the previous
+ * implementation (constructPacketByConcatenation()), create the same bytes for
+ * commands and replies, and then measures how many packets per second can be
+ * constructed for 4-byte register writes and 64-KB block writes. The previous
+ * implementation is measured as the baseline.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "RMAP.hh"
+
+const size_t DataSizes[] = { 4, 65536 };
+const size_t NDataSizes = sizeof(DataSizes) / sizeof(size_t);
+const double MeasurementDurationInMilliSec = 500;
+
+bool checkKnownPacket() {
+	//a write command with a 4-byte target SpaceWire address and a 7-byte reply address (test_RMAPPacket.cc)
+	uint8_t knownPacket[] = { 0x07, 0x0B, 0x06, 0x04, 0xFE, 0x01, 0x4F, 0x91, 00, 00, 00, 00, 00, 00, 00, 0x02, 0x0C,
+			0x0A, 0x04, 0x06, 0xFE, 0xAD, 0xDF, 0x00, 0xFF, 0x80, 0x11, 0x00, 0x00, 0x00, 0x10, 0x2A };
+	RMAPPacket packet;
+	packet.interpretAsAnRMAPPacket(knownPacket, sizeof(knownPacket));
+	packet.constructPacket();
+	std::vector<uint8_t>* constructed = packet.getPacketBufferPointer();
+	return constructed->size() == sizeof(knownPacket) && memcmp(&(constructed->at(0)), knownPacket, sizeof(knownPacket)) == 0;
+}
+
+/** Constructs the packet with both variants, and interprets the result. */
+bool checkVariants(RMAPPacket& packet) {
+	packet.constructPacket();
+	std::vector<uint8_t> internal = *packet.getPacketBufferPointer();
+	std::vector<uint8_t> external(packet.getPacketSize());
+	if (packet.constructPacket(&external[0], external.size()) != internal.size() || internal != external) {
+		return false;
+	}
+	packet.constructPacketByConcatenation();
+	if (*packet.getPacketBufferPointer() != internal) {
+		return false;
+	}
+	try {
+		packet.constructPacket(&external[0], external.size() - 1);
+		return false;
+	} catch (RMAPPacketException& e) {
+		if (e.getStatus() != RMAPPacketException::InsufficientBufferSize) {
+			return false;
+		}
+	}
+	RMAPPacket interpreted;
+	if (packet.isUseDraftECRC()) {
+		//interpretAsAnRMAPPacket() checks CRCs of the current standard
+		interpreted.setUseDraftECRC(true);
+		interpreted.setHeaderCRCIsChecked(false);
+		interpreted.setDataCRCIsChecked(false);
+	}
+	interpreted.interpretAsAnRMAPPacket(internal);
+	interpreted.constructPacket();
+	return *interpreted.getPacketBufferPointer() == internal;
+}
+
+bool checkVariants() {
+	std::vector<uint8_t> targetSpaceWireAddress(2, 0x03);
+	std::vector<uint8_t> data(37);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = i * 3;
+	}
+	for (size_t replyAddressLength = 0; replyAddressLength <= 8; replyAddressLength++) {
+		std::vector<uint8_t> replyAddress(replyAddressLength, 0x05);
+		for (int write = 0; write <= 1; write++) {
+			RMAPPacket command;
+			command.setTargetSpaceWireAddress(targetSpaceWireAddress);
+			command.setReplyAddress(replyAddress);
+			command.setCommand();
+			command.setAddress(0x12345678);
+			if (write) {
+				command.setWrite();
+				command.setData(data);
+			} else {
+				command.setRead();
+				command.setDataLength(data.size());
+			}
+			RMAPPacket reply;
+			reply.setReplyAddress(replyAddress);
+			reply.setReply();
+			reply.setUseDraftECRC(replyAddressLength % 2 == 1);
+			if (write) {
+				reply.setWrite();
+			} else {
+				reply.setRead();
+				reply.setData(data);
+			}
+			if (!checkVariants(command) || !checkVariants(reply)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	if (!checkKnownPacket()) {
+		cerr << "constructPacket() did not reproduce the known packet." << endl;
+		return -1;
+	}
+	if (!checkVariants()) {
+		cerr << "Packets constructed by the variants do not match." << endl;
+		return -1;
+	}
+
+	cout << setw(10) << "Data size" << setw(18) << "Variant" << setw(16) << "Packets/s" << setw(12) << "MB/s" << endl;
+	std::vector<uint8_t> replyAddress(3, 0x05);
+	for (size_t i = 0; i < NDataSizes; i++) {
+		std::vector<uint8_t> data(DataSizes[i]);
+		RMAPPacket command;
+		command.setTargetSpaceWireAddress(replyAddress);
+		command.setReplyAddress(replyAddress);
+		command.setCommand();
+		command.setWrite();
+		command.setAddress(0x00000100);
+		command.setData(data);
+		std::vector<uint8_t> buffer(command.getPacketSize());
+		const char* variants[] = { "concatenation", "internal", "caller-supplied" };
+		for (size_t variant = 0; variant < 3; variant++) {
+			size_t nPackets = 0;
+			double start = Time::getClockValueInMilliSec();
+			double elapsed = 0;
+			while (elapsed < MeasurementDurationInMilliSec) {
+				for (size_t n = 0; n < 100; n++) {
+					command.setTransactionID(nPackets + n);
+					if (variant == 0) {
+						command.constructPacketByConcatenation();
+					} else if (variant == 1) {
+						command.constructPacket();
+					} else {
+						command.constructPacket(&buffer[0], buffer.size());
+					}
+				}
+				nPackets += 100;
+				elapsed = Time::getClockValueInMilliSec() - start;
+			}
+			cout << setw(10) << DataSizes[i] << setw(18) << variants[variant] << setw(16) << fixed << setprecision(0)
+					<< nPackets / (elapsed / 1000.0) << setw(12) << setprecision(1)
+					<< nPackets * buffer.size() / 1024.0 / 1024.0 / (elapsed / 1000.0) << endl;
+		}
+	}
+}
@@ -0,0 +1,314 @@
+/*
+ * test_SpaceWireCaptureFile.cc
+ *
+ * Records packets and TimeCodes with SpaceWireCaptureWriter (including an
+ * append to the existing file, which ends with a partially written record),
+ * reads them back with SpaceWireCaptureReader, and replays them with
+ * SpaceWireIFOverCaptureFile:
+ * - RMAP write commands are replayed as fast as possible to an RMAPEngine
+ *   serving an RMAPTarget, and its replies are recorded to another file.
+ * - Packets are replayed at the recorded timing (at double speed).
+ * - A receive waiting for a distant record must not block rewind(), and
+ *   must be woken up by close().
+ * - A looping replay of a file which holds only sent packets must stop.
+ * Write/read/replay rates are printed.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+#include "RMAP.hh"
+
+const char* CaptureFileName = "/tmp/test_SpaceWireCaptureFile.spwcap";
+const char* ReplyCaptureFileName = "/tmp/test_SpaceWireCaptureFile_replies.spwcap";
+const size_t NPackets = 200000;
+const size_t NAppendedPackets = 100;
+const size_t TimeCodeInterval = 1000;
+const size_t NRMAPCommands = 20000;
+const uint32_t MemorySize = 1024;
+const size_t NTimedPackets = 50;
+const double TimedPacketIntervalInMilliSec = 2;
+const double SpeedFactor = 2;
+const double DistantRecordInMilliSec = 10000;
+const double CloseDelayInMilliSec = 50;
+
+class MemoryAccessAction: public RMAPTargetAccessAction {
+public:
+	std::vector<uint8_t> memory;
+	size_t nWrites;
+
+public:
+	MemoryAccessAction() :
+			memory(MemorySize), nWrites(0) {
+	}
+
+public:
+	void processTransaction(RMAPTransaction* rmapTransaction) throw (RMAPTargetAccessActionException) {
+		RMAPPacket* command = rmapTransaction->commandPacket;
+		command->getData(&memory[command->getAddress()], command->getLength());
+		nWrites++;
+		setReplyWithStatus(rmapTransaction, RMAPReplyStatus::CommandExcecutedSuccessfully);
+	}
+};
+
+/** Calls receive() once, and records the exception status. */
+class Receiver: public CxxUtilities::Thread {
+private:
+	SpaceWireIF* spwif;
+
+public:
+	int status;
+
+public:
+	Receiver(SpaceWireIF* spwif) :
+			spwif(spwif), status(-1) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> buffer;
+		try {
+			spwif->receive(&buffer);
+		} catch (SpaceWireIFException& e) {
+			status = e.getStatus();
+		}
+	}
+};
+
+size_t getPacketSize(size_t i) {
+	return 1 + (i * 37) % 300;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	unlink(CaptureFileName);
+	unlink(ReplyCaptureFileName);
+
+	//record
+	vector<uint8_t> packet(1024);
+	for (size_t i = 0; i < packet.size(); i++) {
+		packet[i] = i;
+	}
+	double start = Time::getClockValueInMilliSec();
+	size_t nBytes = 0;
+	{
+		SpaceWireCaptureWriter writer(CaptureFileName);
+		writer.open();
+		for (size_t i = 0; i < NPackets; i++) {
+			packet[0] = i;
+			writer.writePacket(&packet[0], getPacketSize(i), (i % 100 == 99) ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP);
+			nBytes += getPacketSize(i);
+			if (i % TimeCodeInterval == 0) {
+				writer.writeTimeCode((i / TimeCodeInterval) % 64);
+			}
+		}
+		writer.close();
+	}
+	double elapsed = Time::getClockValueInMilliSec() - start;
+	cout << "Write: " << fixed << setprecision(0) << NPackets / (elapsed / 1000.0) << " packets/s ("
+			<< setprecision(1) << nBytes / 1024.0 / 1024.0 / (elapsed / 1000.0) << " MB/s)" << endl;
+	{
+		//a record of which only the header and a part of the payload were written
+		uint8_t partialRecord[SpaceWireCaptureFileFormat::RecordHeaderSize + 20];
+		memset(partialRecord, 0, sizeof(partialRecord));
+		SpaceWireCaptureFileFormat::encode(partialRecord + 8, 100, 4);
+		int descriptor = ::open(CaptureFileName, O_WRONLY | O_APPEND);
+		if (::write(descriptor, partialRecord, sizeof(partialRecord)) != (ssize_t) sizeof(partialRecord)) {
+			cerr << "Writing a partial record failed." << endl;
+			return -1;
+		}
+		::close(descriptor);
+	}
+	{
+		SpaceWireCaptureWriter writer(CaptureFileName);
+		writer.open();
+		for (size_t i = NPackets; i < NPackets + NAppendedPackets; i++) {
+			packet[0] = i;
+			writer.writePacket(&packet[0], getPacketSize(i), SpaceWireEOPMarker::EOP);
+		}
+	}
+
+	//read back
+	start = Time::getClockValueInMilliSec();
+	{
+		SpaceWireCaptureReader reader(CaptureFileName);
+		reader.open();
+		SpaceWireCaptureRecord record;
+		size_t nReadPackets = 0;
+		size_t nReadTimeCodes = 0;
+		uint64_t previousTimestamp = 0;
+		while (reader.next(record)) {
+			if (record.timestampInNanoSec < previousTimestamp) {
+				cerr << "Timestamps are not in order." << endl;
+				return -1;
+			}
+			previousTimestamp = record.timestampInNanoSec;
+			if (record.isTimeCode()) {
+				nReadTimeCodes++;
+				continue;
+			}
+			size_t i = nReadPackets;
+			bool eep = (i < NPackets && i % 100 == 99);
+			if (record.length != getPacketSize(i) || record.data[0] != (uint8_t) i
+					|| memcmp(record.data + 1, &packet[1], record.length - 1) != 0
+					|| record.getEOPType() != (eep ? SpaceWireEOPMarker::EEP : SpaceWireEOPMarker::EOP)) {
+				cerr << "Record " << i << " does not match the written packet." << endl;
+				return -1;
+			}
+			nReadPackets++;
+		}
+		if (nReadPackets != NPackets + NAppendedPackets || nReadTimeCodes != NPackets / TimeCodeInterval) {
+			cerr << "Wrong number of records (" << nReadPackets << " packets, " << nReadTimeCodes << " TimeCodes)"
+					<< endl;
+			return -1;
+		}
+	}
+	elapsed = Time::getClockValueInMilliSec() - start;
+	cout << "Read: " << setprecision(0) << (NPackets + NAppendedPackets) / (elapsed / 1000.0) << " packets/s" << endl;
+	unlink(CaptureFileName);
+
+	//replay RMAP commands to RMAPEngine
+	{
+		SpaceWireCaptureWriter writer(CaptureFileName);
+		writer.open();
+		for (size_t i = 0; i < NRMAPCommands; i++) {
+			RMAPPacket command;
+			command.setTargetLogicalAddress(0xFE);
+			command.setInitiatorLogicalAddress(0xFE);
+			command.setKey(0x00);
+			command.setWrite();
+			command.setCommand();
+			command.setIncrementMode();
+			command.setNoVerifyMode();
+			command.setReplyMode();
+			command.setTransactionID(i % 65536);
+			command.setAddress((i * 4) % MemorySize);
+			command.setDataLength(4);
+			for (size_t j = 0; j < 4; j++) {
+				command.addData((uint8_t) (i + j));
+			}
+			command.constructPacket();
+			writer.writePacket(*command.getPacketBufferPointer(), SpaceWireEOPMarker::EOP);
+		}
+	}
+	SpaceWireCaptureWriter replyWriter(ReplyCaptureFileName);
+	replyWriter.open();
+	SpaceWireIFOverCaptureFile* replay = new SpaceWireIFOverCaptureFile(CaptureFileName,
+			SpaceWireIFOverCaptureFile::AsFastAsPossible);
+	replay->setSentPacketWriter(&replyWriter);
+	replay->open();
+	MemoryAccessAction memoryAccessAction;
+	RMAPAddressRange addressRange(0, MemorySize);
+	RMAPTarget rmapTarget;
+	rmapTarget.addAddressRangeAndAssociatedAction(&addressRange, &memoryAccessAction);
+	RMAPEngine* rmapEngine = new RMAPEngine(replay);
+	rmapEngine->addRMAPTarget(&rmapTarget);
+	start = Time::getClockValueInMilliSec();
+	rmapEngine->start();
+	rmapEngine->waitUntilRunMethodComplets(); //the engine stops at the end of the capture file
+	elapsed = Time::getClockValueInMilliSec() - start;
+	replyWriter.close();
+	cout << "Replay to RMAPEngine: " << setprecision(0) << NRMAPCommands / (elapsed / 1000.0) << " commands/s, "
+			<< replay->getNSentPackets() << " replies recorded" << endl;
+	if (memoryAccessAction.nWrites != NRMAPCommands || replay->getNSentPackets() != NRMAPCommands) {
+		cerr << "Not all the replayed commands were processed." << endl;
+		return -1;
+	}
+	replay->close();
+	delete rmapEngine;
+	delete replay;
+	unlink(CaptureFileName);
+	unlink(ReplyCaptureFileName);
+
+	//replay at the recorded timing
+	{
+		SpaceWireCaptureWriter writer(CaptureFileName);
+		writer.open();
+		SpaceWireReceiveTimestamp timestamp;
+		timestamp.capture();
+		for (size_t i = 0; i < NTimedPackets; i++) {
+			writer.writePacket(&packet[0], 16, SpaceWireEOPMarker::EOP, timestamp);
+			timestamp.monotonicInNanoSec += (uint64_t) (TimedPacketIntervalInMilliSec * 1e6);
+		}
+	}
+	SpaceWireIFOverCaptureFile timedReplay(CaptureFileName, SpaceWireIFOverCaptureFile::RecordedTiming);
+	timedReplay.setSpeedFactor(SpeedFactor);
+	timedReplay.open();
+	vector<uint8_t> buffer;
+	timedReplay.receive(&buffer);
+	start = Time::getClockValueInMilliSec();
+	for (size_t i = 1; i < NTimedPackets; i++) {
+		timedReplay.receive(&buffer);
+	}
+	elapsed = Time::getClockValueInMilliSec() - start;
+	double expected = (NTimedPackets - 1) * TimedPacketIntervalInMilliSec / SpeedFactor;
+	cout << "Replay at recorded timing (x" << setprecision(0) << SpeedFactor << "): " << setprecision(1) << elapsed
+			<< " ms (expected " << expected << " ms)" << endl;
+	bool reachedEnd = false;
+	try {
+		timedReplay.receive(&buffer);
+	} catch (SpaceWireIFException& e) {
+		reachedEnd = (e.getStatus() == SpaceWireIFException::Disconnected);
+	}
+	timedReplay.close();
+	unlink(CaptureFileName);
+	if (elapsed < expected * 0.95 || expected * 1.5 < elapsed || !reachedEnd) {
+		cerr << "Replay timing is wrong." << endl;
+		return -1;
+	}
+
+	//a receive waiting for a distant record
+	{
+		SpaceWireCaptureWriter writer(CaptureFileName);
+		writer.open();
+		SpaceWireReceiveTimestamp timestamp;
+		timestamp.capture();
+		writer.writePacket(&packet[0], 16, SpaceWireEOPMarker::EOP, timestamp);
+		timestamp.monotonicInNanoSec += (uint64_t) (DistantRecordInMilliSec * 1e6);
+		writer.writePacket(&packet[0], 16, SpaceWireEOPMarker::EOP, timestamp);
+	}
+	SpaceWireIFOverCaptureFile* waitingReplay = new SpaceWireIFOverCaptureFile(CaptureFileName);
+	waitingReplay->open();
+	waitingReplay->receive(&buffer);
+	Receiver receiver(waitingReplay);
+	receiver.start();
+	Condition c;
+	c.wait(CloseDelayInMilliSec);
+	start = Time::getClockValueInMilliSec();
+	waitingReplay->rewind();
+	double rewindTime = Time::getClockValueInMilliSec() - start;
+	waitingReplay->close();
+	receiver.waitUntilRunMethodComplets();
+	elapsed = Time::getClockValueInMilliSec() - start;
+	delete waitingReplay;
+	unlink(CaptureFileName);
+	cout << "Waiting receive: rewind() took " << setprecision(1) << rewindTime << " ms, close() woke it up after "
+			<< elapsed << " ms" << endl;
+	if (CloseDelayInMilliSec < rewindTime || DistantRecordInMilliSec / 10 < elapsed
+			|| receiver.status != SpaceWireIFException::LinkIsNotOpened) {
+		cerr << "A waiting receive blocked the replay." << endl;
+		return -1;
+	}
+
+	//a looping replay of sent packets only
+	{
+		SpaceWireCaptureWriter writer(CaptureFileName);
+		writer.open();
+		for (size_t i = 0; i < 3; i++) {
+			writer.writePacket(&packet[0], 16, SpaceWireEOPMarker::EOP, SpaceWireReceiveTimestamp(),
+					SpaceWireCaptureFileFormat::FlagSent);
+		}
+	}
+	SpaceWireIFOverCaptureFile sentOnlyReplay(CaptureFileName, SpaceWireIFOverCaptureFile::AsFastAsPossible);
+	sentOnlyReplay.setLoop(true);
+	sentOnlyReplay.open();
+	Receiver sentOnlyReceiver(&sentOnlyReplay);
+	sentOnlyReceiver.start();
+	sentOnlyReceiver.waitUntilRunMethodComplets();
+	sentOnlyReplay.close();
+	unlink(CaptureFileName);
+	if (sentOnlyReceiver.status != SpaceWireIFException::Disconnected) {
+		cerr << "Looping replay of sent packets did not stop." << endl;
+		return -1;
+	}
+}
@@ -0,0 +1,134 @@
+/*
+ * test_SpaceWireIFAsync_echo.cc
+ *
+ * Runs a ping-pong between two SpaceWireIFOverLoopback instances using only
+ * the asynchronous API. Both ends post their completions to one
+ * SpaceWireIFCompletionQueue, and the main thread drives everything via
+ * SpaceWireIFCompletionQueue::run(), without receive threads or timeouts.
+ * Then the pending receive of each end is cancelled, and the number of
+ * cancelled operations is checked.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+const size_t DefaultNRoundTrips = 20000;
+const size_t PacketSize = 64;
+
+/** Sends back every received packet. */
+class EchoHandler: public SpaceWireIFAsyncHandler {
+public:
+	SpaceWireIF* spwif;
+	std::vector<uint8_t> reply;
+	size_t nEchoed;
+	size_t nCancelled;
+
+public:
+	EchoHandler(SpaceWireIF* spwif) :
+			spwif(spwif), nEchoed(0), nCancelled(0) {
+	}
+
+public:
+	void onCompletion(SpaceWireIFAsyncOperation* operation) {
+		if (operation->isCancelled()) {
+			nCancelled++;
+			return;
+		}
+		if (operation->type != SpaceWireIFAsyncOperation::Receive || !operation->isCompleted()) {
+			return;
+		}
+		reply = *(operation->buffer);
+		spwif->asyncSend(&reply, this);
+		spwif->asyncReceive(this);
+		nEchoed++;
+	}
+};
+
+/** Sends a packet, and sends the next one when the echo has been received. */
+class PingHandler: public SpaceWireIFAsyncHandler {
+public:
+	SpaceWireIF* spwif;
+	std::vector<uint8_t> packet;
+	size_t nRoundTrips;
+	size_t nCompleted;
+	size_t nCancelled;
+
+public:
+	PingHandler(SpaceWireIF* spwif, size_t nRoundTrips) :
+			spwif(spwif), packet(PacketSize), nRoundTrips(nRoundTrips), nCompleted(0), nCancelled(0) {
+	}
+
+public:
+	void ping() {
+		spwif->asyncReceive(this);
+		spwif->asyncSend(&packet, this);
+	}
+
+	void onCompletion(SpaceWireIFAsyncOperation* operation) {
+		if (operation->isCancelled()) {
+			nCancelled++;
+			return;
+		}
+		if (operation->type != SpaceWireIFAsyncOperation::Receive || !operation->isCompleted()) {
+			return;
+		}
+		if (operation->buffer->size() != PacketSize) {
+			std::cerr << "Echoed packet has a wrong size." << std::endl;
+			exit(-1);
+		}
+		nCompleted++;
+		if (nCompleted < nRoundTrips) {
+			ping();
+		}
+	}
+
+	bool isFinished() const {
+		return nRoundTrips <= nCompleted;
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	size_t nRoundTrips = DefaultNRoundTrips;
+	if (argc >= 2) {
+		nRoundTrips = String::toInteger(argv[1]);
+	}
+
+	SpaceWireIFOverLoopback* end1;
+	SpaceWireIFOverLoopback* end2;
+	SpaceWireIFOverLoopback::createPair(end1, end2);
+	end1->open();
+	end2->open();
+	SpaceWireIFCompletionQueue completionQueue;
+	end1->setCompletionQueue(&completionQueue);
+	end2->setCompletionQueue(&completionQueue);
+
+	PingHandler pingHandler(end1, nRoundTrips);
+	EchoHandler echoHandler(end2);
+	end2->asyncReceive(&echoHandler);
+
+	double start = Time::getClockValueInMilliSec();
+	pingHandler.ping();
+	while (!pingHandler.isFinished()) {
+		completionQueue.run();
+	}
+	double elapsed = Time::getClockValueInMilliSec() - start;
+	cout << nRoundTrips << " round trips of " << PacketSize << "-byte packets in " << fixed << setprecision(1)
+			<< elapsed << " ms (" << setprecision(2) << elapsed * 1000.0 / nRoundTrips << " us per round trip)" << endl;
+	cout << "Handlers invoked: " << completionQueue.getNDispatched() << endl;
+
+	//only the receive re-armed by the echo handler is still pending
+	size_t nCancelled = end1->cancelAsyncOperations() + end2->cancelAsyncOperations();
+	completionQueue.poll();
+	if (nCancelled != 1 || echoHandler.nCancelled != 1) {
+		cerr << "Cancellation failed (" << nCancelled << " cancelled)" << endl;
+		return -1;
+	}
+	cout << "Cancelled " << nCancelled << " pending operation" << endl;
+
+	end1->close();
+	end2->close();
+	delete end1;
+	delete end2;
+}
@@ -0,0 +1,167 @@
+/*
+ * test_SpaceWireIFFaultInjector.cc
+ *
+ * Runs RMAP read transactions over SpaceWireIFOverLoopback with
+ * SpaceWireIFFaultInjector inserted on the initiator side, and measures
+ * goodput and latency of the RMAPInitiator timeout machinery for several
+ * fault rates. Faults are applied to both commands and replies. A transaction
+ * which times out is counted, and the next one is started (no retry).
+ * Replies which arrive after their transaction timed out are counted as
+ * unmatched instead of being reported one by one by RMAPEngine.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+#include "RMAP.hh"
+
+const uint32_t MemorySize = 65536;
+const uint32_t AccessSize = 256;
+const size_t DefaultNTransactions = 2000;
+const double RMAPTimeoutInMilliSec = 20;
+const double FaultRates[] = { 0, 0.001, 0.01, 0.05 };
+const size_t NFaultRates = sizeof(FaultRates) / sizeof(double);
+
+class MemoryAccessAction: public RMAPTargetAccessAction {
+public:
+	std::vector<uint8_t> memory;
+
+public:
+	MemoryAccessAction() :
+			memory(MemorySize) {
+		for (size_t i = 0; i < MemorySize; i++) {
+			memory[i] = i * 7 + 1;
+		}
+	}
+
+public:
+	void processTransaction(RMAPTransaction* rmapTransaction) throw (RMAPTargetAccessActionException) {
+		RMAPPacket* command = rmapTransaction->commandPacket;
+		uint32_t address = command->getAddress();
+		uint32_t length = command->getLength();
+		std::vector<uint8_t> data(memory.begin() + address, memory.begin() + address + length);
+		setReplyWithDataWithStatus(rmapTransaction, &data, RMAPReplyStatus::CommandExcecutedSuccessfully);
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	size_t nTransactions = DefaultNTransactions;
+	if (argc >= 2) {
+		nTransactions = String::toInteger(argv[1]);
+	}
+
+	SpaceWireIFOverLoopback* initiatorSide;
+	SpaceWireIFOverLoopback* targetSide;
+	SpaceWireIFOverLoopback::createPair(initiatorSide, targetSide);
+	SpaceWireIFFaultInjector* faultInjector = new SpaceWireIFFaultInjector(initiatorSide, 1234);
+	faultInjector->open();
+	targetSide->open();
+
+	//target
+	MemoryAccessAction memoryAccessAction;
+	RMAPAddressRange addressRange(0, MemorySize);
+	RMAPTarget rmapTarget;
+	rmapTarget.addAddressRangeAndAssociatedAction(&addressRange, &memoryAccessAction);
+	RMAPEngine* targetEngine = new RMAPEngine(targetSide);
+	targetEngine->addRMAPTarget(&rmapTarget);
+	targetEngine->start();
+
+	//initiator
+	RMAPEngine* initiatorEngine = new RMAPEngine(faultInjector);
+	initiatorEngine->setReportErrorneousReplyPackets(false);
+	initiatorEngine->start();
+	RMAPInitiator* rmapInitiator = new RMAPInitiator(initiatorEngine);
+	rmapInitiator->setInitiatorLogicalAddress(0xFE);
+	RMAPTargetNode rmapTargetNode;
+	rmapTargetNode.setTargetLogicalAddress(0xFE);
+	rmapTargetNode.setDefaultKey(0x00);
+	while (!targetEngine->isStarted() || !initiatorEngine->isStarted()) {
+		Condition c;
+		c.wait(1);
+	}
+
+	cout << nTransactions << " read transactions of " << AccessSize << " bytes per fault rate (timeout "
+			<< RMAPTimeoutInMilliSec << " ms)" << endl;
+	cout << setw(12) << "Fault rate" << setw(12) << "Succeeded" << setw(12) << "Timeouts" << setw(12) << "Corrupted"
+			<< setw(14) << "Goodput[MB/s]" << setw(10) << "p50[us]" << setw(10) << "p99[us]" << setw(10) << "max[us]"
+			<< setw(11) << "Unmatched" << endl;
+	vector<uint8_t> readBuffer(AccessSize);
+	size_t nTotalSucceeded = 0;
+	for (size_t i = 0; i < NFaultRates; i++) {
+		SpaceWireIFFaultModel faults;
+		faults.dropProbability = FaultRates[i];
+		faults.corruptionProbability = FaultRates[i];
+		faults.truncationProbability = FaultRates[i];
+		faults.duplicationProbability = FaultRates[i];
+		faults.reorderingProbability = FaultRates[i];
+		faults.latencyProbability = FaultRates[i];
+		faults.latencyInMicroSec = 1000;
+		faultInjector->setTxFaultModel(faults);
+		faultInjector->setRxFaultModel(faults);
+		faultInjector->resetStatistics();
+
+		size_t nSucceeded = 0, nTimeouts = 0, nCorrupted = 0;
+		size_t nErrorneousReplyPacketsBefore = initiatorEngine->nErrorneousReplyPackets;
+		vector<double> latencies;
+		double start = Time::getClockValueInMilliSec();
+		for (size_t n = 0; n < nTransactions; n++) {
+			uint32_t address = (n * AccessSize) % (MemorySize - AccessSize);
+			double transactionStart = Time::getClockValueInMilliSec();
+			try {
+				rmapInitiator->read(&rmapTargetNode, address, AccessSize, &readBuffer[0], RMAPTimeoutInMilliSec);
+			} catch (RMAPInitiatorException& e) {
+				if (e.getStatus() != RMAPInitiatorException::Timeout) {
+					cerr << "RMAP access failed (" << e.toString() << ")" << endl;
+					return -1;
+				}
+				nTimeouts++;
+				continue;
+			} catch (CxxUtilities::Exception& e) {
+				//e.g. an erroneous reply which passed the CRC check
+				nCorrupted++;
+				continue;
+			}
+			if (memcmp(&readBuffer[0], &memoryAccessAction.memory[address], AccessSize) != 0) {
+				nCorrupted++;
+				continue;
+			}
+			nSucceeded++;
+			latencies.push_back((Time::getClockValueInMilliSec() - transactionStart) * 1000.0);
+		}
+		double elapsed = Time::getClockValueInMilliSec() - start;
+		sort(latencies.begin(), latencies.end());
+		double p50 = 0, p99 = 0, max = 0;
+		if (latencies.size() != 0) {
+			p50 = latencies[latencies.size() / 2];
+			p99 = latencies[latencies.size() * 99 / 100];
+			max = latencies.back();
+		}
+		cout << setw(12) << FaultRates[i] << setw(12) << nSucceeded << setw(12) << nTimeouts << setw(12) << nCorrupted
+				<< setw(14) << fixed << setprecision(2) << nSucceeded * AccessSize / 1024.0 / 1024.0 / (elapsed / 1000.0)
+				<< setw(10) << setprecision(0) << p50 << setw(10) << p99 << setw(10) << max << setw(11)
+				<< initiatorEngine->nErrorneousReplyPackets - nErrorneousReplyPacketsBefore << endl;
+		cout.unsetf(ios::fixed);
+		cout << "  tx: " << faultInjector->getTxStatistics().toString() << endl;
+		cout << "  rx: " << faultInjector->getRxStatistics().toString() << endl;
+		nTotalSucceeded += nSucceeded;
+		if (FaultRates[i] == 0 && nSucceeded != nTransactions) {
+			cerr << "Transactions failed without faults." << endl;
+			return -1;
+		}
+	}
+
+	initiatorEngine->stop();
+	targetEngine->stop();
+	faultInjector->close();
+	targetSide->close();
+	delete rmapInitiator;
+	delete initiatorEngine;
+	delete faultInjector;
+	delete targetEngine;
+	delete initiatorSide;
+	delete targetSide;
+	if (nTotalSucceeded == 0) {
+		return -1;
+	}
+}
@@ -0,0 +1,179 @@
+/*
+ * test_SpaceWireIFLinkBonding.cc
+ *
+ * Bonds up to MaxNLinks SpaceWireIFOverLoopback pairs, each of which is
+ * limited to LinkRateInMbps by SpaceWireIFLinkRateEmulator on the sending
+ * side, and streams packets through the bonded interfaces with each policy.
+ * The throughput should scale with the number of links. The order of packets
+ * is checked per destination logical address for LogicalAddressHash policy.
+ * Finally, one link is closed, and all packets (including the one whose send
+ * failed) must be delivered via the remaining link.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+const size_t MaxNLinks = 3;
+const double LinkRateInMbps = 40;
+const size_t PacketSize = 1024;
+const double MeasurementDurationInSec = 1.0;
+const uint8_t DestinationLogicalAddresses[] = { 0x30, 0x31, 0x32, 0x33 };
+const size_t NDestinations = sizeof(DestinationLogicalAddresses) / sizeof(uint8_t);
+
+/** Sends packets to the destinations in turn with a per-destination sequence number. */
+class PacketSender: public CxxUtilities::Thread {
+private:
+	SpaceWireIFLinkBonding* spwif;
+	size_t nPackets;
+
+public:
+	PacketSender(SpaceWireIFLinkBonding* spwif, size_t nPackets) :
+			spwif(spwif), nPackets(nPackets) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> data(PacketSize);
+		for (size_t i = 0; i < nPackets; i++) {
+			data[0] = DestinationLogicalAddresses[i % NDestinations];
+			uint32_t sequenceNumber = i / NDestinations;
+			memcpy(&data[1], &sequenceNumber, sizeof(uint32_t));
+			spwif->send(&data[0], data.size());
+		}
+		spwif->flush();
+	}
+};
+
+class Setup {
+public:
+	std::vector<SpaceWireIFOverLoopback*> loopbacks;
+	std::vector<SpaceWireIFLinkRateEmulator*> emulators;
+	SpaceWireIFLinkBonding* sender;
+	SpaceWireIFLinkBonding* receiver;
+
+public:
+	Setup(size_t nLinks) {
+		sender = new SpaceWireIFLinkBonding;
+		receiver = new SpaceWireIFLinkBonding;
+		for (size_t i = 0; i < nLinks; i++) {
+			SpaceWireIFOverLoopback* end1;
+			SpaceWireIFOverLoopback* end2;
+			SpaceWireIFOverLoopback::createPair(end1, end2);
+			SpaceWireIFLinkRateEmulator* emulator = new SpaceWireIFLinkRateEmulator(end1, LinkRateInMbps);
+			sender->addLink(emulator);
+			receiver->addLink(end2);
+			loopbacks.push_back(end1);
+			loopbacks.push_back(end2);
+			emulators.push_back(emulator);
+		}
+		sender->open();
+		receiver->open();
+		receiver->setTimeoutDuration(2000000);
+	}
+
+	~Setup() {
+		sender->close();
+		receiver->close();
+		delete sender;
+		delete receiver;
+		for (size_t i = 0; i < emulators.size(); i++) {
+			delete emulators[i];
+		}
+		for (size_t i = 0; i < loopbacks.size(); i++) {
+			delete loopbacks[i];
+		}
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	//packets which take MeasurementDurationInSec on one link (10 bits per character)
+	size_t nPacketsPerLink = (size_t) (LinkRateInMbps * 1e6 * MeasurementDurationInSec / 10 / PacketSize);
+	const char* policyNames[] = { "RoundRobin", "LeastQueued", "LogicalAddressHash" };
+	SpaceWireIFLinkBonding::PolicyType policies[] = { SpaceWireIFLinkBonding::RoundRobin,
+			SpaceWireIFLinkBonding::LeastQueued, SpaceWireIFLinkBonding::LogicalAddressHash };
+
+	cout << "Link rate " << LinkRateInMbps << " Mbps, " << PacketSize << "-byte packets" << endl;
+	cout << setw(20) << "Policy" << setw(8) << "Links" << setw(12) << "MB/s" << setw(10) << "Scaling" << setw(12)
+			<< "In order" << endl;
+	bool failed = false;
+	for (size_t p = 0; p < 3; p++) {
+		double singleLinkThroughput = 0;
+		for (size_t nLinks = 1; nLinks <= MaxNLinks; nLinks++) {
+			Setup setup(nLinks);
+			setup.sender->setPolicy(policies[p]);
+			size_t nPackets = nPacketsPerLink * nLinks;
+			PacketSender packetSender(setup.sender, nPackets);
+			vector<uint8_t> buffer;
+			vector<uint32_t> nextSequenceNumbers(256, 0);
+			bool inOrder = true;
+			double start = Time::getClockValueInMilliSec();
+			packetSender.start();
+			try {
+				for (size_t n = 0; n < nPackets; n++) {
+					setup.receiver->receive(&buffer);
+					uint32_t sequenceNumber;
+					memcpy(&sequenceNumber, &buffer[1], sizeof(uint32_t));
+					if (sequenceNumber != nextSequenceNumbers[buffer[0]]) {
+						inOrder = false;
+					}
+					nextSequenceNumbers[buffer[0]] = sequenceNumber + 1;
+				}
+			} catch (SpaceWireIFException& e) {
+				cerr << "Receive failed (" << e.toString() << ")" << endl;
+				return -1;
+			}
+			double elapsed = Time::getClockValueInMilliSec() - start;
+			packetSender.waitUntilRunMethodComplets();
+			double throughput = nPackets * PacketSize / 1024.0 / 1024.0 / (elapsed / 1000.0);
+			if (nLinks == 1) {
+				singleLinkThroughput = throughput;
+			}
+			bool hashPolicy = (policies[p] == SpaceWireIFLinkBonding::LogicalAddressHash);
+			cout << setw(20) << policyNames[p] << setw(8) << nLinks << setw(12) << fixed << setprecision(2)
+					<< throughput << setw(10) << setprecision(2) << throughput / singleLinkThroughput << setw(12)
+					<< (inOrder ? "yes" : "no") << endl;
+			cout.unsetf(ios::fixed);
+			if (hashPolicy && !inOrder) {
+				cerr << "Packets to a destination were reordered." << endl;
+				failed = true;
+			}
+			if (nLinks == 2 && throughput / singleLinkThroughput < 1.5) {
+				cerr << "Two links did not scale the throughput." << endl;
+				failed = true;
+			}
+		}
+	}
+
+	//a failed link is excluded, and the remaining link carries the traffic
+	{
+		Setup setup(2);
+		setup.sender->setPolicy(SpaceWireIFLinkBonding::RoundRobin);
+		setup.loopbacks[2]->close(); //sending end of the second link
+		vector<uint8_t> data(PacketSize), buffer;
+		size_t nPackets = 100;
+		for (size_t i = 0; i < nPackets; i++) {
+			setup.sender->send(&data[0], data.size());
+		}
+		setup.sender->flush();
+		size_t nReceived = 0;
+		setup.receiver->setTimeoutDuration(200000);
+		try {
+			while (true) {
+				setup.receiver->receive(&buffer);
+				nReceived++;
+			}
+		} catch (SpaceWireIFException& e) {
+		}
+		cout << "After a link failure: " << nReceived << " of " << nPackets << " packets received" << endl;
+		cout << setup.sender->getStatisticsAsString();
+		if (nReceived != nPackets || !setup.sender->getLinkStatistics(1).failed) {
+			cerr << "Packets were lost on the remaining link." << endl;
+			failed = true;
+		}
+	}
+	if (failed) {
+		return -1;
+	}
+}
@@ -0,0 +1,189 @@
+/*
+ * test_SpaceWireIFLinkRateEmulator.cc
+ *
+ * Wraps both ends of SpaceWireIFOverLoopback with SpaceWireIFLinkRateEmulator.
+ * First, a stream of packets is sent at each link rate, and the measured
+ * throughput is compared with the theoretical one (10 bits per data character
+ * and 4 bits per EOP). Link rates which the loopback itself cannot sustain
+ * on this host (measured with pacing disabled) are not checked. Then RMAP read/write is measured over the emulated link
+ * as in test_SpaceWireIFOverLoopback_rmapBenchmark.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+#include "RMAP.hh"
+
+const double LinkRatesInMbps[] = { 10, 50, 200 };
+const size_t NLinkRates = sizeof(LinkRatesInMbps) / sizeof(double);
+const size_t StreamPacketSize = 1024;
+const double StreamDurationInSec = 0.5;
+const size_t NPacketsForCapacity = 10000;
+const double Tolerance = 0.1;
+const double PropagationDelayInMicroSec = 5;
+const uint32_t MemorySize = 64 * 1024;
+const uint32_t AccessSizes[] = { 4, 1024, 16384 };
+const size_t NAccessSizes = sizeof(AccessSizes) / sizeof(uint32_t);
+const size_t NTransactions = 200;
+
+class PacketSender: public CxxUtilities::Thread {
+private:
+	SpaceWireIF* spwif;
+	size_t nPackets;
+
+public:
+	PacketSender(SpaceWireIF* spwif, size_t nPackets) :
+			spwif(spwif), nPackets(nPackets) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> data(StreamPacketSize);
+		for (size_t i = 0; i < nPackets; i++) {
+			spwif->send(data);
+		}
+	}
+};
+
+/** Memory which is read/written via RMAP. */
+class MemoryAccessAction: public RMAPTargetAccessAction {
+public:
+	std::vector<uint8_t> memory;
+
+public:
+	MemoryAccessAction() :
+			memory(MemorySize) {
+	}
+
+public:
+	void processTransaction(RMAPTransaction* rmapTransaction) throw (RMAPTargetAccessActionException) {
+		RMAPPacket* command = rmapTransaction->commandPacket;
+		uint32_t address = command->getAddress();
+		uint32_t length = command->getLength();
+		if (command->isWrite()) {
+			command->getData(&memory[address], length);
+			setReplyWithStatus(rmapTransaction, RMAPReplyStatus::CommandExcecutedSuccessfully);
+		} else {
+			std::vector<uint8_t> data(memory.begin() + address, memory.begin() + address + length);
+			setReplyWithDataWithStatus(rmapTransaction, &data, RMAPReplyStatus::CommandExcecutedSuccessfully);
+		}
+	}
+};
+
+/** Streams packets from link1 to link2, and returns the throughput in MB/s. */
+double measureThroughput(SpaceWireIF* link1, SpaceWireIF* link2, size_t nPackets) {
+	using namespace CxxUtilities;
+	PacketSender sender(link1, nPackets);
+	std::vector<uint8_t> buffer;
+	sender.start();
+	link2->receive(&buffer); //the measurement starts from the first packet
+	double start = Time::getClockValueInMilliSec();
+	for (size_t n = 1; n < nPackets; n++) {
+		link2->receive(&buffer);
+	}
+	double elapsed = Time::getClockValueInMilliSec() - start;
+	sender.waitUntilRunMethodComplets();
+	return (nPackets - 1) * StreamPacketSize / 1024.0 / 1024.0 / (elapsed / 1000.0);
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+
+	SpaceWireIFOverLoopback* end1;
+	SpaceWireIFOverLoopback* end2;
+	SpaceWireIFOverLoopback::createPair(end1, end2);
+	SpaceWireIFLinkRateEmulator* link1 = new SpaceWireIFLinkRateEmulator(end1, LinkRatesInMbps[0],
+			PropagationDelayInMicroSec);
+	SpaceWireIFLinkRateEmulator* link2 = new SpaceWireIFLinkRateEmulator(end2, LinkRatesInMbps[0],
+			PropagationDelayInMicroSec);
+	link1->open();
+	link2->open();
+
+	//packet stream
+	bool failed = false;
+	link1->setLinkRateInMbps(0);
+	link2->setLinkRateInMbps(0);
+	double capacity = measureThroughput(link1, link2, NPacketsForCapacity);
+	cout << "Loopback without pacing: " << fixed << setprecision(2) << capacity << " MB/s" << endl;
+	cout << setw(12) << "Link [Mbps]" << setw(16) << "Expected [MB/s]" << setw(16) << "Measured [MB/s]" << endl;
+	for (size_t i = 0; i < NLinkRates; i++) {
+		link1->setLinkRateInMbps(LinkRatesInMbps[i]);
+		link2->setLinkRateInMbps(LinkRatesInMbps[i]);
+		double packetsPerSec = LinkRatesInMbps[i] * 1e6 / link1->getPacketSizeInBits(StreamPacketSize);
+		double expected = packetsPerSec * StreamPacketSize / 1024.0 / 1024.0;
+		double measured = measureThroughput(link1, link2, (size_t) (packetsPerSec * StreamDurationInSec));
+		cout << setw(12) << setprecision(0) << LinkRatesInMbps[i] << setw(16) << setprecision(2) << expected << setw(16)
+				<< measured;
+		if (capacity * (1 - Tolerance) < expected) {
+			cout << " (limited by the loopback)" << endl;
+		} else if (measured < expected * (1 - Tolerance) || expected * (1 + Tolerance) < measured) {
+			cout << " (NG)" << endl;
+			failed = true;
+		} else {
+			cout << endl;
+		}
+	}
+
+	//RMAP
+	MemoryAccessAction memoryAccessAction;
+	RMAPAddressRange addressRange(0, MemorySize);
+	RMAPTarget rmapTarget;
+	rmapTarget.addAddressRangeAndAssociatedAction(&addressRange, &memoryAccessAction);
+	RMAPEngine* targetEngine = new RMAPEngine(link2);
+	targetEngine->addRMAPTarget(&rmapTarget);
+	targetEngine->start();
+	RMAPEngine* initiatorEngine = new RMAPEngine(link1);
+	initiatorEngine->start();
+	RMAPInitiator* rmapInitiator = new RMAPInitiator(initiatorEngine);
+	rmapInitiator->setInitiatorLogicalAddress(0xFE);
+	RMAPTargetNode rmapTargetNode;
+	rmapTargetNode.setTargetLogicalAddress(0xFE);
+	rmapTargetNode.setDefaultKey(0x00);
+	while (!targetEngine->isStarted() || !initiatorEngine->isStarted()) {
+		Condition c;
+		c.wait(1);
+	}
+	vector<uint8_t> buffer(MemorySize);
+	cout << endl << setw(12) << "Link [Mbps]" << setw(10) << "Access" << setw(10) << "Size" << setw(16)
+			<< "Latency [us]" << setw(12) << "MB/s" << endl;
+	for (size_t i = 0; i < NLinkRates; i++) {
+		link1->setLinkRateInMbps(LinkRatesInMbps[i]);
+		link2->setLinkRateInMbps(LinkRatesInMbps[i]);
+		for (size_t j = 0; j < NAccessSizes; j++) {
+			for (int write = 1; write >= 0; write--) {
+				uint32_t size = AccessSizes[j];
+				double start = Time::getClockValueInMilliSec();
+				try {
+					for (size_t n = 0; n < NTransactions; n++) {
+						if (write) {
+							rmapInitiator->write(&rmapTargetNode, 0, &buffer[0], size);
+						} else {
+							rmapInitiator->read(&rmapTargetNode, 0, size, &buffer[0]);
+						}
+					}
+				} catch (CxxUtilities::Exception& e) {
+					cerr << "RMAP access failed (" << e.toString() << ")" << endl;
+					return -1;
+				}
+				double elapsed = Time::getClockValueInMilliSec() - start;
+				cout << setw(12) << setprecision(0) << LinkRatesInMbps[i] << setw(10) << (write ? "write" : "read")
+						<< setw(10) << size << setw(16) << setprecision(1) << elapsed * 1000.0 / NTransactions << setw(12)
+						<< setprecision(2) << NTransactions * size / 1024.0 / 1024.0 / (elapsed / 1000.0) << endl;
+			}
+		}
+	}
+	initiatorEngine->stop();
+	targetEngine->stop();
+	link1->close();
+	link2->close();
+	delete rmapInitiator;
+	delete initiatorEngine;
+	delete targetEngine;
+	delete link1;
+	delete link2;
+	delete end1;
+	delete end2;
+	if (failed) {
+		return -1;
+	}
+}
@@ -0,0 +1,399 @@
+/*
+ * test_SpaceWireIFMultiplexer_benchmark.cc
+ *
+ * Measures the cost of SpaceWireIFMultiplexer on SpaceWireIFOverLoopback.
+ * Round-trip latency and receive throughput are compared between the real
+ * SpaceWireIF and virtual SpaceWireIFs (two protocol IDs, one receiver thread
+ * each). Then RMAP transactions are executed via a virtual SpaceWireIF while
+ * a stream of SpaceWire-R (protocol ID 0x52) packets is received via another one.
+ * Finally, two RMAPInitiators with different initiator logical addresses run
+ * concurrently, each via its own virtual SpaceWireIF routed by (logical
+ * address, protocol ID), while another thread keeps changing routes.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+#include "RMAP.hh"
+
+const uint8_t LogicalAddress = 0xFE;
+const uint8_t InstrumentLogicalAddress = 0x80;
+const uint8_t RMAPProtocolID = 0x01; //RMAPProtocol::ProtocolIdentifier
+const uint8_t StreamProtocolID = 0x52; //SpaceWireRProtocol::ProtocolID
+const size_t NRoundTrips = 20000;
+const size_t RoundTripPacketSize = 64;
+const size_t NStreamPackets = 400000;
+const size_t StreamPacketSize = 256;
+const size_t NRMAPTransactions = 5000;
+const uint32_t MemorySize = 65536;
+
+std::vector<uint8_t> createPacket(uint8_t protocolID, size_t size) {
+	std::vector<uint8_t> packet(size);
+	packet[0] = LogicalAddress;
+	packet[1] = protocolID;
+	return packet;
+}
+
+/** Sends back every received packet until a 2-byte packet is received. */
+class Echo: public CxxUtilities::Thread {
+private:
+	SpaceWireIF* spwif;
+
+public:
+	Echo(SpaceWireIF* spwif) :
+			spwif(spwif) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> buffer;
+		while (true) {
+			spwif->receive(&buffer);
+			spwif->send(&buffer[0], buffer.size());
+			if (buffer.size() == 2) {
+				return;
+			}
+		}
+	}
+};
+
+/** Sends packets with the given protocol IDs in turn. */
+class StreamSender: public CxxUtilities::Thread {
+private:
+	SpaceWireIF* spwif;
+	std::vector<uint8_t> protocolIDs;
+	size_t nPackets;
+
+public:
+	StreamSender(SpaceWireIF* spwif, std::vector<uint8_t> protocolIDs, size_t nPackets) :
+			spwif(spwif), protocolIDs(protocolIDs), nPackets(nPackets) {
+	}
+
+public:
+	void run() {
+		std::vector<std::vector<uint8_t> > packets;
+		for (size_t i = 0; i < protocolIDs.size(); i++) {
+			packets.push_back(createPacket(protocolIDs[i], StreamPacketSize));
+		}
+		for (size_t i = 0; i < nPackets; i++) {
+			std::vector<uint8_t>& packet = packets[i % packets.size()];
+			spwif->send(&packet[0], packet.size());
+		}
+	}
+};
+
+/** Receives a given number of packets, and checks their protocol ID. */
+class StreamReceiver: public CxxUtilities::Thread {
+private:
+	SpaceWireIF* spwif;
+	int protocolID; //-1: any
+	size_t nPackets;
+
+public:
+	size_t nWrongPackets;
+
+public:
+	StreamReceiver(SpaceWireIF* spwif, int protocolID, size_t nPackets) :
+			spwif(spwif), protocolID(protocolID), nPackets(nPackets), nWrongPackets(0) {
+	}
+
+public:
+	void run() {
+		std::vector<std::vector<uint8_t> > packets;
+		std::vector<SpaceWireEOPMarker::EOPType> eopTypes;
+		size_t n = 0;
+		while (n < nPackets) {
+			size_t nReceived = spwif->receiveBatch(packets, eopTypes);
+			for (size_t i = 0; i < nReceived; i++) {
+				if (protocolID >= 0 && packets[i][1] != protocolID) {
+					nWrongPackets++;
+				}
+			}
+			n += nReceived;
+		}
+	}
+};
+
+class MemoryAccessAction: public RMAPTargetAccessAction {
+public:
+	std::vector<uint8_t> memory;
+
+public:
+	MemoryAccessAction() :
+			memory(MemorySize) {
+	}
+
+public:
+	void processTransaction(RMAPTransaction* rmapTransaction) throw (RMAPTargetAccessActionException) {
+		RMAPPacket* command = rmapTransaction->commandPacket;
+		uint32_t address = command->getAddress();
+		uint32_t length = command->getLength();
+		if (command->isWrite()) {
+			command->getData(&memory[address], length);
+			setReplyWithStatus(rmapTransaction, RMAPReplyStatus::CommandExcecutedSuccessfully);
+		} else {
+			std::vector<uint8_t> data(memory.begin() + address, memory.begin() + address + length);
+			setReplyWithDataWithStatus(rmapTransaction, &data, RMAPReplyStatus::CommandExcecutedSuccessfully);
+		}
+	}
+};
+
+/** Executes RMAP write/read pairs, and checks the read data. */
+class RMAPWorker: public CxxUtilities::Thread {
+private:
+	RMAPInitiator* rmapInitiator;
+	RMAPTargetNode* rmapTargetNode;
+	uint32_t address;
+	size_t nTransactions;
+
+public:
+	bool failed;
+	double elapsedInMilliSec;
+
+public:
+	RMAPWorker(RMAPInitiator* rmapInitiator, RMAPTargetNode* rmapTargetNode, uint32_t address, size_t nTransactions) :
+			rmapInitiator(rmapInitiator), rmapTargetNode(rmapTargetNode), address(address), nTransactions(
+					nTransactions), failed(false), elapsedInMilliSec(0) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> data(4), readData(4);
+		double start = CxxUtilities::Time::getClockValueInMilliSec();
+		try {
+			for (size_t i = 0; i < nTransactions; i++) {
+				data[0] = i;
+				rmapInitiator->write(rmapTargetNode, address, &data[0], data.size());
+				rmapInitiator->read(rmapTargetNode, address, readData.size(), &readData[0]);
+				if (readData != data) {
+					std::cerr << "Read data do not match the written data." << std::endl;
+					failed = true;
+					break;
+				}
+			}
+		} catch (CxxUtilities::Exception& e) {
+			std::cerr << "RMAP access failed (" << e.toString() << ")" << std::endl;
+			failed = true;
+		}
+		elapsedInMilliSec = CxxUtilities::Time::getClockValueInMilliSec() - start;
+	}
+};
+
+/** Adds and removes a route until stopped (routes of other virtual SpaceWireIFs should not be affected). */
+class RouteChanger: public CxxUtilities::StoppableThread {
+private:
+	SpaceWireIFMultiplexer* multiplexer;
+	SpaceWireIFMultiplexedIF* spwif;
+
+public:
+	size_t nChanges;
+
+public:
+	RouteChanger(SpaceWireIFMultiplexer* multiplexer, SpaceWireIFMultiplexedIF* spwif) :
+			multiplexer(multiplexer), spwif(spwif), nChanges(0) {
+	}
+
+public:
+	void run() {
+		stopped = false;
+		while (!stopped) {
+			multiplexer->addRoute(InstrumentLogicalAddress + 1, RMAPProtocolID, spwif);
+			multiplexer->removeRoute(InstrumentLogicalAddress + 1, RMAPProtocolID);
+			nChanges += 2;
+			CxxUtilities::Condition c;
+			c.wait(1);
+		}
+	}
+};
+
+double measureRoundTrip(SpaceWireIF* spwif, SpaceWireIF* farEnd) {
+	using namespace std;
+	using namespace CxxUtilities;
+	Echo echo(farEnd);
+	echo.start();
+	vector<uint8_t> packet = createPacket(RMAPProtocolID, RoundTripPacketSize), reply;
+	double start = Time::getClockValueInMilliSec();
+	for (size_t i = 0; i < NRoundTrips; i++) {
+		spwif->send(&packet[0], packet.size());
+		spwif->receive(&reply);
+	}
+	double elapsed = Time::getClockValueInMilliSec() - start;
+	packet.resize(2);
+	spwif->send(&packet[0], packet.size());
+	spwif->receive(&reply);
+	echo.waitUntilRunMethodComplets();
+	return elapsed * 1000.0 / NRoundTrips;
+}
+
+/** Returns packets/s. */
+double measureThroughput(SpaceWireIF* farEnd, std::vector<StreamReceiver*> receivers) {
+	using namespace CxxUtilities;
+	std::vector<uint8_t> protocolIDs;
+	protocolIDs.push_back(RMAPProtocolID);
+	protocolIDs.push_back(StreamProtocolID);
+	StreamSender sender(farEnd, protocolIDs, NStreamPackets);
+	double start = Time::getClockValueInMilliSec();
+	for (size_t i = 0; i < receivers.size(); i++) {
+		receivers[i]->start();
+	}
+	sender.start();
+	sender.waitUntilRunMethodComplets();
+	for (size_t i = 0; i < receivers.size(); i++) {
+		receivers[i]->waitUntilRunMethodComplets();
+	}
+	double elapsed = Time::getClockValueInMilliSec() - start;
+	return NStreamPackets / (elapsed / 1000.0);
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+
+	SpaceWireIFOverLoopback* end1;
+	SpaceWireIFOverLoopback* end2;
+	SpaceWireIFOverLoopback::createPair(end1, end2);
+	end1->open();
+	end2->open();
+	end1->setTimeoutDuration(5000000);
+	end2->setTimeoutDuration(5000000);
+	bool failed = false;
+
+	cout << setw(24) << "Interface" << setw(24) << "Round trip [us]" << setw(20) << "Packets/s" << endl;
+
+	//real SpaceWireIF
+	double directRoundTrip = measureRoundTrip(end1, end2);
+	vector<StreamReceiver*> receivers;
+	receivers.push_back(new StreamReceiver(end1, -1, NStreamPackets));
+	double directThroughput = measureThroughput(end2, receivers);
+	delete receivers[0];
+	cout << setw(24) << "real SpaceWireIF" << setw(24) << fixed << setprecision(2) << directRoundTrip << setw(20)
+			<< setprecision(0) << directThroughput << endl;
+
+	//virtual SpaceWireIFs
+	SpaceWireIFMultiplexer* multiplexer = new SpaceWireIFMultiplexer(end1);
+	vector<uint8_t> rmapProtocolIDs(1, RMAPProtocolID);
+	vector<uint8_t> streamProtocolIDs(1, StreamProtocolID);
+	SpaceWireIFMultiplexedIF* rmapIF = multiplexer->createVirtualSpaceWireIF(rmapProtocolIDs, "RMAP");
+	SpaceWireIFMultiplexedIF* streamIF = multiplexer->createVirtualSpaceWireIF(streamProtocolIDs, "SpaceWire-R");
+	//the measurements count every packet
+	rmapIF->setOverflowPolicy(SpaceWireIFMultiplexedIF::BlockDemultiplexer);
+	streamIF->setOverflowPolicy(SpaceWireIFMultiplexedIF::BlockDemultiplexer);
+	multiplexer->open();
+	rmapIF->open();
+	streamIF->open();
+	rmapIF->setTimeoutDuration(5000000);
+	streamIF->setTimeoutDuration(5000000);
+	double multiplexedRoundTrip = measureRoundTrip(rmapIF, end2);
+	receivers.clear();
+	receivers.push_back(new StreamReceiver(rmapIF, RMAPProtocolID, NStreamPackets / 2));
+	receivers.push_back(new StreamReceiver(streamIF, StreamProtocolID, NStreamPackets / 2));
+	double multiplexedThroughput = measureThroughput(end2, receivers);
+	for (size_t i = 0; i < receivers.size(); i++) {
+		if (receivers[i]->nWrongPackets != 0) {
+			cerr << "Packets were delivered to a wrong virtual SpaceWireIF." << endl;
+			failed = true;
+		}
+		delete receivers[i];
+	}
+	cout << setw(24) << "virtual SpaceWireIF" << setw(24) << setprecision(2) << multiplexedRoundTrip << setw(20)
+			<< setprecision(0) << multiplexedThroughput << endl;
+
+	//RMAP and a SpaceWire-R stream on one link
+	MemoryAccessAction memoryAccessAction;
+	RMAPAddressRange addressRange(0, MemorySize);
+	RMAPTarget rmapTarget;
+	rmapTarget.addAddressRangeAndAssociatedAction(&addressRange, &memoryAccessAction);
+	RMAPEngine* targetEngine = new RMAPEngine(end2);
+	targetEngine->addRMAPTarget(&rmapTarget);
+	targetEngine->start();
+	RMAPEngine* initiatorEngine = new RMAPEngine(rmapIF);
+	initiatorEngine->start();
+	RMAPInitiator* rmapInitiator = new RMAPInitiator(initiatorEngine);
+	rmapInitiator->setInitiatorLogicalAddress(LogicalAddress);
+	RMAPTargetNode rmapTargetNode;
+	rmapTargetNode.setTargetLogicalAddress(LogicalAddress);
+	rmapTargetNode.setDefaultKey(0x00);
+	while (!targetEngine->isStarted() || !initiatorEngine->isStarted()) {
+		Condition c;
+		c.wait(1);
+	}
+	StreamSender streamSender(end2, streamProtocolIDs, NStreamPackets);
+	StreamReceiver streamReceiver(streamIF, StreamProtocolID, NStreamPackets);
+	streamReceiver.start();
+	streamSender.start();
+	vector<uint8_t> data(4), readData(4);
+	double start = Time::getClockValueInMilliSec();
+	try {
+		for (size_t i = 0; i < NRMAPTransactions; i++) {
+			data[0] = i;
+			rmapInitiator->write(&rmapTargetNode, 0, &data[0], data.size());
+			rmapInitiator->read(&rmapTargetNode, 0, readData.size(), &readData[0]);
+			if (readData != data) {
+				cerr << "Read data do not match the written data." << endl;
+				failed = true;
+				break;
+			}
+		}
+	} catch (CxxUtilities::Exception& e) {
+		cerr << "RMAP access failed (" << e.toString() << ")" << endl;
+		failed = true;
+	}
+	double elapsed = Time::getClockValueInMilliSec() - start;
+	streamSender.waitUntilRunMethodComplets();
+	streamReceiver.waitUntilRunMethodComplets();
+	cout << NRMAPTransactions << " RMAP write/read pairs during a SpaceWire-R stream: " << setprecision(2)
+			<< elapsed * 1000.0 / NRMAPTransactions / 2 << " us per transaction" << endl;
+
+	//two RMAP initiators sharing protocol ID 0x01
+	SpaceWireIFMultiplexedIF* instrumentIF = multiplexer->createVirtualSpaceWireIF(InstrumentLogicalAddress,
+			rmapProtocolIDs, "Instrument");
+	instrumentIF->open();
+	RMAPEngine* instrumentEngine = new RMAPEngine(instrumentIF);
+	instrumentEngine->start();
+	RMAPInitiator* instrumentInitiator = new RMAPInitiator(instrumentEngine);
+	instrumentInitiator->setInitiatorLogicalAddress(InstrumentLogicalAddress);
+	while (!instrumentEngine->isStarted()) {
+		Condition c;
+		c.wait(1);
+	}
+	RMAPWorker worker1(rmapInitiator, &rmapTargetNode, 0, NRMAPTransactions);
+	RMAPWorker worker2(instrumentInitiator, &rmapTargetNode, 4, NRMAPTransactions);
+	RouteChanger routeChanger(multiplexer, streamIF);
+	routeChanger.start();
+	worker1.start();
+	worker2.start();
+	worker1.waitUntilRunMethodComplets();
+	worker2.waitUntilRunMethodComplets();
+	routeChanger.stop();
+	routeChanger.waitUntilRunMethodComplets();
+	cout << "Two initiators (logical address 0x" << hex << (uint32_t) LogicalAddress << " and 0x"
+			<< (uint32_t) InstrumentLogicalAddress << dec << "): " << setprecision(2)
+			<< worker1.elapsedInMilliSec * 1000.0 / NRMAPTransactions / 2 << " / "
+			<< worker2.elapsedInMilliSec * 1000.0 / NRMAPTransactions / 2 << " us per transaction, "
+			<< routeChanger.nChanges << " route changes" << endl;
+	if (worker1.failed || worker2.failed || instrumentIF->nReceivedPackets != NRMAPTransactions * 2
+			|| multiplexer->findRoute(InstrumentLogicalAddress, RMAPProtocolID) != instrumentIF
+			|| multiplexer->findRoute(LogicalAddress, RMAPProtocolID) != rmapIF) {
+		cerr << "Replies were not routed by logical address." << endl;
+		failed = true;
+	}
+
+	cout << "Multiplexer: received=" << multiplexer->nReceivedPackets << " discarded="
+			<< multiplexer->nDiscardedPackets << endl;
+
+	instrumentEngine->stop();
+	initiatorEngine->stop();
+	targetEngine->stop();
+	multiplexer->close();
+	end2->close();
+	delete instrumentInitiator;
+	delete instrumentEngine;
+	delete rmapInitiator;
+	delete initiatorEngine;
+	delete targetEngine;
+	delete multiplexer;
+	delete end1;
+	delete end2;
+	if (failed) {
+		return -1;
+	}
+}
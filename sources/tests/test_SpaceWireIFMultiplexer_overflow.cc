@@ -0,0 +1,199 @@
+/*
+ * test_SpaceWireIFMultiplexer_overflow.cc
+ *
+ * Floods a virtual SpaceWireIF whose receiver never calls receive()
+ * ("housekeeping", protocol ID 0xF0) while RMAP transactions are executed
+ * via another virtual SpaceWireIF of the same SpaceWireIFMultiplexer.
+ * With DropNewest and DropOldest policies, the RMAP latency should not be
+ * affected by the stalled receiver, and the housekeeping queue should keep
+ * the oldest or the newest packets respectively. With BlockDemultiplexer,
+ * the stalled receiver blocks RMAP replies until it drains its queue
+ * (a few transactions time out, and no housekeeping packet is lost).
+ * Late replies to timed-out transactions are counted as unmatched.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+#include "RMAP.hh"
+
+const uint8_t LogicalAddress = 0xFE;
+const uint8_t RMAPProtocolID = 0x01; //RMAPProtocol::ProtocolIdentifier
+const uint8_t HousekeepingProtocolID = 0xF0;
+const size_t HousekeepingQueueCapacity = 256;
+const size_t NHousekeepingPackets = 20000;
+const size_t NRMAPTransactions = 2000;
+const double RMAPTimeoutInMilliSec = 100;
+const uint32_t MemorySize = 4096;
+
+/** Sends housekeeping packets with sequence numbers. */
+class HousekeepingSender: public CxxUtilities::Thread {
+private:
+	SpaceWireIF* spwif;
+
+public:
+	HousekeepingSender(SpaceWireIF* spwif) :
+			spwif(spwif) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> packet(64);
+		packet[0] = LogicalAddress;
+		packet[1] = HousekeepingProtocolID;
+		for (uint32_t i = 0; i < NHousekeepingPackets; i++) {
+			memcpy(&packet[2], &i, sizeof(uint32_t));
+			spwif->send(&packet[0], packet.size());
+		}
+	}
+};
+
+class MemoryAccessAction: public RMAPTargetAccessAction {
+public:
+	std::vector<uint8_t> memory;
+
+public:
+	MemoryAccessAction() :
+			memory(MemorySize) {
+	}
+
+public:
+	void processTransaction(RMAPTransaction* rmapTransaction) throw (RMAPTargetAccessActionException) {
+		RMAPPacket* command = rmapTransaction->commandPacket;
+		std::vector<uint8_t> data(memory.begin() + command->getAddress(),
+				memory.begin() + command->getAddress() + command->getLength());
+		setReplyWithDataWithStatus(rmapTransaction, &data, RMAPReplyStatus::CommandExcecutedSuccessfully);
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+
+	const char* policyNames[] = { "DropNewest", "DropOldest", "BlockDemultiplexer" };
+	SpaceWireIFMultiplexedIF::OverflowPolicy policies[] = { SpaceWireIFMultiplexedIF::DropNewest,
+			SpaceWireIFMultiplexedIF::DropOldest, SpaceWireIFMultiplexedIF::BlockDemultiplexer };
+	bool failed = false;
+	cout << setw(20) << "Policy" << setw(12) << "RMAP OK" << setw(12) << "Timeouts" << setw(10) << "p50[us]"
+			<< setw(10) << "p99[us]" << setw(11) << "Unmatched" << "  Housekeeping queue" << endl;
+	for (size_t p = 0; p < 3; p++) {
+		SpaceWireIFOverLoopback* end1;
+		SpaceWireIFOverLoopback* end2;
+		SpaceWireIFOverLoopback::createPair(end1, end2);
+		end2->open();
+
+		SpaceWireIFMultiplexer* multiplexer = new SpaceWireIFMultiplexer(end1);
+		SpaceWireIFMultiplexedIF* rmapIF = multiplexer->createVirtualSpaceWireIF(vector<uint8_t>(1, RMAPProtocolID),
+				"RMAP");
+		SpaceWireIFMultiplexedIF* housekeepingIF = multiplexer->createVirtualSpaceWireIF(
+				vector<uint8_t>(1, HousekeepingProtocolID), "Housekeeping", HousekeepingQueueCapacity);
+		housekeepingIF->setOverflowPolicy(policies[p]);
+		multiplexer->open();
+		rmapIF->open();
+		housekeepingIF->open();
+
+		MemoryAccessAction memoryAccessAction;
+		RMAPAddressRange addressRange(0, MemorySize);
+		RMAPTarget rmapTarget;
+		rmapTarget.addAddressRangeAndAssociatedAction(&addressRange, &memoryAccessAction);
+		RMAPEngine* targetEngine = new RMAPEngine(end2);
+		targetEngine->addRMAPTarget(&rmapTarget);
+		targetEngine->start();
+		RMAPEngine* initiatorEngine = new RMAPEngine(rmapIF);
+		initiatorEngine->setReportErrorneousReplyPackets(false);
+		initiatorEngine->start();
+		RMAPInitiator* rmapInitiator = new RMAPInitiator(initiatorEngine);
+		rmapInitiator->setInitiatorLogicalAddress(LogicalAddress);
+		RMAPTargetNode rmapTargetNode;
+		rmapTargetNode.setTargetLogicalAddress(LogicalAddress);
+		rmapTargetNode.setDefaultKey(0x00);
+		while (!targetEngine->isStarted() || !initiatorEngine->isStarted()) {
+			Condition c;
+			c.wait(1);
+		}
+
+		//the housekeeping receiver is stalled from here
+		HousekeepingSender housekeepingSender(end2);
+		housekeepingSender.start();
+		vector<uint8_t> readData(4);
+		vector<double> latencies;
+		size_t nTimeouts = 0;
+		for (size_t i = 0; i < NRMAPTransactions; i++) {
+			double start = Time::getClockValueInMilliSec();
+			try {
+				rmapInitiator->read(&rmapTargetNode, 0, readData.size(), &readData[0], RMAPTimeoutInMilliSec);
+			} catch (RMAPInitiatorException& e) {
+				nTimeouts++;
+				if (nTimeouts == 10) { //enough to show the effect of blocking
+					break;
+				}
+				continue;
+			}
+			latencies.push_back((Time::getClockValueInMilliSec() - start) * 1000.0);
+		}
+		size_t maxOccupancyWhileStalled = housekeepingIF->getStatistics().maxQueueOccupancy;
+
+		//the housekeeping receiver wakes up (and unblocks the sender with BlockDemultiplexer)
+		vector<uint8_t> packet;
+		uint32_t firstSequenceNumber = 0;
+		housekeepingIF->setTimeoutDuration(200000);
+		size_t nDrained = 0;
+		try {
+			while (true) {
+				housekeepingIF->receive(&packet);
+				if (nDrained == 0) {
+					memcpy(&firstSequenceNumber, &packet[2], sizeof(uint32_t));
+				}
+				nDrained++;
+			}
+		} catch (SpaceWireIFException& e) {
+		}
+		housekeepingSender.waitUntilRunMethodComplets();
+		SpaceWireIFMultiplexedIFStatistics statistics = housekeepingIF->getStatistics();
+
+		sort(latencies.begin(), latencies.end());
+		double p50 = 0, p99 = 0;
+		if (latencies.size() != 0) {
+			p50 = latencies[latencies.size() / 2];
+			p99 = latencies[latencies.size() * 99 / 100];
+		}
+		cout << setw(20) << policyNames[p] << setw(12) << latencies.size() << setw(12) << nTimeouts << setw(10)
+				<< fixed << setprecision(0) << p50 << setw(10) << p99 << setw(11)
+				<< initiatorEngine->nErrorneousReplyPackets << "  dropped=" << statistics.nDroppedPackets
+				<< " blocked=" << statistics.nBlockedDeliveries << " max occupancy=" << maxOccupancyWhileStalled << "/"
+				<< statistics.queueCapacity << " first drained=#" << firstSequenceNumber << endl;
+		cout.unsetf(ios::fixed);
+
+		if (policies[p] != SpaceWireIFMultiplexedIF::BlockDemultiplexer) {
+			if (nTimeouts != 0 || statistics.nDroppedPackets == 0 || statistics.nBlockedDeliveries != 0) {
+				cerr << "The stalled receiver affected RMAP transactions." << endl;
+				failed = true;
+			}
+			if (statistics.nDroppedPackets + nDrained != NHousekeepingPackets) {
+				cerr << "Housekeeping packets were not accounted for." << endl;
+				failed = true;
+			}
+			bool keptOldest = (firstSequenceNumber == 0);
+			if (keptOldest != (policies[p] == SpaceWireIFMultiplexedIF::DropNewest)) {
+				cerr << "The wrong packets were dropped." << endl;
+				failed = true;
+			}
+		} else if (statistics.nDroppedPackets != 0 || nDrained != NHousekeepingPackets) {
+			cerr << "Housekeeping packets were lost with BlockDemultiplexer." << endl;
+			failed = true;
+		}
+
+		initiatorEngine->stop();
+		targetEngine->stop();
+		multiplexer->close();
+		end2->close();
+		delete rmapInitiator;
+		delete initiatorEngine;
+		delete targetEngine;
+		delete multiplexer;
+		delete end1;
+		delete end2;
+	}
+	if (failed) {
+		return -1;
+	}
+}
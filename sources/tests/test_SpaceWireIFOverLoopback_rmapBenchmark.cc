@@ -0,0 +1,130 @@
+/*
+ * test_SpaceWireIFOverLoopback_rmapBenchmark.cc
+ *
+ * Runs RMAPInitiator/RMAPEngine against an RMAPTarget served by another
+ * RMAPEngine in the same process. The two engines are connected by
+ * SpaceWireIFOverLoopback (real SSDTP framing over a socketpair), so that
+ * the numbers show the overhead of the library without any SpaceWire hardware.
+ * "Wire to app" is the time from the arrival of the reply packet at the
+ * SpaceWireIF (its receive timestamp) until RMAPInitiator returned.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+#include "RMAP.hh"
+
+const uint32_t MemorySize = 1024 * 1024;
+const uint32_t AccessSizes[] = { 4, 256, 4096, 65536 };
+const size_t NAccessSizes = sizeof(AccessSizes) / sizeof(uint32_t);
+const size_t DefaultNTransactions = 2000;
+
+/** Memory which is read/written via RMAP. */
+class MemoryAccessAction: public RMAPTargetAccessAction {
+public:
+	std::vector<uint8_t> memory;
+
+public:
+	MemoryAccessAction() :
+			memory(MemorySize) {
+	}
+
+public:
+	void processTransaction(RMAPTransaction* rmapTransaction) throw (RMAPTargetAccessActionException) {
+		RMAPPacket* command = rmapTransaction->commandPacket;
+		uint32_t address = command->getAddress();
+		uint32_t length = command->getLength();
+		if (command->isWrite()) {
+			command->getData(&memory[address], length);
+			setReplyWithStatus(rmapTransaction, RMAPReplyStatus::CommandExcecutedSuccessfully);
+		} else {
+			std::vector<uint8_t> data(memory.begin() + address, memory.begin() + address + length);
+			setReplyWithDataWithStatus(rmapTransaction, &data, RMAPReplyStatus::CommandExcecutedSuccessfully);
+		}
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	size_t nTransactions = DefaultNTransactions;
+	if (argc >= 2) {
+		nTransactions = String::toInteger(argv[1]);
+	}
+
+	SpaceWireIFOverLoopback* initiatorSide;
+	SpaceWireIFOverLoopback* targetSide;
+	SpaceWireIFOverLoopback::createPair(initiatorSide, targetSide);
+	initiatorSide->open();
+	targetSide->open();
+
+	//target
+	MemoryAccessAction memoryAccessAction;
+	RMAPAddressRange addressRange(0, MemorySize);
+	RMAPTarget rmapTarget;
+	rmapTarget.addAddressRangeAndAssociatedAction(&addressRange, &memoryAccessAction);
+	RMAPEngine* targetEngine = new RMAPEngine(targetSide);
+	targetEngine->addRMAPTarget(&rmapTarget);
+	targetEngine->start();
+
+	//initiator
+	RMAPEngine* initiatorEngine = new RMAPEngine(initiatorSide);
+	initiatorEngine->start();
+	RMAPInitiator* rmapInitiator = new RMAPInitiator(initiatorEngine);
+	rmapInitiator->setInitiatorLogicalAddress(0xFE);
+	RMAPTargetNode rmapTargetNode;
+	rmapTargetNode.setTargetLogicalAddress(0xFE);
+	rmapTargetNode.setDefaultKey(0x00);
+	while (!targetEngine->isStarted() || !initiatorEngine->isStarted()) {
+		Condition c;
+		c.wait(1);
+	}
+
+	cout << nTransactions << " transactions per measurement" << endl;
+	cout << setw(10) << "Access" << setw(12) << "Size" << setw(16) << "Transactions/s" << setw(12) << "MB/s" << setw(16)
+			<< "Latency [us]" << setw(20) << "Wire to app [us]" << endl;
+	vector<uint8_t> buffer(MemorySize);
+	vector<uint8_t> readBuffer(MemorySize);
+	for (size_t i = 0; i < buffer.size(); i++) {
+		buffer[i] = i * 7 + 1;
+	}
+	for (size_t i = 0; i < NAccessSizes; i++) {
+		for (int write = 1; write >= 0; write--) {
+			uint32_t size = AccessSizes[i];
+			double start = Time::getClockValueInMilliSec();
+			double wireToApplication = 0;
+			try {
+				for (size_t n = 0; n < nTransactions; n++) {
+					uint32_t address = (n * size) % (MemorySize - size);
+					if (write) {
+						rmapInitiator->write(&rmapTargetNode, address, &buffer[address], size);
+					} else {
+						rmapInitiator->read(&rmapTargetNode, address, size, &readBuffer[0]);
+						if (memcmp(&readBuffer[0], &buffer[address], size) != 0) {
+							cerr << "Read data do not match the written data." << endl;
+							return -1;
+						}
+					}
+					wireToApplication += rmapInitiator->getReplyPacketPointer()->getReceiveTimestamp().getElapsedTimeInMicroSec();
+				}
+			} catch (CxxUtilities::Exception& e) {
+				cerr << "RMAP access failed (" << e.toString() << ")" << endl;
+				return -1;
+			}
+			double elapsed = Time::getClockValueInMilliSec() - start;
+			cout << setw(10) << (write ? "write" : "read") << setw(12) << size << setw(16) << fixed << setprecision(0)
+					<< nTransactions / (elapsed / 1000.0) << setw(12) << setprecision(1)
+					<< nTransactions * size / 1024.0 / 1024.0 / (elapsed / 1000.0) << setw(16) << setprecision(1)
+					<< elapsed * 1000.0 / nTransactions << setw(20) << setprecision(2) << wireToApplication / nTransactions
+					<< endl;
+		}
+	}
+	initiatorEngine->stop();
+	targetEngine->stop();
+	initiatorSide->close();
+	targetSide->close();
+	delete rmapInitiator;
+	delete initiatorEngine;
+	delete targetEngine;
+	delete initiatorSide;
+	delete targetSide;
+}
@@ -0,0 +1,177 @@
+/*
+ * test_SpaceWireIFOverSharedMemory_benchmark.cc
+ *
+ * Compares SpaceWireIFOverSharedMemory with SpaceWireIFOverTCP connected
+ * via TCP on localhost (server mode and client mode in this process).
+ * Round-trip latency is measured with an echo thread, and throughput with
+ * a thread which sends packets as fast as possible.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+const uint32_t DefaultPortNumber = 10033;
+const char* SharedMemoryName = "/test_SpaceWireIFOverSharedMemory";
+const size_t NRoundTrips = 20000;
+const size_t RoundTripPacketSize = 64;
+const size_t BytesPerThroughputMeasurement = 256 * 1024 * 1024;
+const size_t PacketSizes[] = { 16, 1024, 65536 };
+const size_t NPacketSizes = sizeof(PacketSizes) / sizeof(size_t);
+
+/** Sends back every received packet until the link is closed. */
+class Echo: public CxxUtilities::Thread {
+private:
+	SpaceWireIF* spwif;
+
+public:
+	Echo(SpaceWireIF* spwif) :
+			spwif(spwif) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> buffer;
+		while (true) {
+			try {
+				spwif->receive(&buffer);
+				spwif->send(buffer);
+				if (buffer.size() == 1) { //end of measurement
+					return;
+				}
+			} catch (SpaceWireIFException& e) {
+				if (e.getStatus() != SpaceWireIFException::Timeout) {
+					return;
+				}
+			}
+		}
+	}
+};
+
+class PacketSender: public CxxUtilities::Thread {
+private:
+	SpaceWireIF* spwif;
+	size_t packetSize;
+	size_t nPackets;
+
+public:
+	PacketSender(SpaceWireIF* spwif, size_t packetSize, size_t nPackets) :
+			spwif(spwif), packetSize(packetSize), nPackets(nPackets) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> data(packetSize);
+		for (size_t i = 0; i < packetSize; i++) {
+			data[i] = i;
+		}
+		for (size_t i = 0; i < nPackets; i++) {
+			spwif->send(data);
+		}
+	}
+};
+
+/** Opens SpaceWireIFOverTCP in server mode (open() blocks until connected). */
+class ServerOpener: public CxxUtilities::Thread {
+private:
+	SpaceWireIFOverTCP* spwif;
+
+public:
+	ServerOpener(SpaceWireIFOverTCP* spwif) :
+			spwif(spwif) {
+	}
+
+public:
+	void run() {
+		spwif->open();
+	}
+};
+
+void measure(std::string name, SpaceWireIF* a, SpaceWireIF* b) {
+	using namespace std;
+	using namespace CxxUtilities;
+
+	//round trip
+	{
+		Echo echo(b);
+		echo.start();
+		vector<uint8_t> packet(RoundTripPacketSize), reply;
+		double start = Time::getClockValueInMilliSec();
+		for (size_t i = 0; i < NRoundTrips; i++) {
+			a->send(packet);
+			a->receive(&reply);
+		}
+		double elapsed = Time::getClockValueInMilliSec() - start;
+		packet.resize(1);
+		a->send(packet);
+		a->receive(&reply);
+		echo.waitUntilRunMethodComplets();
+		cout << setw(16) << name << setw(12) << "round trip" << setw(10) << RoundTripPacketSize << setw(14) << fixed
+				<< setprecision(2) << elapsed * 1000.0 / NRoundTrips << " us" << endl;
+	}
+
+	//throughput
+	for (size_t i = 0; i < NPacketSizes; i++) {
+		size_t nPackets = BytesPerThroughputMeasurement / PacketSizes[i];
+		if (nPackets > 2000000) {
+			nPackets = 2000000;
+		}
+		PacketSender sender(a, PacketSizes[i], nPackets);
+		uint8_t* buffer = new uint8_t[PacketSizes[i]];
+		size_t length;
+		SpaceWireEOPMarker::EOPType eopType;
+		double start = Time::getClockValueInMilliSec();
+		sender.start();
+		for (size_t n = 0; n < nPackets; n++) {
+			b->receive(buffer, eopType, PacketSizes[i], length);
+		}
+		double elapsed = Time::getClockValueInMilliSec() - start;
+		sender.waitUntilRunMethodComplets();
+		delete[] buffer;
+		cout << setw(16) << name << setw(12) << "throughput" << setw(10) << PacketSizes[i] << setw(14) << setprecision(0)
+				<< nPackets / (elapsed / 1000.0) << " packets/s" << setw(10) << setprecision(1)
+				<< nPackets * PacketSizes[i] / 1024.0 / 1024.0 / (elapsed / 1000.0) << " MB/s" << endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	uint32_t portNumber = DefaultPortNumber;
+	if (argc >= 2) {
+		portNumber = String::toInteger(argv[1]);
+	}
+
+	cout << setw(16) << "Interface" << setw(12) << "Test" << setw(10) << "Size" << setw(14) << "Result" << endl;
+
+	//shared memory
+	{
+		SpaceWireIFOverSharedMemory server(SharedMemoryName, SpaceWireIFOverSharedMemory::ServerMode);
+		SpaceWireIFOverSharedMemory client(SharedMemoryName, SpaceWireIFOverSharedMemory::ClientMode);
+		server.open();
+		client.open();
+		measure("shared memory", &client, &server);
+		client.close();
+		server.close();
+	}
+
+	//TCP on localhost
+	{
+		SpaceWireIFOverTCP server(portNumber);
+		SpaceWireIFOverTCP client("localhost", portNumber);
+		ServerOpener opener(&server);
+		opener.start();
+		while (true) {
+			try {
+				client.open();
+				break;
+			} catch (SpaceWireIFException& e) {
+				Condition c;
+				c.wait(100);
+			}
+		}
+		opener.waitUntilRunMethodComplets();
+		measure("TCP (localhost)", &client, &server);
+		client.close();
+		server.close();
+	}
+}
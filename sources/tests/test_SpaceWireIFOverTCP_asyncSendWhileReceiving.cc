@@ -0,0 +1,191 @@
+/*
+ * test_SpaceWireIFOverTCP_asyncSendWhileReceiving.cc
+ *
+ * Checks that asyncSend() of SpaceWireIFOverTCP is not delayed by a pending
+ * asyncReceive(). A server-mode instance plays the role of a bridge, and
+ * writes raw SSDTP bytes to the client: first a lone TimeCode frame, then
+ * the header and a half of a data frame. After each of them, the client
+ * sends a packet asynchronously, which the bridge must receive promptly.
+ * Finally the rest of the frame is written, and the pending receive must
+ * complete with the whole packet, and the TimeCode must have been passed
+ * to the TimeCode action.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+#include <sys/socket.h>
+
+const uint32_t DefaultPortNumber = 10036;
+const size_t PacketSize = 1000;
+const double MaximumSendLatencyInMilliSec = 100;
+const double BridgeTimeoutInMilliSec = 1000;
+
+/** Opens SpaceWireIFOverTCP in server mode (open() blocks until connected). */
+class ServerOpener: public CxxUtilities::Thread {
+private:
+	SpaceWireIFOverTCP* spwif;
+
+public:
+	ServerOpener(SpaceWireIFOverTCP* spwif) :
+			spwif(spwif) {
+	}
+
+public:
+	void run() {
+		spwif->open();
+	}
+};
+
+/** Records completed operations (invoked by the worker thread of the client). */
+class RecordingHandler: public SpaceWireIFAsyncHandler {
+public:
+	CxxUtilities::Mutex mutex;
+	size_t nSent;
+	size_t nReceived;
+	std::vector<uint8_t> receivedPacket;
+
+public:
+	RecordingHandler() :
+			nSent(0), nReceived(0) {
+	}
+
+public:
+	void onCompletion(SpaceWireIFAsyncOperation* operation) {
+		if (!operation->isCompleted()) {
+			return;
+		}
+		mutex.lock();
+		if (operation->type == SpaceWireIFAsyncOperation::Send) {
+			nSent++;
+		} else {
+			receivedPacket = *(operation->buffer);
+			nReceived++;
+		}
+		mutex.unlock();
+	}
+
+	size_t getNReceived() {
+		mutex.lock();
+		size_t n = nReceived;
+		mutex.unlock();
+		return n;
+	}
+};
+
+class TimecodeRecorder: public SpaceWireIFActionTimecodeScynchronizedAction {
+public:
+	volatile int timecode;
+
+public:
+	TimecodeRecorder() :
+			timecode(-1) {
+	}
+
+public:
+	void doAction(unsigned char timecodeValue) {
+		timecode = timecodeValue;
+	}
+};
+
+bool check(const std::string& name, bool condition) {
+	if (!condition) {
+		std::cerr << "Failed: " << name << std::endl;
+	}
+	return condition;
+}
+
+/** Sends a packet asynchronously, and returns the time until the bridge received it (negative on timeout). */
+double measureSendLatency(SpaceWireIFOverTCP* client, SpaceWireIFOverTCP* bridge, RecordingHandler* handler,
+		std::vector<uint8_t>* packet) {
+	double start = CxxUtilities::Time::getClockValueInMilliSec();
+	client->asyncSend(packet, handler);
+	std::vector<uint8_t> receivedPacket;
+	try {
+		bridge->receive(&receivedPacket);
+	} catch (SpaceWireIFException& e) {
+		return -1;
+	}
+	if (receivedPacket != *packet) {
+		return -1;
+	}
+	return CxxUtilities::Time::getClockValueInMilliSec() - start;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	typedef SpaceWireSSDTPProtocol P;
+	uint32_t portNumber = DefaultPortNumber;
+	if (argc >= 2) {
+		portNumber = String::toInteger(argv[1]);
+	}
+
+	SpaceWireIFOverTCP* bridge = new SpaceWireIFOverTCP(portNumber);
+	ServerOpener opener(bridge);
+	opener.start();
+	SpaceWireIFOverTCP* client = new SpaceWireIFOverTCP("localhost", portNumber);
+	while (true) {
+		try {
+			client->open();
+			break;
+		} catch (SpaceWireIFException& e) {
+			Condition c;
+			c.wait(100);
+		}
+	}
+	opener.waitUntilRunMethodComplets();
+	bridge->setTimeoutDuration(BridgeTimeoutInMilliSec * 1000);
+	int bridgeSocket = bridge->getSSDTPModule()->getSocketDescriptor();
+	bool ok = true;
+
+	TimecodeRecorder timecodeRecorder;
+	client->addTimecodeAction(&timecodeRecorder);
+	RecordingHandler handler;
+	client->asyncReceive(&handler);
+	vector<uint8_t> packetToBridge(16, 0xAB);
+
+	//a lone TimeCode
+	uint8_t timecodeFrame[P::ControlFrameSize];
+	SpaceWireSSDTPEncoder::encodeTimeCode(timecodeFrame, 0x01);
+	::send(bridgeSocket, timecodeFrame, sizeof(timecodeFrame), 0);
+	Condition c;
+	c.wait(20);
+	double latency = measureSendLatency(client, bridge, &handler, &packetToBridge);
+	cout << "Send after a TimeCode: " << fixed << setprecision(1) << latency << " ms" << endl;
+	ok &= check("send after a TimeCode", 0 <= latency && latency < MaximumSendLatencyInMilliSec);
+
+	//a partially arrived data frame
+	vector<uint8_t> packet(PacketSize);
+	for (size_t i = 0; i < PacketSize; i++) {
+		packet[i] = i;
+	}
+	vector<uint8_t> frame(P::HeaderSize);
+	SpaceWireSSDTPEncoder::encodeHeader(&frame[0], P::DataFlag_Complete_EOP, packet.size());
+	frame.insert(frame.end(), packet.begin(), packet.end());
+	size_t firstPartSize = P::HeaderSize + PacketSize / 2;
+	::send(bridgeSocket, &frame[0], firstPartSize, 0);
+	c.wait(20);
+	latency = measureSendLatency(client, bridge, &handler, &packetToBridge);
+	cout << "Send after a partial frame: " << latency << " ms" << endl;
+	ok &= check("send after a partial frame", 0 <= latency && latency < MaximumSendLatencyInMilliSec);
+	ok &= check("receive pending until the frame completes", handler.getNReceived() == 0);
+
+	//the rest of the frame completes the pending receive
+	::send(bridgeSocket, &frame[firstPartSize], frame.size() - firstPartSize, 0);
+	double start = Time::getClockValueInMilliSec();
+	while (handler.getNReceived() == 0 && Time::getClockValueInMilliSec() - start < BridgeTimeoutInMilliSec) {
+		c.wait(1);
+	}
+	ok &= check("received packet", handler.getNReceived() == 1 && handler.receivedPacket == packet);
+	ok &= check("TimeCode", timecodeRecorder.timecode == 0x01);
+
+	client->cancelAsyncOperations();
+	client->close();
+	bridge->close();
+	delete client;
+	delete bridge;
+	if (!ok) {
+		return -1;
+	}
+}
@@ -0,0 +1,113 @@
+/*
+ * test_SpaceWireIFOverTCP_reconnect.cc
+ *
+ * Checks AutoReconnect mode of SpaceWireIFOverTCP on localhost.
+ * A server-mode instance plays the role of a SpaceWire-to-GigabitEther
+ * bridge. It is closed and re-created after a while, and the client
+ * is expected to reconnect by itself and to deliver the packets sent
+ * during the outage in order. Reconnect statistics are printed at the end.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+const uint32_t DefaultPortNumber = 10034;
+const size_t NPacketsDuringOutage = 100;
+const double OutageInMilliSec = 500;
+
+/** Opens SpaceWireIFOverTCP in server mode (open() blocks until connected). */
+class ServerOpener: public CxxUtilities::Thread {
+private:
+	SpaceWireIFOverTCP* spwif;
+
+public:
+	ServerOpener(SpaceWireIFOverTCP* spwif) :
+			spwif(spwif) {
+	}
+
+public:
+	void run() {
+		spwif->open();
+	}
+};
+
+class LinkStateAction: public SpaceWireIFActionLinkStateAction {
+public:
+	void linkLost(SpaceWireIF* spwif) {
+		std::cout << "Link lost" << std::endl;
+	}
+
+	void linkRestored(SpaceWireIF* spwif) {
+		std::cout << "Link restored" << std::endl;
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	uint32_t portNumber = DefaultPortNumber;
+	if (argc >= 2) {
+		portNumber = String::toInteger(argv[1]);
+	}
+
+	SpaceWireIFOverTCP client("localhost", portNumber);
+	client.setReconnectMode(SpaceWireIFOverTCP::AutoReconnect);
+	client.setReconnectInterval(20, 200);
+	LinkStateAction linkStateAction;
+	client.addLinkStateAction(&linkStateAction);
+
+	//first connection
+	SpaceWireIFOverTCP* bridge = new SpaceWireIFOverTCP(portNumber);
+	ServerOpener opener(bridge);
+	opener.start();
+	while (true) {
+		try {
+			client.open();
+			break;
+		} catch (SpaceWireIFException& e) {
+			Condition c;
+			c.wait(100);
+		}
+	}
+	opener.waitUntilRunMethodComplets();
+	client.setTimeoutDuration(50000);
+
+	//the bridge goes away
+	bridge->close();
+	delete bridge;
+	vector<uint8_t> packet(16);
+	vector<uint8_t> receivedPacket;
+	try {
+		client.receive(&receivedPacket);
+	} catch (SpaceWireIFException& e) {
+		cout << "receive() during the outage: " << e.toString() << endl;
+	}
+	for (size_t i = 0; i < NPacketsDuringOutage; i++) {
+		packet[0] = i;
+		client.send(&packet[0], packet.size());
+	}
+	Condition c;
+	c.wait(OutageInMilliSec);
+
+	//the bridge comes back
+	bridge = new SpaceWireIFOverTCP(portNumber);
+	bridge->open();
+	bridge->setTimeoutDuration(2000000);
+	for (size_t i = 0; i < NPacketsDuringOutage; i++) {
+		bridge->receive(&receivedPacket);
+		if (receivedPacket.size() != packet.size() || receivedPacket[0] != (uint8_t) i) {
+			cerr << "Packets queued during the outage were not delivered in order." << endl;
+			return -1;
+		}
+	}
+	cout << NPacketsDuringOutage << " packets queued during the outage were delivered in order" << endl;
+
+	SpaceWireIFOverTCPReconnectStatistics statistics = client.getReconnectStatistics();
+	cout << statistics.toString() << endl;
+	client.close();
+	bridge->close();
+	delete bridge;
+	if (statistics.nReconnections != 1) {
+		return -1;
+	}
+}
@@ -0,0 +1,122 @@
+/*
+ * test_SpaceWireLockFreeQueue.cc
+ *
+ * Pushes and pops SpaceWireLockFreeQueue concurrently from several producer
+ * and consumer threads through a small queue, so that push() and pop() often
+ * find the queue full or empty. Every element must be popped exactly once,
+ * and the elements of each producer must be seen by each consumer in the order
+ * they were pushed. The throughput is printed.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+#include <sched.h>
+
+const size_t NProducers = 4;
+const size_t NConsumers = 4;
+const size_t NElementsPerProducer = 250000;
+const size_t QueueCapacity = 64;
+
+typedef SpaceWireLockFreeQueue<uint64_t> Queue;
+
+class Producer: public CxxUtilities::Thread {
+private:
+	Queue* queue;
+	uint64_t producerIndex;
+
+public:
+	Producer(Queue* queue, uint64_t producerIndex) :
+			queue(queue), producerIndex(producerIndex) {
+	}
+
+public:
+	void run() {
+		for (uint64_t i = 0; i < NElementsPerProducer; i++) {
+			while (!queue->push((producerIndex << 32) | i)) {
+				sched_yield();
+			}
+		}
+	}
+};
+
+class Consumer: public CxxUtilities::Thread {
+private:
+	Queue* queue;
+	volatile size_t* nPopped;
+	std::vector<size_t>* popCounts;
+
+public:
+	size_t nOrderErrors;
+
+public:
+	Consumer(Queue* queue, volatile size_t* nPopped, std::vector<size_t>* popCounts) :
+			queue(queue), nPopped(nPopped), popCounts(popCounts), nOrderErrors(0) {
+	}
+
+public:
+	void run() {
+		std::vector<int64_t> lastIndex(NProducers, -1);
+		uint64_t element;
+		while (*nPopped < NProducers * NElementsPerProducer) {
+			if (!queue->pop(element)) {
+				sched_yield();
+				continue;
+			}
+			__sync_fetch_and_add(nPopped, 1);
+			size_t producerIndex = element >> 32;
+			int64_t index = element & 0xFFFFFFFF;
+			if (NProducers <= producerIndex || index <= lastIndex[producerIndex]) {
+				nOrderErrors++;
+				continue;
+			}
+			lastIndex[producerIndex] = index;
+			__sync_fetch_and_add(&(*popCounts)[producerIndex * NElementsPerProducer + index], 1);
+		}
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	Queue queue(QueueCapacity);
+	volatile size_t nPopped = 0;
+	vector<size_t> popCounts(NProducers * NElementsPerProducer, 0);
+	vector<Producer*> producers;
+	vector<Consumer*> consumers;
+	double start = CxxUtilities::Time::getClockValueInMilliSec();
+	for (size_t i = 0; i < NConsumers; i++) {
+		consumers.push_back(new Consumer(&queue, &nPopped, &popCounts));
+		consumers.back()->start();
+	}
+	for (size_t i = 0; i < NProducers; i++) {
+		producers.push_back(new Producer(&queue, i));
+		producers.back()->start();
+	}
+	size_t nOrderErrors = 0;
+	for (size_t i = 0; i < NProducers; i++) {
+		producers[i]->waitUntilRunMethodComplets();
+		delete producers[i];
+	}
+	for (size_t i = 0; i < NConsumers; i++) {
+		consumers[i]->waitUntilRunMethodComplets();
+		nOrderErrors += consumers[i]->nOrderErrors;
+		delete consumers[i];
+	}
+	double elapsed = CxxUtilities::Time::getClockValueInMilliSec() - start;
+	size_t nMissing = 0, nDuplicated = 0;
+	for (size_t i = 0; i < popCounts.size(); i++) {
+		if (popCounts[i] == 0) {
+			nMissing++;
+		} else if (1 < popCounts[i]) {
+			nDuplicated++;
+		}
+	}
+	cout << NProducers << " producers, " << NConsumers << " consumers, capacity " << queue.getCapacity() << ": "
+			<< nPopped << " elements in " << fixed << setprecision(1) << elapsed << " ms ("
+			<< nPopped / (elapsed / 1000.0) / 1e6 << " M elements/s)" << endl;
+	cout << "missing=" << nMissing << " duplicated=" << nDuplicated << " out of order=" << nOrderErrors
+			<< " left in queue=" << queue.size() << endl;
+	if (nMissing != 0 || nDuplicated != 0 || nOrderErrors != 0 || !queue.empty()) {
+		return -1;
+	}
+}
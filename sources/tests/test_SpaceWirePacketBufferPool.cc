@@ -0,0 +1,123 @@
+/*
+ * test_SpaceWirePacketBufferPool.cc
+ *
+ * Checks the counters of SpaceWirePacketBufferPool. A fixed sequence of
+ * lease(), returnBuffer() and discard() calls is compared with the expected
+ * hits, misses, outstanding buffers and high-water mark, including buffers
+ * which are freed because they are too large or the pool is full.
+ * Then several threads lease, return and discard buffers concurrently, and
+ * the counters must balance when they have finished.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+const size_t MaximumPooledBuffers = 4;
+const size_t MaximumRetainedCapacity = 1024;
+const size_t NThreads = 4;
+const size_t NLeasesPerThread = 100000;
+const size_t NBuffersHeldPerThread = 3;
+
+bool check(const std::string& name, size_t value, size_t expected) {
+	if (value != expected) {
+		std::cerr << "Failed: " << name << " = " << value << " (expected " << expected << ")" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/** Leases a few buffers at a time and gives them back, every third one via discard(). */
+class Worker: public CxxUtilities::Thread {
+private:
+	SpaceWirePacketBufferPool* pool;
+
+public:
+	Worker(SpaceWirePacketBufferPool* pool) :
+			pool(pool) {
+	}
+
+public:
+	void run() {
+		std::vector<std::vector<uint8_t>*> buffers;
+		for (size_t i = 0; i < NLeasesPerThread; i++) {
+			std::vector<uint8_t>* buffer = pool->lease();
+			buffer->resize(i % (MaximumRetainedCapacity * 2));
+			buffers.push_back(buffer);
+			if (buffers.size() == NBuffersHeldPerThread) {
+				for (size_t o = 0; o < buffers.size(); o++) {
+					if ((i + o) % 3 == 0) {
+						pool->discard(buffers[o]);
+					} else {
+						pool->returnBuffer(buffers[o]);
+					}
+				}
+				buffers.clear();
+			}
+		}
+		for (size_t o = 0; o < buffers.size(); o++) {
+			pool->returnBuffer(buffers[o]);
+		}
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	bool ok = true;
+
+	//fixed sequence
+	SpaceWirePacketBufferPool pool(MaximumPooledBuffers, MaximumRetainedCapacity);
+	vector<vector<uint8_t>*> buffers;
+	for (size_t i = 0; i < 6; i++) {
+		buffers.push_back(pool.lease());
+	}
+	ok &= check("misses after 6 leases", pool.getNMisses(), 6);
+	ok &= check("outstanding after 6 leases", pool.getNOutstandingBuffers(), 6);
+	//a too large buffer is freed, and a full pool frees the last one
+	buffers[0]->resize(MaximumRetainedCapacity + 1);
+	for (size_t i = 0; i < 6; i++) {
+		pool.returnBuffer(buffers[i]);
+	}
+	buffers.clear();
+	ok &= check("pooled after returning 6", pool.getNPooledBuffers(), MaximumPooledBuffers);
+	ok &= check("outstanding after returning 6", pool.getNOutstandingBuffers(), 0);
+	for (size_t i = 0; i < 5; i++) {
+		buffers.push_back(pool.lease());
+	}
+	ok &= check("hits", pool.getNHits(), 4);
+	ok &= check("misses", pool.getNMisses(), 7);
+	pool.discard(buffers[0]);
+	pool.discard(buffers[1]);
+	ok &= check("outstanding after discard", pool.getNOutstandingBuffers(), 3);
+	ok &= check("pooled after discard", pool.getNPooledBuffers(), 0);
+	ok &= check("high-water mark", pool.getNOutstandingBuffersHighWaterMark(), 6);
+	pool.resetCounters();
+	ok &= check("high-water mark after reset", pool.getNOutstandingBuffersHighWaterMark(), 3);
+	for (size_t i = 2; i < 5; i++) {
+		pool.returnBuffer(buffers[i]);
+	}
+	buffers.clear();
+	ok &= check("outstanding at the end", pool.getNOutstandingBuffers(), 0);
+	ok &= check("hits after reset", pool.getNHits(), 0);
+	cout << "Sequence: " << pool.toString() << endl;
+
+	//concurrent use
+	SpaceWirePacketBufferPool sharedPool(MaximumPooledBuffers, MaximumRetainedCapacity);
+	vector<Worker*> workers;
+	for (size_t i = 0; i < NThreads; i++) {
+		workers.push_back(new Worker(&sharedPool));
+		workers.back()->start();
+	}
+	for (size_t i = 0; i < NThreads; i++) {
+		workers[i]->waitUntilRunMethodComplets();
+		delete workers[i];
+	}
+	cout << "Concurrent: " << sharedPool.toString() << endl;
+	ok &= check("leases", sharedPool.getNHits() + sharedPool.getNMisses(), NThreads * NLeasesPerThread);
+	ok &= check("outstanding after concurrent use", sharedPool.getNOutstandingBuffers(), 0);
+	ok &= (sharedPool.getNOutstandingBuffersHighWaterMark() <= NThreads * NBuffersHeldPerThread);
+	ok &= (sharedPool.getNPooledBuffers() <= MaximumPooledBuffers && sharedPool.getNHits() != 0);
+
+	if (!ok) {
+		return -1;
+	}
+}
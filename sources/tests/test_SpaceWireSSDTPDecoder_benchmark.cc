@@ -0,0 +1,100 @@
+/*
+ * test_SpaceWireSSDTPDecoder_benchmark.cc
+ *
+ * Measures the framing cost of SSDTP in isolation. A byte stream is
+ * built in memory with SpaceWireSSDTPEncoder (data packets with a TimeCode
+ * after every 100 packets), and is decoded repeatedly by SpaceWireSSDTPDecoder
+ * in slices of various sizes, without any socket involved.
+ * The listener does not touch payload bytes (the decoder passes them
+ * by pointer), so that the numbers reflect the framing cost only.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+const size_t StreamSize = 64 * 1024 * 1024;
+const size_t NRepetitions = 8;
+const size_t PacketSizes[] = { 16, 256, 4096, 65536 };
+const size_t NPacketSizes = sizeof(PacketSizes) / sizeof(size_t);
+const size_t SliceSizes[] = { 1, 1500, 64 * 1024 };
+const size_t NSliceSizes = sizeof(SliceSizes) / sizeof(size_t);
+
+class CountingListener: public SpaceWireSSDTPDecoderListener {
+public:
+	size_t nPackets;
+	size_t nBytes;
+	size_t nTimeCodes;
+
+public:
+	CountingListener() {
+		nPackets = 0;
+		nBytes = 0;
+		nTimeCodes = 0;
+	}
+
+public:
+	void onData(uint8_t* data, size_t length) {
+		nBytes += length;
+	}
+
+	void onPacketEnd(uint32_t eopType) {
+		nPackets++;
+	}
+
+	void onTimeCode(uint8_t flag, uint8_t timecode) {
+		nTimeCodes++;
+	}
+};
+
+/** Fills a stream with packets of the given size and returns the number of packets. */
+size_t buildStream(std::vector<uint8_t>& stream, size_t packetSize) {
+	stream.clear();
+	stream.reserve(StreamSize + packetSize + 64);
+	size_t nPackets = 0;
+	while (stream.size() < StreamSize) {
+		size_t offset = stream.size();
+		stream.resize(offset + SpaceWireSSDTPProtocol::HeaderSize + packetSize);
+		SpaceWireSSDTPEncoder::encodeDataHeader(&stream[offset], packetSize);
+		for (size_t i = 0; i < packetSize; i++) {
+			stream[offset + SpaceWireSSDTPProtocol::HeaderSize + i] = i;
+		}
+		nPackets++;
+		if (nPackets % 100 == 0) {
+			offset = stream.size();
+			stream.resize(offset + SpaceWireSSDTPProtocol::ControlFrameSize);
+			SpaceWireSSDTPEncoder::encodeTimeCode(&stream[offset], nPackets / 100 % 64);
+		}
+	}
+	return nPackets;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	std::vector<uint8_t> stream;
+	cout << setw(12) << "PacketSize" << setw(12) << "SliceSize" << setw(12) << "MB/s" << setw(16) << "Packets/s" << endl;
+	for (size_t i = 0; i < NPacketSizes; i++) {
+		size_t nPackets = buildStream(stream, PacketSizes[i]);
+		for (size_t j = 0; j < NSliceSizes; j++) {
+			size_t sliceSize = SliceSizes[j];
+			size_t repetitions = (sliceSize == 1) ? 1 : NRepetitions;
+			CountingListener listener;
+			SpaceWireSSDTPDecoder decoder(&listener);
+			double start = Time::getClockValueInMilliSec();
+			for (size_t r = 0; r < repetitions; r++) {
+				for (size_t offset = 0; offset < stream.size(); offset += sliceSize) {
+					size_t length = (stream.size() - offset < sliceSize) ? stream.size() - offset : sliceSize;
+					decoder.decode(&stream[offset], length);
+				}
+			}
+			double elapsed = Time::getClockValueInMilliSec() - start;
+			if (decoder.hasError() || listener.nPackets != nPackets * repetitions) {
+				cerr << "Decoding failed (error=" << decoder.getError() << ", packets=" << listener.nPackets << ")" << endl;
+				return -1;
+			}
+			cout << setw(12) << PacketSizes[i] << setw(12) << sliceSize << setw(12) << fixed << setprecision(1)
+					<< stream.size() * repetitions / 1024.0 / 1024.0 / (elapsed / 1000.0) << setw(16) << setprecision(0)
+					<< listener.nPackets / (elapsed / 1000.0) << endl;
+		}
+	}
+}
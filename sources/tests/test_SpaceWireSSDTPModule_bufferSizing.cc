@@ -0,0 +1,154 @@
+/*
+ * test_SpaceWireSSDTPModule_bufferSizing.cc
+ *
+ * Checks that the buffers of SpaceWireSSDTPModule are allocated lazily and
+ * grow to the largest frame seen, and that modules which share a
+ * SpaceWireSSDTPBufferPool reuse the slabs released by each other.
+ * Packets of mixed sizes are sent over socketpairs, and buffer sizes and
+ * pool statistics are printed and compared with the expected values after
+ * each packet. Finally, a size above the largest size class of the pool must
+ * fail with std::bad_alloc without changing the statistics.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+#include <sys/socket.h>
+
+const size_t PacketSizes[] = { 100, 3000, 5000, 20000, 64, 70000, 10 };
+const size_t NPacketSizes = sizeof(PacketSizes) / sizeof(size_t);
+
+/** Returns the capacity which a buffer reaches after holding size bytes. */
+size_t getExpectedCapacity(size_t size) {
+	size_t capacity = SpaceWireSSDTPBuffer::InitialSize;
+	while (capacity < size) {
+		capacity *= 2;
+	}
+	return capacity;
+}
+
+class ModulePair {
+public:
+	int sockets[2];
+	SpaceWireSSDTPModule* sender;
+	SpaceWireSSDTPModule* receiver;
+
+public:
+	ModulePair(SpaceWireSSDTPBufferPool* pool) {
+		::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+		sender = new SpaceWireSSDTPModule(sockets[0], pool);
+		receiver = new SpaceWireSSDTPModule(sockets[1], pool);
+		receiver->setReceiveMode(SpaceWireSSDTPModule::CopyViaReceiveBuffer);
+	}
+
+	~ModulePair() {
+		delete sender;
+		delete receiver;
+		::close(sockets[0]);
+		::close(sockets[1]);
+	}
+
+public:
+	/** Sends a packet and receives it, and returns false if the content differs. */
+	bool transfer(size_t size) {
+		std::vector<uint8_t> packet(size), receivedPacket;
+		for (size_t i = 0; i < size; i++) {
+			packet[i] = i;
+		}
+		uint32_t eopType;
+		sender->send(&packet);
+		receiver->receive(&receivedPacket, eopType);
+		return receivedPacket == packet;
+	}
+};
+
+bool check(const std::string& name, size_t value, size_t expected) {
+	if (value != expected) {
+		std::cerr << name << " is " << value << " (expected " << expected << ")" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	bool ok = true;
+
+	//lazy allocation and growth without a pool
+	ModulePair pair(NULL);
+	ok &= check("initial buffer size", pair.sender->getBufferSize() + pair.receiver->getBufferSize(), 0);
+	cout << setw(12) << "PacketSize" << setw(14) << "ReceiverBuf" << setw(14) << "HighWater" << endl;
+	size_t largestPacketSize = 0;
+	for (size_t i = 0; i < NPacketSizes; i++) {
+		ok &= pair.transfer(PacketSizes[i]);
+		largestPacketSize = max(largestPacketSize, PacketSizes[i]);
+		cout << setw(12) << PacketSizes[i] << setw(14) << pair.receiver->getBufferSize() << setw(14)
+				<< pair.receiver->getBufferHighWaterMark() << endl;
+		ok &= check("receiver buffer size", pair.receiver->getBufferSize(), getExpectedCapacity(largestPacketSize));
+		ok &= check("receiver high-water mark", pair.receiver->getBufferHighWaterMark(),
+				getExpectedCapacity(largestPacketSize));
+	}
+	//payload is sent with gather writes, and only control frames use the send buffer
+	ok &= check("sender buffer size", pair.sender->getBufferSize(), 0);
+	pair.sender->sendTimeCode(0x01);
+	ok &= check("sender buffer size after a TimeCode", pair.sender->getBufferSize(), SpaceWireSSDTPBuffer::InitialSize);
+
+	//two receivers which share a pool
+	SpaceWireSSDTPBufferPool pool;
+	ModulePair* first = new ModulePair(&pool);
+	ModulePair* second = new ModulePair(&pool);
+	cout << setw(12) << "PacketSize" << setw(10) << "Hits" << setw(10) << "Misses" << setw(12) << "InUse" << setw(12)
+			<< "InUseHWM" << setw(12) << "Allocated" << endl;
+	ModulePair* pairs[] = { first, second };
+	for (size_t p = 0; p < 2; p++) {
+		for (size_t i = 0; i < NPacketSizes; i++) {
+			ok &= pairs[p]->transfer(PacketSizes[i]);
+			cout << setw(12) << PacketSizes[i] << setw(10) << pool.getNHits() << setw(10) << pool.getNMisses() << setw(12)
+					<< pool.getNBytesInUse() << setw(12) << pool.getNBytesInUseHighWaterMark() << setw(12)
+					<< pool.getNBytesAllocated() << endl;
+			ok &= check("bytes in use", pool.getNBytesInUse(),
+					first->receiver->getBufferSize() + second->receiver->getBufferSize());
+		}
+	}
+	//the first receiver missed for each size class, and the second one reused the slabs released
+	//by it except for the largest one, which the first receiver still holds; in-use bytes peaked
+	//when the second receiver grew to the largest size class before releasing its previous slab
+	size_t nSizeClasses = 0;
+	size_t lastCapacity = 0;
+	size_t previousCapacity = 0;
+	size_t largestPacketSizeSoFar = 0;
+	size_t releasedSize = 0;
+	for (size_t i = 0; i < NPacketSizes; i++) {
+		largestPacketSizeSoFar = max(largestPacketSizeSoFar, PacketSizes[i]);
+		size_t capacity = getExpectedCapacity(largestPacketSizeSoFar);
+		if (capacity != lastCapacity) {
+			releasedSize += lastCapacity;
+			previousCapacity = lastCapacity;
+			nSizeClasses++;
+			lastCapacity = capacity;
+		}
+	}
+	ok &= check("hits", pool.getNHits(), nSizeClasses - 1);
+	ok &= check("misses", pool.getNMisses(), nSizeClasses + 1);
+	ok &= check("bytes allocated", pool.getNBytesAllocated(), 2 * lastCapacity + releasedSize);
+	ok &= check("in-use high-water mark", pool.getNBytesInUseHighWaterMark(), 2 * lastCapacity + previousCapacity);
+	delete first;
+	delete second;
+	ok &= check("bytes in use after deletion", pool.getNBytesInUse(), 0);
+	pool.trim();
+	ok &= check("bytes allocated after trim()", pool.getNBytesAllocated(), 0);
+
+	//a size which no size class can hold
+	bool rejected = false;
+	try {
+		size_t capacity;
+		pool.allocate((size_t) -1, capacity);
+	} catch (std::bad_alloc& e) {
+		rejected = true;
+	}
+	ok &= check("oversized allocation rejected", rejected, true);
+	ok &= check("bytes in use after an oversized allocation", pool.getNBytesInUse(), 0);
+	if (!ok) {
+		return -1;
+	}
+}
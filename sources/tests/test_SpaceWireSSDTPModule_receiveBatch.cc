@@ -0,0 +1,222 @@
+/*
+ * test_SpaceWireSSDTPModule_receiveBatch.cc
+ *
+ * Checks SpaceWireSSDTPModule::receiveBatch() over a socketpair, with
+ * read-ahead receive disabled and enabled. A burst of packets terminated with
+ * EOP and EEP (one of them made of two frames, with a TimeCode in between)
+ * is followed by a frame which has arrived only partially. The batch must
+ * return the complete packets with their EOP markers well before the receive
+ * timeout, without waiting for the partial frame. The rest of that frame is
+ * written later, and must be returned by the next call.
+ * Finally, frames which claim packets larger than BufferSize are sent between
+ * small packets. receive() and receiveBatch() must throw DataSizeTooLarge
+ * for them, and must then return the following small packets.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+#include <sys/socket.h>
+
+const double ReceiveTimeoutInMilliSec = 100;
+const double DelayOfRestInMilliSec = 300;
+const size_t MaxPackets = 16;
+const size_t PartialPacketSize = 200;
+
+typedef SpaceWireSSDTPProtocol P;
+
+std::vector<uint8_t> createPacket(size_t size, uint8_t firstByte) {
+	std::vector<uint8_t> packet(size);
+	for (size_t i = 0; i < size; i++) {
+		packet[i] = firstByte + i;
+	}
+	return packet;
+}
+
+void appendFrame(std::vector<uint8_t>& stream, uint8_t flag, const std::vector<uint8_t>& payload) {
+	size_t offset = stream.size();
+	stream.resize(offset + P::HeaderSize);
+	SpaceWireSSDTPEncoder::encodeHeader(&stream[offset], flag, payload.size());
+	stream.insert(stream.end(), payload.begin(), payload.end());
+}
+
+/** Writes the rest of the partial frame after a delay. */
+class DelayedWriter: public CxxUtilities::Thread {
+private:
+	int socketDescriptor;
+	std::vector<uint8_t> bytes;
+	double delayInMilliSec;
+
+public:
+	DelayedWriter(int socketDescriptor, const std::vector<uint8_t>& bytes, double delayInMilliSec =
+			DelayOfRestInMilliSec) :
+			socketDescriptor(socketDescriptor), bytes(bytes), delayInMilliSec(delayInMilliSec) {
+	}
+
+public:
+	void run() {
+		if (delayInMilliSec != 0) {
+			sleep(delayInMilliSec);
+		}
+		size_t offset = 0;
+		while (offset < bytes.size()) {
+			ssize_t result = ::send(socketDescriptor, &bytes[offset], bytes.size() - offset, 0);
+			if (result <= 0) {
+				return;
+			}
+			offset += result;
+		}
+	}
+};
+
+/** Receives a packet with receive() or receiveBatch(), retrying on Timeout, and returns the
+ * status of SpaceWireSSDTPException (-1 if a packet was received).
+ */
+int receiveOne(SpaceWireSSDTPModule* ssdtp, bool batch, std::vector<uint8_t>& packet) {
+	std::vector<std::vector<uint8_t> > packets;
+	std::vector<SpaceWireEOPMarker::EOPType> eopTypes;
+	uint32_t eopType;
+	while (true) {
+		try {
+			if (batch) {
+				ssdtp->receiveBatch(packets, eopTypes, 1);
+				packet = packets[0];
+			} else {
+				ssdtp->receive(&packet, eopType);
+			}
+			return -1;
+		} catch (SpaceWireSSDTPException& e) {
+			if (e.getStatus() != SpaceWireSSDTPException::Timeout) {
+				return e.getStatus();
+			}
+		}
+	}
+}
+
+bool check(const std::string& name, bool condition) {
+	if (!condition) {
+		std::cerr << "Failed: " << name << std::endl;
+	}
+	return condition;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	int sockets[2];
+	::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+	SpaceWireSSDTPModule* ssdtp = new SpaceWireSSDTPModule(sockets[0]);
+	ssdtp->setTimeout(ReceiveTimeoutInMilliSec);
+	bool ok = true;
+	for (int readAhead = 0; readAhead < 2; readAhead++) {
+		if (readAhead) {
+			ssdtp->enableReadAhead();
+		}
+		//expected packets
+		vector<vector<uint8_t> > expectedPackets;
+		vector<SpaceWireEOPMarker::EOPType> expectedEOPTypes;
+		vector<uint8_t> stream;
+		vector<uint8_t> packet = createPacket(100, 0x00);
+		appendFrame(stream, P::DataFlag_Complete_EOP, packet);
+		expectedPackets.push_back(packet);
+		expectedEOPTypes.push_back(SpaceWireEOPMarker::EOP);
+		packet = createPacket(50, 0x10);
+		appendFrame(stream, P::DataFlag_Complete_EEP, packet);
+		expectedPackets.push_back(packet);
+		expectedEOPTypes.push_back(SpaceWireEOPMarker::EEP);
+		packet = createPacket(70, 0x20);
+		appendFrame(stream, P::DataFlag_Flagmented, vector<uint8_t>(packet.begin(), packet.begin() + 30));
+		size_t offset = stream.size();
+		stream.resize(offset + P::ControlFrameSize);
+		SpaceWireSSDTPEncoder::encodeTimeCode(&stream[offset], 0x05);
+		appendFrame(stream, P::DataFlag_Complete_EOP, vector<uint8_t>(packet.begin() + 30, packet.end()));
+		expectedPackets.push_back(packet);
+		expectedEOPTypes.push_back(SpaceWireEOPMarker::EOP);
+		packet = createPacket(16, 0x30);
+		appendFrame(stream, P::DataFlag_Complete_EEP, packet);
+		expectedPackets.push_back(packet);
+		expectedEOPTypes.push_back(SpaceWireEOPMarker::EEP);
+		//a trailing frame of which only the header and a half of the payload have arrived
+		vector<uint8_t> partialPacket = createPacket(PartialPacketSize, 0x40);
+		appendFrame(stream, P::DataFlag_Complete_EOP, partialPacket);
+		size_t restSize = PartialPacketSize / 2;
+		vector<uint8_t> rest(stream.end() - restSize, stream.end());
+		stream.resize(stream.size() - restSize);
+		::send(sockets[1], &stream[0], stream.size(), 0);
+
+		vector<vector<uint8_t> > packets;
+		vector<SpaceWireEOPMarker::EOPType> eopTypes;
+		DelayedWriter delayedWriter(sockets[1], rest);
+		delayedWriter.start();
+		double start = Time::getClockValueInMilliSec();
+		size_t nPackets = ssdtp->receiveBatch(packets, eopTypes, MaxPackets);
+		double elapsed = Time::getClockValueInMilliSec() - start;
+		cout << "Read-ahead " << (readAhead ? "on" : "off") << ": " << nPackets << " packets in " << fixed
+				<< setprecision(1) << elapsed << " ms";
+		bool batchOK = (nPackets == expectedPackets.size() && elapsed < ReceiveTimeoutInMilliSec / 2);
+		for (size_t i = 0; batchOK && i < nPackets; i++) {
+			batchOK = (packets[i] == expectedPackets[i] && eopTypes[i] == expectedEOPTypes[i]);
+		}
+		ok &= check("batch of complete packets", batchOK);
+		ok &= check("TimeCode in the batch", ssdtp->getTimeCode() == 0x05);
+
+		//the partial frame is completed by the delayed writer
+		start = Time::getClockValueInMilliSec();
+		nPackets = 0;
+		while (nPackets == 0) {
+			try {
+				nPackets = ssdtp->receiveBatch(packets, eopTypes, MaxPackets);
+			} catch (SpaceWireSSDTPException& e) {
+				if (e.getStatus() != SpaceWireSSDTPException::Timeout) {
+					throw;
+				}
+			}
+		}
+		elapsed = Time::getClockValueInMilliSec() - start;
+		delayedWriter.waitUntilRunMethodComplets();
+		cout << ", then " << nPackets << " packet after " << elapsed << " ms" << endl;
+		ok &= check("completed partial frame", nPackets == 1 && packets[0] == partialPacket
+				&& eopTypes[0] == SpaceWireEOPMarker::EOP);
+
+		//nothing available
+		start = Time::getClockValueInMilliSec();
+		bool timedOut = false;
+		try {
+			ssdtp->receiveBatch(packets, eopTypes, MaxPackets);
+		} catch (SpaceWireSSDTPException& e) {
+			timedOut = (e.getStatus() == SpaceWireSSDTPException::Timeout);
+		}
+		elapsed = Time::getClockValueInMilliSec() - start;
+		ok &= check("timeout", timedOut && elapsed < ReceiveTimeoutInMilliSec * 3);
+	}
+
+	//packets larger than BufferSize
+	vector<uint8_t> stream;
+	vector<uint8_t> oversizedPacket(SpaceWireSSDTPModule::BufferSize + 1);
+	vector<vector<uint8_t> > smallPackets;
+	for (int batch = 0; batch < 2; batch++) {
+		appendFrame(stream, P::DataFlag_Complete_EOP, oversizedPacket);
+		smallPackets.push_back(createPacket(16, 0x50 + batch));
+		appendFrame(stream, P::DataFlag_Complete_EOP, smallPackets.back());
+	}
+	DelayedWriter oversizedWriter(sockets[1], stream, 0);
+	oversizedWriter.start();
+	for (int batch = 0; batch < 2; batch++) {
+		vector<uint8_t> packet;
+		int status = receiveOne(ssdtp, batch, packet);
+		ok &= check(batch ? "oversized packet (receiveBatch)" : "oversized packet (receive)",
+				status == SpaceWireSSDTPException::DataSizeTooLarge);
+		status = receiveOne(ssdtp, batch, packet);
+		ok &= check(batch ? "packet after an oversized one (receiveBatch)" : "packet after an oversized one (receive)",
+				status == -1 && packet == smallPackets[batch]);
+	}
+	oversizedWriter.waitUntilRunMethodComplets();
+	cout << "Oversized packets: " << (ok ? "rejected" : "not rejected") << endl;
+
+	delete ssdtp;
+	::close(sockets[0]);
+	::close(sockets[1]);
+	if (!ok) {
+		return -1;
+	}
+}
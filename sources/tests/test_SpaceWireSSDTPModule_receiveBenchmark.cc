@@ -0,0 +1,123 @@
+/*
+ * test_SpaceWireSSDTPModule_receiveBenchmark.cc
+ *
+ * Compares receive throughput of SpaceWireSSDTPModule when packets are
+ * copied via the internal receive buffer and when they are received
+ * directly into caller-owned memory, with read-ahead receive disabled and
+ * enabled. The number of recv() system calls per packet is printed for each
+ * measurement. Both ends run in this process and are connected via a TCP
+ * connection on localhost.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+const uint32_t DefaultPortNumber = 10031;
+const size_t BytesPerMeasurement = 512 * 1024 * 1024;
+const size_t PacketSizes[] = { 1024, 64 * 1024, 4 * 1024 * 1024 };
+const size_t NPacketSizes = sizeof(PacketSizes) / sizeof(size_t);
+
+class PacketSender: public CxxUtilities::Thread {
+private:
+	SpaceWireSSDTPModule* ssdtp;
+	size_t packetSize;
+	size_t nPackets;
+
+public:
+	PacketSender(SpaceWireSSDTPModule* ssdtp, size_t packetSize, size_t nPackets) :
+			ssdtp(ssdtp), packetSize(packetSize), nPackets(nPackets) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> data(packetSize);
+		for (size_t i = 0; i < packetSize; i++) {
+			data[i] = i;
+		}
+		for (size_t i = 0; i < nPackets; i++) {
+			ssdtp->send(&data);
+		}
+	}
+};
+
+enum {
+	VectorViaReceiveBuffer, VectorDirect, CallerBuffer
+};
+
+std::string toString(int path) {
+	switch (path) {
+	case VectorViaReceiveBuffer:
+		return "vector (copy via receivebuffer)";
+	case VectorDirect:
+		return "vector (direct)";
+	default:
+		return "caller buffer (direct)";
+	}
+}
+
+double measure(SpaceWireSSDTPModule* sender, SpaceWireSSDTPModule* receiver, size_t packetSize, int path) {
+	size_t nPackets = BytesPerMeasurement / packetSize;
+	std::vector<uint8_t> data;
+	uint8_t* buffer = new uint8_t[packetSize];
+	uint32_t eopType;
+	size_t length;
+	if (path == VectorViaReceiveBuffer) {
+		receiver->setReceiveMode(SpaceWireSSDTPModule::CopyViaReceiveBuffer);
+	} else {
+		receiver->setReceiveMode(SpaceWireSSDTPModule::ReceiveDirectlyToCallerBuffer);
+	}
+	PacketSender packetSender(sender, packetSize, nPackets);
+	double start = CxxUtilities::Time::getClockValueInMilliSec();
+	packetSender.start();
+	for (size_t i = 0; i < nPackets; i++) {
+		if (path == CallerBuffer) {
+			receiver->receive(buffer, packetSize, length, eopType);
+		} else {
+			receiver->receive(&data, eopType);
+		}
+	}
+	double elapsed = CxxUtilities::Time::getClockValueInMilliSec() - start;
+	packetSender.waitUntilRunMethodComplets();
+	delete[] buffer;
+	return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	uint32_t portNumber = DefaultPortNumber;
+	if (argc >= 2) {
+		portNumber = String::toInteger(argv[1]);
+	}
+	TCPServerSocket serverSocket(portNumber);
+	serverSocket.open();
+	TCPClientSocket clientSocket("localhost", portNumber);
+	clientSocket.open(1000);
+	TCPSocket* acceptedSocket = serverSocket.accept();
+	SpaceWireSSDTPModule sender(acceptedSocket);
+	SpaceWireSSDTPModule receiver(&clientSocket);
+
+	cout << setw(12) << "PacketSize" << setw(36) << "Path" << setw(12) << "ReadAhead" << setw(12) << "MB/s" << setw(14)
+			<< "Packets/s" << setw(16) << "recv()/packet" << endl;
+	for (size_t i = 0; i < NPacketSizes; i++) {
+		for (int path = VectorViaReceiveBuffer; path <= CallerBuffer; path++) {
+			for (int readAhead = 0; readAhead < 2; readAhead++) {
+				if (readAhead) {
+					receiver.enableReadAhead();
+				} else {
+					receiver.disableReadAhead();
+				}
+				receiver.resetReceiveCounters();
+				double elapsed = measure(&sender, &receiver, PacketSizes[i], path);
+				size_t nPackets = BytesPerMeasurement / PacketSizes[i];
+				cout << setw(12) << PacketSizes[i] << setw(36) << toString(path) << setw(12) << (readAhead ? "on" : "off")
+						<< setw(12) << fixed << setprecision(1) << BytesPerMeasurement / 1024.0 / 1024.0 / (elapsed / 1000.0)
+						<< setw(14) << setprecision(0) << nPackets / (elapsed / 1000.0) << setw(16) << setprecision(2)
+						<< receiver.getNReceiveSystemCallsPerPacket() << endl;
+			}
+		}
+	}
+	clientSocket.close();
+	acceptedSocket->close();
+	serverSocket.close();
+}
@@ -0,0 +1,200 @@
+/*
+ * test_SpaceWireSSDTPModule_receiveStreaming.cc
+ *
+ * Checks SpaceWireSSDTPModule::receiveStreaming() over a socketpair.
+ * Packets made of several SSDTP frames are written with pauses longer than
+ * the receive timeout between the frames. Each packet must be passed to the
+ * handler as one sequence of fragments which ends with the EOP/EEP of the
+ * packet, and Timeout must be thrown only while no packet has started.
+ * Then a handler throws in the middle of a packet: receiveStreaming() must
+ * throw FragmentHandlerFailed, and the next packet must be received intact.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+#include <sys/socket.h>
+
+const double ReceiveTimeoutInMilliSec = 20;
+const double PauseBetweenFramesInMilliSec = 100;
+const size_t MaxFragmentSize = 256;
+const size_t FrameSizes[] = { 1000, 0, 700, 500 };
+const size_t NFrames = sizeof(FrameSizes) / sizeof(size_t);
+
+class CollectingHandler: public SpaceWireSSDTPFragmentHandler {
+public:
+	std::vector<uint8_t> packet;
+	size_t nFragments;
+	size_t nLastFragments;
+	uint32_t eopType;
+	bool fragmentTooLarge;
+
+public:
+	CollectingHandler() {
+		clear();
+	}
+
+public:
+	void onFragment(uint8_t* data, size_t length, bool isLastFragment, uint32_t eopType) {
+		packet.insert(packet.end(), data, data + length);
+		nFragments++;
+		fragmentTooLarge |= (MaxFragmentSize < length);
+		if (isLastFragment) {
+			nLastFragments++;
+			this->eopType = eopType;
+		}
+	}
+
+	void clear() {
+		packet.clear();
+		nFragments = 0;
+		nLastFragments = 0;
+		eopType = SpaceWireEOPMarker::Continued;
+		fragmentTooLarge = false;
+	}
+};
+
+/** Throws on the second fragment. */
+class ThrowingHandler: public SpaceWireSSDTPFragmentHandler {
+public:
+	size_t nFragments;
+
+public:
+	ThrowingHandler() :
+			nFragments(0) {
+	}
+
+public:
+	void onFragment(uint8_t* data, size_t length, bool isLastFragment, uint32_t eopType) {
+		nFragments++;
+		if (nFragments == 2) {
+			throw std::runtime_error("handler failure");
+		}
+	}
+};
+
+/** Writes the frames of a packet with pauses in between. */
+class SlowWriter: public CxxUtilities::Thread {
+private:
+	int socketDescriptor;
+	uint32_t eopType;
+
+public:
+	std::vector<uint8_t> packet;
+
+public:
+	SlowWriter(int socketDescriptor, uint32_t eopType) :
+			socketDescriptor(socketDescriptor), eopType(eopType) {
+	}
+
+public:
+	void run() {
+		uint8_t header[SpaceWireSSDTPProtocol::HeaderSize];
+		for (size_t i = 0; i < NFrames; i++) {
+			sleep(PauseBetweenFramesInMilliSec);
+			std::vector<uint8_t> frame(FrameSizes[i]);
+			for (size_t o = 0; o < frame.size(); o++) {
+				frame[o] = packet.size() + o;
+			}
+			SpaceWireSSDTPEncoder::encodeHeader(header,
+					(i + 1 == NFrames) ? getCompleteFlag() : SpaceWireSSDTPProtocol::DataFlag_Flagmented, frame.size());
+			::send(socketDescriptor, header, sizeof(header), 0);
+			if (frame.size() != 0) {
+				::send(socketDescriptor, &frame[0], frame.size(), 0);
+			}
+			packet.insert(packet.end(), frame.begin(), frame.end());
+		}
+	}
+
+private:
+	uint8_t getCompleteFlag() {
+		return (eopType == SpaceWireEOPMarker::EEP) ?
+				SpaceWireSSDTPProtocol::DataFlag_Complete_EEP : SpaceWireSSDTPProtocol::DataFlag_Complete_EOP;
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	int sockets[2];
+	::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+	SpaceWireSSDTPModule* ssdtp = new SpaceWireSSDTPModule(sockets[0]);
+	ssdtp->setTimeout(ReceiveTimeoutInMilliSec);
+	bool ok = true;
+	uint32_t eopTypes[] = { SpaceWireEOPMarker::EOP, SpaceWireEOPMarker::EEP };
+	for (size_t p = 0; p < 2; p++) {
+		CollectingHandler handler;
+		SlowWriter writer(sockets[1], eopTypes[p]);
+		writer.start();
+		//Timeout is reported while the first frame has not arrived
+		size_t nTimeouts = 0;
+		size_t nTimeoutsAfterFirstFragment = 0;
+		size_t size = 0;
+		uint32_t eopType;
+		while (true) {
+			try {
+				size = ssdtp->receiveStreaming(&handler, eopType, MaxFragmentSize);
+				break;
+			} catch (SpaceWireSSDTPException& e) {
+				if (e.getStatus() != SpaceWireSSDTPException::Timeout) {
+					cerr << "receiveStreaming() failed with " << e.toString() << endl;
+					return -1;
+				}
+				if (handler.nFragments != 0) {
+					nTimeoutsAfterFirstFragment++;
+				}
+				nTimeouts++;
+			}
+		}
+		writer.waitUntilRunMethodComplets();
+		cout << "Packet " << p << ": " << size << " bytes in " << handler.nFragments << " fragments, "
+				<< nTimeouts << " timeouts (" << nTimeoutsAfterFirstFragment << " after the first fragment)" << endl;
+		ok &= (size == writer.packet.size() && handler.packet == writer.packet);
+		ok &= (handler.nLastFragments == 1 && handler.eopType == eopTypes[p] && eopType == eopTypes[p]);
+		ok &= (!handler.fragmentTooLarge && nTimeouts != 0 && nTimeoutsAfterFirstFragment == 0);
+	}
+
+	//a handler which throws
+	vector<uint8_t> stream;
+	uint8_t header[SpaceWireSSDTPProtocol::HeaderSize];
+	vector<uint8_t> failedPacket(MaxFragmentSize * 4, 0xAA), nextPacket(100);
+	for (size_t i = 0; i < nextPacket.size(); i++) {
+		nextPacket[i] = i;
+	}
+	SpaceWireSSDTPEncoder::encodeHeader(header, SpaceWireSSDTPProtocol::DataFlag_Flagmented, failedPacket.size());
+	stream.insert(stream.end(), header, header + sizeof(header));
+	stream.insert(stream.end(), failedPacket.begin(), failedPacket.end());
+	SpaceWireSSDTPEncoder::encodeHeader(header, SpaceWireSSDTPProtocol::DataFlag_Complete_EOP, failedPacket.size());
+	stream.insert(stream.end(), header, header + sizeof(header));
+	stream.insert(stream.end(), failedPacket.begin(), failedPacket.end());
+	SpaceWireSSDTPEncoder::encodeHeader(header, SpaceWireSSDTPProtocol::DataFlag_Complete_EOP, nextPacket.size());
+	stream.insert(stream.end(), header, header + sizeof(header));
+	stream.insert(stream.end(), nextPacket.begin(), nextPacket.end());
+	::send(sockets[1], &stream[0], stream.size(), 0);
+	ThrowingHandler throwingHandler;
+	uint32_t eopType;
+	bool handlerFailureReported = false;
+	try {
+		ssdtp->receiveStreaming(&throwingHandler, eopType, MaxFragmentSize);
+	} catch (SpaceWireSSDTPException& e) {
+		handlerFailureReported = (e.getStatus() == SpaceWireSSDTPException::FragmentHandlerFailed);
+	}
+	CollectingHandler handler;
+	size_t size = 0;
+	try {
+		size = ssdtp->receiveStreaming(&handler, eopType, MaxFragmentSize);
+	} catch (SpaceWireSSDTPException& e) {
+		cerr << "receiveStreaming() after a handler failure failed with " << e.toString() << endl;
+	}
+	cout << "Throwing handler: " << (handlerFailureReported ? "reported" : "not reported") << ", " << size
+			<< " bytes received next" << endl;
+	ok &= (handlerFailureReported && throwingHandler.nFragments == 2);
+	ok &= (size == nextPacket.size() && handler.packet == nextPacket && eopType == SpaceWireEOPMarker::EOP);
+
+	delete ssdtp;
+	::close(sockets[0]);
+	::close(sockets[1]);
+	if (!ok) {
+		cerr << "A packet was not received as a whole" << endl;
+		return -1;
+	}
+}
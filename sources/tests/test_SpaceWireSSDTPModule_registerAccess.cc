@@ -0,0 +1,243 @@
+/*
+ * test_SpaceWireSSDTPModule_registerAccess.cc
+ *
+ * Exercises the SSDTP2 register access path of SpaceWireSSDTPModule over a
+ * socketpair. The other end emulates a bridge: it records the command frames
+ * it receives, and replies are sent by the test in a controlled order while
+ * a receiver thread keeps calling receive() on the module.
+ * Checked are outstanding requests completed out of order, the wake-up
+ * latency of waitRegisterRequest(), a timeout followed by a late reply, and
+ * replies which do not match the outstanding request by type or address.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+#include <sys/socket.h>
+
+const size_t NLatencyMeasurements = 20;
+const double ReplyDelayInMilliSec = 20;
+const double MaximumMeanWakeUpLatencyInMilliSec = 5;
+
+class RegisterCommand {
+public:
+	uint8_t flag;
+	uint32_t address;
+	uint32_t value;
+};
+
+/** Records command frames received by the emulated bridge. */
+class BridgeEmulator: public CxxUtilities::StoppableThread, public SpaceWireSSDTPDecoderListener {
+private:
+	int socketDescriptor;
+	CxxUtilities::Mutex mutex;
+	std::vector<RegisterCommand> commands;
+
+public:
+	BridgeEmulator(int socketDescriptor) :
+			socketDescriptor(socketDescriptor) {
+	}
+
+public:
+	void run() {
+		SpaceWireSSDTPDecoder decoder(this);
+		uint8_t buffer[1024];
+		while (!stopped) {
+			ssize_t result = ::recv(socketDescriptor, buffer, sizeof(buffer), 0);
+			if (result <= 0) {
+				break;
+			}
+			decoder.decode(buffer, result);
+		}
+	}
+
+public:
+	void onData(uint8_t* data, size_t length) {
+	}
+
+	void onPacketEnd(uint32_t eopType) {
+	}
+
+	void onRegisterAccess(uint8_t flag, uint32_t address, uint32_t value) {
+		RegisterCommand command;
+		command.flag = flag;
+		command.address = address;
+		command.value = value;
+		mutex.lock();
+		commands.push_back(command);
+		mutex.unlock();
+	}
+
+public:
+	std::vector<RegisterCommand> getCommands() {
+		mutex.lock();
+		std::vector<RegisterCommand> result = commands;
+		mutex.unlock();
+		return result;
+	}
+
+	void reply(uint8_t flag, uint32_t address, uint32_t value) {
+		uint8_t frame[SpaceWireSSDTPProtocol::HeaderSize + SpaceWireSSDTPProtocol::RegisterReplySize];
+		size_t frameSize = SpaceWireSSDTPEncoder::encodeRegisterFrame(frame, flag, address, value);
+		::send(socketDescriptor, frame, frameSize, 0);
+	}
+};
+
+/** Receives packets so that register replies are processed. */
+class Receiver: public CxxUtilities::StoppableThread {
+private:
+	SpaceWireSSDTPModule* ssdtp;
+
+public:
+	Receiver(SpaceWireSSDTPModule* ssdtp) :
+			ssdtp(ssdtp) {
+	}
+
+public:
+	void run() {
+		std::vector<uint8_t> data;
+		uint32_t eopType;
+		while (!stopped) {
+			try {
+				ssdtp->receive(&data, eopType);
+			} catch (SpaceWireSSDTPException& e) {
+				if (e.getStatus() != SpaceWireSSDTPException::Timeout) {
+					break;
+				}
+			}
+		}
+	}
+};
+
+/** Sends a reply after a delay. */
+class DelayedReply: public CxxUtilities::Thread {
+private:
+	BridgeEmulator* bridge;
+	uint32_t address;
+
+public:
+	double replyTime;
+
+public:
+	DelayedReply(BridgeEmulator* bridge, uint32_t address) :
+			bridge(bridge), address(address), replyTime(0) {
+	}
+
+public:
+	void run() {
+		sleep(ReplyDelayInMilliSec);
+		replyTime = CxxUtilities::Time::getClockValueInMilliSec();
+		bridge->reply(SpaceWireSSDTPProtocol::ControlFlag_RegisterAccess_ReadReply, address, address + 1);
+	}
+};
+
+bool check(const std::string& name, bool condition) {
+	if (!condition) {
+		std::cerr << "Failed: " << name << std::endl;
+	}
+	return condition;
+}
+
+/** Waits until the module has processed a reply for the address. */
+void waitForReplyProcessed(SpaceWireSSDTPModule* ssdtp, uint32_t address, uint32_t value) {
+	uint32_t lastValue;
+	while (!ssdtp->getLastRegisterValue(address, lastValue) || lastValue != value) {
+		CxxUtilities::Condition c;
+		c.wait(1);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	typedef SpaceWireSSDTPProtocol P;
+	int sockets[2];
+	::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+	SpaceWireSSDTPModule* ssdtp = new SpaceWireSSDTPModule(sockets[0]);
+	ssdtp->setTimeout(10);
+	BridgeEmulator bridge(sockets[1]);
+	bridge.start();
+	Receiver receiver(ssdtp);
+	receiver.start();
+	bool ok = true;
+
+	//outstanding requests completed out of order
+	SpaceWireSSDTPRegisterRequest read10, read20, write10;
+	ssdtp->requestRegisterRead(&read10, 0x10);
+	ssdtp->requestRegisterRead(&read20, 0x20);
+	ssdtp->requestRegisterWrite(&write10, 0x10, 0x55);
+	ok &= check("3 outstanding requests", ssdtp->getNOutstandingRegisterRequests() == 3);
+	while (bridge.getCommands().size() != 3) {
+		CxxUtilities::Condition c;
+		c.wait(1);
+	}
+	vector<RegisterCommand> commands = bridge.getCommands();
+	ok &= check("command frames", commands[0].flag == P::ControlFlag_RegisterAccess_ReadCommand
+			&& commands[0].address == 0x10 && commands[1].flag == P::ControlFlag_RegisterAccess_ReadCommand
+			&& commands[1].address == 0x20 && commands[2].flag == P::ControlFlag_RegisterAccess_WriteCommand
+			&& commands[2].address == 0x10 && commands[2].value == 0x55);
+	bridge.reply(P::ControlFlag_RegisterAccess_WriteReply, 0x10, 0x55);
+	ok &= check("write reply completes the write request", ssdtp->waitRegisterRequest(&write10, 1000));
+	ok &= check("write reply does not complete the read request", !read10.isCompleted());
+	bridge.reply(P::ControlFlag_RegisterAccess_ReadReply, 0x20, 0xAA);
+	bridge.reply(P::ControlFlag_RegisterAccess_ReadReply, 0x10, 0x11);
+	ok &= check("read replies", ssdtp->waitRegisterRequest(&read20, 1000) && ssdtp->waitRegisterRequest(&read10, 1000)
+			&& read20.value == 0xAA && read10.value == 0x11);
+	ok &= check("no outstanding request", ssdtp->getNOutstandingRegisterRequests() == 0);
+
+	//wake-up latency
+	double latencySum = 0;
+	for (size_t i = 0; i < NLatencyMeasurements; i++) {
+		SpaceWireSSDTPRegisterRequest request;
+		ssdtp->requestRegisterRead(&request, 0x100 + i);
+		DelayedReply delayedReply(&bridge, 0x100 + i);
+		delayedReply.start();
+		bool completed = ssdtp->waitRegisterRequest(&request, 1000);
+		double wakeUpTime = CxxUtilities::Time::getClockValueInMilliSec();
+		delayedReply.waitUntilRunMethodComplets();
+		ok &= check("delayed reply", completed && request.value == 0x100 + i + 1);
+		latencySum += wakeUpTime - delayedReply.replyTime;
+	}
+	double meanLatency = latencySum / NLatencyMeasurements;
+	cout << "Mean wake-up latency after a reply: " << fixed << setprecision(3) << meanLatency << " ms" << endl;
+	ok &= check("wake-up latency", meanLatency < MaximumMeanWakeUpLatencyInMilliSec);
+
+	//timeout, and a reply which arrives after the request was withdrawn
+	double start = CxxUtilities::Time::getClockValueInMilliSec();
+	bool timedOut = false;
+	try {
+		ssdtp->registerRead(0x30, 50);
+	} catch (SpaceWireSSDTPException& e) {
+		timedOut = (e.getStatus() == SpaceWireSSDTPException::Timeout);
+	}
+	double elapsed = CxxUtilities::Time::getClockValueInMilliSec() - start;
+	ok &= check("timeout", timedOut && 45 <= elapsed && elapsed < 500);
+	ok &= check("timed-out request is withdrawn", ssdtp->getNOutstandingRegisterRequests() == 0);
+	bridge.reply(P::ControlFlag_RegisterAccess_ReadReply, 0x30, 0x33);
+	waitForReplyProcessed(ssdtp, 0x30, 0x33);
+	ok &= check("late reply is ignored", ssdtp->getNOutstandingRegisterRequests() == 0);
+
+	//replies which do not match by type or by address
+	SpaceWireSSDTPRegisterRequest read40;
+	ssdtp->requestRegisterRead(&read40, 0x40);
+	bridge.reply(P::ControlFlag_RegisterAccess_WriteReply, 0x40, 0x01);
+	waitForReplyProcessed(ssdtp, 0x40, 0x01);
+	bridge.reply(P::ControlFlag_RegisterAccess_ReadReply, 0x41, 0x02);
+	waitForReplyProcessed(ssdtp, 0x41, 0x02);
+	ok &= check("mismatched replies do not complete the request", !read40.isCompleted()
+			&& ssdtp->getNOutstandingRegisterRequests() == 1);
+	bridge.reply(P::ControlFlag_RegisterAccess_ReadReply, 0x40, 0x04);
+	ok &= check("matching reply", ssdtp->waitRegisterRequest(&read40, 1000) && read40.value == 0x04);
+
+	receiver.stop();
+	receiver.waitUntilRunMethodComplets();
+	bridge.stop();
+	::shutdown(sockets[1], SHUT_RDWR);
+	bridge.waitUntilRunMethodComplets();
+	delete ssdtp;
+	::close(sockets[0]);
+	::close(sockets[1]);
+	if (!ok) {
+		return -1;
+	}
+	cout << "Register access checks passed" << endl;
+}
@@ -0,0 +1,177 @@
+/*
+ * test_SpaceWireSSDTPModule_sendMany.cc
+ *
+ * Checks SSDTP framing of SpaceWireSSDTPModule::sendMany() over a TCP
+ * connection on localhost. The sending socket has a small send buffer and a
+ * short send timeout, and
+ * the receiving side pauses from time to time, so that gather writes complete
+ * only partially and subsequent writes time out. A batch which times out
+ * is sent again; every packet must then be decoded exactly once, in order,
+ * with its size, content, and EOP marker intact. Finally, a batch larger than
+ * one gather write is sent without a timeout.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+#include <sys/socket.h>
+
+const uint32_t DefaultPortNumber = 10035;
+const size_t NPacketsWithTimeout = 20000;
+const size_t NPacketsPerBatch = 200;
+const size_t NPacketsInLargeBatch = 1000;
+const size_t BytesBetweenPauses = 256 * 1024;
+const double PauseInMilliSec = 10;
+
+size_t getPacketSize(size_t sequenceNumber) {
+	return 4 + sequenceNumber % 1500;
+}
+
+void fillPacket(std::vector<uint8_t>& packet, size_t sequenceNumber) {
+	packet.resize(getPacketSize(sequenceNumber));
+	packet[0] = sequenceNumber >> 24;
+	packet[1] = sequenceNumber >> 16;
+	packet[2] = sequenceNumber >> 8;
+	packet[3] = sequenceNumber;
+	for (size_t i = 4; i < packet.size(); i++) {
+		packet[i] = sequenceNumber + i;
+	}
+}
+
+/** Checks each decoded packet against the expected sequence. */
+class CheckingListener: public SpaceWireSSDTPDecoderListener {
+public:
+	std::vector<uint8_t> packet;
+	size_t nPackets;
+	size_t nErrors;
+
+public:
+	CheckingListener() :
+			nPackets(0), nErrors(0) {
+	}
+
+public:
+	void onData(uint8_t* data, size_t length) {
+		packet.insert(packet.end(), data, data + length);
+	}
+
+	void onPacketEnd(uint32_t eopType) {
+		std::vector<uint8_t> expected;
+		fillPacket(expected, nPackets);
+		uint32_t expectedEOPType = (nPackets < NPacketsWithTimeout) ? SpaceWireEOPMarker::EOP : SpaceWireEOPMarker::EEP;
+		if (packet != expected || eopType != expectedEOPType) {
+			if (nErrors == 0) {
+				std::cerr << "Packet " << nPackets << " is broken (" << packet.size() << " bytes)" << std::endl;
+			}
+			nErrors++;
+		}
+		packet.clear();
+		nPackets++;
+	}
+};
+
+class SlowReader: public CxxUtilities::Thread {
+private:
+	int socketDescriptor;
+	size_t nPacketsToReceive;
+
+public:
+	CheckingListener listener;
+	bool decodingFailed;
+
+public:
+	SlowReader(int socketDescriptor, size_t nPacketsToReceive) :
+			socketDescriptor(socketDescriptor), nPacketsToReceive(nPacketsToReceive), decodingFailed(false) {
+	}
+
+public:
+	void run() {
+		SpaceWireSSDTPDecoder decoder(&listener);
+		uint8_t buffer[4096];
+		size_t bytesSincePause = 0;
+		while (listener.nPackets < nPacketsToReceive && !decoder.hasError()) {
+			ssize_t result = ::recv(socketDescriptor, buffer, sizeof(buffer), 0);
+			if (result <= 0) {
+				break;
+			}
+			decoder.decode(buffer, result);
+			bytesSincePause += result;
+			if (BytesBetweenPauses <= bytesSincePause) {
+				bytesSincePause = 0;
+				sleep(PauseInMilliSec);
+			}
+		}
+		decodingFailed = decoder.hasError();
+	}
+};
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	uint32_t portNumber = DefaultPortNumber;
+	if (argc >= 2) {
+		portNumber = String::toInteger(argv[1]);
+	}
+	TCPServerSocket serverSocket(portNumber);
+	serverSocket.open();
+	TCPClientSocket clientSocket("localhost", portNumber);
+	clientSocket.open(1000);
+	TCPSocket* acceptedSocket = serverSocket.accept();
+	int sendingSocket = acceptedSocket->getSocketDescriptor();
+	int sendBufferSize = 8192;
+	::setsockopt(sendingSocket, SOL_SOCKET, SO_SNDBUF, &sendBufferSize, sizeof(sendBufferSize));
+	struct timeval timeout;
+	timeout.tv_sec = 0;
+	timeout.tv_usec = 1000;
+	::setsockopt(sendingSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	SpaceWireSSDTPModule* ssdtp = new SpaceWireSSDTPModule(acceptedSocket);
+	SlowReader reader(clientSocket.getSocketDescriptor(), NPacketsWithTimeout + NPacketsInLargeBatch);
+	reader.start();
+
+	//batches which fit a single gather write are either sent or not sent
+	vector<vector<uint8_t> > storage(NPacketsInLargeBatch);
+	vector<vector<uint8_t>*> packets;
+	size_t nTimeouts = 0;
+	for (size_t first = 0; first < NPacketsWithTimeout; first += NPacketsPerBatch) {
+		packets.clear();
+		for (size_t i = 0; i < NPacketsPerBatch; i++) {
+			fillPacket(storage[i], first + i);
+			packets.push_back(&storage[i]);
+		}
+		while (true) {
+			try {
+				ssdtp->sendMany(packets);
+				break;
+			} catch (SpaceWireSSDTPException& e) {
+				if (e.getStatus() != SpaceWireSSDTPException::Timeout) {
+					cerr << "sendMany() failed with " << e.toString() << endl;
+					return -1;
+				}
+				nTimeouts++;
+			}
+		}
+	}
+
+	//a batch which is split into multiple gather writes
+	timeout.tv_usec = 0;
+	::setsockopt(sendingSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	packets.clear();
+	for (size_t i = 0; i < NPacketsInLargeBatch; i++) {
+		fillPacket(storage[i], NPacketsWithTimeout + i);
+		packets.push_back(&storage[i]);
+	}
+	ssdtp->sendMany(packets, SpaceWireEOPMarker::EEP);
+
+	reader.waitUntilRunMethodComplets();
+	delete ssdtp;
+	clientSocket.close();
+	acceptedSocket->close();
+	serverSocket.close();
+	cout << reader.listener.nPackets << " packets decoded, " << reader.listener.nErrors << " broken, " << nTimeouts
+			<< " batches resent after a timeout" << endl;
+	if (reader.decodingFailed || reader.listener.nErrors != 0
+			|| reader.listener.nPackets != NPacketsWithTimeout + NPacketsInLargeBatch) {
+		return -1;
+	}
+}
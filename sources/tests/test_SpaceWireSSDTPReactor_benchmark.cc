@@ -0,0 +1,206 @@
+/*
+ * test_SpaceWireSSDTPReactor_benchmark.cc
+ *
+ * Receives packets from many SSDTP links connected via TCP on localhost,
+ * first with one blocking receive thread per link, and then with a single
+ * SpaceWireSSDTPReactor thread. Throughput and CPU time consumed by the
+ * process are compared.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+#include <sys/resource.h>
+
+const uint32_t DefaultPortNumber = 10032;
+const size_t DefaultNLinks = 100;
+const size_t PacketSize = 256;
+const size_t PacketsPerLink = 20000;
+const size_t NSenderThreads = 4;
+
+/** Sends packets to a subset of the links in a round-robin manner. */
+class PacketSender: public CxxUtilities::Thread {
+private:
+	std::vector<SpaceWireSSDTPModule*> links;
+
+public:
+	PacketSender(std::vector<SpaceWireSSDTPModule*>& allLinks, size_t index) {
+		for (size_t i = index; i < allLinks.size(); i += NSenderThreads) {
+			links.push_back(allLinks[i]);
+		}
+	}
+
+public:
+	void run() {
+		uint8_t data[PacketSize];
+		for (size_t i = 0; i < PacketSize; i++) {
+			data[i] = i;
+		}
+		for (size_t n = 0; n < PacketsPerLink; n++) {
+			for (size_t i = 0; i < links.size(); i++) {
+				links[i]->send(data, PacketSize);
+			}
+		}
+	}
+};
+
+/** Receives packets of one link with blocking receive. */
+class PacketReceiver: public CxxUtilities::Thread {
+private:
+	SpaceWireSSDTPModule* ssdtp;
+
+public:
+	PacketReceiver(SpaceWireSSDTPModule* ssdtp) :
+			ssdtp(ssdtp) {
+	}
+
+public:
+	void run() {
+		uint8_t buffer[PacketSize];
+		size_t length;
+		uint32_t eopType;
+		size_t n = 0;
+		while (n < PacketsPerLink) {
+			try {
+				ssdtp->receive(buffer, PacketSize, length, eopType);
+				n++;
+			} catch (SpaceWireSSDTPException& e) {
+				if (e.getStatus() != SpaceWireSSDTPException::Timeout) {
+					return;
+				}
+			}
+		}
+	}
+};
+
+class CountingHandler: public SpaceWireSSDTPReactorHandler {
+public:
+	volatile size_t nReceivedPackets;
+
+public:
+	CountingHandler() :
+			nReceivedPackets(0) {
+	}
+
+public:
+	void onPacket(SpaceWireSSDTPReactorLink* link, uint8_t* data, size_t length, uint32_t eopType) {
+		nReceivedPackets++;
+	}
+};
+
+double getCPUTimeInSec() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+void startSenders(std::vector<SpaceWireSSDTPModule*>& senders, std::vector<PacketSender*>& senderThreads) {
+	for (size_t i = 0; i < NSenderThreads; i++) {
+		senderThreads.push_back(new PacketSender(senders, i));
+		senderThreads.back()->start();
+	}
+}
+
+void waitSenders(std::vector<PacketSender*>& senderThreads) {
+	for (size_t i = 0; i < senderThreads.size(); i++) {
+		senderThreads[i]->waitUntilRunMethodComplets();
+		delete senderThreads[i];
+	}
+	senderThreads.clear();
+}
+
+void printResult(std::string method, size_t nThreads, double elapsed, double cpuTime, size_t nPackets) {
+	using namespace std;
+	cout << setw(20) << method << setw(10) << nThreads << setw(14) << fixed << setprecision(0)
+			<< nPackets / (elapsed / 1000.0) << setw(10) << setprecision(1)
+			<< nPackets * PacketSize / 1024.0 / 1024.0 / (elapsed / 1000.0) << setw(12) << setprecision(2) << cpuTime
+			<< endl;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	uint32_t portNumber = DefaultPortNumber;
+	size_t nLinks = DefaultNLinks;
+	if (argc >= 2) {
+		portNumber = String::toInteger(argv[1]);
+	}
+	if (argc >= 3) {
+		nLinks = String::toInteger(argv[2]);
+	}
+
+	//connect links
+	TCPServerSocket serverSocket(portNumber);
+	serverSocket.open();
+	vector<TCPClientSocket*> clientSockets;
+	vector<TCPSocket*> acceptedSockets;
+	vector<SpaceWireSSDTPModule*> senders;
+	vector<SpaceWireSSDTPModule*> receivers;
+	for (size_t i = 0; i < nLinks; i++) {
+		TCPClientSocket* clientSocket = new TCPClientSocket("localhost", portNumber);
+		clientSocket->open(1000);
+		clientSocket->setTimeout(500);
+		TCPSocket* acceptedSocket = serverSocket.accept();
+		clientSockets.push_back(clientSocket);
+		acceptedSockets.push_back(acceptedSocket);
+		senders.push_back(new SpaceWireSSDTPModule(acceptedSocket));
+		receivers.push_back(new SpaceWireSSDTPModule(clientSocket));
+	}
+	size_t nPackets = nLinks * PacketsPerLink;
+
+	cout << nLinks << " links, " << PacketsPerLink << " packets of " << PacketSize << " bytes per link" << endl;
+	cout << setw(20) << "Method" << setw(10) << "Threads" << setw(14) << "Packets/s" << setw(10) << "MB/s" << setw(12)
+			<< "CPU [s]" << endl;
+
+	//thread per link
+	{
+		vector<PacketSender*> senderThreads;
+		vector<PacketReceiver*> receiverThreads;
+		double cpuStart = getCPUTimeInSec();
+		double start = Time::getClockValueInMilliSec();
+		for (size_t i = 0; i < nLinks; i++) {
+			receiverThreads.push_back(new PacketReceiver(receivers[i]));
+			receiverThreads.back()->start();
+		}
+		startSenders(senders, senderThreads);
+		for (size_t i = 0; i < nLinks; i++) {
+			receiverThreads[i]->waitUntilRunMethodComplets();
+			delete receiverThreads[i];
+		}
+		double elapsed = Time::getClockValueInMilliSec() - start;
+		waitSenders(senderThreads);
+		printResult("thread per link", nLinks, elapsed, getCPUTimeInSec() - cpuStart, nPackets);
+	}
+
+	//reactor
+	{
+		SpaceWireSSDTPReactor reactor;
+		CountingHandler handler;
+		for (size_t i = 0; i < nLinks; i++) {
+			reactor.addLink(receivers[i], &handler);
+		}
+		vector<PacketSender*> senderThreads;
+		double cpuStart = getCPUTimeInSec();
+		double start = Time::getClockValueInMilliSec();
+		reactor.start();
+		startSenders(senders, senderThreads);
+		while (handler.nReceivedPackets < nPackets) {
+			Condition c;
+			c.wait(1);
+		}
+		double elapsed = Time::getClockValueInMilliSec() - start;
+		waitSenders(senderThreads);
+		reactor.stop();
+		reactor.waitUntilRunMethodComplets();
+		printResult("reactor", 1, elapsed, getCPUTimeInSec() - cpuStart, nPackets);
+	}
+
+	for (size_t i = 0; i < nLinks; i++) {
+		delete senders[i];
+		delete receivers[i];
+		clientSockets[i]->close();
+		delete clientSockets[i];
+		acceptedSockets[i]->close();
+	}
+	serverSocket.close();
+}
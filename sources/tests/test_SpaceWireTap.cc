@@ -0,0 +1,185 @@
+/*
+ * test_SpaceWireTap.cc
+ *
+ * Runs RMAP writes over SpaceWireIFOverLoopback, first without a tap, and then
+ * with a SpaceWireTap attached to the initiator side while the engines are running.
+ * The latencies of both runs are printed, and the capture file is checked to
+ * contain every command as a sent packet and every reply as a received packet.
+ * Then a tap with a few short slots and a slow action is attached to
+ * SpaceWireIFOverSharedMemory to check that packets are dropped and counted
+ * (and truncated to the snap length) instead of blocking the sender.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+#include "RMAP.hh"
+
+const char* CaptureFileName = "test_SpaceWireTap.spwcap";
+const char* SharedMemoryName = "/test_SpaceWireTap";
+const uint32_t MemorySize = 1024;
+const size_t DefaultNTransactions = 5000;
+const size_t NPacketsToSlowTap = 2000;
+
+class MemoryAccessAction: public RMAPTargetAccessAction {
+public:
+	std::vector<uint8_t> memory;
+
+public:
+	MemoryAccessAction() :
+			memory(MemorySize) {
+	}
+
+public:
+	void processTransaction(RMAPTransaction* rmapTransaction) throw (RMAPTargetAccessActionException) {
+		RMAPPacket* command = rmapTransaction->commandPacket;
+		command->getData(&memory[command->getAddress()], command->getLength());
+		setReplyWithStatus(rmapTransaction, RMAPReplyStatus::CommandExcecutedSuccessfully);
+	}
+};
+
+/** A tap action which is much slower than the link. */
+class SlowAction: public SpaceWireTapAction {
+public:
+	size_t nPackets;
+
+public:
+	SlowAction() :
+			nPackets(0) {
+	}
+
+public:
+	void doAction(const SpaceWireTapRecord& record) {
+		nPackets++;
+		CxxUtilities::Condition c;
+		c.wait(1);
+	}
+};
+
+/** Returns the mean latency of 4-byte RMAP writes in us. */
+double measure(RMAPInitiator* rmapInitiator, RMAPTargetNode* rmapTargetNode, size_t nTransactions) {
+	uint8_t data[4] = { 0x01, 0x02, 0x03, 0x04 };
+	double start = CxxUtilities::Time::getClockValueInMilliSec();
+	for (size_t n = 0; n < nTransactions; n++) {
+		rmapInitiator->write(rmapTargetNode, (n * 4) % MemorySize, data, 4);
+	}
+	return (CxxUtilities::Time::getClockValueInMilliSec() - start) * 1000.0 / nTransactions;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	using namespace CxxUtilities;
+	size_t nTransactions = DefaultNTransactions;
+	if (argc >= 2) {
+		nTransactions = String::toInteger(argv[1]);
+	}
+	unlink(CaptureFileName);
+
+	SpaceWireIFOverLoopback* initiatorSide;
+	SpaceWireIFOverLoopback* targetSide;
+	SpaceWireIFOverLoopback::createPair(initiatorSide, targetSide);
+	initiatorSide->open();
+	targetSide->open();
+	MemoryAccessAction memoryAccessAction;
+	RMAPAddressRange addressRange(0, MemorySize);
+	RMAPTarget rmapTarget;
+	rmapTarget.addAddressRangeAndAssociatedAction(&addressRange, &memoryAccessAction);
+	RMAPEngine* targetEngine = new RMAPEngine(targetSide);
+	targetEngine->addRMAPTarget(&rmapTarget);
+	targetEngine->start();
+	RMAPEngine* initiatorEngine = new RMAPEngine(initiatorSide);
+	initiatorEngine->start();
+	RMAPInitiator* rmapInitiator = new RMAPInitiator(initiatorEngine);
+	rmapInitiator->setInitiatorLogicalAddress(0xFE);
+	RMAPTargetNode rmapTargetNode;
+	rmapTargetNode.setTargetLogicalAddress(0xFE);
+	rmapTargetNode.setDefaultKey(0x00);
+	while (!targetEngine->isStarted() || !initiatorEngine->isStarted()) {
+		Condition c;
+		c.wait(1);
+	}
+
+	//without a tap, then with a tap attached to the running interface
+	measure(rmapInitiator, &rmapTargetNode, nTransactions / 10); //warm up
+	double latencyWithoutTap = measure(rmapInitiator, &rmapTargetNode, nTransactions);
+	SpaceWireCaptureWriter writer(CaptureFileName);
+	writer.open();
+	SpaceWireTap* tap = new SpaceWireTap(&writer);
+	tap->start();
+	initiatorSide->setTap(tap);
+	double latencyWithTap = measure(rmapInitiator, &rmapTargetNode, nTransactions);
+	initiatorSide->setTap(NULL);
+	tap->stop();
+	tap->waitUntilRunMethodComplets();
+	writer.close();
+	SpaceWireTapStatistics statistics = tap->getStatistics();
+	delete tap;
+	cout << "4-byte RMAP write latency: " << fixed << setprecision(2) << latencyWithoutTap << " us without a tap, "
+			<< latencyWithTap << " us with a tap" << endl;
+	cout << "Tap: " << statistics.toString() << endl;
+
+	initiatorEngine->stop();
+	targetEngine->stop();
+	initiatorSide->close();
+	targetSide->close();
+	delete rmapInitiator;
+	delete initiatorEngine;
+	delete targetEngine;
+	delete initiatorSide;
+	delete targetSide;
+
+	if (statistics.nTapped + statistics.nDropped != 2 * nTransactions || statistics.nWritten != statistics.nTapped) {
+		cerr << "Not all the packets were accounted for." << endl;
+		return -1;
+	}
+	SpaceWireCaptureReader reader(CaptureFileName);
+	reader.open();
+	SpaceWireCaptureRecord record;
+	size_t nSent = 0, nReceived = 0;
+	while (reader.next(record)) {
+		//byte 2 is the instruction field (command bit 0x40)
+		bool isCommand = (2 < record.length) && ((record.data[2] & 0x40) != 0);
+		if (record.isSent() != isCommand) {
+			cerr << "A record has a wrong direction." << endl;
+			return -1;
+		}
+		record.isSent() ? nSent++ : nReceived++;
+	}
+	reader.close();
+	unlink(CaptureFileName);
+	cout << "Capture file: " << nSent << " sent, " << nReceived << " received" << endl;
+	if (nSent + nReceived != statistics.nWritten) {
+		return -1;
+	}
+
+	//a full ring drops packets instead of blocking
+	SpaceWireIFOverSharedMemory server(SharedMemoryName, SpaceWireIFOverSharedMemory::ServerMode);
+	SpaceWireIFOverSharedMemory client(SharedMemoryName, SpaceWireIFOverSharedMemory::ClientMode);
+	server.open();
+	client.open();
+	SlowAction slowAction;
+	SpaceWireTap* slowTap = new SpaceWireTap(&slowAction, 4, 16);
+	slowTap->start();
+	client.setTap(slowTap);
+	server.setTap(slowTap);
+	vector<uint8_t> packet(64), receivedPacket;
+	double start = Time::getClockValueInMilliSec();
+	for (size_t i = 0; i < NPacketsToSlowTap; i++) {
+		client.send(packet);
+		server.receive(&receivedPacket);
+	}
+	double elapsed = Time::getClockValueInMilliSec() - start;
+	client.setTap(NULL);
+	server.setTap(NULL);
+	slowTap->stop();
+	slowTap->waitUntilRunMethodComplets();
+	statistics = slowTap->getStatistics();
+	delete slowTap;
+	client.close();
+	server.close();
+	cout << "Slow tap: " << statistics.toString() << " (" << setprecision(1) << elapsed << " ms for "
+			<< NPacketsToSlowTap << " packets)" << endl;
+	if (statistics.nTapped + statistics.nDropped != 2 * NPacketsToSlowTap || statistics.nDropped == 0
+			|| statistics.nTruncated != statistics.nTapped || slowAction.nPackets != statistics.nTapped) {
+		return -1;
+	}
+}
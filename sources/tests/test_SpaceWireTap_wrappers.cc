@@ -0,0 +1,195 @@
+/*
+ * test_SpaceWireTap_wrappers.cc
+ *
+ * Attaches a SpaceWireTap to SpaceWireIFs which wrap other interfaces
+ * (SpaceWireIFLinkRateEmulator, SpaceWireIFFaultInjector, virtual
+ * SpaceWireIFs of SpaceWireIFMultiplexer, SpaceWireIFLinkBonding) and to
+ * SpaceWireIFOverCaptureFile, sends packets via one of them and receives them
+ * via another. The tap must see every packet as sent by the sending interface
+ * and as received by the receiving one. The fault injector duplicates every
+ * sent packet, and its tap must see the duplicates.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+const char* CaptureFileName = "/tmp/test_SpaceWireTap_wrappers.spwcap";
+const size_t NPackets = 1000;
+const size_t PacketSize = 64;
+const uint8_t LogicalAddress = 0xFE;
+const uint8_t ProtocolID = 0xF0;
+
+/** Counts tapped packets per interface and direction. */
+class CountingAction: public SpaceWireTapAction {
+public:
+	CxxUtilities::Mutex mutex;
+	std::map<SpaceWireIF*, size_t> nSent;
+	std::map<SpaceWireIF*, size_t> nReceived;
+
+public:
+	void doAction(const SpaceWireTapRecord& record) {
+		mutex.lock();
+		if (record.isSent()) {
+			nSent[record.spwif]++;
+		} else {
+			nReceived[record.spwif]++;
+		}
+		mutex.unlock();
+	}
+};
+
+/** Sends packets via sender and receives them via receiver with a tap attached to both,
+ * and checks the number of tapped packets.
+ */
+bool checkTap(const std::string& name, SpaceWireIF* sender, SpaceWireIF* receiver, size_t nSentPerPacket = 1) {
+	using namespace std;
+	CountingAction action;
+	SpaceWireTap* tap = new SpaceWireTap(&action, NPackets * 4);
+	tap->start();
+	sender->setTap(tap);
+	receiver->setTap(tap);
+	vector<uint8_t> packet(PacketSize), buffer;
+	packet[0] = LogicalAddress;
+	packet[1] = ProtocolID;
+	size_t nReceived = 0;
+	try {
+		for (size_t i = 0; i < NPackets; i++) {
+			sender->send(packet);
+			for (size_t n = 0; n < nSentPerPacket; n++) {
+				receiver->receive(&buffer);
+				nReceived++;
+			}
+		}
+	} catch (SpaceWireIFException& e) {
+		cerr << name << ": " << e.toString() << endl;
+	}
+	sender->setTap(NULL);
+	receiver->setTap(NULL);
+	tap->stop();
+	tap->waitUntilRunMethodComplets();
+	SpaceWireTapStatistics statistics = tap->getStatistics();
+	delete tap;
+	cout << setw(20) << name << ": " << action.nSent[sender] << " sent, " << action.nReceived[receiver]
+			<< " received (" << statistics.toString() << ")" << endl;
+	return nReceived == NPackets * nSentPerPacket && action.nSent[sender] == NPackets * nSentPerPacket
+			&& action.nReceived[receiver] == nReceived && statistics.nDropped == 0;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	bool ok = true;
+	cout << "Tapped packets (" << NPackets << " packets sent)" << endl;
+
+	//SpaceWireIFLinkRateEmulator
+	{
+		SpaceWireIFOverLoopback* end1;
+		SpaceWireIFOverLoopback* end2;
+		SpaceWireIFOverLoopback::createPair(end1, end2);
+		SpaceWireIFLinkRateEmulator* sender = new SpaceWireIFLinkRateEmulator(end1, 1000);
+		SpaceWireIFLinkRateEmulator* receiver = new SpaceWireIFLinkRateEmulator(end2, 1000);
+		sender->open();
+		receiver->open();
+		ok &= checkTap("LinkRateEmulator", sender, receiver);
+		sender->close();
+		receiver->close();
+		delete sender;
+		delete receiver;
+		delete end1;
+		delete end2;
+	}
+
+	//SpaceWireIFFaultInjector which duplicates every sent packet
+	{
+		SpaceWireIFOverLoopback* end1;
+		SpaceWireIFOverLoopback* end2;
+		SpaceWireIFOverLoopback::createPair(end1, end2);
+		SpaceWireIFFaultInjector* sender = new SpaceWireIFFaultInjector(end1);
+		SpaceWireIFFaultInjector* receiver = new SpaceWireIFFaultInjector(end2);
+		SpaceWireIFFaultModel faults;
+		faults.duplicationProbability = 1;
+		sender->setTxFaultModel(faults);
+		sender->open();
+		receiver->open();
+		ok &= checkTap("FaultInjector", sender, receiver, 2);
+		sender->close();
+		receiver->close();
+		delete sender;
+		delete receiver;
+		delete end1;
+		delete end2;
+	}
+
+	//virtual SpaceWireIFs of SpaceWireIFMultiplexer
+	{
+		SpaceWireIFOverLoopback* end1;
+		SpaceWireIFOverLoopback* end2;
+		SpaceWireIFOverLoopback::createPair(end1, end2);
+		SpaceWireIFMultiplexer* multiplexer1 = new SpaceWireIFMultiplexer(end1);
+		SpaceWireIFMultiplexer* multiplexer2 = new SpaceWireIFMultiplexer(end2);
+		SpaceWireIFMultiplexedIF* sender = multiplexer1->createVirtualSpaceWireIF(vector<uint8_t>(1, ProtocolID));
+		SpaceWireIFMultiplexedIF* receiver = multiplexer2->createVirtualSpaceWireIF(vector<uint8_t>(1, ProtocolID));
+		multiplexer1->open();
+		multiplexer2->open();
+		sender->open();
+		receiver->open();
+		ok &= checkTap("MultiplexedIF", sender, receiver);
+		multiplexer1->close();
+		multiplexer2->close();
+		delete multiplexer1;
+		delete multiplexer2;
+		delete end1;
+		delete end2;
+	}
+
+	//SpaceWireIFLinkBonding of two links
+	{
+		vector<SpaceWireIFOverLoopback*> loopbacks;
+		SpaceWireIFLinkBonding* sender = new SpaceWireIFLinkBonding;
+		SpaceWireIFLinkBonding* receiver = new SpaceWireIFLinkBonding;
+		for (size_t i = 0; i < 2; i++) {
+			SpaceWireIFOverLoopback* end1;
+			SpaceWireIFOverLoopback* end2;
+			SpaceWireIFOverLoopback::createPair(end1, end2);
+			sender->addLink(end1);
+			receiver->addLink(end2);
+			loopbacks.push_back(end1);
+			loopbacks.push_back(end2);
+		}
+		sender->setPolicy(SpaceWireIFLinkBonding::RoundRobin);
+		sender->open();
+		receiver->open();
+		receiver->setTimeoutDuration(2000000);
+		ok &= checkTap("LinkBonding", sender, receiver);
+		sender->close();
+		receiver->close();
+		delete sender;
+		delete receiver;
+		for (size_t i = 0; i < loopbacks.size(); i++) {
+			delete loopbacks[i];
+		}
+	}
+
+	//SpaceWireIFOverCaptureFile (sends are discarded, recorded packets are replayed)
+	{
+		unlink(CaptureFileName);
+		{
+			SpaceWireCaptureWriter writer(CaptureFileName);
+			writer.open();
+			vector<uint8_t> packet(PacketSize);
+			for (size_t i = 0; i < NPackets; i++) {
+				writer.writePacket(&packet[0], packet.size(), SpaceWireEOPMarker::EOP, SpaceWireReceiveTimestamp());
+			}
+		}
+		SpaceWireIFOverCaptureFile* replay = new SpaceWireIFOverCaptureFile(CaptureFileName,
+				SpaceWireIFOverCaptureFile::AsFastAsPossible);
+		replay->open();
+		ok &= checkTap("OverCaptureFile", replay, replay);
+		replay->close();
+		delete replay;
+		unlink(CaptureFileName);
+	}
+
+	if (!ok) {
+		return -1;
+	}
+}
@@ -0,0 +1,124 @@
+/*
+ * test_SpaceWireTimecodeDispatcher.cc
+ *
+ * Checks that SpaceWireTimecodeDispatcher delivers TimeCodes to the target
+ * action in arrival order. First, a burst which fits the queue is recorded
+ * while the dispatcher is running, and must be delivered without loss.
+ * Then TimeCodes are recorded faster than a slow target handles them: some
+ * are dropped, but the delivered ones must keep their order and every
+ * TimeCode must be counted as either dispatched or dropped.
+ * Finally, a dispatcher stopped right after start() must terminate.
+ */
+
+#include "CxxUtilities/CxxUtilities.hh"
+#include "SpaceWire.hh"
+
+const size_t NTimecodesInBurst = 4096;
+const size_t NTimecodesToSlowTarget = 2000;
+const size_t SmallQueueCapacity = 16;
+
+/** Records delivered TimeCodes. The position in the recorded sequence is
+ * encoded in the TimeCode value modulo 64.
+ */
+class RecordingAction: public SpaceWireIFActionTimecodeScynchronizedAction {
+public:
+	std::vector<uint8_t> timecodes;
+	double delayInMilliSec;
+
+public:
+	RecordingAction(double delayInMilliSec = 0) :
+			delayInMilliSec(delayInMilliSec) {
+	}
+
+public:
+	void doAction(unsigned char timecode) {
+		timecodes.push_back(timecode);
+		if (delayInMilliSec != 0) {
+			CxxUtilities::Condition c;
+			c.wait(delayInMilliSec);
+		}
+	}
+};
+
+void waitUntilDispatched(SpaceWireTimecodeDispatcher* dispatcher) {
+	while (true) {
+		SpaceWireTimecodeStatistics statistics = dispatcher->getStatistics();
+		if (statistics.nDispatched + statistics.nDropped == statistics.nReceived) {
+			return;
+		}
+		CxxUtilities::Condition c;
+		c.wait(1);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std;
+	bool ok = true;
+
+	//a burst which fits the queue
+	RecordingAction action;
+	SpaceWireTimecodeDispatcher* dispatcher = new SpaceWireTimecodeDispatcher(&action, NTimecodesInBurst);
+	dispatcher->start();
+	for (size_t i = 0; i < NTimecodesInBurst; i++) {
+		dispatcher->doAction(i % 64);
+	}
+	waitUntilDispatched(dispatcher);
+	dispatcher->stop();
+	dispatcher->waitUntilRunMethodComplets();
+	SpaceWireTimecodeStatistics statistics = dispatcher->getStatistics();
+	delete dispatcher;
+	size_t nOutOfOrder = 0;
+	for (size_t i = 0; i < action.timecodes.size(); i++) {
+		if (action.timecodes[i] != i % 64) {
+			nOutOfOrder++;
+		}
+	}
+	cout << "Burst: " << action.timecodes.size() << " delivered, " << nOutOfOrder << " out of order, "
+			<< statistics.nDropped << " dropped" << endl;
+	ok &= (action.timecodes.size() == NTimecodesInBurst && nOutOfOrder == 0 && statistics.nDropped == 0);
+
+	//a slow target behind a small queue; with this pacing, 64 TimeCodes in a row are dropped only
+	//if the dispatcher stalls for milliseconds, so a step of 0 (mod 64) means a duplicate or a reordering
+	RecordingAction slowAction(0.1);
+	dispatcher = new SpaceWireTimecodeDispatcher(&slowAction, SmallQueueCapacity);
+	dispatcher->start();
+	for (size_t i = 0; i < NTimecodesToSlowTarget; i++) {
+		dispatcher->doAction(i % 64);
+		if (i % 8 == 0) {
+			CxxUtilities::Condition c;
+			c.wait(0.1);
+		}
+	}
+	waitUntilDispatched(dispatcher);
+	dispatcher->stop();
+	dispatcher->waitUntilRunMethodComplets();
+	statistics = dispatcher->getStatistics();
+	delete dispatcher;
+	size_t nSkipped = 0;
+	nOutOfOrder = 0;
+	for (size_t i = 1; i < slowAction.timecodes.size(); i++) {
+		size_t step = (slowAction.timecodes[i] + 64 - slowAction.timecodes[i - 1]) % 64;
+		if (step == 0) {
+			nOutOfOrder++;
+		} else {
+			nSkipped += step - 1;
+		}
+	}
+	size_t nDelivered = slowAction.timecodes.size();
+	cout << "Slow target: " << nDelivered << " delivered, " << statistics.nDropped << " dropped, " << nOutOfOrder
+			<< " out of order" << endl;
+	ok &= (statistics.nReceived == NTimecodesToSlowTarget && statistics.nDispatched == nDelivered
+			&& nDelivered + statistics.nDropped == NTimecodesToSlowTarget && nOutOfOrder == 0);
+	ok &= (nDelivered != 0 && slowAction.timecodes[0] == 0 && nSkipped + nDelivered <= NTimecodesToSlowTarget);
+
+	//stop() issued before the thread starts running
+	dispatcher = new SpaceWireTimecodeDispatcher(&action);
+	dispatcher->start();
+	dispatcher->stop();
+	dispatcher->waitUntilRunMethodComplets();
+	delete dispatcher;
+
+	if (!ok) {
+		return -1;
+	}
+}
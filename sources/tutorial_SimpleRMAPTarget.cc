@@ -116,7 +116,7 @@ public:
 				std::vector<uint8_t>* packet;
 				try {
 					//try to receive SpaceWire packet
-					packet = spwif->receive();
+					packet = spwif->receiveLeased();
 
 					//try to process the received packet as an RMAP Command packet
 					RMAPPacket* replyPacket = createReplyPacketFor(packet);
@@ -134,7 +134,7 @@ public:
 						goto finalize;
 					}
 				}
-				delete packet;
+				spwif->releasePacket(packet);
 			}
 			finalize: //
 			finalizeSpaceWireIF();